@@ -0,0 +1 @@
+#include "../../../src/hed/libs/credential/TrustStore.h"
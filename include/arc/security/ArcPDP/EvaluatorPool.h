@@ -0,0 +1 @@
+#include "../../../../src/hed/libs/security/ArcPDP/EvaluatorPool.h"
@@ -0,0 +1,356 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdlib>
+
+#include <glibmm/timer.h>
+
+#include <arc/FileLock.h>
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/URL.h>
+#include <ldns/ldns.h>
+
+#include "ArcheryResolver.h"
+
+// Nested objects deeper than that are not followed
+#define ARCHERY_MAX_DEPTH (10)
+// Attempts to lock cache file before giving up storing results
+#define ARCHERY_CACHE_LOCK_TRIES (10)
+
+namespace Arc {
+
+  static Logger logger(Logger::getRootLogger(), "ServiceEndpointRetrieverPlugin.ARCHERY");
+
+  // DNS names are case insensitive and may be written with final dot
+  static std::string dns_key(const std::string& name) {
+    std::string key = lower(name);
+    while (!key.empty() && (key[key.length()-1] == '.')) key.resize(key.length()-1);
+    return key;
+  }
+
+  bool ArcheryRecord::IsArcheryType(const std::string& type) {
+    return (type == "org.nordugrid.archery") ||
+           (type == "archery") ||
+           (type == "archery.group") ||
+           (type == "archery.service");
+  }
+
+  bool ArcheryRecord::Parse(const std::string& record) {
+    text = record;
+    url.clear();
+    types.clear();
+    active = true; //missing status treated as 'active'
+    // skip object ID records (not valuable for endpoints retrieving)
+    if (text.substr(0,2) == "o=") return false;
+    // fetch key=value pairs from endpoint record
+    std::size_t space_pos = 0, space_found = 0;
+    while (space_found != std::string::npos) {
+      space_found = text.find_first_of(" ", space_pos);
+      std::string kv = text.substr(space_pos, space_found - space_pos);
+      space_pos = space_found + 1;
+      if (kv.empty()) continue;
+      // check key=value part
+      std::string keyeq = kv.substr(0,2);
+      if (keyeq == "u=") {
+        url = kv.substr(2);
+      } else if (keyeq == "t=") {
+        types.push_back(kv.substr(2));
+      } else if (keyeq == "s=") {
+        if (kv.substr(2) != "1") active = false;
+      } else {
+        logger.msg(WARNING,"Wrong service record field \"%s\" found in the \"%s\"", kv, text);
+      }
+    }
+    // check parsed values
+    if (url.empty()) {
+      logger.msg(WARNING,"Malformed ARCHERY record found (endpoint url is not defined): %s", text);
+      return false;
+    }
+    if (active && types.empty()) {
+      logger.msg(WARNING,"Malformed ARCHERY record found (endpoint type is not defined): %s", text);
+      return false;
+    }
+    return true;
+  }
+
+  std::string ArcheryRecord::Nested() const {
+    if (!active) return "";
+    for (std::vector<std::string>::const_iterator t = types.begin(); t != types.end(); ++t) {
+      if (!IsArcheryType(*t)) continue;
+      if (url.substr(0,6) == "dns://") return url.substr(6);
+      if (url.find("://") == std::string::npos) return "_archery." + url;
+    }
+    return "";
+  }
+
+  ArcheryResolver::ArcheryResolver(const std::string& cache_file, int max_queries):
+      cache_file(cache_file), max_queries(max_queries), nameserver_port(0),
+      max_depth(ARCHERY_MAX_DEPTH), cache_changed(false), busy(0), idle(0),
+      workers(0), counter(NULL), queries(0) {
+    if (this->max_queries < 1) this->max_queries = 1;
+    if (!cache_file.empty()) LoadCache(cache_file, cache);
+  }
+
+  ArcheryResolver::~ArcheryResolver() {
+  }
+
+  void ArcheryResolver::SetNameserver(const std::string& address, int port) {
+    nameserver = address;
+    nameserver_port = port;
+  }
+
+  void ArcheryResolver::SetFilter(bool recursive, const std::list<std::string>& rejected) {
+    max_depth = recursive ? ARCHERY_MAX_DEPTH : 0;
+    this->rejected = rejected;
+  }
+
+  bool ArcheryResolver::Rejected(const ArcheryRecord& record) const {
+    URL url(record.url);
+    for (std::list<std::string>::const_iterator r = rejected.begin(); r != rejected.end(); ++r) {
+      if (url.StringMatches(*r)) return true;
+    }
+    return false;
+  }
+
+  // Called with lock held. Idle workers take new names first.
+  void ArcheryResolver::AddWorkers() {
+    while ((workers < max_queries) && ((int)pending.size() > idle)) {
+      if (!CreateThreadFunction(&Worker, this, counter)) break;
+      ++workers;
+    }
+  }
+
+  // Each line contains name, expiration time and one record
+  void ArcheryResolver::LoadCache(const std::string& fname, std::map<std::string, CacheEntry>& entries) {
+    std::list<std::string> lines;
+    if (!FileRead(fname, lines)) return;
+    time_t now = time(NULL);
+    for (std::list<std::string>::iterator line = lines.begin(); line != lines.end(); ++line) {
+      std::string::size_type name_end = line->find(' ');
+      if (name_end == std::string::npos) continue;
+      std::string::size_type expires_end = line->find(' ', name_end+1);
+      if (expires_end == std::string::npos) continue;
+      time_t expires = 0;
+      if (!stringto(line->substr(name_end+1, expires_end-name_end-1), expires)) continue;
+      if (expires <= now) continue;
+      CacheEntry& entry = entries[line->substr(0, name_end)];
+      if (entry.expires != expires) {
+        // Another generation of records
+        entry.expires = expires;
+        entry.records.clear();
+      }
+      entry.records.push_back(line->substr(expires_end+1));
+    }
+  }
+
+  void ArcheryResolver::SaveCache() {
+    if (cache_file.empty() || !cache_changed) return;
+    FileLock flock(cache_file);
+    int tries = ARCHERY_CACHE_LOCK_TRIES;
+    while (!flock.acquire()) {
+      if (--tries <= 0) {
+        logger.msg(VERBOSE, "Failed to lock ARCHERY cache %s", cache_file);
+        return;
+      }
+      Glib::usleep(100000);
+    }
+    // Merge with records stored by other processes meanwhile
+    std::map<std::string, CacheEntry> entries;
+    LoadCache(cache_file, entries);
+    time_t now = time(NULL);
+    for (std::map<std::string, CacheEntry>::iterator c = cache.begin(); c != cache.end(); ++c) {
+      if (c->second.expires <= now) continue;
+      CacheEntry& entry = entries[c->first];
+      if (entry.expires < c->second.expires) entry = c->second;
+    }
+    std::string data;
+    for (std::map<std::string, CacheEntry>::iterator e = entries.begin(); e != entries.end(); ++e) {
+      for (std::list<std::string>::iterator r = e->second.records.begin(); r != e->second.records.end(); ++r) {
+        data += e->first + " " + tostring(e->second.expires) + " " + *r + "\n";
+      }
+    }
+    if (!FileCreate(cache_file, data)) {
+      logger.msg(VERBOSE, "Failed to store ARCHERY cache %s", cache_file);
+    }
+    flock.release();
+    cache_changed = false;
+  }
+
+  bool ArcheryResolver::Query(const std::string& name, std::list<std::string>& records) {
+    ldns_resolver *res = NULL;
+    if (nameserver.empty()) {
+      // create a new resolver from /etc/resolv.conf
+      if (ldns_resolver_new_frm_file(&res, NULL) != LDNS_STATUS_OK) {
+        logger.msg(DEBUG,"Cannot create resolver from /etc/resolv.conf");
+        return false;
+      }
+    } else {
+      res = ldns_resolver_new();
+      ldns_rdf *ns = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_A, nameserver.c_str());
+      if (!ns) ns = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_AAAA, nameserver.c_str());
+      if (!res || !ns || (ldns_resolver_push_nameserver(res, ns) != LDNS_STATUS_OK)) {
+        logger.msg(DEBUG,"Cannot use nameserver %s", nameserver);
+        if (ns) ldns_rdf_deep_free(ns);
+        if (res) ldns_resolver_deep_free(res);
+        return false;
+      }
+      ldns_rdf_deep_free(ns);
+      ldns_resolver_set_port(res, nameserver_port);
+    }
+
+    ldns_rdf *domain = ldns_dname_new_frm_str(name.c_str());
+    if (!domain) {
+      logger.msg(DEBUG,"Cannot initialize ARCHERY domain name for query");
+      ldns_resolver_deep_free(res);
+      return false;
+    }
+    // query TXT records
+    {
+      Glib::Mutex::Lock lock_(lock);
+      ++queries;
+    }
+    ldns_pkt *pkt = ldns_resolver_query(res,domain,LDNS_RR_TYPE_TXT,LDNS_RR_CLASS_IN,LDNS_RD);
+    ldns_rdf_deep_free(domain);
+    ldns_resolver_deep_free(res);
+    if (!pkt) {
+      logger.msg(DEBUG,"Cannot query service endpoint TXT records from DNS");
+      return false;
+    }
+    ldns_rr_list *txt = ldns_pkt_rr_list_by_type(pkt,LDNS_RR_TYPE_TXT,LDNS_SECTION_ANSWER);
+    if (!txt) {
+      logger.msg(DEBUG,"Cannot parse service endpoint TXT records.");
+      ldns_pkt_free(pkt);
+      return false;
+    }
+
+    // Records are processed in reverse sorted order
+    ldns_rr_list_sort(txt);
+    uint32_t ttl = 0;
+    for (size_t n = ldns_rr_list_rr_count(txt); n > 0; --n) {
+      ldns_rr *txtrr = ldns_rr_list_rr(txt, n-1);
+      if ((n == ldns_rr_list_rr_count(txt)) || (ldns_rr_ttl(txtrr) < ttl)) ttl = ldns_rr_ttl(txtrr);
+      char *txtstr = ldns_rdf2str(ldns_rr_rdf(txtrr,0));
+      if (!txtstr) continue;
+      std::string record(txtstr);
+      free(txtstr);
+      // start with trimming whitespaces and qoutes
+      record = trim(record, " \"\t\n");
+      if (!record.empty()) records.push_back(record);
+    }
+    ldns_rr_list_deep_free(txt);
+    ldns_pkt_free(pkt);
+
+    if ((ttl > 0) && !cache_file.empty()) {
+      Glib::Mutex::Lock lock_(lock);
+      CacheEntry& entry = cache[dns_key(name)];
+      entry.expires = time(NULL) + ttl;
+      entry.records = records;
+      cache_changed = true;
+    }
+    return true;
+  }
+
+  bool ArcheryResolver::Resolve(const std::string& name, std::list<std::string>& records) {
+    {
+      Glib::Mutex::Lock lock_(lock);
+      std::map<std::string, CacheEntry>::iterator entry = cache.find(name);
+      if ((entry != cache.end()) && (entry->second.expires > time(NULL))) {
+        logger.msg(DEBUG, "Using cached ARCHERY records of %s", name);
+        records = entry->second.records;
+        return true;
+      }
+    }
+    return Query(name, records);
+  }
+
+  // Takes names from queue till nothing left to resolve
+  void ArcheryResolver::Worker(void* arg) {
+    ArcheryResolver& it = *((ArcheryResolver*)arg);
+    Glib::Mutex::Lock lock_(it.lock);
+    for (;;) {
+      if (it.pending.empty()) {
+        if (it.busy == 0) break;
+        ++(it.idle);
+        it.cond.wait(it.lock);
+        --(it.idle);
+        continue;
+      }
+      std::string name = it.pending.front();
+      it.pending.pop_front();
+      int depth = it.lookups[name].depth;
+      ++(it.busy);
+      lock_.release();
+      std::list<std::string> texts;
+      bool ok = it.Resolve(name, texts);
+      std::list<ArcheryRecord> records;
+      for (std::list<std::string>::iterator text = texts.begin(); text != texts.end(); ++text) {
+        ArcheryRecord record;
+        if (record.Parse(*text)) records.push_back(record);
+      }
+      lock_.acquire();
+      Lookup& lookup = it.lookups[name];
+      lookup.ok = ok;
+      lookup.records = records;
+      if (depth < it.max_depth) {
+        for (std::list<ArcheryRecord>::iterator r = records.begin(); r != records.end(); ++r) {
+          std::string nested = dns_key(r->Nested());
+          if (nested.empty() || (it.lookups.find(nested) != it.lookups.end())) continue;
+          if (it.Rejected(*r)) {
+            logger.msg(VERBOSE, "Skipping rejected ARCHERY object %s", r->url);
+            continue;
+          }
+          it.lookups[nested].depth = depth + 1;
+          it.pending.push_back(nested);
+        }
+        it.AddWorkers();
+      }
+      --(it.busy);
+      it.cond.broadcast();
+    }
+  }
+
+  void ArcheryResolver::Collect(const std::string& name, std::set<std::string>& visited, std::list<ArcheryRecord>& records) {
+    visited.insert(name);
+    std::list<ArcheryRecord>& found = lookups[name].records;
+    for (std::list<ArcheryRecord>::iterator r = found.begin(); r != found.end(); ++r) {
+      std::string nested = dns_key(r->Nested());
+      if (!nested.empty()) {
+        std::map<std::string, Lookup>::iterator lookup = lookups.find(nested);
+        if ((lookup != lookups.end()) && lookup->second.ok) {
+          // Replace reference with content of nested object, but only once
+          if (visited.find(nested) == visited.end()) Collect(nested, visited, records);
+          continue;
+        }
+      }
+      records.push_back(*r);
+    }
+  }
+
+  bool ArcheryResolver::Discover(const std::string& name, std::list<ArcheryRecord>& records) {
+    std::string root = dns_key(name);
+    lookups.clear();
+    pending.clear();
+    lookups[root];
+    pending.push_back(root);
+    // Current thread is first worker, more are added when nested objects are found
+    SimpleCounter threads;
+    counter = &threads;
+    workers = 1;
+    idle = 0;
+    Worker(this);
+    threads.wait();
+    counter = NULL;
+    SaveCache();
+    if (!lookups[root].ok) return false;
+    std::set<std::string> visited;
+    Collect(root, visited, records);
+    logger.msg(VERBOSE, "Resolved %u ARCHERY objects of %s with %u DNS queries",
+               (unsigned int)lookups.size(), name, queries);
+    return true;
+  }
+
+} // namespace Arc
@@ -0,0 +1,109 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARC_ARCHERYRESOLVER_H__
+#define __ARC_ARCHERYRESOLVER_H__
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <glibmm/thread.h>
+
+namespace Arc {
+
+class SimpleCounter;
+
+/// Endpoint record published in ARCHERY
+class ArcheryRecord {
+public:
+  std::string text;                // record as published
+  std::string url;                 // u=
+  std::vector<std::string> types;  // t=
+  bool active;                     // s=
+  ArcheryRecord(): active(true) {}
+  /// Parses TXT record. Returns false for records not describing endpoints.
+  bool Parse(const std::string& record);
+  /// Returns DNS name of nested ARCHERY object or empty string.
+  std::string Nested() const;
+  /// Checks if type refers to ARCHERY object
+  static bool IsArcheryType(const std::string& type);
+};
+
+/// Resolves ARCHERY tree stored in DNS TXT records.
+/** Nested groups and services are resolved concurrently with limited
+    number of outstanding queries. Worker threads are started only while
+    there are more names waiting than idle workers. Results are cached in file which is
+    shared by all client processes of user. Cached records are used till
+    their TTL expires. */
+class ArcheryResolver {
+public:
+  /// Creates resolver using cache in specified file. Empty name disables cache.
+  ArcheryResolver(const std::string& cache_file, int max_queries);
+  ~ArcheryResolver();
+  /// Sends queries to specified server instead of those in /etc/resolv.conf
+  void SetNameserver(const std::string& address, int port);
+  /// Restricts which nested objects are resolved.
+  /** If recursive is false only the specified name is resolved. Nested
+      objects with URL matching any of rejected patterns (same matching as
+      URL::StringMatches) are not queried and are returned as references. */
+  void SetFilter(bool recursive, const std::list<std::string>& rejected);
+  /// Collects records of specified name and of all nested objects.
+  /** Records referring to nested objects which were resolved are replaced
+      by records of those objects. Returns false if name itself can't be
+      resolved. */
+  bool Discover(const std::string& name, std::list<ArcheryRecord>& records);
+  /// Number of queries sent to DNS by this object
+  unsigned int Queries() const { return queries; }
+  /// Number of threads which were resolving names during last Discover()
+  int Workers() const { return workers; }
+
+private:
+  class CacheEntry {
+  public:
+    time_t expires;
+    std::list<std::string> records;
+    CacheEntry(): expires(0) {}
+  };
+  class Lookup {
+  public:
+    bool ok;
+    int depth;
+    std::list<ArcheryRecord> records;
+    Lookup(): ok(false), depth(0) {}
+  };
+  std::string cache_file;
+  int max_queries;
+  std::string nameserver;
+  int nameserver_port;
+  int max_depth;
+  std::list<std::string> rejected;
+  Glib::Mutex lock;
+  Glib::Cond cond;
+  std::map<std::string, CacheEntry> cache;
+  bool cache_changed;
+  std::map<std::string, Lookup> lookups;
+  std::list<std::string> pending;
+  int busy;
+  int idle;
+  int workers;
+  SimpleCounter* counter;
+  unsigned int queries;
+
+  ArcheryResolver(const ArcheryResolver&);
+  ArcheryResolver& operator=(const ArcheryResolver&);
+  static void LoadCache(const std::string& fname, std::map<std::string, CacheEntry>& entries);
+  void SaveCache();
+  bool Query(const std::string& name, std::list<std::string>& records);
+  bool Resolve(const std::string& name, std::list<std::string>& records);
+  bool Rejected(const ArcheryRecord& record) const;
+  void AddWorkers();
+  void Collect(const std::string& name, std::set<std::string>& visited, std::list<ArcheryRecord>& records);
+  static void Worker(void* arg);
+};
+
+} // namespace Arc
+
+#endif // __ARC_ARCHERYRESOLVER_H__
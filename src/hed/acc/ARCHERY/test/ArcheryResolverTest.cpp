@@ -0,0 +1,277 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <glibmm/miscutils.h>
+#include <ldns/ldns.h>
+
+#include <arc/Thread.h>
+
+#include "../ArcheryResolver.h"
+
+// Answers TXT queries for names of predefined zone on loopback interface
+class TestResponder {
+public:
+  std::map<std::string, std::list<std::string> > zone;
+  int port;
+  TestResponder();
+  ~TestResponder();
+  bool Start();
+  void Stop();
+  unsigned int Queries();
+private:
+  int sock;
+  bool stop;
+  unsigned int queries;
+  Glib::Mutex lock;
+  Arc::SimpleCounter counter;
+  static void Serve(void* arg);
+  void Answer(const uint8_t* buf, size_t len, const struct sockaddr_in& from);
+};
+
+TestResponder::TestResponder(): port(0), sock(-1), stop(false), queries(0) {
+}
+
+TestResponder::~TestResponder() {
+  Stop();
+}
+
+bool TestResponder::Start() {
+  stop = false;
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock == -1) return false;
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) return false;
+  if (getsockname(sock, (struct sockaddr*)&addr, &addrlen) != 0) return false;
+  port = ntohs(addr.sin_port);
+  return Arc::CreateThreadFunction(&Serve, this, &counter);
+}
+
+void TestResponder::Stop() {
+  stop = true;
+  counter.wait();
+  if (sock != -1) close(sock);
+  sock = -1;
+}
+
+unsigned int TestResponder::Queries() {
+  Glib::Mutex::Lock lock_(lock);
+  return queries;
+}
+
+void TestResponder::Serve(void* arg) {
+  TestResponder& it = *((TestResponder*)arg);
+  uint8_t buf[4096];
+  while (!it.stop) {
+    struct pollfd fd;
+    fd.fd = it.sock;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    if (poll(&fd, 1, 100) <= 0) continue;
+    struct sockaddr_in from;
+    socklen_t fromlen = sizeof(from);
+    ssize_t len = recvfrom(it.sock, buf, sizeof(buf), 0, (struct sockaddr*)&from, &fromlen);
+    if (len > 0) it.Answer(buf, len, from);
+  }
+}
+
+void TestResponder::Answer(const uint8_t* buf, size_t len, const struct sockaddr_in& from) {
+  ldns_pkt* query = NULL;
+  if (ldns_wire2pkt(&query, buf, len) != LDNS_STATUS_OK) return;
+  ldns_rr* question = ldns_rr_list_rr(ldns_pkt_question(query), 0);
+  if (!question) {
+    ldns_pkt_free(query);
+    return;
+  }
+  {
+    Glib::Mutex::Lock lock_(lock);
+    ++queries;
+  }
+  char* qname = ldns_rdf2str(ldns_rr_owner(question));
+  std::string name(qname);
+  free(qname);
+  ldns_pkt* answer = ldns_pkt_new();
+  ldns_pkt_set_id(answer, ldns_pkt_id(query));
+  ldns_pkt_set_qr(answer, true);
+  ldns_pkt_set_aa(answer, true);
+  ldns_pkt_set_rd(answer, ldns_pkt_rd(query));
+  ldns_pkt_push_rr(answer, LDNS_SECTION_QUESTION, ldns_rr_clone(question));
+  std::map<std::string, std::list<std::string> >::iterator records = zone.find(name);
+  if (records == zone.end()) {
+    ldns_pkt_set_rcode(answer, LDNS_RCODE_NXDOMAIN);
+  } else {
+    for (std::list<std::string>::iterator r = records->second.begin(); r != records->second.end(); ++r) {
+      ldns_rr* rr = NULL;
+      std::string text = name + " 300 IN TXT \"" + *r + "\"";
+      if (ldns_rr_new_frm_str(&rr, text.c_str(), 0, NULL, NULL) == LDNS_STATUS_OK) {
+        ldns_pkt_push_rr(answer, LDNS_SECTION_ANSWER, rr);
+      }
+    }
+  }
+  uint8_t* wire = NULL;
+  size_t size = 0;
+  if (ldns_pkt2wire(&wire, answer, &size) == LDNS_STATUS_OK) {
+    sendto(sock, wire, size, 0, (const struct sockaddr*)&from, sizeof(from));
+    free(wire);
+  }
+  ldns_pkt_free(answer);
+  ldns_pkt_free(query);
+}
+
+class ArcheryResolverTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ArcheryResolverTest);
+  CPPUNIT_TEST(TestDiscover);
+  CPPUNIT_TEST(TestCache);
+  CPPUNIT_TEST(TestFailure);
+  CPPUNIT_TEST(TestFilter);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestDiscover();
+  void TestCache();
+  void TestFailure();
+  void TestFilter();
+
+private:
+  TestResponder responder;
+  std::string cache;
+};
+
+void ArcheryResolverTest::setUp() {
+  cache = Glib::get_current_dir() + "/archery.cache";
+  unlink(cache.c_str());
+  std::list<std::string>& root = responder.zone["_archery.test.org."];
+  root.push_back("o=group");
+  root.push_back("u=dns://_archery.a.test.org t=archery.group");
+  root.push_back("u=dns://_archery.b.test.org t=archery.group");
+  root.push_back("u=https://ce0.test.org/arex t=org.nordugrid.arcrest");
+  std::list<std::string>& a = responder.zone["_archery.a.test.org."];
+  a.push_back("u=https://ce1.test.org/arex t=org.nordugrid.arcrest");
+  // Loop must not be followed again
+  a.push_back("u=dns://_archery.test.org t=archery.group");
+  std::list<std::string>& b = responder.zone["_archery.b.test.org."];
+  b.push_back("u=https://ce2.test.org/arex t=org.nordugrid.arcrest s=0");
+  b.push_back("u=ce3.test.org t=archery.service");
+  b.push_back("u=dns://_archery.missing.test.org t=archery.group");
+  std::list<std::string>& c = responder.zone["_archery.ce3.test.org."];
+  c.push_back("u=https://ce3.test.org/arex t=org.nordugrid.arcrest t=org.ogf.glue.emies.activitycreation");
+  CPPUNIT_ASSERT(responder.Start());
+}
+
+void ArcheryResolverTest::tearDown() {
+  responder.Stop();
+  unlink(cache.c_str());
+  unlink((cache + ".lock").c_str());
+}
+
+static std::set<std::string> urls(const std::list<Arc::ArcheryRecord>& records) {
+  std::set<std::string> result;
+  for (std::list<Arc::ArcheryRecord>::const_iterator r = records.begin(); r != records.end(); ++r) {
+    result.insert(r->url);
+  }
+  return result;
+}
+
+void ArcheryResolverTest::TestDiscover() {
+  Arc::ArcheryResolver resolver("", 4);
+  resolver.SetNameserver("127.0.0.1", responder.port);
+  std::list<Arc::ArcheryRecord> records;
+  CPPUNIT_ASSERT(resolver.Discover("_archery.test.org", records));
+  // root, a, b, ce3 and missing group
+  CPPUNIT_ASSERT_EQUAL(5u, resolver.Queries());
+  CPPUNIT_ASSERT_EQUAL(5u, responder.Queries());
+  CPPUNIT_ASSERT_EQUAL(5, (int)records.size());
+  std::set<std::string> found = urls(records);
+  CPPUNIT_ASSERT(found.count("https://ce0.test.org/arex"));
+  CPPUNIT_ASSERT(found.count("https://ce1.test.org/arex"));
+  CPPUNIT_ASSERT(found.count("https://ce2.test.org/arex"));
+  CPPUNIT_ASSERT(found.count("https://ce3.test.org/arex"));
+  // Group which could not be resolved is reported as is
+  CPPUNIT_ASSERT(found.count("dns://_archery.missing.test.org"));
+  for (std::list<Arc::ArcheryRecord>::iterator r = records.begin(); r != records.end(); ++r) {
+    if (r->url == "https://ce2.test.org/arex") CPPUNIT_ASSERT(!r->active);
+    if (r->url == "https://ce3.test.org/arex") CPPUNIT_ASSERT_EQUAL(2, (int)r->types.size());
+  }
+}
+
+void ArcheryResolverTest::TestCache() {
+  std::set<std::string> first;
+  {
+    Arc::ArcheryResolver resolver(cache, 4);
+    resolver.SetNameserver("127.0.0.1", responder.port);
+    std::list<Arc::ArcheryRecord> records;
+    CPPUNIT_ASSERT(resolver.Discover("_archery.test.org.", records));
+    CPPUNIT_ASSERT_EQUAL(5u, resolver.Queries());
+    first = urls(records);
+  }
+  // Another client run uses stored records
+  Arc::ArcheryResolver resolver(cache, 4);
+  resolver.SetNameserver("127.0.0.1", responder.port);
+  std::list<Arc::ArcheryRecord> records;
+  CPPUNIT_ASSERT(resolver.Discover("_ARCHERY.test.org", records));
+  // Only missing group is queried again
+  CPPUNIT_ASSERT_EQUAL(1u, resolver.Queries());
+  CPPUNIT_ASSERT(first == urls(records));
+}
+
+void ArcheryResolverTest::TestFailure() {
+  Arc::ArcheryResolver resolver(cache, 4);
+  resolver.SetNameserver("127.0.0.1", responder.port);
+  std::list<Arc::ArcheryRecord> records;
+  CPPUNIT_ASSERT(!resolver.Discover("_archery.unknown.org", records));
+  CPPUNIT_ASSERT(records.empty());
+}
+
+void ArcheryResolverTest::TestFilter() {
+  {
+    // Without recursion only root is resolved by single thread
+    Arc::ArcheryResolver resolver("", 4);
+    resolver.SetNameserver("127.0.0.1", responder.port);
+    resolver.SetFilter(false, std::list<std::string>());
+    std::list<Arc::ArcheryRecord> records;
+    CPPUNIT_ASSERT(resolver.Discover("_archery.test.org", records));
+    CPPUNIT_ASSERT_EQUAL(1u, resolver.Queries());
+    CPPUNIT_ASSERT_EQUAL(1, resolver.Workers());
+    CPPUNIT_ASSERT_EQUAL(3, (int)records.size());
+  }
+  // Rejected group is not queried and reference to it is returned as is
+  Arc::ArcheryResolver resolver("", 4);
+  resolver.SetNameserver("127.0.0.1", responder.port);
+  std::list<std::string> rejected;
+  rejected.push_back("dns://_archery.b.test.org");
+  resolver.SetFilter(true, rejected);
+  std::list<Arc::ArcheryRecord> records;
+  CPPUNIT_ASSERT(resolver.Discover("_archery.test.org", records));
+  // root and a
+  CPPUNIT_ASSERT_EQUAL(2u, resolver.Queries());
+  CPPUNIT_ASSERT(resolver.Workers() <= 2);
+  std::set<std::string> found = urls(records);
+  CPPUNIT_ASSERT_EQUAL(3, (int)found.size());
+  CPPUNIT_ASSERT(found.count("dns://_archery.b.test.org"));
+  CPPUNIT_ASSERT(!found.count("https://ce2.test.org/arex"));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ArcheryResolverTest);
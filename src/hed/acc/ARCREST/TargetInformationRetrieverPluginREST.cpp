@@ -57,15 +57,17 @@ namespace Arc {
       delete response;
       return Arc::EndpointQueryingStatus(EndpointQueryingStatus::FAILED,"No response");
     }
-    logger.msg(VERBOSE, "CONTENT %u: %s", response->BufferSize(0), std::string(response->Buffer(0),response->BufferSize(0)));
-    Arc::XMLNode servicesQueryResponse(response->Buffer(0),response->BufferSize(0));
+    if(logger.isEnabled(VERBOSE)) {
+      logger.msg(VERBOSE, "CONTENT %u: %s", response->BufferSize(0), std::string(response->Buffer(0),response->BufferSize(0)));
+    }
+    // Response of busy service may be big, so it is parsed without building whole tree
+    bool parsed = GLUE2::ParseExecutionTargets(response->Buffer(0), response->BufferSize(0), csList);
     delete response;
-    if(!servicesQueryResponse) {
+    if(!parsed) {
       logger.msg(VERBOSE, "Response is not XML");
       return Arc::EndpointQueryingStatus(EndpointQueryingStatus::FAILED,"Response is not XML");
     }
 
-    GLUE2::ParseExecutionTargets(servicesQueryResponse["Domains"]["AdminDomain"]["Services"], csList);
     logger.msg(VERBOSE, "Parsed domains: %u",csList.size());
     for(std::list<Arc::ComputingServiceType>::iterator cs = csList.begin(); cs != csList.end(); ++cs) {
       cs->AdminDomain->Name = url.Host();
@@ -44,9 +44,17 @@ static void do_shutdown(void)
     if(loader) delete loader;
     if(main_daemon) delete main_daemon;
     logger.msg(Arc::DEBUG, "exit");
+    Arc::LogFile::FlushAll();
     _exit(exit_code);
 }
 
+static void sigfatal_handler(int sig) {
+    // Save whatever is left in asynchronous log queues and die
+    Arc::LogFile::EmergencyFlushAll();
+    signal(sig,SIG_DFL);
+    raise(sig);
+}
+
 static void sighup_handler(int) {
     int old_errno = errno;
     if(main_daemon) main_daemon->logreopen();
@@ -141,6 +149,19 @@ static bool is_true(Arc::XMLNode val) {
   return false;
 }
 
+// Log files to be switched to asynchronous mode. Writer threads
+// are started after daemonizing because threads do not survive fork.
+static std::list<Arc::LogFile*> async_log_dests;
+static unsigned int async_log_queue_size = 0;
+static Arc::LogFile::OverflowPolicy async_log_overflow = Arc::LogFile::OverflowDropDebug;
+
+static void start_async_logger(void)
+{
+    for (std::list<Arc::LogFile*>::iterator i = async_log_dests.begin(); i != async_log_dests.end(); ++i) {
+      (*i)->setAsync(async_log_queue_size, async_log_overflow);
+    }
+}
+
 static std::string init_logger(Arc::XMLNode log, bool foreground)
 {
     // set up root logger(s)
@@ -190,11 +211,21 @@ static std::string init_logger(Arc::XMLNode log, bool foreground)
       if((reopen == "true") || (reopen == "1")) reopen_b = true;
     }
 
+    if (log["QueueSize"]) Arc::stringto((std::string)log["QueueSize"], async_log_queue_size);
+
+    if (log["Overflow"]) {
+      std::string overflow_s = (std::string)(log["Overflow"]);
+      if (overflow_s == "block") async_log_overflow = Arc::LogFile::OverflowBlock;
+      else if (overflow_s == "drop") async_log_overflow = Arc::LogFile::OverflowDrop;
+      else if (overflow_s != "dropdebug") logger.msg(Arc::WARNING, "Unknown log overflow policy %s", overflow_s);
+    }
+
     Arc::Logger::rootLogger.removeDestinations();
     for (std::list<Arc::LogFile*>::iterator i = dests.begin(); i != dests.end(); ++i) {
       (*i)->setBackups(backups);
       (*i)->setMaxSize(maxsize);
       (*i)->setReopen(reopen_b);
+      if (async_log_queue_size > 0) async_log_dests.push_back(*i);
       Arc::Logger::rootLogger.addDestination(**i);
     }
     if (foreground) {
@@ -407,9 +438,18 @@ int main(int argc, char **argv)
             if (!is_true((config)["Server"]["Foreground"])) {
                 main_daemon = new Arc::Daemon(pid_file, root_log_file, is_true((config)["Server"]["Watchdog"]), &daemon_kick);
             }
+            start_async_logger();
             // set signal handlers
             signal(SIGTERM, sig_shutdown);
             signal(SIGINT, sig_shutdown);
+            if (!async_log_dests.empty()) {
+                // Only needed to save queued log messages
+                signal(SIGSEGV, sigfatal_handler);
+                signal(SIGBUS, sigfatal_handler);
+                signal(SIGFPE, sigfatal_handler);
+                signal(SIGILL, sigfatal_handler);
+                signal(SIGABRT, sigfatal_handler);
+            }
 
             // bootstrap
             loader = new Arc::MCCLoader(config);
@@ -352,3 +352,8 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { "acix", "HED:DMC", "ARC Cache Index", 0, &ArcDMCACIX::DataPointACIX::Instance },
   { NULL, NULL, NULL, 0, NULL }
 };
+
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "acix", "HED:DMC", "acix" },
+  { NULL, NULL, NULL }
+};
@@ -28,11 +28,16 @@
 #include <arc/Utils.h>
 
 #include "DataPointFile.h"
+#include "FileIOEngine.h"
 
 namespace ArcDMCFile {
 
   using namespace Arc;
 
+  // Number of simultaneous requests used by I/O engine if not specified
+  #define FILE_IO_DEPTH (4)
+  // Default amount of data written between pushes to storage by I/O engine
+  #define FILE_IO_SYNC (64*1024*1024)
 
   static char const * const stdfds[] = {
     "stdin",
@@ -46,14 +51,28 @@ namespace ArcDMCFile {
     : DataPointDirect(url, usercfg, parg),
       reading(false),
       writing(false),
+      io_engine(false),
+      io_direct(false),
+      io_sync(FILE_IO_SYNC),
       is_channel(false),
       channel_num(0) {
     fd = -1;
+    dfd = -1;
     fa = NULL;
     if (url.Protocol() == "file") {
       cache = false;
       is_channel = false;
       local = true;
+      io_engine = (url.Option("ioengine") == "async");
+      if (io_engine) {
+        io_direct = (url.Option("iodirect") == "yes");
+        if (url.Option("threads").empty()) bufnum = FILE_IO_DEPTH;
+        std::string optval = url.Option("iosync");
+        if (!optval.empty() && !stringto(optval, io_sync)) {
+          logger.msg(WARNING, "Bad value for iosync option: %s", optval);
+          io_sync = FILE_IO_SYNC;
+        }
+      }
     }
     else if (url.Protocol() == "stdio") {
       linkable = false;
@@ -96,11 +115,39 @@ namespace ArcDMCFile {
     return fd;
   }
 
+  int DataPointFile::open_direct(int flags) {
+#ifdef O_DIRECT
+    int dfd = ::open(url.Path().c_str(), flags | O_DIRECT);
+    if (dfd == -1) {
+      logger.msg(VERBOSE, "Failed to open %s for direct I/O: %s", url.Path(), StrError(errno));
+    }
+    return dfd;
+#else
+    logger.msg(VERBOSE, "Direct I/O is not supported");
+    return -1;
+#endif
+  }
+
   void DataPointFile::read_file_start(void* arg) {
     ((DataPointFile*)arg)->read_file();
   }
 
   void DataPointFile::read_file() {
+    if (io_engine && (fd != -1)) {
+      unsigned long long int range_length = 0;
+      unsigned long long int offset = 0;
+      if (range_end > range_start) {
+        range_length = range_end - range_start;
+        offset = range_start;
+      }
+      FileIOEngine engine(fd, dfd, *buffer, checksums, bufnum, 0);
+      // Note: checksum calculation not possible if not starting from beginning
+      if (!engine.Read(offset, range_length, offset == 0)) buffer->error_read(true);
+      if (dfd != -1) { ::close(dfd); dfd = -1; }
+      ::close(fd);
+      buffer->eof_read(true);
+      return;
+    }
     bool limit_length = false;
     unsigned long long int range_length = 0;
     unsigned long long int offset = 0;
@@ -189,55 +236,41 @@ namespace ArcDMCFile {
     ((DataPointFile*)arg)->write_file();
   }
 
-  class write_file_chunks {
-   private:
-    typedef struct {
-      unsigned long long int start;
-      unsigned long long int end;
-    } chunk_t;
-    std::list<chunk_t> chunks;
-   public:
-    write_file_chunks(void) {
-    }
-    // which is file EOF according to collected information
-    unsigned long long int eof(void) {
-      if(chunks.empty()) return 0;
-      return (--(chunks.end()))->end;
-    }
-    // how far non-interruptive file chunk reaches
-    unsigned long long int extends(void) {
-      if(chunks.empty()) return 0;
-      if(chunks.begin()->start > 0) return 0;
-      return chunks.begin()->end;
-    }
-    void add(unsigned long long int start, unsigned long long int end) {
-      chunk_t c;
-      c.start = start;
-      c.end = end;
-      if(chunks.empty()) {
-        chunks.push_back(c);
-        return;
-      }
-      for(std::list<chunk_t>::iterator chunk = chunks.begin();
-                  chunk != chunks.end();++chunk) {
-        if(end < chunk->start) {
-          chunks.insert(chunk,c);
-          return;
-        }
-        if(((start >= chunk->start) && (start <= chunk->end)) ||
-           ((end >= chunk->start) && (end <= chunk->end))) {
-          if(chunk->start < start) start = chunk->start;
-          if(chunk->end > end) end = chunk->end;
-          chunks.erase(chunk);
-          add(start,end);
-          return;
-        }
-      }
-      chunks.push_back(c);
+  void DataPointFile::close_written_file() {
+    if (dfd != -1) {
+      ::close(dfd);
+      dfd = -1;
     }
-  };
+    if (fd != -1) {
+      // This is for broken filesystems. Specifically for Lustre.
+      if (fsync(fd) != 0 && errno != EINVAL) { // this error is caused by special files like stdout
+        logger.msg(ERROR, "fsync of file %s failed: %s", url.Path(), StrError(errno));
+        buffer->error_write(true);
+      }
+      if(close(fd) != 0) {
+        logger.msg(ERROR, "closing file %s failed: %s", url.Path(), StrError(errno));
+        buffer->error_write(true);
+      }
+    }    
+    if (fa) {
+      // Lustre?
+      if(!fa->fa_close()) {
+        logger.msg(ERROR, "closing file %s failed: %s", url.Path(), StrError(errno));
+        buffer->error_write(true);
+      }
+    }    
+  }
 
   void DataPointFile::write_file() {
+    if (io_engine && (fd != -1) && !is_channel) {
+      FileIOEngine engine(fd, dfd, *buffer, checksums, bufnum, io_sync);
+      // Failures are reported to buffer by engine.
+      // Checksums are also handled by engine.
+      (void)engine.Write();
+      buffer->eof_write(true);
+      close_written_file();
+      return;
+    }
     unsigned long long int cksum_p = 0;
     bool do_cksum = (checksums.size() > 0);
     write_file_chunks cksum_chunks;
@@ -328,24 +361,7 @@ namespace ArcDMCFile {
       /* 3. announce */
       buffer->is_written(h);
     }
-    if (fd != -1) {
-      // This is for broken filesystems. Specifically for Lustre.
-      if (fsync(fd) != 0 && errno != EINVAL) { // this error is caused by special files like stdout
-        logger.msg(ERROR, "fsync of file %s failed: %s", url.Path(), StrError(errno));
-        buffer->error_write(true);
-      }
-      if(close(fd) != 0) {
-        logger.msg(ERROR, "closing file %s failed: %s", url.Path(), StrError(errno));
-        buffer->error_write(true);
-      }
-    }    
-    if (fa) {
-      // Lustre?
-      if(!fa->fa_close()) {
-        logger.msg(ERROR, "closing file %s failed: %s", url.Path(), StrError(errno));
-        buffer->error_write(true);
-      }
-    }    
+    close_written_file();
     if((do_cksum) && (cksum_chunks.eof() == cksum_p)) {
       for(std::list<CheckSum*>::iterator cksum = checksums.begin();
                 cksum != checksums.end(); ++cksum) {
@@ -566,6 +582,7 @@ namespace ArcDMCFile {
         SetSize(st.st_size);
         SetModified(st.st_mtime);
       }
+      if (io_engine && io_direct) dfd = open_direct(O_RDONLY);
     } else {
       fd = -1;
       fa = new FileAccess;
@@ -590,6 +607,7 @@ namespace ArcDMCFile {
     buffer = &buf;
     /* create thread to maintain reading */
     if(!CreateThreadFunction(&DataPointFile::read_file_start,this,&transfers_started)) {
+      if(dfd != -1) { ::close(dfd); dfd = -1; }
       if(fd != -1) ::close(fd);
       if(fa) { fa->fa_close(); delete fa; }
       fd = -1; fa = NULL;
@@ -605,6 +623,8 @@ namespace ArcDMCFile {
     reading = false;
     if (!buffer->eof_read()) {
       buffer->error_read(true);      /* trigger transfer error */
+      if(dfd != -1) ::close(dfd);
+      dfd = -1;
       if(fd != -1) ::close(fd);
       if(fa) fa->fa_close(); // protect?
       fd = -1;
@@ -758,8 +778,10 @@ namespace ArcDMCFile {
     }
     buffer->speed.reset();
     buffer->speed.hold(false);
+    if (io_engine && io_direct && (fd != -1) && !is_channel) dfd = open_direct(O_WRONLY);
     /* create thread to maintain writing */
     if(!CreateThreadFunction(&DataPointFile::write_file_start,this,&transfers_started)) {
+      if(dfd != -1) { close(dfd); dfd = -1; }
       if(fd != -1) { close(fd); fd = -1; }
       if(fa) { fa->fa_close(); delete fa; fa = NULL; }
       buffer->error_write(true);
@@ -775,6 +797,8 @@ namespace ArcDMCFile {
     writing = false;
     if (!buffer->eof_write()) {
       buffer->error_write(true);      /* trigger transfer error */
+      if(dfd != -1) close(dfd);
+      dfd = -1;
       if(fd != -1) close(fd);
       if(fa) fa->fa_close();
       fd = -1;
@@ -825,3 +849,8 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { "file", "HED:DMC", "Regular local file", 0, &ArcDMCFile::DataPointFile::Instance },
   { NULL, NULL, NULL, 0, NULL }
 };
+
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "file", "HED:DMC", "file,stdio" },
+  { NULL, NULL, NULL }
+};
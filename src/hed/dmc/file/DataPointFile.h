@@ -45,9 +45,19 @@ namespace ArcDMCFile {
     static void write_file_start(void* arg);
     void read_file();
     void write_file();
+    void close_written_file();
+    int open_direct(int flags);
     bool reading;
     bool writing;
     int fd;
+    /// descriptor opened for direct I/O
+    int dfd;
+    /// use FileIOEngine with bufnum simultaneous requests
+    bool io_engine;
+    /// use direct I/O in FileIOEngine
+    bool io_direct;
+    /// push written data to storage every io_sync bytes
+    unsigned long long int io_sync;
     FileAccess* fa;
     bool is_channel;
     unsigned int channel_num;
@@ -0,0 +1,372 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+// NOTE: On Solaris errno is not working properly if cerrno is included first
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "FileIOEngine.h"
+
+// Alignment required for requests made through O_DIRECT descriptor
+#define FILE_IO_ALIGN (4096)
+
+namespace ArcDMCFile {
+
+  Logger FileIOEngine::logger(Logger::getRootLogger(), "DataPoint.File.IO");
+
+  void write_file_chunks::add(unsigned long long int start, unsigned long long int end) {
+    chunk_t c;
+    c.start = start;
+    c.end = end;
+    if(chunks.empty()) {
+      chunks.push_back(c);
+      return;
+    }
+    for(std::list<chunk_t>::iterator chunk = chunks.begin();
+                chunk != chunks.end();++chunk) {
+      if(end < chunk->start) {
+        chunks.insert(chunk,c);
+        return;
+      }
+      if(((start >= chunk->start) && (start <= chunk->end)) ||
+         ((end >= chunk->start) && (end <= chunk->end))) {
+        if(chunk->start < start) start = chunk->start;
+        if(chunk->end > end) end = chunk->end;
+        chunks.erase(chunk);
+        add(start,end);
+        return;
+      }
+    }
+    chunks.push_back(c);
+  }
+
+  static bool is_aligned(unsigned long long int value) {
+    return ((value % FILE_IO_ALIGN) == 0);
+  }
+
+  // Makes sure bounce buffer suitable for O_DIRECT can hold size bytes
+  static bool bounce_alloc(char*& bounce, unsigned int& bounce_size, unsigned int size) {
+    if (bounce && (bounce_size >= size)) return true;
+    if (bounce) free(bounce);
+    bounce = NULL;
+    bounce_size = 0;
+    void* buf = NULL;
+    if (posix_memalign(&buf, FILE_IO_ALIGN, size) != 0) return false;
+    bounce = (char*)buf;
+    bounce_size = size;
+    return true;
+  }
+
+  FileIOEngine::FileIOEngine(int fd, int dfd, DataBuffer& buffer, std::list<CheckSum*>& checksums,
+                             int depth, unsigned long long int sync_interval):
+      fd_(fd), dfd_(dfd), buffer_(buffer), checksums_(checksums),
+      depth_(depth), sync_interval_(sync_interval), failed_(false),
+      do_cksum_(false), limit_length_(false), end_(0), next_(0), committed_(0), eof_(false),
+      unsynced_(0), syncing_(false), cksum_p_(0) {
+    if (depth_ < 1) depth_ = 1;
+  }
+
+  FileIOEngine::~FileIOEngine(void) {
+    workers_.wait();
+  }
+
+  bool FileIOEngine::run(void (*worker)(void*)) {
+    // Calling thread serves requests too
+    for (int n = 1; n < depth_; ++n) {
+      if (!CreateThreadFunction(worker, this, &workers_)) {
+        logger.msg(WARNING, "Failed to create thread for I/O, using %d", n);
+        break;
+      }
+    }
+    (*worker)(this);
+    workers_.wait();
+    return !failed_;
+  }
+
+  int FileIOEngine::do_pread(char* buf, unsigned int size, unsigned long long int offset,
+                             char*& bounce, unsigned int& bounce_size) {
+    unsigned int done = 0;
+    if ((dfd_ != -1) && is_aligned(offset)) {
+      // Whole aligned request must be used even for tail of file
+      unsigned int asize = ((size + FILE_IO_ALIGN - 1) / FILE_IO_ALIGN) * FILE_IO_ALIGN;
+      if (bounce_alloc(bounce, bounce_size, asize)) {
+        bool fallback = false;
+        while (done < size) {
+          ssize_t l = ::pread(dfd_, bounce + done, asize - done, offset + done);
+          if (l == -1) {
+            if (errno == EINTR) continue;
+            if ((errno == EINVAL) && (done == 0)) {
+              // not suitable for O_DIRECT - use regular way
+              fallback = true;
+              break;
+            }
+            return -1;
+          }
+          if (l == 0) break;
+          done += l;
+          if (!is_aligned(done)) break; // only possible at end of file
+        }
+        if (!fallback) {
+          if (done > size) done = size;
+          std::memcpy(buf, bounce, done);
+          return done;
+        }
+      }
+    }
+    while (done < size) {
+      ssize_t l = ::pread(fd_, buf + done, size - done, offset + done);
+      if (l == -1) {
+        if (errno == EINTR) continue;
+        return -1;
+      }
+      if (l == 0) break;
+      done += l;
+    }
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
+    // Data passes through once - do not keep it in page cache
+    if (done > 0) (void)posix_fadvise(fd_, offset, done, POSIX_FADV_DONTNEED);
+#endif
+    return done;
+  }
+
+  int FileIOEngine::do_pwrite(const char* buf, unsigned int size, unsigned long long int offset,
+                              char*& bounce, unsigned int& bounce_size) {
+    unsigned int done = 0;
+    if ((dfd_ != -1) && is_aligned(offset) && is_aligned(size) &&
+        bounce_alloc(bounce, bounce_size, size)) {
+      std::memcpy(bounce, buf, size);
+      while (done < size) {
+        ssize_t l = ::pwrite(dfd_, bounce + done, size - done, offset + done);
+        if (l == -1) {
+          if (errno == EINTR) continue;
+          if ((errno == EINVAL) && (done == 0)) break; // not suitable for O_DIRECT - use regular way
+          return -1;
+        }
+        done += l;
+      }
+      if (done == size) return done;
+    }
+    while (done < size) {
+      ssize_t l = ::pwrite(fd_, buf + done, size - done, offset + done);
+      if (l == -1) {
+        if (errno == EINTR) continue;
+        return -1;
+      }
+      done += l;
+    }
+    return done;
+  }
+
+  void FileIOEngine::read_worker_start(void* arg) {
+    ((FileIOEngine*)arg)->read_worker();
+  }
+
+  void FileIOEngine::read_worker(void) {
+    char* bounce = NULL;
+    unsigned int bounce_size = 0;
+    for (;;) {
+      int h;
+      unsigned int l;
+      if (!buffer_.for_read(h, l, true)) {
+        /* failed to get buffer - must be error or request to exit */
+        Glib::Mutex::Lock lock(lock_);
+        if (!eof_) failed_ = true;
+        cond_.broadcast();
+        break;
+      }
+      if (buffer_.error()) {
+        buffer_.is_read(h, 0, 0);
+        break;
+      }
+      unsigned long long int offset;
+      {
+        Glib::Mutex::Lock lock(lock_);
+        if (failed_ || eof_ || (limit_length_ && (next_ >= end_))) {
+          lock.release();
+          buffer_.is_read(h, 0, 0);
+          break;
+        }
+        offset = next_;
+        if (limit_length_ && (l > (end_ - offset))) l = end_ - offset;
+        next_ += l;
+      }
+      int ll = do_pread(buffer_[h], l, offset, bounce, bounce_size);
+      if (ll == -1) {
+        logger.msg(VERBOSE, "Failed to read file at offset %llu: %s", offset, StrError(errno));
+        {
+          Glib::Mutex::Lock lock(lock_);
+          failed_ = true;
+          cond_.broadcast();
+        }
+        buffer_.is_read(h, 0, 0);
+        break;
+      }
+      Glib::Mutex::Lock lock(lock_);
+      // Pass data to buffer in order so that destination which can't
+      // write out of order and checksums get continuous stream.
+      while ((committed_ != offset) && !failed_ && !(eof_ && (offset >= committed_))) {
+        cond_.wait(lock_);
+      }
+      if (committed_ != offset) {
+        lock.release();
+        buffer_.is_read(h, 0, 0);
+        break;
+      }
+      if (ll > 0) {
+        if (do_cksum_) {
+          for (std::list<CheckSum*>::iterator cksum = checksums_.begin();
+                    cksum != checksums_.end(); ++cksum) {
+            if (*cksum) (*cksum)->add(buffer_[h], ll);
+          }
+        }
+        buffer_.is_read(h, ll, offset);
+      } else {
+        buffer_.is_read(h, 0, 0);
+      }
+      committed_ += ll;
+      if ((unsigned int)ll < l) eof_ = true;
+      cond_.broadcast();
+      if (eof_) break;
+    }
+    if (bounce) free(bounce);
+  }
+
+  bool FileIOEngine::Read(unsigned long long int offset, unsigned long long int length, bool do_cksum) {
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_SEQUENTIAL)
+    (void)posix_fadvise(fd_, offset, length, POSIX_FADV_SEQUENTIAL);
+#endif
+    do_cksum_ = do_cksum;
+    limit_length_ = (length > 0);
+    end_ = offset + length;
+    next_ = offset;
+    committed_ = offset;
+    eof_ = false;
+    failed_ = false;
+    bool result = run(&read_worker_start);
+    if (result && do_cksum_ && eof_) {
+      for (std::list<CheckSum*>::iterator cksum = checksums_.begin();
+                cksum != checksums_.end(); ++cksum) {
+        if (*cksum) (*cksum)->end();
+      }
+    }
+    return result;
+  }
+
+  void FileIOEngine::sync(unsigned int written) {
+    if (sync_interval_ == 0) return;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      unsynced_ += written;
+      if (syncing_ || (unsynced_ < sync_interval_)) return;
+      syncing_ = true;
+      unsynced_ = 0;
+    }
+#ifdef HAVE_SYNC_FILE_RANGE
+    // Waiting for previously started write-back keeps amount of dirty
+    // pages limited. Then start write-back of everything written so far.
+    (void)sync_file_range(fd_, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE);
+#endif
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
+    // Drop pages which are already on storage
+    (void)posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    Glib::Mutex::Lock lock(lock_);
+    syncing_ = false;
+  }
+
+  void FileIOEngine::write_checksum(char* buf, unsigned int size, unsigned long long int offset) {
+    Glib::Mutex::Lock lock(lock_);
+    if (!do_cksum_) return;
+    cksum_chunks_.add(offset, offset+size);
+    if (offset == cksum_p_) {
+      for (std::list<CheckSum*>::iterator cksum = checksums_.begin();
+                cksum != checksums_.end(); ++cksum) {
+        if (*cksum) (*cksum)->add(buf, size);
+      }
+      cksum_p_ = offset + size;
+    }
+    if (cksum_chunks_.extends() > cksum_p_) {
+      // from file
+      const unsigned int tbuf_size = 65536;
+      char* tbuf = new char[tbuf_size];
+      for (;cksum_chunks_.extends() > cksum_p_;) {
+        unsigned int l = tbuf_size;
+        if (l > (cksum_chunks_.extends()-cksum_p_)) l = cksum_chunks_.extends()-cksum_p_;
+        ssize_t ll = ::pread(fd_, tbuf, l, cksum_p_);
+        if (ll <= 0) { do_cksum_ = false; break; }
+        for (std::list<CheckSum*>::iterator cksum = checksums_.begin();
+                  cksum != checksums_.end(); ++cksum) {
+          if (*cksum) (*cksum)->add(tbuf, ll);
+        }
+        cksum_p_ += ll;
+      }
+      delete[] tbuf;
+    }
+  }
+
+  void FileIOEngine::write_worker_start(void* arg) {
+    ((FileIOEngine*)arg)->write_worker();
+  }
+
+  void FileIOEngine::write_worker(void) {
+    char* bounce = NULL;
+    unsigned int bounce_size = 0;
+    for (;;) {
+      int h;
+      unsigned int l;
+      unsigned long long int p;
+      if (!buffer_.for_write(h, l, p, true)) {
+        /* failed to get buffer - must be error or request to exit */
+        if (!buffer_.eof_read()) {
+          buffer_.error_write(true);
+          Glib::Mutex::Lock lock(lock_);
+          failed_ = true;
+        }
+        break;
+      }
+      if (buffer_.error()) {
+        buffer_.is_written(h);
+        break;
+      }
+      if (do_pwrite(buffer_[h], l, p, bounce, bounce_size) == -1) {
+        logger.msg(VERBOSE, "Failed to write file at offset %llu: %s", p, StrError(errno));
+        buffer_.is_written(h);
+        buffer_.error_write(true);
+        Glib::Mutex::Lock lock(lock_);
+        failed_ = true;
+        break;
+      }
+      write_checksum(buffer_[h], l, p);
+      buffer_.is_written(h);
+      sync(l);
+    }
+    if (bounce) free(bounce);
+  }
+
+  bool FileIOEngine::Write(void) {
+    do_cksum_ = (checksums_.size() > 0);
+    cksum_p_ = 0;
+    unsynced_ = 0;
+    failed_ = false;
+    bool result = run(&write_worker_start);
+    if (result && do_cksum_ && (cksum_chunks_.eof() == cksum_p_)) {
+      for (std::list<CheckSum*>::iterator cksum = checksums_.begin();
+                cksum != checksums_.end(); ++cksum) {
+        if (*cksum) (*cksum)->end();
+      }
+    }
+    return result;
+  }
+
+} // namespace ArcDMCFile
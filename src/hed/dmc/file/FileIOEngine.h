@@ -0,0 +1,98 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARCDMCFILE_FILEIOENGINE_H__
+#define __ARCDMCFILE_FILEIOENGINE_H__
+
+#include <list>
+
+#include <arc/Thread.h>
+#include <arc/Logger.h>
+#include <arc/CheckSum.h>
+#include <arc/data/DataBuffer.h>
+
+namespace ArcDMCFile {
+
+using namespace Arc;
+
+/// Collects ranges of file already written
+class write_file_chunks {
+ private:
+  typedef struct {
+    unsigned long long int start;
+    unsigned long long int end;
+  } chunk_t;
+  std::list<chunk_t> chunks;
+ public:
+  write_file_chunks(void) {
+  }
+  // which is file EOF according to collected information
+  unsigned long long int eof(void) {
+    if(chunks.empty()) return 0;
+    return (--(chunks.end()))->end;
+  }
+  // how far non-interruptive file chunk reaches
+  unsigned long long int extends(void) {
+    if(chunks.empty()) return 0;
+    if(chunks.begin()->start > 0) return 0;
+    return chunks.begin()->end;
+  }
+  void add(unsigned long long int start, unsigned long long int end);
+};
+
+/// Moves data between DataBuffer and local file keeping several positional
+/// requests outstanding. Requests are served by a small pool of threads.
+/// Requests which are aligned to FILE_IO_ALIGN may bypass page cache
+/// through separate descriptor opened with O_DIRECT.
+class FileIOEngine {
+ public:
+  /// fd is regular descriptor, dfd is descriptor opened with O_DIRECT or -1.
+  /// depth is number of requests processed simultaneously. While writing
+  /// written data is pushed to storage every sync_interval bytes (0 - never).
+  FileIOEngine(int fd, int dfd, DataBuffer& buffer, std::list<CheckSum*>& checksums,
+               int depth, unsigned long long int sync_interval);
+  ~FileIOEngine(void);
+  /// Reads file starting at offset into buffer. If length is not 0 at most
+  /// length bytes are read. Returns false on failure. Data is passed to
+  /// buffer in order of offsets.
+  bool Read(unsigned long long int offset, unsigned long long int length, bool do_cksum);
+  /// Writes data from buffer to file till end of data or error.
+  /// Returns false on failure.
+  bool Write(void);
+ private:
+  int fd_;
+  int dfd_;
+  DataBuffer& buffer_;
+  std::list<CheckSum*>& checksums_;
+  int depth_;
+  unsigned long long int sync_interval_;
+  SimpleCounter workers_;
+  Glib::Mutex lock_;
+  Glib::Cond cond_;
+  bool failed_;
+  // reading
+  bool do_cksum_;
+  bool limit_length_;
+  unsigned long long int end_;       // offset where reading stops
+  unsigned long long int next_;      // offset of next read request
+  unsigned long long int committed_; // data up to this offset passed to buffer
+  bool eof_;
+  // writing
+  unsigned long long int unsynced_;  // amount written since last sync
+  bool syncing_;
+  write_file_chunks cksum_chunks_;
+  unsigned long long int cksum_p_;
+  static void read_worker_start(void* arg);
+  static void write_worker_start(void* arg);
+  void read_worker(void);
+  void write_worker(void);
+  bool run(void (*worker)(void*));
+  int do_pread(char* buf, unsigned int size, unsigned long long int offset, char*& bounce, unsigned int& bounce_size);
+  int do_pwrite(const char* buf, unsigned int size, unsigned long long int offset, char*& bounce, unsigned int& bounce_size);
+  void sync(unsigned int written);
+  void write_checksum(char* buf, unsigned int size, unsigned long long int offset);
+  static Logger logger;
+};
+
+} // namespace ArcDMCFile
+
+#endif // __ARCDMCFILE_FILEIOENGINE_H__
@@ -646,3 +646,8 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { "gfal2", "HED:DMC", "Grid File Access Library 2", 0, &ArcDMCGFAL::DataPointGFAL::Instance },
   { NULL, NULL, NULL, 0, NULL }
 };
+
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "gfal2", "HED:DMC", "rfio,dcap,gsidcap,lfc,gfal" },
+  { NULL, NULL, NULL }
+};
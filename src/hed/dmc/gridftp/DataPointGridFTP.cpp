@@ -1363,6 +1363,11 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { NULL, NULL, NULL, 0, NULL }
 };
 
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "gsiftp", "HED:DMC.disabled", "gsiftp,ftp" },
+  { NULL, NULL, NULL }
+};
+
 extern "C" {
   void ARC_MODULE_CONSTRUCTOR_NAME(Glib::Module* module, Arc::ModuleManager* manager) {
     if(manager && module) {
@@ -1570,3 +1570,8 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { "http", "HED:DMC", "HTTP, HTTP over SSL (https) or DAV(s)", 0, &ArcDMCHTTP::DataPointHTTP::Instance },
   { NULL, NULL, NULL, 0, NULL }
 };
+
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "http", "HED:DMC", "http,https,httpg,dav,davs" },
+  { NULL, NULL, NULL }
+};
@@ -82,3 +82,8 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { "mock", "HED:DMC", "Dummy protocol", 0, &ArcDMCMock::DataPointMock::Instance },
   { NULL, NULL, NULL, 0, NULL }
 };
+
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "mock", "HED:DMC", "mock,fail" },
+  { NULL, NULL, NULL }
+};
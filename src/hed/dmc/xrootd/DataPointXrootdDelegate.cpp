@@ -74,6 +74,11 @@ extern Arc::PluginDescriptor const ARC_PLUGINS_TABLE_NAME[] = {
   { NULL, NULL, NULL, 0, NULL }
 };
 
+extern Arc::PluginProtocolsDescriptor const ARC_PLUGINS_PROTOCOLS_NAME[] = {
+  { "root", "HED:DMC", "root" },
+  { NULL, NULL, NULL }
+};
+
 extern "C" {
   void ARC_MODULE_CONSTRUCTOR_NAME(Glib::Module* module, Arc::ModuleManager* manager) {
   }
@@ -44,13 +44,16 @@ class LocalMapDirect: public LocalMap {
 class LocalMapPool: public LocalMap {
  private:
   std::string dir_;
+  unsigned int lease_;
+  // Kept open for all requests. SimpleMap is safe for concurrent use.
+  SimpleMap pool_;
  public:
-  LocalMapPool(const std::string& dir);
+  LocalMapPool(const std::string& dir, unsigned int lease);
   virtual ~LocalMapPool(void);
   virtual std::string ID(Arc::Message* msg);
 };
 
-LocalMapPool::LocalMapPool(const std::string& dir):dir_(dir) {
+LocalMapPool::LocalMapPool(const std::string& dir, unsigned int lease):dir_(dir),lease_(lease),pool_(dir,lease) {
 }
 
 LocalMapPool::~LocalMapPool(void) {
@@ -61,7 +64,9 @@ std::string LocalMapPool::ID(Arc::Message* msg) {
   // So far only DN from TLS is supported.
   std::string dn = msg->Attributes()->get("TLS:IDENTITYDN");
   if(dn.empty()) return "";
-  SimpleMap pool(dir_);
+  if(pool_) return pool_.map(dn);
+  // Pool was not available at startup - try again
+  SimpleMap pool(dir_,lease_);
   if(!pool) return "";
   return pool.map(dn);
 }
@@ -163,7 +168,12 @@ static LocalMap* MakeLocalMap(Arc::XMLNode pdp) {
   if(p) {
     std::string dir = p;
     if(dir.empty()) return NULL;
-    return new LocalMapPool(dir);
+    unsigned int lease = SIMPLEMAP_LEASE_TIME;
+    Arc::XMLNode l = pdp["LocalSimplePoolLease"];
+    if(l) {
+      if(!Arc::stringto((std::string)l,lease)) return NULL;
+    };
+    return new LocalMapPool(dir,lease);
   };
   return NULL;
 }
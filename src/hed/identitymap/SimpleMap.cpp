@@ -54,10 +54,19 @@ class FileLock {
   bool operator!(void) { return (h_ == -1); };
 };
 
-SimpleMap::SimpleMap(const std::string& dir):dir_(dir) {
+// Maximal number of remembered mappings
+#define SIMPLEMAP_CACHE_MAX (100000)
+
+Glib::Mutex SimpleMap::pool_lock_;
+Glib::Mutex SimpleMap::cache_lock_;
+std::map<std::string,SimpleMap::CacheEntry> SimpleMap::cache_;
+
+SimpleMap::SimpleMap(const std::string& dir, unsigned int lease):dir_(dir),lease_(lease) {
   if((dir_.length() == 0) || (dir_[dir_.length()-1] != '/')) dir_+="/";
   if(dir_[0] != '/') dir_=Glib::get_current_dir()+"/"+dir_;
   pool_handle_=::open((dir_+"pool").c_str(),O_RDWR);
+  // Lease must be renewed on disk long before mapping may expire
+  if(lease_ > SELFUNMAP_TIME/2) lease_ = SELFUNMAP_TIME/2;
 }
 
 SimpleMap::~SimpleMap(void) {
@@ -77,10 +86,44 @@ SimpleMap::~SimpleMap(void) {
 std::string SimpleMap::map(const std::string& subject) {
   if(pool_handle_ == -1) failure("not initialized");
   if(subject.empty()) failure("missing subject");
+  std::string key = dir_ + '\0' + subject;
+  if(lease_ > 0) {
+    Glib::Mutex::Lock lock(cache_lock_);
+    std::map<std::string,CacheEntry>::iterator entry = cache_.find(key);
+    if((entry != cache_.end()) && (entry->second.expires > time(NULL))) return entry->second.name;
+  };
+  // File lock does not exclude threads of same process. Cache is
+  // updated under same lock to stay consistent with concurrent unmap().
+  Glib::Mutex::Lock plock(pool_lock_);
+  std::string name = map_pool(subject);
+  if(name.empty() || (lease_ == 0)) return name;
+  time_t now = time(NULL);
+  Glib::Mutex::Lock lock(cache_lock_);
+  if(cache_.size() >= SIMPLEMAP_CACHE_MAX) {
+    for(std::map<std::string,CacheEntry>::iterator entry = cache_.begin(); entry != cache_.end();) {
+      if(entry->second.expires <= now) {
+        cache_.erase(entry++);
+      } else {
+        ++entry;
+      };
+    };
+    if(cache_.size() >= SIMPLEMAP_CACHE_MAX) cache_.clear();
+  };
+  CacheEntry& entry = cache_[key];
+  entry.name = name;
+  entry.expires = now + lease_;
+  return name;
+}
+
+static std::string subject_file(const std::string& subject) {
   std::string filename(subject);
   for(std::string::size_type i = filename.find('/');i!=std::string::npos;
       i=filename.find('/',i+1)) filename[i]='_';
-  filename=dir_+filename;
+  return filename;
+}
+
+std::string SimpleMap::map_pool(const std::string& subject) {
+  std::string filename=dir_+subject_file(subject);
   FileLock lock(pool_handle_);
   if(!lock) failure("failed to lock pool file");
   // Check for existing mapping
@@ -103,7 +146,7 @@ std::string SimpleMap::map(const std::string& subject) {
     std::string name;
     while(f.good()) {
       std::getline(f,name);
-      if(!f.fail()) break;
+      if(f.fail()) break;
       if(name.empty()) continue;
       names.push_back(name);
     };
@@ -179,9 +222,14 @@ std::string SimpleMap::map(const std::string& subject) {
 
 bool SimpleMap::unmap(const std::string& subject) {
   if(pool_handle_ == -1) return false;
+  Glib::Mutex::Lock plock(pool_lock_);
+  {
+    Glib::Mutex::Lock lock(cache_lock_);
+    cache_.erase(dir_ + '\0' + subject);
+  };
   FileLock lock(pool_handle_);
   if(!lock) return false;
-  if(unlink((dir_+subject).c_str()) == 0) return true;
+  if(unlink((dir_+subject_file(subject)).c_str()) == 0) return true;
   if(errno == ENOENT) return true;
   return false;
 }
@@ -1,15 +1,37 @@
+#include <map>
 #include <string>
 
+#include <glibmm/thread.h>
+
 #define SELFUNMAP_TIME (10*24*60*60)
 
+// Default time (seconds) mapping is served from memory before pool is consulted again
+#define SIMPLEMAP_LEASE_TIME (5*60)
+
 namespace ArcSec {
 
 class SimpleMap {
  private:
+  // Mapping remembered in memory till lease expires
+  class CacheEntry {
+   public:
+    std::string name;
+    time_t expires;
+  };
   std::string dir_;
   int pool_handle_;
+  unsigned int lease_;
+  static Glib::Mutex pool_lock_;
+  static Glib::Mutex cache_lock_;
+  static std::map<std::string,CacheEntry> cache_;
+  std::string map_pool(const std::string& subject);
  public:
-  SimpleMap(const std::string& dir);
+  /** Opens pool in directory dir. Mappings are kept in memory
+    for lease seconds. Value 0 disables caching. Because every
+    mapping is renewed on disk when its lease is renewed and
+    lease is much shorter than SELFUNMAP_TIME, cached mapping
+    can't be given to other subject meanwhile. */
+  SimpleMap(const std::string& dir, unsigned int lease = SIMPLEMAP_LEASE_TIME);
   ~SimpleMap(void);
   std::string map(const std::string& subject);
   bool unmap(const std::string& subject);
@@ -0,0 +1,120 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <glibmm/miscutils.h>
+
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+
+#include "../SimpleMap.h"
+
+#define POOL_SIZE 8
+#define THREADS 8
+#define ITERATIONS 200
+
+class SimpleMapTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SimpleMapTest);
+  CPPUNIT_TEST(TestMap);
+  CPPUNIT_TEST(TestConcurrentMap);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestMap();
+  void TestConcurrentMap();
+
+private:
+  std::string dir;
+};
+
+void SimpleMapTest::setUp() {
+  dir = Glib::get_current_dir() + "/simplemap.test";
+  Arc::DirDelete(dir);
+  CPPUNIT_ASSERT(Arc::DirCreate(dir, 0700, true));
+  std::ofstream pool((dir + "/pool").c_str());
+  for (int n = 0; n < POOL_SIZE; ++n) pool << "user" << n << std::endl;
+}
+
+void SimpleMapTest::tearDown() {
+  Arc::DirDelete(dir);
+}
+
+void SimpleMapTest::TestMap() {
+  ArcSec::SimpleMap pool(dir);
+  CPPUNIT_ASSERT((bool)pool);
+  std::string name = pool.map("/O=Grid/CN=Test");
+  CPPUNIT_ASSERT(!name.empty());
+  // Served from memory
+  CPPUNIT_ASSERT_EQUAL(name, pool.map("/O=Grid/CN=Test"));
+  // Same mapping is stored on disk
+  ArcSec::SimpleMap uncached(dir, 0);
+  CPPUNIT_ASSERT_EQUAL(name, uncached.map("/O=Grid/CN=Test"));
+  std::ifstream f((dir + "/_O=Grid_CN=Test").c_str());
+  std::string stored;
+  std::getline(f, stored);
+  CPPUNIT_ASSERT_EQUAL(name, stored);
+  // Unmapping removes mapping from memory and disk
+  CPPUNIT_ASSERT(pool.unmap("/O=Grid/CN=Test"));
+  CPPUNIT_ASSERT(::access((dir + "/_O=Grid_CN=Test").c_str(), F_OK) != 0);
+  CPPUNIT_ASSERT(!pool.map("/O=Grid/CN=Test").empty());
+}
+
+class MapThreadArg {
+ public:
+  ArcSec::SimpleMap* pool;
+  std::string subject;
+  std::string name;
+  bool consistent;
+  Arc::SimpleCounter* counter;
+};
+
+static void map_thread(void* arg) {
+  MapThreadArg& it = *((MapThreadArg*)arg);
+  it.consistent = true;
+  for (int n = 0; n < ITERATIONS; ++n) {
+    std::string name = it.pool->map(it.subject);
+    if (name.empty() || (!it.name.empty() && (name != it.name))) it.consistent = false;
+    it.name = name;
+  }
+  it.counter->dec();
+}
+
+void SimpleMapTest::TestConcurrentMap() {
+  // Half of threads share cached pool, others always go to disk
+  ArcSec::SimpleMap cached(dir);
+  ArcSec::SimpleMap uncached(dir, 0);
+  CPPUNIT_ASSERT((bool)cached);
+  CPPUNIT_ASSERT((bool)uncached);
+  Arc::SimpleCounter counter;
+  std::vector<MapThreadArg> args(THREADS);
+  for (int n = 0; n < THREADS; ++n) {
+    args[n].pool = (n % 2) ? &uncached : &cached;
+    args[n].subject = "/O=Grid/CN=User " + Arc::tostring(n);
+    args[n].counter = &counter;
+    counter.inc();
+    if (!Arc::CreateThreadFunction(&map_thread, &args[n])) counter.dec();
+  }
+  counter.wait();
+  std::set<std::string> names;
+  for (int n = 0; n < THREADS; ++n) {
+    CPPUNIT_ASSERT(args[n].consistent);
+    // Every subject must get own account
+    CPPUNIT_ASSERT(names.insert(args[n].name).second);
+    CPPUNIT_ASSERT_EQUAL(args[n].name, uncached.map(args[n].subject));
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SimpleMapTest);
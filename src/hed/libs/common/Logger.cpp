@@ -8,6 +8,9 @@
 #include <fstream>
 
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
 
 #include <arc/DateTime.h>
 #include <arc/StringConv.h>
@@ -260,13 +263,42 @@ namespace Arc {
     EnvLockUnwrap(false);
   }
 
+  // Queue and counters are protected by lock. Only enabled is read
+  // without lock as first check in LogFile::log().
+  class LogFile::AsyncQueue {
+   public:
+    bool enabled;
+    unsigned int queue_max;
+    OverflowPolicy overflow;
+    Glib::Mutex lock;
+    Glib::Cond queue_cond; // messages queued or writer asked to exit
+    Glib::Cond done_cond;  // messages written, space freed or writer exited
+    std::list<std::string> queue;
+    unsigned int queue_length; // std::list::size() is not constant time
+    unsigned long long int queued;
+    unsigned long long int written;
+    unsigned long long int dropped;
+    unsigned long long int dropped_reported;
+    bool writer_running;
+    bool writer_exit;
+    AsyncQueue(void): enabled(false), queue_max(0), overflow(OverflowDropDebug),
+                      queue_length(0), queued(0), written(0), dropped(0), dropped_reported(0),
+                      writer_running(false), writer_exit(false) {};
+  };
+
+  // Held by FlushAll() while it flushes files copied from allfiles, so
+  // LogFile is not destroyed under it. Never taken while holding
+  // allfilesmutex or queue lock.
+  static Glib::Mutex flushallmutex;
+
   LogFile::LogFile(const std::string& path)
     : LogDestination(),
       path(path),
       destination(),
       maxsize(-1),
       backups(-1),
-      reopen(false) {
+      reopen(false),
+      async(new AsyncQueue) {
     if(path.empty()) {
       //logger.msg(Arc::ERROR,"Log file path is not specified");
       return;
@@ -281,8 +313,168 @@ namespace Arc {
   }
 
   LogFile::~LogFile() {
-    Glib::Mutex::Lock lock(allfilesmutex);
-    allfiles.remove(this);
+    {
+      Glib::Mutex::Lock lock(allfilesmutex);
+      allfiles.remove(this);
+    }
+    // Wait for FlushAll() which may still use this object
+    { Glib::Mutex::Lock lock(flushallmutex); }
+    stopWriter();
+    delete async;
+  }
+
+  static void flush_all_at_exit(void) {
+    LogFile::FlushAll();
+  }
+
+  // Queues can't be flushed from signal handler because that requires
+  // locking and stream operations. Instead handler wakes up dedicated
+  // thread through pipe and waits limited time for it to finish.
+  #define LOG_EMERGENCY_FLUSH_TIMEOUT (5000) // ms
+
+  static int emergency_pipe[2] = { -1, -1 };
+  static volatile sig_atomic_t emergency_done = 0;
+
+  static void emergency_flusher(void*) {
+    char c;
+    for(;;) {
+      ssize_t l = ::read(emergency_pipe[0], &c, 1);
+      if(l == 1) break;
+      if((l < 0) && (errno == EINTR)) continue;
+      return;
+    }
+    LogFile::FlushAll();
+    emergency_done = 1;
+  }
+
+  void LogFile::setAsync(unsigned int queue_size, OverflowPolicy newoverflow) {
+    if(queue_size == 0) {
+      stopWriter();
+      return;
+    }
+    {
+      // Done before taking queue lock because FlushAll() takes locks
+      // in opposite order
+      static bool exit_handler_set = false;
+      Glib::Mutex::Lock alock(allfilesmutex);
+      if(!exit_handler_set) {
+        ::atexit(&flush_all_at_exit);
+        if(::pipe(emergency_pipe) == 0) {
+          if(!CreateThreadFunction(&emergency_flusher, NULL)) {
+            ::close(emergency_pipe[0]);
+            ::close(emergency_pipe[1]);
+            emergency_pipe[0] = emergency_pipe[1] = -1;
+          }
+        }
+        exit_handler_set = true;
+      }
+    }
+    Glib::Mutex::Lock lock(async->lock);
+    async->queue_max = queue_size;
+    async->overflow = newoverflow;
+    if(async->enabled) return;
+    async->writer_exit = false;
+    async->writer_running = true;
+    if(!CreateThreadFunction(&writer, this)) {
+      async->writer_running = false;
+      return;
+    }
+    async->enabled = true;
+  }
+
+  void LogFile::stopWriter(void) {
+    Glib::Mutex::Lock lock(async->lock);
+    if(!async->writer_running) return;
+    // Writer drains queue before exiting
+    async->writer_exit = true;
+    async->queue_cond.broadcast();
+    while(async->writer_running) async->done_cond.wait(async->lock);
+    async->enabled = false;
+  }
+
+  void LogFile::Flush() {
+    Glib::Mutex::Lock lock(async->lock);
+    unsigned long long int target = async->queued;
+    while(async->writer_running && (async->written < target)) async->done_cond.wait(async->lock);
+  }
+
+  unsigned long long int LogFile::getDropped() {
+    Glib::Mutex::Lock lock(async->lock);
+    return async->dropped;
+  }
+
+  void LogFile::FlushAll() {
+    Glib::Mutex::Lock flock(flushallmutex);
+    // Flush() waits for writers, so allfilesmutex is not held meanwhile
+    std::list<LogFile*> files;
+    {
+      Glib::Mutex::Lock lock(allfilesmutex);
+      files = allfiles;
+    }
+    for(std::list<LogFile*>::const_iterator f = files.begin(); f != files.end(); ++f) {
+      (*f)->Flush();
+    }
+  }
+
+  void LogFile::EmergencyFlushAll() {
+    // Only async-signal-safe calls here
+    if(emergency_pipe[1] == -1) return;
+    char c = 0;
+    if(::write(emergency_pipe[1], &c, 1) != 1) return;
+    struct timespec delay = { 0, 10000000 }; // 10 ms
+    for(int waited = 0; waited < LOG_EMERGENCY_FLUSH_TIMEOUT; waited += 10) {
+      if(emergency_done) break;
+      ::nanosleep(&delay, NULL);
+    }
+  }
+
+  void LogFile::writer(void* arg) {
+    LogFile& it = *((LogFile*)arg);
+    AsyncQueue& q = *(it.async);
+    Glib::Mutex::Lock lock(q.lock);
+    for(;;) {
+      while(q.queue.empty() && (q.dropped == q.dropped_reported) && !q.writer_exit) {
+        q.queue_cond.wait(q.lock);
+      }
+      if(q.queue.empty() && (q.dropped == q.dropped_reported)) break; // exit requested
+      std::list<std::string> batch;
+      batch.swap(q.queue);
+      unsigned long long int batch_size = q.queue_length;
+      q.queue_length = 0;
+      if(q.dropped != q.dropped_reported) {
+        batch.push_back("[" + Time().str() + "] " + tostring(q.dropped - q.dropped_reported) +
+                        " log messages were dropped because logging queue was full\n");
+        q.dropped_reported = q.dropped;
+      }
+      // Writers waiting for space can proceed while batch is written
+      q.done_cond.broadcast();
+      lock.release();
+      it.write(batch);
+      lock.acquire();
+      q.written += batch_size;
+      q.done_cond.broadcast();
+    }
+    q.writer_running = false;
+    q.done_cond.broadcast();
+  }
+
+  void LogFile::write(const std::list<std::string>& batch) {
+    Glib::Mutex::Lock lock(mutex);
+    // If requested to reopen on every write or if was closed because of error
+    if (reopen || !destination.is_open()) {
+      destination.open(path.c_str(), std::fstream::out | std::fstream::app);
+    }
+    if(!destination.is_open()) return;
+    for(std::list<std::string>::const_iterator m = batch.begin(); m != batch.end(); ++m) {
+      destination << *m;
+    }
+    destination.flush();
+    // Check if unrecoverable error occurred. Close if error
+    // and reopen on next write.
+    if(destination.bad()) destination.close();
+    // Before closing check if must backup
+    backup();
+    if (reopen) destination.close();
   }
 
   void LogFile::ReopenAll() {
@@ -331,6 +523,35 @@ namespace Arc {
   }
 
   void LogFile::log(const LogMessage& message) {
+    if(async->enabled) {
+      // Formatting is done here because message content depends on time
+      // and thread. Writer only passes ready lines to file.
+      std::ostringstream line;
+      EnvLockWrap(false); // Protecting getenv inside gettext()
+      line << *this << message << "\n";
+      EnvLockUnwrap(false);
+      AsyncQueue& q = *async;
+      Glib::Mutex::Lock lock(q.lock);
+      if(q.writer_running && !q.writer_exit) {
+        while(q.queue_length >= q.queue_max) {
+          if((q.overflow == OverflowDrop) ||
+             ((q.overflow == OverflowDropDebug) && (message.getLevel() <= VERBOSE))) {
+            ++q.dropped;
+            return;
+          }
+          q.done_cond.wait(q.lock);
+          if(!q.writer_running || q.writer_exit) break;
+        }
+        if(q.writer_running && !q.writer_exit) {
+          q.queue.push_back(line.str());
+          ++q.queue_length;
+          ++q.queued;
+          q.queue_cond.signal();
+          return;
+        }
+      }
+      // Writer is being stopped - fall back to synchronous writing
+    }
     Glib::Mutex::Lock lock(mutex);
     // If requested to reopen on every write or if was closed because of error
     if (reopen || !destination.is_open()) {
@@ -398,6 +619,29 @@ namespace Arc {
     new LoggerContextRef(context,id);
   }
 
+  // All existing contexts. Used for finding lowest threshold in process.
+  // Allocated on first use because contexts of static loggers may be
+  // created before static objects of this file are initialized.
+  static std::list<LoggerContext*>* allcontexts = NULL;
+
+  static Glib::Mutex& allcontextsmutex(void) {
+    static Glib::Mutex* mutex = new Glib::Mutex;
+    return *mutex;
+  }
+
+  LoggerContext::LoggerContext(LogLevel thr):usage_count(0),threshold(thr) {
+    Glib::Mutex::Lock lock(allcontextsmutex());
+    if(!allcontexts) allcontexts = new std::list<LoggerContext*>;
+    allcontexts->push_back(this);
+  }
+
+  LoggerContext::LoggerContext(const LoggerContext& ctx):
+             usage_count(0),destinations(ctx.destinations),threshold(ctx.threshold) {
+    Glib::Mutex::Lock lock(allcontextsmutex());
+    if(!allcontexts) allcontexts = new std::list<LoggerContext*>;
+    allcontexts->push_back(this);
+  }
+
   void LoggerContext::Acquire(void) {
     mutex.lock();
     ++usage_count;
@@ -417,9 +661,15 @@ namespace Arc {
   LoggerContext::~LoggerContext(void) {
     mutex.trylock();
     mutex.unlock();
+    {
+      Glib::Mutex::Lock lock(allcontextsmutex());
+      if(allcontexts) allcontexts->remove(this);
+    }
+    Logger::updateMinimalThreshold();
   }
 
   Logger* Logger::rootLogger = NULL;
+  LogLevel Logger::minimalThreshold = (LogLevel)0;
   std::map<std::string,LogLevel>* Logger::defaultThresholds = NULL;
   unsigned int Logger::rootLoggerMark = ~rootLoggerMagic;
 
@@ -441,6 +691,7 @@ namespace Arc {
                                    defaultThresholds->find(domain);
     if(thr != defaultThresholds->end()) {
       context.threshold = thr->second;
+      updateMinimalThreshold();
     }
   }
 
@@ -450,6 +701,7 @@ namespace Arc {
     : parent(&parent),
       domain(parent.getDomain() + "." + subdomain),
       context(threshold) {
+    updateMinimalThreshold();
   }
 
   Logger::~Logger() {
@@ -508,8 +760,25 @@ namespace Arc {
   }
 
   void Logger::setThreshold(LogLevel threshold) {
-    Glib::Mutex::Lock lock(mutex);
-    this->getContext().threshold = threshold;
+    {
+      Glib::Mutex::Lock lock(mutex);
+      this->getContext().threshold = threshold;
+    }
+    updateMinimalThreshold();
+  }
+
+  void Logger::updateMinimalThreshold(void) {
+    Glib::Mutex::Lock lock(allcontextsmutex());
+    LogLevel threshold = (LogLevel)0;
+    if(allcontexts) {
+      for(std::list<LoggerContext*>::iterator ctx = allcontexts->begin();
+                                   ctx != allcontexts->end(); ++ctx) {
+        LogLevel thr = (*ctx)->threshold;
+        if(thr == (LogLevel)0) continue; // inherited from parent
+        if((threshold == (LogLevel)0) || (thr < threshold)) threshold = thr;
+      }
+    }
+    minimalThreshold = threshold;
   }
 
   void Logger::setThresholdForDomain(LogLevel threshold,
@@ -556,17 +825,22 @@ namespace Arc {
   }
 
   void Logger::msg(LogMessage message) {
-    message.setDomain(domain);
-    if (message.getLevel() >= getThreshold()) {
-      log(message);
+    if (isEnabled(message.getLevel())) {
+      forward(message);
     }
   }
 
+  void Logger::forward(LogMessage message) {
+    message.setDomain(domain);
+    log(message);
+  }
+
   Logger::Logger()
     : parent(0),
       domain("Arc"),
       context(DefaultLogLevel) {
     // addDestination(cerr);
+    updateMinimalThreshold();
   }
 
   std::string Logger::getDomain() {
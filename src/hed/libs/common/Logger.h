@@ -381,12 +381,49 @@ namespace Arc {
      */
     void setReopen(bool newreopen);
 
+    /// Action taken when queue of asynchronous LogFile is full.
+    enum OverflowPolicy {
+      OverflowBlock,     ///< Wait till writer frees space in queue
+      OverflowDropDebug, ///< Drop DEBUG and VERBOSE messages, wait for others
+      OverflowDrop       ///< Drop any message
+    };
+
+    /// Switch to asynchronous writing.
+    /** Messages are formatted by caller and put into queue of up to
+       queue_size entries. Dedicated thread writes them to file in
+       batches and also takes care of rotation. Number of dropped
+       messages is reported in log file. Specifying queue_size 0
+       switches back to synchronous writing after all queued messages
+       are written.
+       @param queue_size Maximal number of messages in queue.
+       @param overflow What to do if queue is full.
+     */
+    void setAsync(unsigned int queue_size, OverflowPolicy overflow = OverflowDropDebug);
+
+    /// Wait till all queued messages are written to file.
+    void Flush();
+
+    /// Returns number of messages dropped because queue was full.
+    unsigned long long int getDropped();
+
     /// Reopen file if currently open.
     void Reopen();
 
     /// Reopen all LogFile objects.
     static void ReopenAll();
 
+    /// Write queued messages of all LogFile objects.
+    /** Must be called before process exits without destroying LogFile
+       objects, like by calling _exit(). */
+    static void FlushAll();
+
+    /// Write queued messages of all LogFile objects from signal handler.
+    /** Best effort to save queued messages if process is terminated by
+       fatal signal. Async-signal-safe: messages are written by helper
+       thread and this method waits for it for limited time. Does
+       nothing if no LogFile was switched to asynchronous mode. */
+    static void EmergencyFlushAll();
+
     /// Returns true if this instance is valid.
     operator bool(void);
 
@@ -406,11 +443,17 @@ namespace Arc {
     LogFile(const LogFile& unique);
     void operator=(const LogFile& unique);
     void backup(void);
+    void write(const std::list<std::string>& batch);
+    void stopWriter(void);
+    static void writer(void* arg);
     std::string path;
     std::ofstream destination;
     int maxsize;
     int backups;
     bool reopen;
+    /// State of asynchronous writing, defined in Logger.cpp
+    class AsyncQueue;
+    AsyncQueue* async;
   };
 
   class LoggerContextRef;
@@ -433,10 +476,9 @@ namespace Arc {
       /// The threshold of Logger.
       LogLevel threshold;
 
-      LoggerContext(LogLevel thr):usage_count(0),threshold(thr) { };
+      LoggerContext(LogLevel thr);
 
-      LoggerContext(const LoggerContext& ctx):
-             usage_count(0),destinations(ctx.destinations),threshold(ctx.threshold) { };
+      LoggerContext(const LoggerContext& ctx);
 
       ~LoggerContext(void);
 
@@ -488,6 +530,7 @@ namespace Arc {
      @endcode
    */
   class Logger {
+  friend class LoggerContext;
   public:
 
     /// The root Logger.
@@ -586,6 +629,19 @@ namespace Arc {
     /// Returns the threshold of this logger.
     LogLevel getThreshold() const;
 
+    /// Checks if message of specified level would be logged.
+    /** Messages below lowest threshold of all loggers and contexts are
+       rejected without taking any locks. Otherwise level is compared to
+       threshold effective for this logger in current thread. msg()
+       methods use it to skip formatting of suppressed messages. It may
+       also be used to avoid expensive preparation of message arguments.
+       @param level The level of the message.
+     */
+    bool isEnabled(LogLevel level) const {
+      if (level < minimalThreshold) return false;
+      return (level >= getThreshold());
+    }
+
     /// Creates per-thread context.
     /** Creates new context for this logger which becomes effective
        for operations initiated by this thread. All new threads 
@@ -616,38 +672,44 @@ namespace Arc {
        @param str The message text.
      */
     void msg(LogLevel level, const std::string& str) {
-      msg(LogMessage(level, IString(str)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str)));
     }
 
     template<class T0>
     void msg(LogLevel level, const std::string& str,
              const T0& t0) {
-      msg(LogMessage(level, IString(str, t0)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0)));
     }
 
     template<class T0, class T1>
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1) {
-      msg(LogMessage(level, IString(str, t0, t1)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1)));
     }
 
     template<class T0, class T1, class T2>
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2) {
-      msg(LogMessage(level, IString(str, t0, t1, t2)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2)));
     }
 
     template<class T0, class T1, class T2, class T3>
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2, t3)));
     }
 
     template<class T0, class T1, class T2, class T3, class T4>
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4)));
     }
 
     template<class T0, class T1, class T2, class T3, class T4,
@@ -655,7 +717,8 @@ namespace Arc {
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5)));
     }
 
     template<class T0, class T1, class T2, class T3, class T4,
@@ -663,7 +726,8 @@ namespace Arc {
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5, const T6& t6) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6)));
     }
 
     template<class T0, class T1, class T2, class T3, class T4,
@@ -671,7 +735,8 @@ namespace Arc {
     void msg(LogLevel level, const std::string& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5, const T6& t6, const T7& t7) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6, t7)));
+      if (!isEnabled(level)) return;
+      forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6, t7)));
     }
 
   private:
@@ -712,6 +777,15 @@ namespace Arc {
      */
     void log(const LogMessage& message);
 
+    /// Sends message which already passed threshold check.
+    void forward(LogMessage message);
+
+    /// Recomputes minimalThreshold from all existing contexts.
+    static void updateMinimalThreshold(void);
+
+    /// Lowest threshold of all loggers and contexts.
+    static LogLevel minimalThreshold;
+
     /// A pointer to the parent of this logger.
     Logger *parent;
 
@@ -161,6 +161,17 @@ namespace Arc {
         \param size size of buf
         \return number of written bytes. */
     int WriteStdin(int timeout, const char *buf, int size);
+    /// Returns handle of stdout pipe of running executable.
+    /** Handle may be used for waiting for data. Reading must be done
+        through ReadStdout(). Returns -1 if there is no pipe. */
+    int StdoutHandle(void) const {
+      return stdout_;
+    }
+    /// Returns handle of stderr pipe of running executable.
+    /** Returns -1 if there is no pipe. */
+    int StderrHandle(void) const {
+      return stderr_;
+    }
     /// Associate stdout pipe of executable with string.
     /** This method must be called before Start(). str object
         must be valid as long as this object exists. */
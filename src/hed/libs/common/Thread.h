@@ -224,6 +224,23 @@ namespace Arc {
       lock_.unlock();
       return res;
     }
+    /// Wait for condition no longer than t milliseconds without using semaphor.
+    /** Call it *only* with lock acquired.
+        \return false if timeout occurred */
+    bool wait_nonblock(int t) {
+      Glib::TimeVal etime;
+      etime.assign_current_time();
+      etime.add_milliseconds(t);
+      bool res(true);
+      ++waiting_;
+      while (!flag_) {
+        res = cond_.timed_wait(lock_, etime);
+        if (!res) break;
+      }
+      --waiting_;
+      if(res) --flag_;
+      return res;
+    }
     /// Reset object to initial state.
     void reset(void) {
       lock_.lock();
@@ -5,10 +5,14 @@
 
 
 #include <sstream>
+#include <fstream>
+
+#include <unistd.h>
 
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <arc/Logger.h>
+#include <arc/StringConv.h>
 
 class LoggerTest
   : public CppUnit::TestFixture {
@@ -18,6 +22,8 @@ class LoggerTest
   CPPUNIT_TEST(TestLoggerVERBOSE);
   CPPUNIT_TEST(TestLoggerTHREAD);
   CPPUNIT_TEST(TestLoggerDEFAULT);
+  CPPUNIT_TEST(TestLoggerENABLED);
+  CPPUNIT_TEST(TestLogFileASYNC);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -28,6 +34,8 @@ public:
   void TestLoggerVERBOSE();
   void TestLoggerTHREAD();
   void TestLoggerDEFAULT();
+  void TestLoggerENABLED();
+  void TestLogFileASYNC();
 
 private:
   std::stringstream stream;
@@ -121,4 +129,56 @@ void LoggerTest::TestLoggerDEFAULT() {
   CPPUNIT_ASSERT_EQUAL(bad_level, default_level);
 }
 
+void LoggerTest::TestLoggerENABLED() {
+  Arc::LogLevel root_level = Arc::Logger::getRootLogger().getThreshold();
+  Arc::Logger::getRootLogger().setThreshold(Arc::WARNING);
+  CPPUNIT_ASSERT(!logger->isEnabled(Arc::DEBUG));
+  CPPUNIT_ASSERT(!logger->isEnabled(Arc::VERBOSE));
+  CPPUNIT_ASSERT(logger->isEnabled(Arc::INFO));
+
+  // Child without own threshold follows its parent
+  Arc::Logger child(*logger, "Child");
+  CPPUNIT_ASSERT(!child.isEnabled(Arc::VERBOSE));
+  logger->setThreshold(Arc::VERBOSE);
+  CPPUNIT_ASSERT(child.isEnabled(Arc::VERBOSE));
+  child.msg(Arc::VERBOSE, "This VERBOSE message should be seen");
+  std::string res = stream.str();
+  res = res.substr(res.rfind(']') + 2);
+  CPPUNIT_ASSERT_EQUAL(res, std::string("This VERBOSE message should be seen\n"));
+  stream.str("");
+
+  logger->setThreshold(Arc::INFO);
+  child.msg(Arc::VERBOSE, "This VERBOSE message should not be seen");
+  CPPUNIT_ASSERT(stream.str().empty());
+  Arc::Logger::getRootLogger().setThreshold(root_level);
+}
+
+void LoggerTest::TestLogFileASYNC() {
+  std::string path("LoggerTest.async.log");
+  ::unlink(path.c_str());
+  {
+    Arc::LogFile file(path);
+    CPPUNIT_ASSERT((bool)file);
+    file.setFormat(Arc::EmptyFormat);
+    // Small queue makes writers wait for background thread
+    file.setAsync(2, Arc::LogFile::OverflowBlock);
+    Arc::Logger filelogger(Arc::Logger::getRootLogger(), "TestFile", Arc::INFO);
+    filelogger.addDestination(file);
+    for(int n = 0; n < 100; ++n) filelogger.msg(Arc::INFO, "Message %i", n);
+    file.Flush();
+    CPPUNIT_ASSERT_EQUAL(0ULL, file.getDropped());
+    std::ifstream in(path.c_str());
+    std::string line;
+    int lines = 0;
+    while(std::getline(in, line)) {
+      CPPUNIT_ASSERT_EQUAL(std::string("Message ") + Arc::tostring(lines), line);
+      ++lines;
+    }
+    CPPUNIT_ASSERT_EQUAL(100, lines);
+    filelogger.removeDestinations();
+  }
+  ::unlink(path.c_str());
+  stream.str("");
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(LoggerTest);
@@ -166,6 +166,8 @@ namespace Arc {
         cadir.NewAttribute("PolicyGlobus") = "true";
       };
       comp.NewAttribute("entry") = "tls";
+      // Used to find TLS session which can be resumed
+      comp.NewChild("Endpoint") = host + ":" + tostring(port);
       if (sec.sec == SSL3Sec) comp.NewChild("Handshake") = "SSLv3";
       else if (sec.sec == TLS10Sec) comp.NewChild("Handshake") = "TLSv1.0";
       else if (sec.sec == TLS11Sec) comp.NewChild("Handshake") = "TLSv1.1";
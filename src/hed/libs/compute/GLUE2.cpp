@@ -4,6 +4,8 @@
 #include <config.h>
 #endif
 
+#include <libxml/xmlreader.h>
+
 #include <arc/StringConv.h>
 
 #include "GLUE2.h"
@@ -26,199 +28,440 @@ namespace Arc {
     return true;
   }
 
-  void GLUE2::ParseExecutionTargets(XMLNode glue2tree, std::list<ComputingServiceType>& targets) {
-
-    XMLNode GLUEService = glue2tree;
-    if(GLUEService.Name() != "ComputingService") {
-      GLUEService = glue2tree["ComputingService"];
+  void GLUE2::ParseComputingService(XMLNode xService, ComputingServiceType& cs) {
+    if (xService["ID"]) {
+      cs->ID = (std::string)xService["ID"];
     }
+    if (xService["Name"]) {
+      cs->Name = (std::string)xService["Name"];
+    }
+    if (xService["Capability"]) {
+      for (XMLNode n = xService["Capability"]; n; ++n) {
+        cs->Capability.insert((std::string)n);
+      }
+    }
+    if (xService["Type"]) {
+      cs->Type = (std::string)xService["Type"];
+    } else {
+      logger.msg(VERBOSE, "The Service doesn't advertise its Type.");
+    }
+    if (xService["QualityLevel"]) {
+      cs->QualityLevel = (std::string)xService["QualityLevel"];
+    } else {
+      logger.msg(VERBOSE, "The ComputingService doesn't advertise its Quality Level.");
+    }
+    if (xService["TotalJobs"]) {
+      cs->TotalJobs = stringtoi((std::string)xService["TotalJobs"]);
+    }
+    if (xService["RunningJobs"]) {
+      cs->RunningJobs = stringtoi((std::string)xService["RunningJobs"]);
+    }
+    if (xService["WaitingJobs"]) {
+      cs->WaitingJobs = stringtoi((std::string)xService["WaitingJobs"]);
+    }
+    if (xService["StagingJobs"]) {
+      cs->StagingJobs = stringtoi((std::string)xService["StagingJobs"]);
+    }
+    if (xService["SuspendedJobs"]) {
+      cs->SuspendedJobs = stringtoi((std::string)xService["SuspendedJobs"]);
+    }
+    if (xService["PreLRMSWaitingJobs"]) {
+      cs->PreLRMSWaitingJobs = stringtoi((std::string)xService["PreLRMSWaitingJobs"]);
+    }
+    // The GLUE2 specification does not have attribute ComputingService.LocalRunningJobs
+    //if (xService["LocalRunningJobs"]) {
+    //  cs->LocalRunningJobs = stringtoi((std::string)xService["LocalRunningJobs"]);
+    //}
+    // The GLUE2 specification does not have attribute ComputingService.LocalWaitingJobs
+    //if (xService["LocalWaitingJobs"]) {
+    //  cs->LocalWaitingJobs = stringtoi((std::string)xService["LocalWaitingJobs"]);
+    //}
+    // The GLUE2 specification does not have attribute ComputingService.LocalSuspendedJobs
+    //if (xService["LocalSuspendedJobs"]) {
+    //  cs->LocalWaitingJobs = stringtoi((std::string)xService["LocalSuspendedJobs"]);
+    //}
+  }
 
-    for (; GLUEService; ++GLUEService) {
-      ComputingServiceType cs;
-
-      if (GLUEService["ID"]) {
-        cs->ID = (std::string)GLUEService["ID"];
+  void GLUE2::ParseComputingEndpoint(XMLNode xEndpoint, ComputingEndpointType& ComputingEndpoint) {
+    if (xEndpoint["URL"]) {
+      ComputingEndpoint->URLString = (std::string)xEndpoint["URL"];
+    } else {
+      logger.msg(VERBOSE, "The ComputingEndpoint has no URL.");
+    }
+    if (xEndpoint["HealthState"]) {
+      ComputingEndpoint->HealthState = (std::string)xEndpoint["HealthState"];
+    } else {
+      logger.msg(VERBOSE, "The Service advertises no Health State.");
+    }
+    if (xEndpoint["HealthStateInfo"]) {
+      ComputingEndpoint->HealthStateInfo = (std::string)xEndpoint["HealthStateInfo"];
+    }
+    if (xEndpoint["Capability"]) {
+      for (XMLNode n = xEndpoint["Capability"]; n; ++n) {
+        ComputingEndpoint->Capability.insert((std::string)n);
       }
-      if (GLUEService["Name"]) {
-        cs->Name = (std::string)GLUEService["Name"];
+    }
+    if (xEndpoint["QualityLevel"]) {
+      ComputingEndpoint->QualityLevel = (std::string)xEndpoint["QualityLevel"];
+    } else {
+      logger.msg(VERBOSE, "The ComputingEndpoint doesn't advertise its Quality Level.");
+    }
+
+    if (xEndpoint["Technology"]) {
+      ComputingEndpoint->Technology = (std::string)xEndpoint["Technology"];
+    }
+    if (xEndpoint["InterfaceName"]) {
+      ComputingEndpoint->InterfaceName = lower((std::string)xEndpoint["InterfaceName"]);
+    } else if (xEndpoint["Interface"]) { // No such attribute according to GLUE2 document. Legacy/backward compatibility?
+      ComputingEndpoint->InterfaceName = lower((std::string)xEndpoint["Interface"]);
+    } else {
+      logger.msg(VERBOSE, "The ComputingService doesn't advertise its Interface.");
+    }
+    if (xEndpoint["InterfaceVersion"]) {
+      for (XMLNode n = xEndpoint["InterfaceVersion"]; n; ++n) {
+        ComputingEndpoint->InterfaceVersion.push_back((std::string)n);
       }
-      if (GLUEService["Capability"]) {
-        for (XMLNode n = GLUEService["Capability"]; n; ++n) {
-          cs->Capability.insert((std::string)n);
-        }
+    }
+    if (xEndpoint["InterfaceExtension"]) {
+      for (XMLNode n = xEndpoint["InterfaceExtension"]; n; ++n) {
+        ComputingEndpoint->InterfaceExtension.push_back((std::string)n);
       }
-      if (GLUEService["Type"]) {
-        cs->Type = (std::string)GLUEService["Type"];
-      } else {
-        logger.msg(VERBOSE, "The Service doesn't advertise its Type.");
+    }
+    if (xEndpoint["SupportedProfile"]) {
+      for (XMLNode n = xEndpoint["SupportedProfile"]; n; ++n) {
+        ComputingEndpoint->SupportedProfile.push_back((std::string)n);
       }
-      if (GLUEService["QualityLevel"]) {
-        cs->QualityLevel = (std::string)GLUEService["QualityLevel"];
+    }
+    if (xEndpoint["Implementor"]) {
+      ComputingEndpoint->Implementor = (std::string)xEndpoint["Implementor"];
+    }
+    if (xEndpoint["ImplementationName"]) {
+      if (xEndpoint["ImplementationVersion"]) {
+        ComputingEndpoint->Implementation =
+          Software((std::string)xEndpoint["ImplementationName"],
+                   (std::string)xEndpoint["ImplementationVersion"]);
       } else {
-        logger.msg(VERBOSE, "The ComputingService doesn't advertise its Quality Level.");
+        ComputingEndpoint->Implementation = Software((std::string)xEndpoint["ImplementationName"]);
       }
-      if (GLUEService["TotalJobs"]) {
-        cs->TotalJobs = stringtoi((std::string)GLUEService["TotalJobs"]);
+    }
+    if (xEndpoint["ServingState"]) {
+      ComputingEndpoint->ServingState = (std::string)xEndpoint["ServingState"];
+    } else {
+      logger.msg(VERBOSE, "The ComputingEndpoint doesn't advertise its Serving State.");
+    }
+    if (xEndpoint["IssuerCA"]) {
+      ComputingEndpoint->IssuerCA = (std::string)xEndpoint["IssuerCA"];
+    }
+    if (xEndpoint["TrustedCA"]) {
+      XMLNode n = xEndpoint["TrustedCA"];
+      while (n) {
+        // Workaround to drop non-conforming records generated by EGI services
+        std::string subject = (std::string)n;
+        if(CheckConformingDN(subject)) {
+          ComputingEndpoint->TrustedCA.push_back(subject);
+        }
+        ++n; //The increment operator works in an unusual manner (returns void)
       }
-      if (GLUEService["RunningJobs"]) {
-        cs->RunningJobs = stringtoi((std::string)GLUEService["RunningJobs"]);
+    }
+    if (xEndpoint["DowntimeStart"]) {
+      ComputingEndpoint->DowntimeStarts = (std::string)xEndpoint["DowntimeStart"];
+    }
+    if (xEndpoint["DowntimeEnd"]) {
+      ComputingEndpoint->DowntimeEnds = (std::string)xEndpoint["DowntimeEnd"];
+    }
+    if (xEndpoint["Staging"]) {
+      ComputingEndpoint->Staging = (std::string)xEndpoint["Staging"];
+    }
+    if (xEndpoint["JobDescription"]) {
+      for (XMLNode n = xEndpoint["JobDescription"]; n; ++n) {
+        ComputingEndpoint->JobDescriptions.push_back((std::string)n);
       }
-      if (GLUEService["WaitingJobs"]) {
-        cs->WaitingJobs = stringtoi((std::string)GLUEService["WaitingJobs"]);
+    }
+
+    if (xEndpoint["TotalJobs"]) {
+      ComputingEndpoint->TotalJobs = stringtoi((std::string)xEndpoint["TotalJobs"]);
+    }
+    if (xEndpoint["RunningJobs"]) {
+      ComputingEndpoint->RunningJobs = stringtoi((std::string)xEndpoint["RunningJobs"]);
+    }
+    if (xEndpoint["WaitingJobs"]) {
+      ComputingEndpoint->WaitingJobs = stringtoi((std::string)xEndpoint["WaitingJobs"]);
+    }
+    if (xEndpoint["StagingJobs"]) {
+      ComputingEndpoint->StagingJobs = stringtoi((std::string)xEndpoint["StagingJobs"]);
+    }
+    if (xEndpoint["SuspendedJobs"]) {
+      ComputingEndpoint->SuspendedJobs = stringtoi((std::string)xEndpoint["SuspendedJobs"]);
+    }
+    if (xEndpoint["PreLRMSWaitingJobs"]) {
+      ComputingEndpoint->PreLRMSWaitingJobs = stringtoi((std::string)xEndpoint["PreLRMSWaitingJobs"]);
+    }
+    // The GLUE2 specification does not have attribute ComputingEndpoint.LocalRunningJobs
+    //if (xEndpoint["LocalRunningJobs"]) {
+    //  ComputingEndpoint->LocalRunningJobs = stringtoi((std::string)xEndpoint["LocalRunningJobs"]);
+    //}
+    // The GLUE2 specification does not have attribute ComputingEndpoint.LocalWaitingJobs
+    //if (xEndpoint["LocalWaitingJobs"]) {
+    //  ComputingEndpoint->LocalWaitingJobs = stringtoi((std::string)xEndpoint["LocalWaitingJobs"]);
+    //}
+    // The GLUE2 specification does not have attribute ComputingEndpoint.LocalSuspendedJobs
+    //if (xEndpoint["LocalSuspendedJobs"]) {
+    //  ComputingEndpoint->LocalSuspendedJobs = stringtoi((std::string)xEndpoint["LocalSuspendedJobs"]);
+    //}
+  }
+
+  void GLUE2::ParseComputingShare(XMLNode xComputingShare, ComputingShareType& ComputingShare) {
+    if (xComputingShare["FreeSlots"]) {
+      ComputingShare->FreeSlots = stringtoi((std::string)xComputingShare["FreeSlots"]);
+    }
+    if (xComputingShare["FreeSlotsWithDuration"]) {
+      // Format: ns[:t] [ns[:t]]..., where ns is number of slots and t is the duration.
+      ComputingShare->FreeSlotsWithDuration.clear();
+
+      const std::string fswdValue = (std::string)xComputingShare["FreeSlotsWithDuration"];
+      std::list<std::string> fswdList;
+      tokenize(fswdValue, fswdList);
+      for (std::list<std::string>::iterator it = fswdList.begin();
+           it != fswdList.end(); it++) {
+        std::list<std::string> fswdPair;
+        tokenize(*it, fswdPair, ":");
+        long duration = LONG_MAX;
+        int freeSlots = 0;
+        if (fswdPair.size() > 2 || !stringto(fswdPair.front(), freeSlots) || (fswdPair.size() == 2 && !stringto(fswdPair.back(), duration)) ) {
+          logger.msg(VERBOSE, "The \"FreeSlotsWithDuration\" attribute published by \"%s\" is wrongly formatted. Ignoring it.");
+          logger.msg(DEBUG, "Wrong format of the \"FreeSlotsWithDuration\" = \"%s\" (\"%s\")", fswdValue, *it);
+          continue;
+        }
+
+        ComputingShare->FreeSlotsWithDuration[Period(duration)] = freeSlots;
       }
-      if (GLUEService["StagingJobs"]) {
-        cs->StagingJobs = stringtoi((std::string)GLUEService["StagingJobs"]);
+    }
+    if (xComputingShare["UsedSlots"]) {
+      ComputingShare->UsedSlots = stringtoi((std::string)xComputingShare["UsedSlots"]);
+    }
+    if (xComputingShare["RequestedSlots"]) {
+      ComputingShare->RequestedSlots = stringtoi((std::string)xComputingShare["RequestedSlots"]);
+    }
+    if (xComputingShare["Name"]) {
+      ComputingShare->Name = (std::string)xComputingShare["Name"];
+    }
+    if (xComputingShare["MappingQueue"]) {
+      ComputingShare->MappingQueue = (std::string)xComputingShare["MappingQueue"];
+    }
+    if (xComputingShare["MaxWallTime"]) {
+      ComputingShare->MaxWallTime = (std::string)xComputingShare["MaxWallTime"];
+    }
+    if (xComputingShare["MaxTotalWallTime"]) {
+      ComputingShare->MaxTotalWallTime = (std::string)xComputingShare["MaxTotalWallTime"];
+    }
+    if (xComputingShare["MinWallTime"]) {
+      ComputingShare->MinWallTime = (std::string)xComputingShare["MinWallTime"];
+    }
+    if (xComputingShare["DefaultWallTime"]) {
+      ComputingShare->DefaultWallTime = (std::string)xComputingShare["DefaultWallTime"];
+    }
+    if (xComputingShare["MaxCPUTime"]) {
+      ComputingShare->MaxCPUTime = (std::string)xComputingShare["MaxCPUTime"];
+    }
+    if (xComputingShare["MaxTotalCPUTime"]) {
+      ComputingShare->MaxTotalCPUTime = (std::string)xComputingShare["MaxTotalCPUTime"];
+    }
+    if (xComputingShare["MinCPUTime"]) {
+      ComputingShare->MinCPUTime = (std::string)xComputingShare["MinCPUTime"];
+    }
+    if (xComputingShare["DefaultCPUTime"]) {
+      ComputingShare->DefaultCPUTime = (std::string)xComputingShare["DefaultCPUTime"];
+    }
+    if (xComputingShare["MaxTotalJobs"]) {
+      ComputingShare->MaxTotalJobs = stringtoi((std::string)xComputingShare["MaxTotalJobs"]);
+    }
+    if (xComputingShare["MaxRunningJobs"]) {
+      ComputingShare->MaxRunningJobs = stringtoi((std::string)xComputingShare["MaxRunningJobs"]);
+    }
+    if (xComputingShare["MaxWaitingJobs"]) {
+      ComputingShare->MaxWaitingJobs = stringtoi((std::string)xComputingShare["MaxWaitingJobs"]);
+    }
+    if (xComputingShare["MaxPreLRMSWaitingJobs"]) {
+      ComputingShare->MaxPreLRMSWaitingJobs = stringtoi((std::string)xComputingShare["MaxPreLRMSWaitingJobs"]);
+    }
+    if (xComputingShare["MaxUserRunningJobs"]) {
+      ComputingShare->MaxUserRunningJobs = stringtoi((std::string)xComputingShare["MaxUserRunningJobs"]);
+    }
+    if (xComputingShare["MaxSlotsPerJob"]) {
+      ComputingShare->MaxSlotsPerJob = stringtoi((std::string)xComputingShare["MaxSlotsPerJob"]);
+    }
+    if (xComputingShare["MaxStageInStreams"]) {
+      ComputingShare->MaxStageInStreams = stringtoi((std::string)xComputingShare["MaxStageInStreams"]);
+    }
+    if (xComputingShare["MaxStageOutStreams"]) {
+      ComputingShare->MaxStageOutStreams = stringtoi((std::string)xComputingShare["MaxStageOutStreams"]);
+    }
+    if (xComputingShare["SchedulingPolicy"]) {
+      ComputingShare->SchedulingPolicy = (std::string)xComputingShare["SchedulingPolicy"];
+    }
+    if (xComputingShare["MaxMainMemory"]) {
+      ComputingShare->MaxMainMemory = stringtoi((std::string)xComputingShare["MaxMainMemory"]);
+    }
+    if (xComputingShare["MaxVirtualMemory"]) {
+      ComputingShare->MaxVirtualMemory = stringtoi((std::string)xComputingShare["MaxVirtualMemory"]);
+    }
+    if (xComputingShare["MaxDiskSpace"]) {
+      ComputingShare->MaxDiskSpace = stringtoi((std::string)xComputingShare["MaxDiskSpace"]);
+    }
+    if (xComputingShare["DefaultStorageService"]) {
+      ComputingShare->DefaultStorageService = (std::string)xComputingShare["DefaultStorageService"];
+    }
+    if (xComputingShare["Preemption"]) {
+      ComputingShare->Preemption = ((std::string)xComputingShare["Preemption"] == "true") ? true : false;
+    }
+    if (xComputingShare["EstimatedAverageWaitingTime"]) {
+      ComputingShare->EstimatedAverageWaitingTime = (std::string)xComputingShare["EstimatedAverageWaitingTime"];
+    }
+    if (xComputingShare["EstimatedWorstWaitingTime"]) {
+      ComputingShare->EstimatedWorstWaitingTime = stringtoi((std::string)xComputingShare["EstimatedWorstWaitingTime"]);
+    }
+    if (xComputingShare["ReservationPolicy"]) {
+      ComputingShare->ReservationPolicy = stringtoi((std::string)xComputingShare["ReservationPolicy"]);
+    }
+  }
+
+  void GLUE2::ParseComputingManager(XMLNode xComputingManager, ComputingManagerType& ComputingManager) {
+    if (xComputingManager["ProductName"]) {
+      ComputingManager->ProductName = (std::string)xComputingManager["ProductName"];
+    }
+    // The GlUE2 specification does not have attribute ComputingManager.Type
+    //if (xComputingManager["Type"]) {
+    //  ComputingManager->Type = (std::string)xComputingManager["Type"];
+    //}
+    if (xComputingManager["ProductVersion"]) {
+      ComputingManager->ProductVersion = (std::string)xComputingManager["ProductVersion"];
+    }
+    if (xComputingManager["Reservation"]) {
+      ComputingManager->Reservation = ((std::string)xComputingManager["Reservation"] == "true");
+    }
+    if (xComputingManager["BulkSubmission"]) {
+      ComputingManager->BulkSubmission = ((std::string)xComputingManager["BulkSubmission"] == "true");
+    }
+    if (xComputingManager["TotalPhysicalCPUs"]) {
+      ComputingManager->TotalPhysicalCPUs = stringtoi((std::string)xComputingManager["TotalPhysicalCPUs"]);
+    }
+    if (xComputingManager["TotalLogicalCPUs"]) {
+      ComputingManager->TotalLogicalCPUs = stringtoi((std::string)xComputingManager["TotalLogicalCPUs"]);
+    }
+    if (xComputingManager["TotalSlots"]) {
+      ComputingManager->TotalSlots = stringtoi((std::string)xComputingManager["TotalSlots"]);
+    }
+    if (xComputingManager["Homogeneous"]) {
+      ComputingManager->Homogeneous = ((std::string)xComputingManager["Homogeneous"] == "true");
+    }
+    if (xComputingManager["NetworkInfo"]) {
+      for (XMLNode n = xComputingManager["NetworkInfo"]; n; ++n) {
+        ComputingManager->NetworkInfo.push_back((std::string)n);
       }
-      if (GLUEService["SuspendedJobs"]) {
-        cs->SuspendedJobs = stringtoi((std::string)GLUEService["SuspendedJobs"]);
+    }
+    if (xComputingManager["WorkingAreaShared"]) {
+      ComputingManager->WorkingAreaShared = ((std::string)xComputingManager["WorkingAreaShared"] == "true");
+    }
+    if (xComputingManager["WorkingAreaFree"]) {
+      ComputingManager->WorkingAreaFree = stringtoi((std::string)xComputingManager["WorkingAreaFree"]);
+    }
+    if (xComputingManager["WorkingAreaTotal"]) {
+      ComputingManager->WorkingAreaTotal = stringtoi((std::string)xComputingManager["WorkingAreaTotal"]);
+    }
+    if (xComputingManager["WorkingAreaLifeTime"]) {
+      ComputingManager->WorkingAreaLifeTime = (std::string)xComputingManager["WorkingAreaLifeTime"];
+    }
+    if (xComputingManager["CacheFree"]) {
+      ComputingManager->CacheFree = stringtoi((std::string)xComputingManager["CacheFree"]);
+    }
+    if (xComputingManager["CacheTotal"]) {
+      ComputingManager->CacheTotal = stringtoi((std::string)xComputingManager["CacheTotal"]);
+    }
+  }
+
+  void GLUE2::ParseBenchmark(XMLNode n, ComputingManagerType& ComputingManager) {
+    double value;
+    if (n["Type"] && n["Value"] &&
+        stringto((std::string)n["Value"], value)) {
+      (*ComputingManager.Benchmarks)[(std::string)n["Type"]] = value;
+    } else {
+      logger.msg(VERBOSE, "Couldn't parse benchmark XML:\n%s", (std::string)n);
+    }
+  }
+
+  void GLUE2::ParseApplicationEnvironment(XMLNode n, ComputingManagerType& ComputingManager) {
+    ApplicationEnvironment ae((std::string)n["AppName"], (std::string)n["AppVersion"]);
+    ae.State = (std::string)n["State"];
+    if (n["FreeSlots"]) {
+      ae.FreeSlots = stringtoi((std::string)n["FreeSlots"]);
+    }
+    //else {
+    //  ae.FreeSlots = ComputingShare->FreeSlots; // Non compatible??, i.e. a ComputingShare is unrelated to the ApplicationEnvironment.
+    //}
+    if (n["FreeJobs"]) {
+      ae.FreeJobs = stringtoi((std::string)n["FreeJobs"]);
+    } else {
+      ae.FreeJobs = -1;
+    }
+    if (n["FreeUserSeats"]) {
+      ae.FreeUserSeats = stringtoi((std::string)n["FreeUserSeats"]);
+    } else {
+      ae.FreeUserSeats = -1;
+    }
+    ComputingManager.ApplicationEnvironments->push_back(ae);
+  }
+
+  void GLUE2::ParseExecutionEnvironment(XMLNode xEnvironment, ExecutionEnvironmentType& ExecutionEnvironment) {
+    if (xEnvironment["Platform"]) {
+      ExecutionEnvironment->Platform = (std::string)xEnvironment["Platform"];
+    }
+
+    if (xEnvironment["MainMemorySize"]) {
+      ExecutionEnvironment->MainMemorySize = stringtoi((std::string)xEnvironment["MainMemorySize"]);
+    }
+
+    if (xEnvironment["OSName"]) {
+      if (xEnvironment["OSVersion"]) {
+        if (xEnvironment["OSFamily"]) {
+          ExecutionEnvironment->OperatingSystem = Software((std::string)xEnvironment["OSFamily"],
+                                                           (std::string)xEnvironment["OSName"],
+                                                           (std::string)xEnvironment["OSVersion"]);
+        }
+        else {
+          ExecutionEnvironment->OperatingSystem = Software((std::string)xEnvironment["OSName"],
+                                                           (std::string)xEnvironment["OSVersion"]);
+        }
       }
-      if (GLUEService["PreLRMSWaitingJobs"]) {
-        cs->PreLRMSWaitingJobs = stringtoi((std::string)GLUEService["PreLRMSWaitingJobs"]);
+      else {
+        ExecutionEnvironment->OperatingSystem = Software((std::string)xEnvironment["OSName"]);
       }
-      // The GLUE2 specification does not have attribute ComputingService.LocalRunningJobs
-      //if (GLUEService["LocalRunningJobs"]) {
-      //  cs->LocalRunningJobs = stringtoi((std::string)GLUEService["LocalRunningJobs"]);
-      //}
-      // The GLUE2 specification does not have attribute ComputingService.LocalWaitingJobs
-      //if (GLUEService["LocalWaitingJobs"]) {
-      //  cs->LocalWaitingJobs = stringtoi((std::string)GLUEService["LocalWaitingJobs"]);
-      //}
-      // The GLUE2 specification does not have attribute ComputingService.LocalSuspendedJobs
-      //if (GLUEService["LocalSuspendedJobs"]) {
-      //  cs->LocalWaitingJobs = stringtoi((std::string)GLUEService["LocalSuspendedJobs"]);
-      //}
+    }
+
+    if (xEnvironment["ConnectivityIn"]) {
+      ExecutionEnvironment->ConnectivityIn = (lower((std::string)xEnvironment["ConnectivityIn"]) == "true");
+    }
+
+    if (xEnvironment["ConnectivityOut"]) {
+      ExecutionEnvironment->ConnectivityOut = (lower((std::string)xEnvironment["ConnectivityOut"]) == "true");
+    }
+  }
+
+  void GLUE2::ParseExecutionTargets(XMLNode glue2tree, std::list<ComputingServiceType>& targets) {
+
+    XMLNode GLUEService = glue2tree;
+    if(GLUEService.Name() != "ComputingService") {
+      GLUEService = glue2tree["ComputingService"];
+    }
 
+    for (; GLUEService; ++GLUEService) {
+      ComputingServiceType cs;
+      ParseComputingService(GLUEService, cs);
 
       XMLNode xmlCENode = GLUEService["ComputingEndpoint"];
       int endpointID = 0;
       for(;(bool)xmlCENode;++xmlCENode) {
         ComputingEndpointType ComputingEndpoint;
-        if (xmlCENode["URL"]) {
-          ComputingEndpoint->URLString = (std::string)xmlCENode["URL"];
-        } else {
-          logger.msg(VERBOSE, "The ComputingEndpoint has no URL.");
-        }
-        if (xmlCENode["HealthState"]) {
-          ComputingEndpoint->HealthState = (std::string)xmlCENode["HealthState"];
-        } else {
-          logger.msg(VERBOSE, "The Service advertises no Health State.");
-        }
-        if (xmlCENode["HealthStateInfo"]) {
-          ComputingEndpoint->HealthStateInfo = (std::string)xmlCENode["HealthStateInfo"];
-        }
-        if (xmlCENode["Capability"]) {
-          for (XMLNode n = xmlCENode["Capability"]; n; ++n) {
-            ComputingEndpoint->Capability.insert((std::string)n);
-          }
-        }
-        if (xmlCENode["QualityLevel"]) {
-          ComputingEndpoint->QualityLevel = (std::string)xmlCENode["QualityLevel"];
-        } else {
-          logger.msg(VERBOSE, "The ComputingEndpoint doesn't advertise its Quality Level.");
-        }
-
-        if (xmlCENode["Technology"]) {
-          ComputingEndpoint->Technology = (std::string)xmlCENode["Technology"];
-        }
-        if (xmlCENode["InterfaceName"]) {
-          ComputingEndpoint->InterfaceName = lower((std::string)xmlCENode["InterfaceName"]);
-        } else if (xmlCENode["Interface"]) { // No such attribute according to GLUE2 document. Legacy/backward compatibility?
-          ComputingEndpoint->InterfaceName = lower((std::string)xmlCENode["Interface"]);
-        } else {
-          logger.msg(VERBOSE, "The ComputingService doesn't advertise its Interface.");
-        }
-        if (xmlCENode["InterfaceVersion"]) {
-          for (XMLNode n = xmlCENode["InterfaceVersion"]; n; ++n) {
-            ComputingEndpoint->InterfaceVersion.push_back((std::string)n);
-          }
-        }
-        if (xmlCENode["InterfaceExtension"]) {
-          for (XMLNode n = xmlCENode["InterfaceExtension"]; n; ++n) {
-            ComputingEndpoint->InterfaceExtension.push_back((std::string)n);
-          }
-        }
-        if (xmlCENode["SupportedProfile"]) {
-          for (XMLNode n = xmlCENode["SupportedProfile"]; n; ++n) {
-            ComputingEndpoint->SupportedProfile.push_back((std::string)n);
-          }
-        }
-        if (xmlCENode["Implementor"]) {
-          ComputingEndpoint->Implementor = (std::string)xmlCENode["Implementor"];
-        }
-        if (xmlCENode["ImplementationName"]) {
-          if (xmlCENode["ImplementationVersion"]) {
-            ComputingEndpoint->Implementation =
-              Software((std::string)xmlCENode["ImplementationName"],
-                       (std::string)xmlCENode["ImplementationVersion"]);
-          } else {
-            ComputingEndpoint->Implementation = Software((std::string)xmlCENode["ImplementationName"]);
-          }
-        }
-        if (xmlCENode["ServingState"]) {
-          ComputingEndpoint->ServingState = (std::string)xmlCENode["ServingState"];
-        } else {
-          logger.msg(VERBOSE, "The ComputingEndpoint doesn't advertise its Serving State.");
-        }
-        if (xmlCENode["IssuerCA"]) {
-          ComputingEndpoint->IssuerCA = (std::string)xmlCENode["IssuerCA"];
-        }
-        if (xmlCENode["TrustedCA"]) {
-          XMLNode n = xmlCENode["TrustedCA"];
-          while (n) {
-            // Workaround to drop non-conforming records generated by EGI services
-            std::string subject = (std::string)n;
-            if(CheckConformingDN(subject)) {
-              ComputingEndpoint->TrustedCA.push_back(subject);
-            }
-            ++n; //The increment operator works in an unusual manner (returns void)
-          }
-        }
-        if (xmlCENode["DowntimeStart"]) {
-          ComputingEndpoint->DowntimeStarts = (std::string)xmlCENode["DowntimeStart"];
-        }
-        if (xmlCENode["DowntimeEnd"]) {
-          ComputingEndpoint->DowntimeEnds = (std::string)xmlCENode["DowntimeEnd"];
-        }
-        if (xmlCENode["Staging"]) {
-          ComputingEndpoint->Staging = (std::string)xmlCENode["Staging"];
-        }
-        if (xmlCENode["JobDescription"]) {
-          for (XMLNode n = xmlCENode["JobDescription"]; n; ++n) {
-            ComputingEndpoint->JobDescriptions.push_back((std::string)n);
-          }
-        }
-
-        if (xmlCENode["TotalJobs"]) {
-          ComputingEndpoint->TotalJobs = stringtoi((std::string)xmlCENode["TotalJobs"]);
-        }
-        if (xmlCENode["RunningJobs"]) {
-          ComputingEndpoint->RunningJobs = stringtoi((std::string)xmlCENode["RunningJobs"]);
-        }
-        if (xmlCENode["WaitingJobs"]) {
-          ComputingEndpoint->WaitingJobs = stringtoi((std::string)xmlCENode["WaitingJobs"]);
-        }
-        if (xmlCENode["StagingJobs"]) {
-          ComputingEndpoint->StagingJobs = stringtoi((std::string)xmlCENode["StagingJobs"]);
-        }
-        if (xmlCENode["SuspendedJobs"]) {
-          ComputingEndpoint->SuspendedJobs = stringtoi((std::string)xmlCENode["SuspendedJobs"]);
-        }
-        if (xmlCENode["PreLRMSWaitingJobs"]) {
-          ComputingEndpoint->PreLRMSWaitingJobs = stringtoi((std::string)xmlCENode["PreLRMSWaitingJobs"]);
-        }
-        // The GLUE2 specification does not have attribute ComputingEndpoint.LocalRunningJobs
-        //if (xmlCENode["LocalRunningJobs"]) {
-        //  ComputingEndpoint->LocalRunningJobs = stringtoi((std::string)xmlCENode["LocalRunningJobs"]);
-        //}
-        // The GLUE2 specification does not have attribute ComputingEndpoint.LocalWaitingJobs
-        //if (xmlCENode["LocalWaitingJobs"]) {
-        //  ComputingEndpoint->LocalWaitingJobs = stringtoi((std::string)xmlCENode["LocalWaitingJobs"]);
-        //}
-        // The GLUE2 specification does not have attribute ComputingEndpoint.LocalSuspendedJobs
-        //if (xmlCENode["LocalSuspendedJobs"]) {
-        //  ComputingEndpoint->LocalSuspendedJobs = stringtoi((std::string)xmlCENode["LocalSuspendedJobs"]);
-        //}
-
+        ParseComputingEndpoint(xmlCENode, ComputingEndpoint);
         cs.ComputingEndpoint.insert(std::pair<int, ComputingEndpointType>(endpointID++, ComputingEndpoint));
       }
 
@@ -226,120 +469,7 @@ namespace Arc {
       int shareID = 0;
       for (;(bool)xComputingShare;++xComputingShare) {
         ComputingShareType ComputingShare;
-
-        if (xComputingShare["FreeSlots"]) {
-          ComputingShare->FreeSlots = stringtoi((std::string)xComputingShare["FreeSlots"]);
-        }
-        if (xComputingShare["FreeSlotsWithDuration"]) {
-          // Format: ns[:t] [ns[:t]]..., where ns is number of slots and t is the duration.
-          ComputingShare->FreeSlotsWithDuration.clear();
-
-          const std::string fswdValue = (std::string)xComputingShare["FreeSlotsWithDuration"];
-          std::list<std::string> fswdList;
-          tokenize(fswdValue, fswdList);
-          for (std::list<std::string>::iterator it = fswdList.begin();
-               it != fswdList.end(); it++) {
-            std::list<std::string> fswdPair;
-            tokenize(*it, fswdPair, ":");
-            long duration = LONG_MAX;
-            int freeSlots = 0;
-            if (fswdPair.size() > 2 || !stringto(fswdPair.front(), freeSlots) || (fswdPair.size() == 2 && !stringto(fswdPair.back(), duration)) ) {
-              logger.msg(VERBOSE, "The \"FreeSlotsWithDuration\" attribute published by \"%s\" is wrongly formatted. Ignoring it.");
-              logger.msg(DEBUG, "Wrong format of the \"FreeSlotsWithDuration\" = \"%s\" (\"%s\")", fswdValue, *it);
-              continue;
-            }
-
-            ComputingShare->FreeSlotsWithDuration[Period(duration)] = freeSlots;
-          }
-        }
-        if (xComputingShare["UsedSlots"]) {
-          ComputingShare->UsedSlots = stringtoi((std::string)xComputingShare["UsedSlots"]);
-        }
-        if (xComputingShare["RequestedSlots"]) {
-          ComputingShare->RequestedSlots = stringtoi((std::string)xComputingShare["RequestedSlots"]);
-        }
-        if (xComputingShare["Name"]) {
-          ComputingShare->Name = (std::string)xComputingShare["Name"];
-        }
-        if (xComputingShare["MappingQueue"]) {
-          ComputingShare->MappingQueue = (std::string)xComputingShare["MappingQueue"];
-        }
-        if (xComputingShare["MaxWallTime"]) {
-          ComputingShare->MaxWallTime = (std::string)xComputingShare["MaxWallTime"];
-        }
-        if (xComputingShare["MaxTotalWallTime"]) {
-          ComputingShare->MaxTotalWallTime = (std::string)xComputingShare["MaxTotalWallTime"];
-        }
-        if (xComputingShare["MinWallTime"]) {
-          ComputingShare->MinWallTime = (std::string)xComputingShare["MinWallTime"];
-        }
-        if (xComputingShare["DefaultWallTime"]) {
-          ComputingShare->DefaultWallTime = (std::string)xComputingShare["DefaultWallTime"];
-        }
-        if (xComputingShare["MaxCPUTime"]) {
-          ComputingShare->MaxCPUTime = (std::string)xComputingShare["MaxCPUTime"];
-        }
-        if (xComputingShare["MaxTotalCPUTime"]) {
-          ComputingShare->MaxTotalCPUTime = (std::string)xComputingShare["MaxTotalCPUTime"];
-        }
-        if (xComputingShare["MinCPUTime"]) {
-          ComputingShare->MinCPUTime = (std::string)xComputingShare["MinCPUTime"];
-        }
-        if (xComputingShare["DefaultCPUTime"]) {
-          ComputingShare->DefaultCPUTime = (std::string)xComputingShare["DefaultCPUTime"];
-        }
-        if (xComputingShare["MaxTotalJobs"]) {
-          ComputingShare->MaxTotalJobs = stringtoi((std::string)xComputingShare["MaxTotalJobs"]);
-        }
-        if (xComputingShare["MaxRunningJobs"]) {
-          ComputingShare->MaxRunningJobs = stringtoi((std::string)xComputingShare["MaxRunningJobs"]);
-        }
-        if (xComputingShare["MaxWaitingJobs"]) {
-          ComputingShare->MaxWaitingJobs = stringtoi((std::string)xComputingShare["MaxWaitingJobs"]);
-        }
-        if (xComputingShare["MaxPreLRMSWaitingJobs"]) {
-          ComputingShare->MaxPreLRMSWaitingJobs = stringtoi((std::string)xComputingShare["MaxPreLRMSWaitingJobs"]);
-        }
-        if (xComputingShare["MaxUserRunningJobs"]) {
-          ComputingShare->MaxUserRunningJobs = stringtoi((std::string)xComputingShare["MaxUserRunningJobs"]);
-        }
-        if (xComputingShare["MaxSlotsPerJob"]) {
-          ComputingShare->MaxSlotsPerJob = stringtoi((std::string)xComputingShare["MaxSlotsPerJob"]);
-        }
-        if (xComputingShare["MaxStageInStreams"]) {
-          ComputingShare->MaxStageInStreams = stringtoi((std::string)xComputingShare["MaxStageInStreams"]);
-        }
-        if (xComputingShare["MaxStageOutStreams"]) {
-          ComputingShare->MaxStageOutStreams = stringtoi((std::string)xComputingShare["MaxStageOutStreams"]);
-        }
-        if (xComputingShare["SchedulingPolicy"]) {
-          ComputingShare->SchedulingPolicy = (std::string)xComputingShare["SchedulingPolicy"];
-        }
-        if (xComputingShare["MaxMainMemory"]) {
-          ComputingShare->MaxMainMemory = stringtoi((std::string)xComputingShare["MaxMainMemory"]);
-        }
-        if (xComputingShare["MaxVirtualMemory"]) {
-          ComputingShare->MaxVirtualMemory = stringtoi((std::string)xComputingShare["MaxVirtualMemory"]);
-        }
-        if (xComputingShare["MaxDiskSpace"]) {
-          ComputingShare->MaxDiskSpace = stringtoi((std::string)xComputingShare["MaxDiskSpace"]);
-        }
-        if (xComputingShare["DefaultStorageService"]) {
-          ComputingShare->DefaultStorageService = (std::string)xComputingShare["DefaultStorageService"];
-        }
-        if (xComputingShare["Preemption"]) {
-          ComputingShare->Preemption = ((std::string)xComputingShare["Preemption"] == "true") ? true : false;
-        }
-        if (xComputingShare["EstimatedAverageWaitingTime"]) {
-          ComputingShare->EstimatedAverageWaitingTime = (std::string)xComputingShare["EstimatedAverageWaitingTime"];
-        }
-        if (xComputingShare["EstimatedWorstWaitingTime"]) {
-          ComputingShare->EstimatedWorstWaitingTime = stringtoi((std::string)xComputingShare["EstimatedWorstWaitingTime"]);
-        }
-        if (xComputingShare["ReservationPolicy"]) {
-          ComputingShare->ReservationPolicy = stringtoi((std::string)xComputingShare["ReservationPolicy"]);
-        }
-
+        ParseComputingShare(xComputingShare, ComputingShare);
         cs.ComputingShare.insert(std::pair<int, ComputingShareType>(shareID++, ComputingShare));
       }
 
@@ -360,124 +490,18 @@ namespace Arc {
       int managerID = 0;
       for (XMLNode xComputingManager = GLUEService["ComputingManager"]; (bool)xComputingManager; ++xComputingManager) {
         ComputingManagerType ComputingManager;
-        if (xComputingManager["ProductName"]) {
-          ComputingManager->ProductName = (std::string)xComputingManager["ProductName"];
-        }
-        // The GlUE2 specification does not have attribute ComputingManager.Type
-        //if (xComputingManager["Type"]) {
-        //  ComputingManager->Type = (std::string)xComputingManager["Type"];
-        //}
-        if (xComputingManager["ProductVersion"]) {
-          ComputingManager->ProductVersion = (std::string)xComputingManager["ProductVersion"];
-        }
-        if (xComputingManager["Reservation"]) {
-          ComputingManager->Reservation = ((std::string)xComputingManager["Reservation"] == "true");
-        }
-        if (xComputingManager["BulkSubmission"]) {
-          ComputingManager->BulkSubmission = ((std::string)xComputingManager["BulkSubmission"] == "true");
-        }
-        if (xComputingManager["TotalPhysicalCPUs"]) {
-          ComputingManager->TotalPhysicalCPUs = stringtoi((std::string)xComputingManager["TotalPhysicalCPUs"]);
-        }
-        if (xComputingManager["TotalLogicalCPUs"]) {
-          ComputingManager->TotalLogicalCPUs = stringtoi((std::string)xComputingManager["TotalLogicalCPUs"]);
-        }
-        if (xComputingManager["TotalSlots"]) {
-          ComputingManager->TotalSlots = stringtoi((std::string)xComputingManager["TotalSlots"]);
-        }
-        if (xComputingManager["Homogeneous"]) {
-          ComputingManager->Homogeneous = ((std::string)xComputingManager["Homogeneous"] == "true");
-        }
-        if (xComputingManager["NetworkInfo"]) {
-          for (XMLNode n = xComputingManager["NetworkInfo"]; n; ++n) {
-            ComputingManager->NetworkInfo.push_back((std::string)n);
-          }
-        }
-        if (xComputingManager["WorkingAreaShared"]) {
-          ComputingManager->WorkingAreaShared = ((std::string)xComputingManager["WorkingAreaShared"] == "true");
-        }
-        if (xComputingManager["WorkingAreaFree"]) {
-          ComputingManager->WorkingAreaFree = stringtoi((std::string)xComputingManager["WorkingAreaFree"]);
-        }
-        if (xComputingManager["WorkingAreaTotal"]) {
-          ComputingManager->WorkingAreaTotal = stringtoi((std::string)xComputingManager["WorkingAreaTotal"]);
-        }
-        if (xComputingManager["WorkingAreaLifeTime"]) {
-          ComputingManager->WorkingAreaLifeTime = (std::string)xComputingManager["WorkingAreaLifeTime"];
-        }
-        if (xComputingManager["CacheFree"]) {
-          ComputingManager->CacheFree = stringtoi((std::string)xComputingManager["CacheFree"]);
-        }
-        if (xComputingManager["CacheTotal"]) {
-          ComputingManager->CacheTotal = stringtoi((std::string)xComputingManager["CacheTotal"]);
-        }
+        ParseComputingManager(xComputingManager, ComputingManager);
         for (XMLNode n = xComputingManager["Benchmark"]; n; ++n) {
-          double value;
-          if (n["Type"] && n["Value"] &&
-              stringto((std::string)n["Value"], value)) {
-            (*ComputingManager.Benchmarks)[(std::string)n["Type"]] = value;
-          } else {
-            logger.msg(VERBOSE, "Couldn't parse benchmark XML:\n%s", (std::string)n);
-            continue;
-          }
+          ParseBenchmark(n, ComputingManager);
         }
         for (XMLNode n = xComputingManager["ApplicationEnvironments"]["ApplicationEnvironment"]; n; ++n) {
-          ApplicationEnvironment ae((std::string)n["AppName"], (std::string)n["AppVersion"]);
-          ae.State = (std::string)n["State"];
-          if (n["FreeSlots"]) {
-            ae.FreeSlots = stringtoi((std::string)n["FreeSlots"]);
-          }
-          //else {
-          //  ae.FreeSlots = ComputingShare->FreeSlots; // Non compatible??, i.e. a ComputingShare is unrelated to the ApplicationEnvironment.
-          //}
-          if (n["FreeJobs"]) {
-            ae.FreeJobs = stringtoi((std::string)n["FreeJobs"]);
-          } else {
-            ae.FreeJobs = -1;
-          }
-          if (n["FreeUserSeats"]) {
-            ae.FreeUserSeats = stringtoi((std::string)n["FreeUserSeats"]);
-          } else {
-            ae.FreeUserSeats = -1;
-          }
-          ComputingManager.ApplicationEnvironments->push_back(ae);
+          ParseApplicationEnvironment(n, ComputingManager);
         }
 
         int eeID = 0;
         for (XMLNode xExecutionEnvironment = xComputingManager["ExecutionEnvironments"]["ExecutionEnvironment"]; (bool)xExecutionEnvironment; ++xExecutionEnvironment) {
           ExecutionEnvironmentType ExecutionEnvironment;
-          if (xExecutionEnvironment["Platform"]) {
-            ExecutionEnvironment->Platform = (std::string)xExecutionEnvironment["Platform"];
-          }
-
-          if (xExecutionEnvironment["MainMemorySize"]) {
-            ExecutionEnvironment->MainMemorySize = stringtoi((std::string)xExecutionEnvironment["MainMemorySize"]);
-          }
-
-          if (xExecutionEnvironment["OSName"]) {
-            if (xExecutionEnvironment["OSVersion"]) {
-              if (xExecutionEnvironment["OSFamily"]) {
-                ExecutionEnvironment->OperatingSystem = Software((std::string)xExecutionEnvironment["OSFamily"],
-                                                                 (std::string)xExecutionEnvironment["OSName"],
-                                                                 (std::string)xExecutionEnvironment["OSVersion"]);
-              }
-              else {
-                ExecutionEnvironment->OperatingSystem = Software((std::string)xExecutionEnvironment["OSName"],
-                                                                 (std::string)xExecutionEnvironment["OSVersion"]);
-              }
-            }
-            else {
-              ExecutionEnvironment->OperatingSystem = Software((std::string)xExecutionEnvironment["OSName"]);
-            }
-          }
-
-          if (xExecutionEnvironment["ConnectivityIn"]) {
-            ExecutionEnvironment->ConnectivityIn = (lower((std::string)xExecutionEnvironment["ConnectivityIn"]) == "true");
-          }
-
-          if (xExecutionEnvironment["ConnectivityOut"]) {
-            ExecutionEnvironment->ConnectivityOut = (lower((std::string)xExecutionEnvironment["ConnectivityOut"]) == "true");
-          }
+          ParseExecutionEnvironment(xExecutionEnvironment, ExecutionEnvironment);
           ComputingManager.ExecutionEnvironment.insert(std::pair<int, ExecutionEnvironmentType>(eeID++, ExecutionEnvironment));
         }
 
@@ -488,4 +512,206 @@ namespace Arc {
     }
   }
 
+  // Sequential reader of GLUE2 document. Simple attributes of every object
+  // are collected into small standalone XML tree which is then passed to
+  // same methods used for parsing complete tree. Only children of
+  // ComputingService and ComputingManager which are needed for
+  // ComputingServiceType are entered. All other subtrees are skipped
+  // without being built in memory.
+  class GLUE2::Reader {
+  public:
+    Reader(const char* buf, std::size_t size);
+    ~Reader();
+    bool Parse(std::list<ComputingServiceType>& targets);
+  private:
+    xmlTextReaderPtr reader;
+    bool failed;
+    std::string Name();
+    bool Child(int depth);
+    bool Leaf(std::string& value);
+    void Attribute(XMLNode attributes);
+    void Service(std::list<ComputingServiceType>& targets);
+    void Manager(ComputingManagerType& ComputingManager);
+    void Attributes(XMLNode attributes);
+  };
+
+  GLUE2::Reader::Reader(const char* buf, std::size_t size): reader(NULL), failed(false) {
+    reader = xmlReaderForMemory(buf, size, NULL, NULL,
+                                XML_PARSE_NONET|XML_PARSE_NOERROR|XML_PARSE_NOWARNING);
+  }
+
+  GLUE2::Reader::~Reader() {
+    if (reader) xmlFreeTextReader(reader);
+  }
+
+  std::string GLUE2::Reader::Name() {
+    const xmlChar* name = xmlTextReaderConstLocalName(reader);
+    return name ? (const char*)name : "";
+  }
+
+  // Moves to next child element of element at specified depth. Child
+  // element reader is positioned at is skipped unless it was already
+  // consumed. Returns false at end of parent element.
+  bool GLUE2::Reader::Child(int depth) {
+    for (;;) {
+      int type = xmlTextReaderNodeType(reader);
+      int ret;
+      if (type == XML_READER_TYPE_ELEMENT) {
+        if (xmlTextReaderDepth(reader) == depth) {
+          if (xmlTextReaderIsEmptyElement(reader)) return false;
+          ret = xmlTextReaderRead(reader);
+        } else {
+          ret = xmlTextReaderNext(reader);
+        }
+      } else {
+        ret = xmlTextReaderRead(reader);
+      }
+      if (ret != 1) {
+        failed = true;
+        return false;
+      }
+      type = xmlTextReaderNodeType(reader);
+      int d = xmlTextReaderDepth(reader);
+      if ((type == XML_READER_TYPE_END_ELEMENT) && (d <= depth)) return false;
+      if ((type == XML_READER_TYPE_ELEMENT) && (d == depth + 1)) return true;
+    }
+  }
+
+  // Reads content of current element. Returns false if element has
+  // children elements. Reader is left at end of element.
+  bool GLUE2::Reader::Leaf(std::string& value) {
+    value.clear();
+    if (xmlTextReaderIsEmptyElement(reader)) return true;
+    int depth = xmlTextReaderDepth(reader);
+    bool leaf = true;
+    int ret = xmlTextReaderRead(reader);
+    while (ret == 1) {
+      int type = xmlTextReaderNodeType(reader);
+      if ((type == XML_READER_TYPE_END_ELEMENT) && (xmlTextReaderDepth(reader) == depth)) {
+        return leaf;
+      }
+      if (type == XML_READER_TYPE_ELEMENT) {
+        leaf = false;
+        ret = xmlTextReaderNext(reader);
+        continue;
+      }
+      if (leaf && ((type == XML_READER_TYPE_TEXT) ||
+                   (type == XML_READER_TYPE_CDATA) ||
+                   (type == XML_READER_TYPE_WHITESPACE) ||
+                   (type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE))) {
+        const xmlChar* text = xmlTextReaderConstValue(reader);
+        if (text) value += (const char*)text;
+      }
+      ret = xmlTextReaderRead(reader);
+    }
+    failed = true;
+    return false;
+  }
+
+  // Copies current element into attributes if it is simple one
+  void GLUE2::Reader::Attribute(XMLNode attributes) {
+    std::string name = Name();
+    std::string value;
+    if (Leaf(value)) attributes.NewChild(name) = value;
+  }
+
+  // Collects all simple children of current element
+  void GLUE2::Reader::Attributes(XMLNode attributes) {
+    int depth = xmlTextReaderDepth(reader);
+    while (Child(depth)) Attribute(attributes);
+  }
+
+  void GLUE2::Reader::Manager(ComputingManagerType& ComputingManager) {
+    XMLNode attributes(NS(), "ComputingManager");
+    int eeID = 0;
+    int depth = xmlTextReaderDepth(reader);
+    while (Child(depth)) {
+      std::string name = Name();
+      if (name == "Benchmark") {
+        XMLNode benchmark(NS(), "Benchmark");
+        Attributes(benchmark);
+        ParseBenchmark(benchmark, ComputingManager);
+      } else if (name == "ApplicationEnvironments") {
+        int edepth = xmlTextReaderDepth(reader);
+        while (Child(edepth)) {
+          if (Name() != "ApplicationEnvironment") continue;
+          XMLNode environment(NS(), "ApplicationEnvironment");
+          Attributes(environment);
+          ParseApplicationEnvironment(environment, ComputingManager);
+        }
+      } else if (name == "ExecutionEnvironments") {
+        int edepth = xmlTextReaderDepth(reader);
+        while (Child(edepth)) {
+          if (Name() != "ExecutionEnvironment") continue;
+          XMLNode environment(NS(), "ExecutionEnvironment");
+          Attributes(environment);
+          ExecutionEnvironmentType ExecutionEnvironment;
+          ParseExecutionEnvironment(environment, ExecutionEnvironment);
+          ComputingManager.ExecutionEnvironment.insert(std::pair<int, ExecutionEnvironmentType>(eeID++, ExecutionEnvironment));
+        }
+      } else {
+        Attribute(attributes);
+      }
+    }
+    ParseComputingManager(attributes, ComputingManager);
+  }
+
+  void GLUE2::Reader::Service(std::list<ComputingServiceType>& targets) {
+    ComputingServiceType cs;
+    XMLNode attributes(NS(), "ComputingService");
+    int endpointID = 0;
+    int shareID = 0;
+    int managerID = 0;
+    int depth = xmlTextReaderDepth(reader);
+    while (Child(depth)) {
+      std::string name = Name();
+      if (name == "ComputingEndpoint") {
+        XMLNode endpoint(NS(), "ComputingEndpoint");
+        Attributes(endpoint);
+        ComputingEndpointType ComputingEndpoint;
+        ParseComputingEndpoint(endpoint, ComputingEndpoint);
+        cs.ComputingEndpoint.insert(std::pair<int, ComputingEndpointType>(endpointID++, ComputingEndpoint));
+      } else if (name == "ComputingShare") {
+        XMLNode share(NS(), "ComputingShare");
+        Attributes(share);
+        ComputingShareType ComputingShare;
+        ParseComputingShare(share, ComputingShare);
+        cs.ComputingShare.insert(std::pair<int, ComputingShareType>(shareID++, ComputingShare));
+      } else if (name == "ComputingManager") {
+        ComputingManagerType ComputingManager;
+        Manager(ComputingManager);
+        cs.ComputingManager.insert(std::pair<int, ComputingManagerType>(managerID++, ComputingManager));
+      } else {
+        // Activities and other complex children are skipped here
+        Attribute(attributes);
+      }
+    }
+    if (failed) return;
+    ParseComputingService(attributes, cs);
+    targets.push_back(cs);
+  }
+
+  bool GLUE2::Reader::Parse(std::list<ComputingServiceType>& targets) {
+    if (!reader) return false;
+    int ret = xmlTextReaderRead(reader);
+    while ((ret == 1) && !failed) {
+      if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+        std::string name = Name();
+        if (name == "ComputingService") {
+          Service(targets);
+        } else if ((name == "ComputingActivities") || (name == "ComputingActivity")) {
+          ret = xmlTextReaderNext(reader);
+          continue;
+        }
+      }
+      ret = xmlTextReaderRead(reader);
+    }
+    return (ret == 0) && !failed;
+  }
+
+  bool GLUE2::ParseExecutionTargets(const char* glue2xml, std::size_t size, std::list<ComputingServiceType>& targets) {
+    Reader reader(glue2xml, size);
+    return reader.Parse(targets);
+  }
+
 } // namespace Arc
@@ -3,6 +3,7 @@
 #ifndef __ARC_GLUE2_H__
 #define __ARC_GLUE2_H__
 
+#include <cstddef>
 #include <list>
 #include <string>
 
@@ -30,7 +31,30 @@ namespace Arc {
      * @param targets
      */
     static void ParseExecutionTargets(XMLNode glue2tree, std::list<ComputingServiceType>& targets);
+    /**
+     * Parses ComputingService elements found anywhere in GLUE2 document
+     * stored in buffer. Unlike method above this one does not build
+     * whole document in memory. Document is read sequentially and only
+     * attributes of one object at a time are kept. Subtrees not needed
+     * for ComputingServiceType like ComputingActivities are skipped.
+     * That makes it suitable for big documents published by busy services.
+     * Returns false if buffer does not contain well-formed XML. In that
+     * case targets may already contain some of parsed services.
+     *
+     * @param glue2xml
+     * @param size
+     * @param targets
+     */
+    static bool ParseExecutionTargets(const char* glue2xml, std::size_t size, std::list<ComputingServiceType>& targets);
   private:
+    class Reader;
+    static void ParseComputingService(XMLNode xService, ComputingServiceType& cs);
+    static void ParseComputingEndpoint(XMLNode xEndpoint, ComputingEndpointType& ComputingEndpoint);
+    static void ParseComputingShare(XMLNode xComputingShare, ComputingShareType& ComputingShare);
+    static void ParseComputingManager(XMLNode xComputingManager, ComputingManagerType& ComputingManager);
+    static void ParseBenchmark(XMLNode n, ComputingManagerType& ComputingManager);
+    static void ParseApplicationEnvironment(XMLNode n, ComputingManagerType& ComputingManager);
+    static void ParseExecutionEnvironment(XMLNode xEnvironment, ExecutionEnvironmentType& ExecutionEnvironment);
     static Logger logger;
   };
 
@@ -4,6 +4,12 @@
 #include <config.h>
 #endif
 
+#include <vector>
+
+#if HAVE_SYS_VFS_H
+#include <sys/vfs.h>
+#endif
+
 #include <arc/FileUtils.h>
 #include <arc/Logger.h>
 #include <arc/StringConv.h>
@@ -78,6 +84,131 @@ namespace Arc {
     return err;
   }
 
+  // Prepared statement which is compiled once and then reused for many rows.
+  // Values are stored in the same escaped form as produced by sql_escape in
+  // order to keep database compatible with older versions of this code.
+  class JobDBStatement {
+  public:
+    JobDBStatement(sqlite3* db, const char* sql): stmt(NULL) {
+      int err;
+      while((err = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) == SQLITE_BUSY) {
+        struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+        (void)::nanosleep(&delay, NULL);
+      }
+      if(err != SQLITE_OK) {
+        if(stmt) (void)sqlite3_finalize(stmt);
+        stmt = NULL;
+      }
+    }
+
+    ~JobDBStatement() {
+      if(stmt) (void)sqlite3_finalize(stmt);
+    }
+
+    operator bool() const { return (stmt != NULL); }
+
+    bool operator!() const { return (stmt == NULL); }
+
+    bool bind(int idx, const std::string& val) {
+      return (sqlite3_bind_text(stmt, idx, val.c_str(), val.length(), SQLITE_TRANSIENT) == SQLITE_OK);
+    }
+
+    int step() {
+      int err;
+      while((err = sqlite3_step(stmt)) == SQLITE_BUSY) {
+        struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+        (void)::nanosleep(&delay, NULL);
+      }
+      return err;
+    }
+
+    void reset() {
+      (void)sqlite3_reset(stmt);
+      (void)sqlite3_clear_bindings(stmt);
+    }
+
+    // Feeds all resulting rows to callback with same signature as used by sqlite3_exec.
+    int select(int (*callback)(void*,int,char**,char**), void *arg) {
+      int colnum = sqlite3_column_count(stmt);
+      std::vector<char*> texts(colnum, (char*)NULL);
+      std::vector<char*> names(colnum, (char*)NULL);
+      for(int n = 0; n < colnum; ++n) names[n] = const_cast<char*>(sqlite3_column_name(stmt, n));
+      int err;
+      while((err = step()) == SQLITE_ROW) {
+        for(int n = 0; n < colnum; ++n) {
+          texts[n] = reinterpret_cast<char*>(const_cast<unsigned char*>(sqlite3_column_text(stmt, n)));
+        }
+        if((*callback)(arg, colnum, colnum?&(texts[0]):NULL, colnum?&(names[0]):NULL) != 0) return SQLITE_ABORT;
+      }
+      return (err == SQLITE_DONE) ? SQLITE_OK : err;
+    }
+
+  private:
+    JobDBStatement(const JobDBStatement&);
+    JobDBStatement& operator=(const JobDBStatement&);
+    sqlite3_stmt* stmt;
+  };
+
+  // Groups all modifications done during its life time into single transaction.
+  // Unless committed changes are rolled back on destruction.
+  class JobDBTransaction {
+  public:
+    JobDBTransaction(sqlite3* db): db(db), active(false) {
+      // Obtain write lock immediately to avoid deadlocks with other writers.
+      active = (sqlite3_exec_nobusy(db, "BEGIN IMMEDIATE", NULL, NULL, NULL) == SQLITE_OK);
+    }
+
+    ~JobDBTransaction() {
+      if(active) (void)sqlite3_exec_nobusy(db, "ROLLBACK", NULL, NULL, NULL);
+    }
+
+    operator bool() const { return active; }
+
+    bool operator!() const { return !active; }
+
+    bool commit() {
+      if(!active) return false;
+      active = false;
+      if(sqlite3_exec_nobusy(db, "COMMIT", NULL, NULL, NULL) == SQLITE_OK) return true;
+      (void)sqlite3_exec_nobusy(db, "ROLLBACK", NULL, NULL, NULL);
+      return false;
+    }
+
+  private:
+    sqlite3* db;
+    bool active;
+  };
+
+  static int JournalModeCallback(void* arg, int colnum, char** texts, char** names) {
+    if((colnum > 0) && texts[0]) *reinterpret_cast<std::string*>(arg) = Arc::lower(texts[0]);
+    return 0;
+  }
+
+  // Write-ahead log needs memory shared by all processes using database.
+  // SQLite can't provide it on network file systems, yet switching to WAL
+  // does not fail there and database gets corrupted or locked when used
+  // from several hosts. Hence WAL is used only on known local file systems.
+  static bool WALSupported(const std::string& name) {
+#if HAVE_SYS_VFS_H
+    struct statfs st;
+    if(::statfs(name.c_str(), &st) != 0) return false;
+    switch((unsigned long int)st.f_type) {
+      case 0xEF53UL:     // ext2, ext3, ext4
+      case 0x58465342UL: // XFS
+      case 0x9123683EUL: // Btrfs
+      case 0x2FC12FC1UL: // ZFS
+      case 0xF2F52010UL: // F2FS
+      case 0x3153464AUL: // JFS
+      case 0x52654973UL: // ReiserFS
+      case 0x01021994UL: // tmpfs
+        return true;
+      default:
+        break;
+    }
+#endif
+    return false;
+  }
+
   #define JOBS_COLUMNS_OLD \
             "id, idfromendpoint, name, statusinterface, statusurl, " \
             "managementinterfacename, managementurl, " \
@@ -100,6 +231,15 @@ namespace Arc {
             "workingareaerasetime, proxyexpirationtime, submissionhost, submissionclienttime, " \
             "othermessages, activityoldid"
 
+  // One placeholder per column in JOBS_COLUMNS
+  #define JOBS_PLACEHOLDERS \
+            "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " \
+            "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " \
+            "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " \
+            "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " \
+            "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " \
+            "?, ?"
+
  
   JobInformationStorageSQLite::JobDB::JobDB(const std::string& name, bool create): jobDB(NULL)
   {
@@ -164,6 +304,29 @@ namespace Arc {
         tearDown();
         throw SQLiteException(IString("Unable to create index for jobs table in data base (%s)", name).str(), err);
       }
+      err = sqlite3_exec_nobusy(jobDB,
+          "CREATE INDEX IF NOT EXISTS name ON jobs(name)",
+           NULL, NULL, NULL);
+      if(err != SQLITE_OK) {
+        handleError(NULL, err);
+        tearDown();
+        throw SQLiteException(IString("Unable to create index for jobs table in data base (%s)", name).str(), err);
+      }
+      // Write-ahead log lets readers proceed while jobs are being written and
+      // makes commit of big transaction cheap. Elsewhere database stays in
+      // or returns to rollback journal mode.
+      std::string journalMode;
+      if(!WALSupported(name)) {
+        (void)sqlite3_exec_nobusy(jobDB, "PRAGMA journal_mode=DELETE", NULL, NULL, NULL);
+      } else {
+        err = sqlite3_exec_nobusy(jobDB, "PRAGMA journal_mode=WAL", &JournalModeCallback, &journalMode, NULL);
+        if(err != SQLITE_OK) {
+          handleError("Failed to switch to write-ahead log", err);
+        } else if(journalMode == "wal") {
+          // In WAL mode database can't get corrupted with reduced synchronization.
+          (void)sqlite3_exec_nobusy(jobDB, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+        }
+      }
     } else {
       // SQLite opens database in lazy way. But we still want to know if it is good database.
       err = sqlite3_exec_nobusy(jobDB, "PRAGMA schema_version;", NULL, NULL, NULL);
@@ -267,25 +430,37 @@ namespace Arc {
     
     try {
       JobDB db(name, true);
+      // All modifications are done in single transaction. That saves
+      // on synchronization to disk which otherwise happens for every row.
+      JobDBTransaction transaction(db.handle());
+      if (!transaction) {
+        logger.msg(VERBOSE, "Unable to start transaction in job database (%s)", name);
+        return false;
+      }
       // Identify jobs to remove
       std::list<std::string> prunedIds;
       ListJobsCallbackArg prunedArg(prunedIds);
-      for (std::set<std::string>::const_iterator itPruned = prunedServices.begin();
-           itPruned != prunedServices.end(); ++itPruned) {
-        std::string sqlcmd = "SELECT id FROM jobs WHERE (serviceinformationhost = '" + *itPruned + "')";
-        (void)sqlite3_exec_nobusy(db.handle(), sqlcmd.c_str(), &ListJobsCallback, &prunedArg, NULL);
+      if (!prunedServices.empty()) {
+        JobDBStatement selectStmt(db.handle(), "SELECT id FROM jobs WHERE (serviceinformationhost = ?)");
+        if (!selectStmt) {
+          logger.msg(VERBOSE, "Unable to prepare statements for job database (%s)", name);
+          return false;
+        }
+        for (std::set<std::string>::const_iterator itPruned = prunedServices.begin();
+             itPruned != prunedServices.end(); ++itPruned) {
+          selectStmt.bind(1, sql_escape(*itPruned));
+          (void)selectStmt.select(&ListJobsCallback, &prunedArg);
+          selectStmt.reset();
+        }
       }
       // Filter out jobs to be modified
-      if(!jobs.empty()) {
+      if(!prunedIds.empty()) {
+        std::set<std::string> writtenIds;
+        for (std::list<Job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+          writtenIds.insert(it->JobID);
+        }
         for(std::list<std::string>::iterator itId = prunedIds.begin(); itId != prunedIds.end();) {
-          bool found = false;
-          for (std::list<Job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
-            if(it->JobID == *itId) {
-              found = true;
-              break;
-            }
-          }
-          if(found) {
+          if(writtenIds.find(sql_unescape(*itId)) != writtenIds.end()) {
             itId = prunedIds.erase(itId);
           } else {
             ++itId;
@@ -293,79 +468,96 @@ namespace Arc {
         }
       }
       // Remove identified jobs
-      for(std::list<std::string>::iterator itId = prunedIds.begin(); itId != prunedIds.end(); ++itId) {
-        std::string sqlcmd = "DELETE FROM jobs WHERE (id = '" + *itId + "')";
-        (void)sqlite3_exec_nobusy(db.handle(), sqlcmd.c_str(), &ListJobsCallback, &prunedArg, NULL);
+      if(!prunedIds.empty()) {
+        JobDBStatement deleteStmt(db.handle(), "DELETE FROM jobs WHERE (id = ?)");
+        if (!deleteStmt) {
+          logger.msg(VERBOSE, "Unable to prepare statements for job database (%s)", name);
+          return false;
+        }
+        for(std::list<std::string>::iterator itId = prunedIds.begin(); itId != prunedIds.end(); ++itId) {
+          deleteStmt.bind(1, *itId);
+          (void)deleteStmt.step();
+          deleteStmt.reset();
+        }
       }
       // Add new jobs
+      JobDBStatement insertStmt(db.handle(), "INSERT OR IGNORE INTO jobs(" JOBS_COLUMNS ") VALUES (" JOBS_PLACEHOLDERS ")");
+      JobDBStatement replaceStmt(db.handle(), "REPLACE INTO jobs(" JOBS_COLUMNS ") VALUES (" JOBS_PLACEHOLDERS ")");
+      if (!insertStmt || !replaceStmt) {
+        logger.msg(VERBOSE, "Unable to prepare statements for job database (%s)", name);
+        return false;
+      }
+      std::list<const Job*> addedJobs;
+      std::vector<std::string> values;
       for (std::list<Job>::const_iterator it = jobs.begin();
            it != jobs.end(); ++it) {
-        std::string sqlvalues = "jobs("
-          JOBS_COLUMNS
-          ") VALUES ('"+
-             sql_escape(it->JobID)+"', '"+
-             sql_escape(it->IDFromEndpoint)+"', '"+
-             sql_escape(it->Name)+"', '"+
-             sql_escape(it->JobStatusInterfaceName)+"', '"+
-             sql_escape(it->JobStatusURL.fullstr())+"', '"+
-             sql_escape(it->JobManagementInterfaceName)+"', '"+
-             sql_escape(it->JobManagementURL.fullstr())+"', '"+
-             sql_escape(it->ServiceInformationInterfaceName)+"', '"+
-             sql_escape(it->ServiceInformationURL.fullstr())+"', '"+
-             sql_escape(it->ServiceInformationURL.Host())+"', '"+
-             sql_escape(it->SessionDir.fullstr())+"', '"+
-             sql_escape(it->StageInDir.fullstr())+"', '"+
-             sql_escape(it->StageOutDir.fullstr())+"', '"+
-             sql_escape(it->JobDescriptionDocument)+"', '"+
-             sql_escape(tostring(it->LocalSubmissionTime.GetTime()))+"', '"+
-             sql_escape(it->DelegationID)+"', '"+
-             // attributes available after code update
-             sql_escape(it->Type)+"', '"+
-             sql_escape(it->LocalIDFromManager)+"', '"+
-             sql_escape(it->JobDescription)+"', '"+
-             sql_escape(it->State.GetGeneralState())+"', '"+
-             sql_escape(it->RestartState.GetGeneralState())+"', '"+
-             sql_escape(it->ExitCode)+"', '"+
-             sql_escape(it->ComputingManagerExitCode)+"', '"+
-             sql_escape(it->Error)+"', '"+
-             sql_escape(it->WaitingPosition)+"', '"+
-             sql_escape(it->UserDomain)+"', '"+
-             sql_escape(it->Owner)+"', '"+
-             sql_escape(it->LocalOwner)+"', '"+
-             sql_escape(it->RequestedTotalWallTime)+"', '"+
-             sql_escape(it->RequestedTotalCPUTime)+"', '"+
-             sql_escape(it->RequestedSlots)+"', '"+
-             sql_escape(it->RequestedApplicationEnvironment)+"', '"+
-             sql_escape(it->StdIn)+"', '"+
-             sql_escape(it->StdOut)+"', '"+
-             sql_escape(it->StdErr)+"', '"+
-             sql_escape(it->LogDir)+"', '"+
-             sql_escape(it->ExecutionNode)+"', '"+
-             sql_escape(it->Queue)+"', '"+
-             sql_escape(it->UsedTotalWallTime)+"', '"+
-             sql_escape(it->UsedTotalCPUTime)+"', '"+
-             sql_escape(it->UsedMainMemory)+"', '"+
-             sql_escape(it->SubmissionTime)+"', '"+
-             sql_escape(it->ComputingManagerSubmissionTime)+"', '"+
-             sql_escape(it->StartTime)+"', '"+
-             sql_escape(it->ComputingManagerEndTime)+"', '"+
-             sql_escape(it->EndTime)+"', '"+
-             sql_escape(it->WorkingAreaEraseTime)+"', '"+
-             sql_escape(it->ProxyExpirationTime)+"', '"+
-             sql_escape(it->SubmissionHost)+"', '"+
-             sql_escape(it->SubmissionClientName)+"', '"+
-             sql_escape(it->OtherMessages)+"', '"+
-             sql_escape(it->ActivityOldID)+"')";
+        values.clear();
+        values.push_back(sql_escape(it->JobID));
+        values.push_back(sql_escape(it->IDFromEndpoint));
+        values.push_back(sql_escape(it->Name));
+        values.push_back(sql_escape(it->JobStatusInterfaceName));
+        values.push_back(sql_escape(it->JobStatusURL.fullstr()));
+        values.push_back(sql_escape(it->JobManagementInterfaceName));
+        values.push_back(sql_escape(it->JobManagementURL.fullstr()));
+        values.push_back(sql_escape(it->ServiceInformationInterfaceName));
+        values.push_back(sql_escape(it->ServiceInformationURL.fullstr()));
+        values.push_back(sql_escape(it->ServiceInformationURL.Host()));
+        values.push_back(sql_escape(it->SessionDir.fullstr()));
+        values.push_back(sql_escape(it->StageInDir.fullstr()));
+        values.push_back(sql_escape(it->StageOutDir.fullstr()));
+        values.push_back(sql_escape(it->JobDescriptionDocument));
+        values.push_back(sql_escape(tostring(it->LocalSubmissionTime.GetTime())));
+        values.push_back(sql_escape(it->DelegationID));
+        values.push_back(sql_escape(it->Type));
+        values.push_back(sql_escape(it->LocalIDFromManager));
+        values.push_back(sql_escape(it->JobDescription));
+        values.push_back(sql_escape(it->State.GetGeneralState()));
+        values.push_back(sql_escape(it->RestartState.GetGeneralState()));
+        values.push_back(sql_escape(it->ExitCode));
+        values.push_back(sql_escape(it->ComputingManagerExitCode));
+        values.push_back(sql_escape(it->Error));
+        values.push_back(sql_escape(it->WaitingPosition));
+        values.push_back(sql_escape(it->UserDomain));
+        values.push_back(sql_escape(it->Owner));
+        values.push_back(sql_escape(it->LocalOwner));
+        values.push_back(sql_escape(it->RequestedTotalWallTime));
+        values.push_back(sql_escape(it->RequestedTotalCPUTime));
+        values.push_back(sql_escape(it->RequestedSlots));
+        values.push_back(sql_escape(it->RequestedApplicationEnvironment));
+        values.push_back(sql_escape(it->StdIn));
+        values.push_back(sql_escape(it->StdOut));
+        values.push_back(sql_escape(it->StdErr));
+        values.push_back(sql_escape(it->LogDir));
+        values.push_back(sql_escape(it->ExecutionNode));
+        values.push_back(sql_escape(it->Queue));
+        values.push_back(sql_escape(it->UsedTotalWallTime));
+        values.push_back(sql_escape(it->UsedTotalCPUTime));
+        values.push_back(sql_escape(it->UsedMainMemory));
+        values.push_back(sql_escape(it->SubmissionTime));
+        values.push_back(sql_escape(it->ComputingManagerSubmissionTime));
+        values.push_back(sql_escape(it->StartTime));
+        values.push_back(sql_escape(it->ComputingManagerEndTime));
+        values.push_back(sql_escape(it->EndTime));
+        values.push_back(sql_escape(it->WorkingAreaEraseTime));
+        values.push_back(sql_escape(it->ProxyExpirationTime));
+        values.push_back(sql_escape(it->SubmissionHost));
+        values.push_back(sql_escape(it->SubmissionClientName));
+        values.push_back(sql_escape(it->OtherMessages));
+        values.push_back(sql_escape(it->ActivityOldID));
         bool new_job = true;
-        int err = sqlite3_exec_nobusy(db.handle(), ("INSERT OR IGNORE INTO " + sqlvalues).c_str(), NULL, NULL, NULL);
-        if(err != SQLITE_OK) {
+        for (std::size_t n = 0; n < values.size(); ++n) insertStmt.bind(n+1, values[n]);
+        int err = insertStmt.step();
+        insertStmt.reset();
+        if(err != SQLITE_DONE) {
           logger.msg(VERBOSE, "Unable to write records into job database (%s): Id \"%s\"", name, it->JobID);
           logErrorMessage(err);
           return false;
         }
         if(sqlite3_changes(db.handle()) == 0) {
-          err = sqlite3_exec_nobusy(db.handle(), ("REPLACE INTO " + sqlvalues).c_str(), NULL, NULL, NULL);
-          if(err != SQLITE_OK) {
+          for (std::size_t n = 0; n < values.size(); ++n) replaceStmt.bind(n+1, values[n]);
+          err = replaceStmt.step();
+          replaceStmt.reset();
+          if(err != SQLITE_DONE) {
             logger.msg(VERBOSE, "Unable to write records into job database (%s): Id \"%s\"", name, it->JobID);
             logErrorMessage(err);
             return false;
@@ -377,8 +569,13 @@ namespace Arc {
           logErrorMessage(err);
           return false;
         }
-        if(new_job) newJobs.push_back(&(*it));
+        if(new_job) addedJobs.push_back(&(*it));
       }
+      if (!transaction.commit()) {
+        logger.msg(VERBOSE, "Unable to commit records into job database (%s)", name);
+        return false;
+      }
+      newJobs.splice(newJobs.end(), addedJobs);
     } catch (const SQLiteException& e) {
       return false;
     }
@@ -392,11 +589,14 @@ namespace Arc {
     const std::list<std::string>* endpoints;
     const std::list<std::string>* rejectEndpoints;
     std::list<std::string> jobIdentifiersMatched;
+    std::set<std::string> jobIdentifiersSet;
     ReadJobsCallbackArg(std::list<Job>& jobs, 
                         std::list<std::string>* jobIdentifiers,
                         const std::list<std::string>* endpoints,
                         const std::list<std::string>* rejectEndpoints):
-       jobs(jobs), jobIdentifiers(jobIdentifiers), endpoints(endpoints), rejectEndpoints(rejectEndpoints) {};
+       jobs(jobs), jobIdentifiers(jobIdentifiers), endpoints(endpoints), rejectEndpoints(rejectEndpoints) {
+      if(jobIdentifiers) jobIdentifiersSet.insert(jobIdentifiers->begin(), jobIdentifiers->end());
+    };
   };
 
   static int ReadJobsCallback(void* arg, int colnum, char** texts, char** names) {
@@ -409,13 +609,9 @@ namespace Arc {
         if(strcmp(names[n], "id") == 0) {
           carg.jobs.back().JobID = sql_unescape(texts[n]);
           if(carg.jobIdentifiers) {
-            for(std::list<std::string>::iterator it = carg.jobIdentifiers->begin();
-                           it != carg.jobIdentifiers->end(); ++it) {
-              if(*it == carg.jobs.back().JobID) {
-                accept = true;
-                carg.jobIdentifiersMatched.push_back(*it);
-                break;
-              }
+            if(carg.jobIdentifiersSet.find(carg.jobs.back().JobID) != carg.jobIdentifiersSet.end()) {
+              accept = true;
+              carg.jobIdentifiersMatched.push_back(carg.jobs.back().JobID);
             }
           } else {
             accept = true;
@@ -425,13 +621,9 @@ namespace Arc {
         } else if(strcmp(names[n], "name") == 0) {
           carg.jobs.back().Name = sql_unescape(texts[n]);
           if(carg.jobIdentifiers) {
-            for(std::list<std::string>::iterator it = carg.jobIdentifiers->begin();
-                           it != carg.jobIdentifiers->end(); ++it) {
-              if(*it == carg.jobs.back().Name) {
-                accept = true;
-                carg.jobIdentifiersMatched.push_back(*it);
-                break;
-              }
+            if(carg.jobIdentifiersSet.find(carg.jobs.back().Name) != carg.jobIdentifiersSet.end()) {
+              accept = true;
+              carg.jobIdentifiersMatched.push_back(carg.jobs.back().Name);
             }
           } else {
             accept = true;
@@ -568,9 +760,12 @@ namespace Arc {
 
     try {
       JobDB db(name);
-      std::string sqlcmd = "SELECT * FROM jobs";
+      JobDBStatement selectStmt(db.handle(), "SELECT * FROM jobs");
+      if(!selectStmt) {
+        return false;
+      }
       ReadJobsCallbackArg carg(jobs, NULL, NULL, &rejectEndpoints);
-      int err = sqlite3_exec_nobusy(db.handle(), sqlcmd.c_str(), &ReadJobsCallback, &carg, NULL);
+      int err = selectStmt.select(&ReadJobsCallback, &carg);
       if(err != SQLITE_OK) {
         // handle error ??
         return false;
@@ -592,9 +787,52 @@ namespace Arc {
     
     try {
       JobDB db(name);
-      std::string sqlcmd = "SELECT * FROM jobs";
       ReadJobsCallbackArg carg(jobs, &jobIdentifiers, &endpoints, &rejectEndpoints);
-      int err = sqlite3_exec_nobusy(db.handle(), sqlcmd.c_str(), &ReadJobsCallback, &carg, NULL);
+      int err = SQLITE_OK;
+      if(endpoints.empty()) {
+        // Only jobs matching identifiers are requested. Those are looked up
+        // through indices on id and name. Identifiers are passed through
+        // temporary table because their number may exceed limit on number
+        // of bound parameters. Temporary tables do not need write access
+        // to the main database.
+        if(jobIdentifiers.empty()) return true;
+        err = sqlite3_exec_nobusy(db.handle(), "CREATE TEMP TABLE readids(id TEXT PRIMARY KEY)", NULL, NULL, NULL);
+        if(err != SQLITE_OK) {
+          return false;
+        }
+        {
+          JobDBStatement insertStmt(db.handle(), "INSERT OR IGNORE INTO temp.readids(id) VALUES (?)");
+          if(!insertStmt) {
+            return false;
+          }
+          if(sqlite3_exec_nobusy(db.handle(), "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+            return false;
+          }
+          for(std::list<std::string>::const_iterator itId = jobIdentifiers.begin(); itId != jobIdentifiers.end(); ++itId) {
+            insertStmt.bind(1, sql_escape(*itId));
+            (void)insertStmt.step();
+            insertStmt.reset();
+          }
+          if(sqlite3_exec_nobusy(db.handle(), "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+            return false;
+          }
+        }
+        JobDBStatement selectStmt(db.handle(),
+            "SELECT * FROM jobs WHERE (id IN (SELECT id FROM temp.readids)) OR "
+            "(name IN (SELECT id FROM temp.readids)) ORDER BY rowid");
+        if(!selectStmt) {
+          return false;
+        }
+        err = selectStmt.select(&ReadJobsCallback, &carg);
+      } else {
+        // Matching endpoints relies on URL::StringMatches and can't
+        // be expressed in SQL. So all jobs have to be checked.
+        JobDBStatement selectStmt(db.handle(), "SELECT * FROM jobs");
+        if(!selectStmt) {
+          return false;
+        }
+        err = selectStmt.select(&ReadJobsCallback, &carg);
+      }
       if(err != SQLITE_OK) {
         // handle error ??
         return false;
@@ -618,11 +856,17 @@ namespace Arc {
     }
 
     if (remove(name.c_str()) != 0) {
-      if (errno == ENOENT) return true; // No such file. DB already cleaned.
-      logger.msg(VERBOSE, "Unable to truncate job database (%s)", name);
-      perror("Error");
-      return false;
+      if (errno != ENOENT) {
+        logger.msg(VERBOSE, "Unable to truncate job database (%s)", name);
+        perror("Error");
+        return false;
+      }
     }
+    // Leftovers of write-ahead log must not be applied to new database.
+    // Removed only after database itself is gone, so committed data are
+    // never separated from it.
+    (void)remove((name+"-wal").c_str());
+    (void)remove((name+"-shm").c_str());
     
     return true;
   }
@@ -634,14 +878,23 @@ namespace Arc {
 
     try {
       JobDB db(name, true);
+      JobDBTransaction transaction(db.handle());
+      JobDBStatement deleteStmt(db.handle(), "DELETE FROM jobs WHERE (id = ?)");
+      if(!transaction || !deleteStmt) {
+        return false;
+      }
       for (std::list<std::string>::const_iterator it = jobids.begin();
            it != jobids.end(); ++it) {
-        std::string sqlcmd = "DELETE FROM jobs WHERE (id = '"+sql_escape(*it)+"')";
-        int err = sqlite3_exec_nobusy(db.handle(), sqlcmd.c_str(), NULL, NULL, NULL); 
-        if(err != SQLITE_OK) {
+        deleteStmt.bind(1, sql_escape(*it));
+        int err = deleteStmt.step();
+        deleteStmt.reset();
+        if(err != SQLITE_DONE) {
         } else if(sqlite3_changes(db.handle()) < 1) {
         }
       }
+      if(!transaction.commit()) {
+        return false;
+      }
     } catch (const SQLiteException& e) {
       return false;
     }
@@ -0,0 +1,182 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <list>
+#include <sstream>
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/XMLNode.h>
+#include <arc/compute/ExecutionTarget.h>
+#include <arc/compute/GLUE2.h>
+
+class GLUE2Test
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(GLUE2Test);
+  CPPUNIT_TEST(TestStreamParse);
+  CPPUNIT_TEST(TestStreamMatchesTree);
+  CPPUNIT_TEST(TestStreamNotXML);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  GLUE2Test();
+
+  void setUp() {}
+  void tearDown() {}
+
+  void TestStreamParse();
+  void TestStreamMatchesTree();
+  void TestStreamNotXML();
+
+private:
+  std::string xml;
+};
+
+GLUE2Test::GLUE2Test() {
+  xml =
+    "<Domains xmlns=\"http://schemas.ogf.org/glue/2009/03/spec_2.0_r1\">"
+    "<AdminDomain><ID>urn:ad:test</ID><Services>"
+    "<ComputingService>"
+      "<ID>urn:cs:test</ID>"
+      "<Name>Test service</Name>"
+      "<Capability>executionmanagement.jobexecution</Capability>"
+      "<Capability>information.discovery.resource</Capability>"
+      "<Type>org.nordugrid.arex</Type>"
+      "<QualityLevel>production</QualityLevel>"
+      "<Location><ID>urn:loc:test</ID><Country>Norway</Country></Location>"
+      "<TotalJobs>3</TotalJobs>"
+      "<RunningJobs>2</RunningJobs>"
+      "<WaitingJobs>1</WaitingJobs>"
+      "<ComputingEndpoint>"
+        "<ID>urn:ce:rest</ID>"
+        "<URL>https://ce.test.org:443/arex</URL>"
+        "<Capability>executionmanagement.jobexecution</Capability>"
+        "<Technology>webservice</Technology>"
+        "<InterfaceName>org.nordugrid.arcrest</InterfaceName>"
+        "<InterfaceVersion>1.0</InterfaceVersion>"
+        "<HealthState>ok</HealthState>"
+        "<ServingState>production</ServingState>"
+        "<JobDescription>emies:adl</JobDescription>"
+        "<JobDescription>nordugrid:xrsl</JobDescription>"
+        "<AccessPolicy><Rule>vo:test</Rule></AccessPolicy>"
+        "<ComputingActivities>"
+          "<ComputingActivity><ID>urn:job:1</ID><State>running</State></ComputingActivity>"
+          "<ComputingActivity><ID>urn:job:2</ID><State>queued</State></ComputingActivity>"
+        "</ComputingActivities>"
+        "<Associations><ComputingShareID>urn:share:main</ComputingShareID></Associations>"
+      "</ComputingEndpoint>"
+      "<ComputingShare>"
+        "<ID>urn:share:main</ID>"
+        "<Name>main</Name>"
+        "<MappingQueue>batch</MappingQueue>"
+        "<MaxWallTime>3600</MaxWallTime>"
+        "<MaxRunningJobs>100</MaxRunningJobs>"
+        "<FreeSlots>7</FreeSlots>"
+        "<MappingPolicy><Rule>vo:test</Rule></MappingPolicy>"
+      "</ComputingShare>"
+      "<ComputingManager>"
+        "<ID>urn:cm:test</ID>"
+        "<ProductName>SLURM</ProductName>"
+        "<ProductVersion>20.11</ProductVersion>"
+        "<TotalSlots>64</TotalSlots>"
+        "<Homogeneous>true</Homogeneous>"
+        "<NetworkInfo>infiniband</NetworkInfo>"
+        "<Benchmark><Type>specint2000</Type><Value>1234.5</Value></Benchmark>"
+        "<ExecutionEnvironments>"
+          "<ExecutionEnvironment>"
+            "<ID>urn:ee:test</ID>"
+            "<Platform>amd64</Platform>"
+            "<MainMemorySize>4096</MainMemorySize>"
+            "<OSFamily>linux</OSFamily>"
+            "<OSName>centos</OSName>"
+            "<OSVersion>7</OSVersion>"
+            "<ConnectivityOut>true</ConnectivityOut>"
+            "<Associations><ComputingActivityID>urn:job:1</ComputingActivityID></Associations>"
+          "</ExecutionEnvironment>"
+        "</ExecutionEnvironments>"
+        "<ApplicationEnvironments>"
+          "<ApplicationEnvironment>"
+            "<ID>urn:ae:python</ID>"
+            "<AppName>PYTHON</AppName>"
+            "<AppVersion>3.6</AppVersion>"
+            "<State>installednotverified</State>"
+            "<FreeJobs>5</FreeJobs>"
+          "</ApplicationEnvironment>"
+        "</ApplicationEnvironments>"
+      "</ComputingManager>"
+    "</ComputingService>"
+    "</Services></AdminDomain></Domains>";
+}
+
+void GLUE2Test::TestStreamParse() {
+  std::list<Arc::ComputingServiceType> services;
+  CPPUNIT_ASSERT(Arc::GLUE2::ParseExecutionTargets(xml.c_str(), xml.length(), services));
+  CPPUNIT_ASSERT_EQUAL(1, (int)services.size());
+  Arc::ComputingServiceType& cs = services.front();
+  CPPUNIT_ASSERT_EQUAL((std::string)"urn:cs:test", cs->ID);
+  CPPUNIT_ASSERT_EQUAL(2, (int)cs->Capability.size());
+  CPPUNIT_ASSERT_EQUAL(3, cs->TotalJobs);
+
+  CPPUNIT_ASSERT_EQUAL(1, (int)cs.ComputingEndpoint.size());
+  Arc::ComputingEndpointType& ce = cs.ComputingEndpoint[0];
+  CPPUNIT_ASSERT_EQUAL((std::string)"https://ce.test.org:443/arex", ce->URLString);
+  CPPUNIT_ASSERT_EQUAL((std::string)"ok", ce->HealthState);
+  CPPUNIT_ASSERT_EQUAL(2, (int)ce->JobDescriptions.size());
+
+  CPPUNIT_ASSERT_EQUAL(1, (int)cs.ComputingShare.size());
+  Arc::ComputingShareType& share = cs.ComputingShare[0];
+  CPPUNIT_ASSERT_EQUAL((std::string)"batch", share->MappingQueue);
+  CPPUNIT_ASSERT_EQUAL(100, share->MaxRunningJobs);
+
+  CPPUNIT_ASSERT_EQUAL(1, (int)cs.ComputingManager.size());
+  Arc::ComputingManagerType& cm = cs.ComputingManager[0];
+  CPPUNIT_ASSERT_EQUAL((std::string)"SLURM", cm->ProductName);
+  CPPUNIT_ASSERT_EQUAL(64, cm->TotalSlots);
+  CPPUNIT_ASSERT_EQUAL(1, (int)cm.Benchmarks->size());
+  CPPUNIT_ASSERT_EQUAL(1234.5, (*cm.Benchmarks)["specint2000"]);
+  CPPUNIT_ASSERT_EQUAL(1, (int)cm.ApplicationEnvironments->size());
+  CPPUNIT_ASSERT_EQUAL(5, cm.ApplicationEnvironments->front().FreeJobs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)cm.ExecutionEnvironment.size());
+  CPPUNIT_ASSERT_EQUAL((std::string)"amd64", cm.ExecutionEnvironment[0]->Platform);
+  CPPUNIT_ASSERT_EQUAL(4096, cm.ExecutionEnvironment[0]->MainMemorySize);
+  CPPUNIT_ASSERT(cm.ExecutionEnvironment[0]->ConnectivityOut);
+}
+
+void GLUE2Test::TestStreamMatchesTree() {
+  std::list<Arc::ComputingServiceType> streamed;
+  CPPUNIT_ASSERT(Arc::GLUE2::ParseExecutionTargets(xml.c_str(), xml.length(), streamed));
+  std::list<Arc::ComputingServiceType> parsed;
+  Arc::XMLNode tree(xml);
+  Arc::GLUE2::ParseExecutionTargets(tree["AdminDomain"]["Services"], parsed);
+  CPPUNIT_ASSERT_EQUAL(parsed.size(), streamed.size());
+
+  // Both parsers must fill same attributes
+  std::list<Arc::ExecutionTarget> streamedTargets;
+  std::list<Arc::ExecutionTarget> parsedTargets;
+  Arc::ExecutionTarget::GetExecutionTargets(streamed, streamedTargets);
+  Arc::ExecutionTarget::GetExecutionTargets(parsed, parsedTargets);
+  CPPUNIT_ASSERT_EQUAL(parsedTargets.size(), streamedTargets.size());
+  std::list<Arc::ExecutionTarget>::iterator s = streamedTargets.begin();
+  for (std::list<Arc::ExecutionTarget>::iterator p = parsedTargets.begin();
+       p != parsedTargets.end(); ++p, ++s) {
+    std::ostringstream ps;
+    std::ostringstream ss;
+    ps << *p;
+    ss << *s;
+    CPPUNIT_ASSERT_EQUAL(ps.str(), ss.str());
+  }
+}
+
+void GLUE2Test::TestStreamNotXML() {
+  std::list<Arc::ComputingServiceType> services;
+  std::string bad = "<Domains><AdminDomain><Services><ComputingService><ID>x</ID></Services>";
+  CPPUNIT_ASSERT(!Arc::GLUE2::ParseExecutionTargets(bad.c_str(), bad.length(), services));
+  CPPUNIT_ASSERT(services.empty());
+  std::string text = "Internal server error";
+  CPPUNIT_ASSERT(!Arc::GLUE2::ParseExecutionTargets(text.c_str(), text.length(), services));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(GLUE2Test);
@@ -16,6 +16,9 @@
 #ifdef DBJSTORE_ENABLED
 #include "JobInformationStorageBDB.h"
 #endif
+#ifdef SQLITEJSTORE_ENABLED
+#include "JobInformationStorageSQLite.h"
+#endif
 
 
 int main(int argc, char **argv) {
@@ -39,7 +42,7 @@ int main(int argc, char **argv) {
   options.AddOption('f', "filename", "", "", filename);
   
   std::string typeS = "";
-  options.AddOption('t', "type", "Type of storage back-end to use (BDB or XML)", "type", typeS);
+  options.AddOption('t', "type", "Type of storage back-end to use (BDB, SQLITE or XML)", "type", typeS);
   
   std::string hostname = "test.nordugrid.org";
   options.AddOption(0, "hostname", "", "", hostname);
@@ -80,6 +83,12 @@ int main(int argc, char **argv) {
     Arc::JobInformationStorageBDB *jisDB4 = new Arc::JobInformationStorageBDB(filename);
     jisPointer = (Arc::JobInformationStorage**)&jisDB4;
   }
+#endif
+#ifdef SQLITEJSTORE_ENABLED
+  else if (typeS == "SQLITE") {
+    Arc::JobInformationStorageSQLite *jisSQLite = new Arc::JobInformationStorageSQLite(filename);
+    jisPointer = (Arc::JobInformationStorage**)&jisSQLite;
+  }
 #endif
   else {
     std::cerr << "ERROR: Unable to determine storage back-end to use." << std::endl;
@@ -10,6 +10,7 @@
 #include <openssl/x509v3.h>
 #include <openssl/err.h>
 
+#include "TrustStore.h"
 #include "CertUtil.h"
 
 #define X509_CERT_DIR  "X509_CERT_DIR"
@@ -63,20 +64,20 @@ static Arc::Logger& logger = Arc::Logger::rootLogger;
 
 static int verify_callback(int ok, X509_STORE_CTX* store_ctx);
 static bool collect_proxy_info(std::string& proxy_policy, X509* cert);
-static int verify_cert_additional(X509* cert, X509_STORE_CTX* store_ctx, std::string const& ca_dir, std::string& proxy_policy);
+static int verify_cert_additional(X509* cert, X509_STORE_CTX* store_ctx, std::string const& ca_dir, Arc::TrustStore& trust, std::string& proxy_policy);
 
 int verify_cert_chain(X509* cert, STACK_OF(X509)** certchain, std::string const& ca_file, std::string const& ca_dir, std::string& proxy_policy) {
   int i;
-  int j;
   int retval = 0;
   X509_STORE* cert_store = NULL;
   X509_STORE_CTX* store_ctx = NULL;
+  STACK_OF(X509)* untrusted = NULL;
   X509* cert_in_chain = NULL;
   X509* user_cert = NULL;
+  Arc::TrustStore* trust = NULL;
 
   user_cert = cert;
-  if ((cert_store = X509_STORE_new()) == NULL) { goto err; }
-  X509_STORE_set_verify_cb_func(cert_store, verify_callback);
+  if ((untrusted = sk_X509_new_null()) == NULL) { goto err; }
   if (*certchain != NULL) {
     for (i=0;i<sk_X509_num(*certchain);i++) {
       cert_in_chain = sk_X509_value(*certchain,i);
@@ -85,25 +86,21 @@ int verify_cert_chain(X509* cert, STACK_OF(X509)** certchain, std::string const&
         user_cert = cert_in_chain;
       }
       else {
-        j = X509_STORE_add_cert(cert_store, cert_in_chain);
-        if (!j) {
-          if ((ERR_GET_REASON(ERR_peek_error()) == X509_R_CERT_ALREADY_IN_HASH_TABLE)) {
-            ERR_clear_error();
-            break;
-          }
-          else { goto err; }
-        }
+        if (!sk_X509_push(untrusted, cert_in_chain)) { goto err; }
       }
     }
   }
   if(user_cert == NULL) goto err;
 
-  if (!X509_STORE_load_locations(cert_store,
-           ca_file.empty() ? NULL:ca_file.c_str(),
-           ca_dir.empty() ? NULL:ca_dir.c_str())) { goto err; }
+  if (ca_file.empty() && ca_dir.empty()) { goto err; }
+  // CA certificates and CRLs are loaded once per process and shared.
+  // Shared store is used directly and is not modified.
+  trust = &Arc::TrustStore::Get(ca_file, ca_dir);
+  if ((cert_store = trust->Store()) == NULL) { goto err; }
 
   if ((store_ctx = X509_STORE_CTX_new()) == NULL) { goto err; }
-  X509_STORE_CTX_init(store_ctx, cert_store, user_cert, NULL);
+  X509_STORE_CTX_init(store_ctx, cert_store, user_cert, untrusted);
+  X509_STORE_CTX_set_verify_cb(store_ctx, verify_callback);
 
   X509_STORE_CTX_set_flags(store_ctx, X509_V_FLAG_ALLOW_PROXY_CERTS);
 
@@ -116,13 +113,13 @@ int verify_cert_chain(X509* cert, STACK_OF(X509)** certchain, std::string const&
   // Also as all of the OpenSSL tests have passed and we now get to
   // look at the certificate to verify additional rules (like CRL).
 
-  if(!verify_cert_additional(cert, store_ctx, ca_dir, proxy_policy)) { goto err; }
+  if(!verify_cert_additional(cert, store_ctx, ca_dir, *trust, proxy_policy)) { goto err; }
   if(*certchain) sk_X509_pop_free(*certchain, X509_free);
   *certchain = sk_X509_new_null();
   for (i=(cert)?1:0; i < sk_X509_num(X509_STORE_CTX_get0_chain(store_ctx)); i++) {
     X509* tmp = NULL;
     tmp = sk_X509_value(X509_STORE_CTX_get0_chain(store_ctx),i);
-    if(!verify_cert_additional(tmp, store_ctx, ca_dir, proxy_policy)) { goto err; }
+    if(!verify_cert_additional(tmp, store_ctx, ca_dir, *trust, proxy_policy)) { goto err; }
     tmp = X509_dup(tmp);
     sk_X509_insert(*certchain, tmp, i);
   }
@@ -130,8 +127,10 @@ int verify_cert_chain(X509* cert, STACK_OF(X509)** certchain, std::string const&
   retval = 1;
 
 err:
-  if(cert_store) { X509_STORE_free(cert_store); }
   if(store_ctx) { X509_STORE_CTX_free(store_ctx); }
+  if(cert_store) { X509_STORE_free(cert_store); }
+  // Certificates belong to certchain
+  if(untrusted) { sk_X509_free(untrusted); }
 
   return retval;
 }
@@ -183,7 +182,7 @@ static int verify_callback(int ok, X509_STORE_CTX* store_ctx) {
   return ok;
 }
 
-static int verify_cert_additional(X509* cert, X509_STORE_CTX* store_ctx, std::string const& ca_dir, std::string& proxy_policy) {
+static int verify_cert_additional(X509* cert, X509_STORE_CTX* store_ctx, std::string const& ca_dir, Arc::TrustStore& trust, std::string& proxy_policy) {
   certType type;
   if(!check_cert_type(cert,type)) {
     logger.msg(Arc::ERROR,"Can not get the certificate type");
@@ -270,30 +269,17 @@ static int verify_cert_additional(X509* cert, X509_STORE_CTX* store_ctx, std::st
     X509_OBJECT_free(obj); obj = NULL;
 
     /* now check if the *issuer* has a CRL, and we are revoked */
-    obj = X509_OBJECT_new();
-    if (!obj) return 0;
-    if (X509_STORE_CTX_get_by_subject(store_ctx, X509_LU_CRL, X509_get_issuer_name(cert), obj)) {
-      if(X509_CRL* crl=X509_OBJECT_get0_X509_CRL(obj)) {
-        /* check if this cert is revoked */
-        int n = sk_X509_REVOKED_num(X509_CRL_get_REVOKED(crl));
-        for (int i=0; i<n; i++) {
-          X509_REVOKED* revoked = (X509_REVOKED *)sk_X509_REVOKED_value(X509_CRL_get_REVOKED(crl),i);
-          if(!ASN1_INTEGER_cmp(X509_REVOKED_get0_serialNumber(revoked), X509_get_serialNumber(cert))) {
-            long serial;
-            char buf[64];
-            serial = ASN1_INTEGER_get(X509_REVOKED_get0_serialNumber(revoked));
-            snprintf(buf, sizeof(buf), "%ld (0x%lX)",serial,serial);
-            char* subject_string = X509_NAME_oneline(X509_get_subject_name(cert),NULL,0);
-            logger.msg(Arc::ERROR,"Certificate with serial number %s and subject \"%s\" is revoked",buf,subject_string);
-            X509_STORE_CTX_set_error(store_ctx,X509_V_ERR_CERT_REVOKED);
-            if(subject_string) OPENSSL_free(subject_string);
-            X509_OBJECT_free(obj);
-            return (0);
-          }
-        }
-      }
+    if (trust.IsRevoked(X509_get_issuer_name(cert), X509_get_serialNumber(cert))) {
+      long serial;
+      char buf[64];
+      serial = ASN1_INTEGER_get(X509_get_serialNumber(cert));
+      snprintf(buf, sizeof(buf), "%ld (0x%lX)",serial,serial);
+      char* subject_string = X509_NAME_oneline(X509_get_subject_name(cert),NULL,0);
+      logger.msg(Arc::ERROR,"Certificate with serial number %s and subject \"%s\" is revoked",buf,subject_string);
+      X509_STORE_CTX_set_error(store_ctx,X509_V_ERR_CERT_REVOKED);
+      if(subject_string) OPENSSL_free(subject_string);
+      return (0);
     }
-    X509_OBJECT_free(obj);
 
 
     /** Only need to check signing policy file for no-proxy certificate*/
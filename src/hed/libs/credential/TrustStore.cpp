@@ -0,0 +1,346 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/crypto/OpenSSL.h>
+
+#include "TrustStore.h"
+
+// How often (seconds) CA files are checked for changes
+#define TRUST_STORE_CHECK_PERIOD (60)
+
+#define SIGNING_POLICY_FILE_EXTENSION ".signing_policy"
+
+namespace Arc {
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+
+#define X509_STORE_get0_objects(store) ((store)->objs)
+#define X509_OBJECT_get_type(obj) ((obj)->type)
+#define X509_OBJECT_get0_X509(obj) ((obj)->data.x509)
+#define X509_OBJECT_get0_X509_CRL(obj) ((obj)->data.crl)
+#define X509_REVOKED_get0_serialNumber(revoked) ((revoked)->serialNumber)
+
+static int X509_STORE_up_ref(X509_STORE* store) {
+  CRYPTO_add(&(store->references),1,CRYPTO_LOCK_X509_STORE);
+  return 1;
+}
+
+#endif
+
+static Logger logger(Logger::getRootLogger(), "TrustStore");
+
+// Loaded content. Never modified after being made, hence
+// can be used without locking while referenced.
+class TrustStore::Content {
+ public:
+  X509_STORE* store;
+  std::set<std::string> revoked;
+  std::map<std::string,std::string> policies;
+  unsigned int certs;
+  unsigned int crls;
+  Content(void):store(NULL),certs(0),crls(0) { };
+  ~Content(void) { if(store) X509_STORE_free(store); };
+};
+
+// Keeps all stores and refreshes them in background
+class TrustStoreRegistry {
+ public:
+  static TrustStoreRegistry& Instance(void);
+  TrustStore& Get(const std::string& ca_file, const std::string& ca_dir);
+ private:
+  Glib::Mutex lock_;
+  Glib::Cond cond_;
+  std::map<std::string,TrustStore*> stores_;
+  bool running_;
+  bool exit_;
+  TrustStoreRegistry(void);
+  ~TrustStoreRegistry(void);
+  static void refresh(void* arg);
+};
+
+TrustStoreRegistry& TrustStoreRegistry::Instance(void) {
+  // Created on first use, after OpenSSL is initialized, so it is destroyed
+  // before OpenSSL cleans up at exit.
+  static TrustStoreRegistry registry;
+  return registry;
+}
+
+TrustStoreRegistry::TrustStoreRegistry(void):running_(false),exit_(false) {
+  OpenSSLInit();
+}
+
+TrustStoreRegistry::~TrustStoreRegistry(void) {
+  Glib::Mutex::Lock lock(lock_);
+  exit_ = true;
+  cond_.broadcast();
+  // Wait for reload being done now
+  while(running_) cond_.wait(lock_);
+  for(std::map<std::string,TrustStore*>::iterator store = stores_.begin(); store != stores_.end(); ++store) {
+    delete store->second;
+  };
+  stores_.clear();
+}
+
+TrustStore& TrustStoreRegistry::Get(const std::string& ca_file, const std::string& ca_dir) {
+  std::string key = ca_file + '\0' + ca_dir;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,TrustStore*>::iterator store = stores_.find(key);
+  if(store != stores_.end()) {
+    // Store is loaded once when created. If files were missing
+    // then, background thread picks them up later.
+    return *(store->second);
+  };
+  // Loading is done under lock to avoid parsing same files
+  // by many threads at startup.
+  TrustStore* new_store = new TrustStore(ca_file, ca_dir);
+  new_store->Refresh();
+  stores_[key] = new_store;
+  if(!running_) {
+    if(CreateThreadFunction(&refresh,this)) running_ = true;
+  };
+  return *new_store;
+}
+
+void TrustStoreRegistry::refresh(void* arg) {
+  TrustStoreRegistry& it = *((TrustStoreRegistry*)arg);
+  Glib::Mutex::Lock lock(it.lock_);
+  for(;;) {
+    Glib::TimeVal etime;
+    etime.assign_current_time();
+    etime.add_seconds(TRUST_STORE_CHECK_PERIOD);
+    while(!it.exit_) {
+      if(!it.cond_.timed_wait(it.lock_, etime)) break;
+    };
+    if(it.exit_) break;
+    // Stores are never removed while thread is running
+    std::list<TrustStore*> stores;
+    for(std::map<std::string,TrustStore*>::iterator store = it.stores_.begin(); store != it.stores_.end(); ++store) {
+      stores.push_back(store->second);
+    };
+    lock.release();
+    for(std::list<TrustStore*>::iterator store = stores.begin(); store != stores.end(); ++store) {
+      (*store)->Refresh();
+    };
+    lock.acquire();
+  };
+  it.running_ = false;
+  it.cond_.broadcast();
+}
+
+
+static std::string revoked_key(X509_NAME* issuer, const ASN1_INTEGER* serial) {
+  std::string key;
+  unsigned char* buf = NULL;
+  int l = i2d_X509_NAME(issuer, &buf);
+  if((l < 0) || !buf) return key;
+  key.assign((char*)buf, l);
+  OPENSSL_free(buf);
+  buf = NULL;
+  l = i2d_ASN1_INTEGER((ASN1_INTEGER*)serial, &buf);
+  if((l < 0) || !buf) return "";
+  key.append((char*)buf, l);
+  OPENSSL_free(buf);
+  return key;
+}
+
+static std::string name_hash(X509_NAME* name) {
+  char hash[32];
+  snprintf(hash, sizeof(hash), "%08lx", X509_NAME_hash(name));
+  hash[sizeof(hash)-1] = 0;
+  return hash;
+}
+
+static void stamp_file(const std::string& path, std::string& stamp) {
+  struct stat st;
+  if(::stat(path.c_str(),&st) != 0) {
+    stamp += path + ":-;";
+    return;
+  };
+  stamp += path + ":" + tostring(st.st_ino) + ":" + tostring(st.st_size) + ":" + tostring(st.st_mtime) + ";";
+}
+
+TrustStore& TrustStore::Get(const std::string& ca_file, const std::string& ca_dir) {
+  return TrustStoreRegistry::Instance().Get(ca_file, ca_dir);
+}
+
+TrustStore::TrustStore(const std::string& ca_file, const std::string& ca_dir):
+    ca_file_(ca_file),ca_dir_(ca_dir),content_(NULL),generation_(0) {
+}
+
+TrustStore::~TrustStore(void) {
+  delete content_;
+}
+
+// Collects information about files used to build store.
+// Any difference means store must be reloaded.
+std::string TrustStore::Stamp(void) const {
+  std::string stamp;
+  if(!ca_file_.empty()) stamp_file(ca_file_,stamp);
+  if(!ca_dir_.empty()) {
+    stamp_file(ca_dir_,stamp);
+    // CA certificates and CRLs may be replaced without
+    // touching directory itself, hence summarize all files.
+    unsigned long long int entries = 0;
+    unsigned long long int sizes = 0;
+    unsigned long long int inodes = 0;
+    time_t latest = 0;
+    try {
+      Glib::Dir dir(ca_dir_);
+      for(;;) {
+        std::string name = dir.read_name();
+        if(name.empty()) break;
+        struct stat st;
+        if(::stat(Glib::build_filename(ca_dir_,name).c_str(),&st) != 0) continue;
+        ++entries;
+        sizes += st.st_size;
+        inodes += st.st_ino;
+        if(st.st_mtime > latest) latest = st.st_mtime;
+      };
+    } catch(Glib::FileError& e) {
+    };
+    stamp += tostring(entries) + ":" + tostring(sizes) + ":" + tostring(inodes) + ":" + tostring(latest);
+  };
+  return stamp;
+}
+
+TrustStore::Content* TrustStore::Load(void) const {
+  Content* content = new Content;
+  content->store = X509_STORE_new();
+  X509_LOOKUP* lookup = content->store ? X509_STORE_add_lookup(content->store, X509_LOOKUP_file()) : NULL;
+  if(!lookup) {
+    logger.msg(ERROR, "Failed to create store for trusted certificates");
+    delete content;
+    return NULL;
+  };
+  std::list<std::string> files;
+  if(!ca_file_.empty()) files.push_back(ca_file_);
+  if(!ca_dir_.empty()) {
+    try {
+      Glib::Dir dir(ca_dir_);
+      for(;;) {
+        std::string name = dir.read_name();
+        if(name.empty()) break;
+        // Only files named <hash>.<number>, <hash>.r<number>
+        // and <hash>.signing_policy are used.
+        if((name.length() < 10) || (name[8] != '.')) continue;
+        if(name.find_first_not_of("0123456789abcdef") < 8) continue;
+        std::string suffix = name.substr(9);
+        std::string path = Glib::build_filename(ca_dir_, name);
+        if(name.substr(8) == SIGNING_POLICY_FILE_EXTENSION) {
+          std::ifstream f(path.c_str());
+          if(!f) continue;
+          std::stringstream policy;
+          policy<<f.rdbuf();
+          content->policies[name.substr(0,8)] = policy.str();
+          continue;
+        };
+        if(suffix[0] == 'r') suffix.erase(0,1);
+        if(suffix.empty() || (suffix.find_first_not_of("0123456789") != std::string::npos)) continue;
+        files.push_back(path);
+      };
+    } catch(Glib::FileError& e) {
+      logger.msg(ERROR, "Failed to read directory of trusted CAs %s: %s", ca_dir_, e.what());
+    };
+  };
+  for(std::list<std::string>::iterator file = files.begin(); file != files.end(); ++file) {
+    if(X509_load_cert_crl_file(lookup, file->c_str(), X509_FILETYPE_PEM) <= 0) {
+      logger.msg(WARNING, "Failed to load trusted certificate or CRL from %s", *file);
+    };
+  };
+  // Same certificate may appear in more than one file
+  ERR_clear_error();
+  STACK_OF(X509_OBJECT)* objects = X509_STORE_get0_objects(content->store);
+  for(int n = 0; n < sk_X509_OBJECT_num(objects); ++n) {
+    X509_OBJECT* obj = sk_X509_OBJECT_value(objects, n);
+    if(X509_OBJECT_get_type(obj) == X509_LU_X509) {
+      ++(content->certs);
+    } else if(X509_OBJECT_get_type(obj) == X509_LU_CRL) {
+      ++(content->crls);
+      X509_CRL* crl = X509_OBJECT_get0_X509_CRL(obj);
+      STACK_OF(X509_REVOKED)* revoked = X509_CRL_get_REVOKED(crl);
+      for(int i = 0; i < sk_X509_REVOKED_num(revoked); ++i) {
+        std::string key = revoked_key(X509_CRL_get_issuer(crl),
+                            X509_REVOKED_get0_serialNumber(sk_X509_REVOKED_value(revoked, i)));
+        if(!key.empty()) content->revoked.insert(key);
+      };
+    };
+  };
+  if((content->certs == 0) && (content->crls == 0)) {
+    logger.msg(ERROR, "No trusted certificates found in %s", ca_dir_.empty() ? ca_file_ : ca_dir_);
+    delete content;
+    return NULL;
+  };
+  return content;
+}
+
+void TrustStore::Refresh(void) {
+  std::string stamp = Stamp();
+  {
+    Glib::Mutex::Lock lock(lock_);
+    if(content_ && (stamp == stamp_)) return;
+  };
+  // Loading is slow. Others keep using current content meanwhile.
+  Content* content = Load();
+  Glib::Mutex::Lock lock(lock_);
+  if(!content) {
+    // Keep using previous content and retry later
+    if(content_) logger.msg(WARNING, "Failed to reload trusted certificates, keeping previous ones");
+    return;
+  };
+  logger.msg(content_ ? INFO : VERBOSE, "Loaded %u trusted certificates and %u CRLs with %u revoked certificates",
+             content->certs, content->crls, (unsigned int)content->revoked.size());
+  delete content_;
+  content_ = content;
+  stamp_ = stamp;
+  ++generation_;
+}
+
+X509_STORE* TrustStore::Store(void) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!content_) return NULL;
+  X509_STORE_up_ref(content_->store);
+  return content_->store;
+}
+
+bool TrustStore::IsRevoked(X509_NAME* issuer, ASN1_INTEGER* serial) {
+  std::string key = revoked_key(issuer, serial);
+  if(key.empty()) return false;
+  Glib::Mutex::Lock lock(lock_);
+  if(!content_) return false;
+  return (content_->revoked.find(key) != content_->revoked.end());
+}
+
+bool TrustStore::SigningPolicy(X509_NAME* issuer, std::string& policy) {
+  std::string hash = name_hash(issuer);
+  Glib::Mutex::Lock lock(lock_);
+  if(!content_) return false;
+  std::map<std::string,std::string>::iterator p = content_->policies.find(hash);
+  if(p == content_->policies.end()) return false;
+  policy = p->second;
+  return true;
+}
+
+unsigned int TrustStore::Generation(void) {
+  Glib::Mutex::Lock lock(lock_);
+  return generation_;
+}
+
+} // namespace Arc
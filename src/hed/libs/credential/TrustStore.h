@@ -0,0 +1,65 @@
+#ifndef __ARC_TRUSTSTORE_H__
+#define __ARC_TRUSTSTORE_H__
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <openssl/x509.h>
+#include <glibmm/thread.h>
+
+namespace Arc {
+
+  /// Process-wide store of trusted CA certificates, CRLs and signing policies.
+  /** Parsing CA directory and especially big CRLs is expensive. Instead
+      of doing it for every connection or every verified chain this class
+      loads content of CA file and directory once and shares it between
+      all users in process. Serial numbers of revoked certificates are
+      indexed for fast lookup. Background thread periodically checks if
+      files were changed (for example by fetch-crl) and reloads them.
+      Users already holding previous X509_STORE keep using it.
+      \ingroup credential */
+  class TrustStore {
+  public:
+    /// Returns store for specified CA file and/or directory.
+    /** Store is loaded on first request. Obtained reference remains
+        valid till end of process. */
+    static TrustStore& Get(const std::string& ca_file, const std::string& ca_dir);
+
+    /// Returns OpenSSL store with all loaded certificates and CRLs.
+    /** Caller gets own reference and must release it with X509_STORE_free()
+        or pass it to function which takes ownership like
+        SSL_CTX_set_cert_store(). Returned store must not be modified.
+        Returns NULL if nothing could be loaded. */
+    X509_STORE* Store(void);
+
+    /// Checks if certificate with serial number issued by issuer is revoked.
+    bool IsRevoked(X509_NAME* issuer, ASN1_INTEGER* serial);
+
+    /// Fetches content of Globus signing policy of CA with specified subject.
+    bool SigningPolicy(X509_NAME* issuer, std::string& policy);
+
+    /// Number which changes every time store content is reloaded.
+    unsigned int Generation(void);
+
+  private:
+    class Content;
+    Glib::Mutex lock_;
+    std::string ca_file_;
+    std::string ca_dir_;
+    Content* content_;
+    std::string stamp_;
+    unsigned int generation_;
+    TrustStore(const std::string& ca_file, const std::string& ca_dir);
+    ~TrustStore(void);
+    TrustStore(const TrustStore&);
+    TrustStore& operator=(const TrustStore&);
+    std::string Stamp(void) const;
+    Content* Load(void) const;
+    void Refresh(void);
+    friend class TrustStoreRegistry;
+  };
+
+} // namespace Arc
+
+#endif // __ARC_TRUSTSTORE_H__
@@ -3,8 +3,13 @@
 #endif
 
 #include <fstream>
+#include <map>
 #include <glibmm/fileutils.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <openssl/evp.h>
 
 #include <arc/DateTime.h>
 #include <arc/Thread.h>
@@ -882,15 +887,45 @@ err:
 
   }
   
+  // Returns empty string if path is not regular file
+  static std::string file_stamp(const std::string& path) {
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0) return "";
+    if(!S_ISREG(st.st_mode)) return "";
+    return tostring(st.st_ino) + ":" + tostring(st.st_size) + ":" + tostring(st.st_mtime);
+  }
+
+  // In-memory copy of content of *.lsc files. Files are read again
+  // only if they are changed.
+  class LSCIndexEntry {
+   public:
+    std::string stamp;
+    std::vector<std::string> dns;
+  };
+
+  static Glib::Mutex lsc_index_lock;
+  static std::map<std::string,LSCIndexEntry> lsc_index;
+
   /* Get the DNs chain from relative *.lsc file.
    * The location of .lsc file is path: $vomsdir/<VO>/<hostname>.lsc
    */
-  static bool getLSC(const std::string& vomsdir, const std::string& voname, const std::string& hostname, std::vector<std::string>& vomscert_trust_dn) {
-    std::string lsc_loc = vomsdir + G_DIR_SEPARATOR_S + voname + G_DIR_SEPARATOR_S + hostname + ".lsc";
-    if (!Glib::file_test(lsc_loc, Glib::FILE_TEST_IS_REGULAR)) {
+  static bool getLSC(const std::string& vomsdir, const std::string& voname, const std::string& hostname, std::vector<std::string>& vomscert_trust_dn, std::string& lsc_loc) {
+    lsc_loc = vomsdir + G_DIR_SEPARATOR_S + voname + G_DIR_SEPARATOR_S + hostname + ".lsc";
+    std::string stamp = file_stamp(lsc_loc);
+    if (stamp.empty()) {
       CredentialLogger.msg(INFO, "VOMS: The lsc file %s does not exist", lsc_loc);
+      Glib::Mutex::Lock lock(lsc_index_lock);
+      lsc_index.erase(lsc_loc);
       return false;
     }
+    {
+      Glib::Mutex::Lock lock(lsc_index_lock);
+      std::map<std::string,LSCIndexEntry>::iterator i = lsc_index.find(lsc_loc);
+      if ((i != lsc_index.end()) && (i->second.stamp == stamp)) {
+        vomscert_trust_dn.insert(vomscert_trust_dn.end(), i->second.dns.begin(), i->second.dns.end());
+        return true;
+      }
+    }
     std::string trustdn_str;  
     std::ifstream in(lsc_loc.c_str(), std::ios::in);
     if (!in) {       
@@ -899,7 +934,15 @@ err:
     }
     std::getline<char>(in, trustdn_str, 0);
     in.close();
-    tokenize(trustdn_str, vomscert_trust_dn, "\n");
+    std::vector<std::string> dns;
+    tokenize(trustdn_str, dns, "\n");
+    {
+      Glib::Mutex::Lock lock(lsc_index_lock);
+      LSCIndexEntry& entry = lsc_index[lsc_loc];
+      entry.stamp = stamp;
+      entry.dns = dns;
+    }
+    vomscert_trust_dn.insert(vomscert_trust_dn.end(), dns.begin(), dns.end());
     return true;
   }
 
@@ -907,7 +950,7 @@ err:
     const std::string vomsdir, const std::string& voname, const std::string& hostname, 
     const std::string& ca_cert_dir, const std::string& ca_cert_file, 
     VOMSTrustList& vomscert_trust_dn, 
-    X509*& issuer_cert, unsigned int& status, bool verify) {
+    X509*& issuer_cert, unsigned int& status, bool verify, std::string& lsc) {
 
     bool res = true;
     X509* issuer = NULL;
@@ -941,7 +984,7 @@ err:
         bool lsc_check = false;
         if((vomscert_trust_dn.SizeChains()==0) && (vomscert_trust_dn.SizeRegexs()==0)) {
           std::vector<std::string> voms_trustdn;
-          if(!getLSC(vomsdir, voname, hostname, voms_trustdn)) {
+          if(!getLSC(vomsdir, voname, hostname, voms_trustdn, lsc)) {
             CredentialLogger.msg(WARNING,"VOMS: there is no constraints of trusted voms DNs, the certificates stack in AC will not be checked.");
             trust_success = true;
             status |= VOMSACInfo::TrustFailed;
@@ -1540,7 +1583,7 @@ err:
         VOMSTrustList& vomscert_trust_dn,
         X509* holder, std::vector<std::string>& attr_output, 
         std::string& vo_name, std::string& ac_holder_name, std::string& ac_issuer_name, 
-        Time& from, Time& till, unsigned int& status, bool verify) {
+        Time& from, Time& till, unsigned int& status, bool verify, std::string& lsc) {
     bool res = true;
     //Extract name 
     STACK_OF(AC_ATTR) * atts = ac->acinfo->attrib;
@@ -1605,7 +1648,7 @@ err:
 
     if(!checkSignature(ac, vomsdir, voname, hostname,
                        ca_cert_dir, ca_cert_file, vomscert_trust_dn,
-                       issuer, status, verify)) {
+                       issuer, status, verify, lsc)) {
       CredentialLogger.msg(ERROR,"VOMS: can not verify the signature of the AC");
       res = false;
     }
@@ -1620,6 +1663,145 @@ err:
     return res;
   }
 
+  // Cache of results of AC verification. Same proxy is usually presented
+  // on many connections and verifying its ACs involves signature checks,
+  // reading LSC files and validating chain of VOMS server certificate.
+  // Entries are indexed by digests of AC, holder certificate and
+  // verification parameters. They expire with AC or after
+  // VOMS_AC_CACHE_TTL in order to catch up with changes in CAs and CRLs.
+  // Entries which used LSC file are dropped if that file changes.
+  // Failures caused by AC itself (bad signature or content, no trust)
+  // will not go away and are kept as long as successes. Other failures,
+  // like unverifiable chain of VOMS server certificate, may be caused by
+  // CA or CRL files being updated, so they are kept only shortly.
+
+#define VOMS_AC_CACHE_TTL (600)
+#define VOMS_AC_CACHE_NEGATIVE_TTL (30)
+#define VOMS_AC_CACHE_MAX (10000)
+#define VOMS_AC_CACHE_REPORT (1000)
+
+  class VOMSACCacheEntry {
+   public:
+    VOMSACInfo info;
+    bool result;
+    time_t expires;
+    std::string lsc;
+    std::string lsc_stamp;
+  };
+
+  static Glib::Mutex voms_ac_cache_lock;
+  static std::map<std::string,VOMSACCacheEntry> voms_ac_cache;
+  static unsigned long long int voms_ac_cache_hits = 0;
+  static unsigned long long int voms_ac_cache_misses = 0;
+
+  static bool digest_append(const std::string& data, std::string& key) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdlen = 0;
+    if(!EVP_Digest(data.c_str(), data.length(), md, &mdlen, EVP_sha256(), NULL)) return false;
+    key.append((const char*)md, mdlen);
+    return true;
+  }
+
+  static std::string voms_ac_cache_key(AC* ac, X509* holder,
+        const std::string& ca_cert_dir, const std::string& ca_cert_file,
+        const std::string& vomsdir, const VOMSTrustList& vomscert_trust_dn, bool verify) {
+    std::string key;
+    int l = i2d_AC(ac, NULL);
+    if(l <= 0) return "";
+    std::string der(l, '\0');
+    unsigned char* p = (unsigned char*)&(der[0]);
+    if(i2d_AC(ac, &p) != l) return "";
+    if(!digest_append(der, key)) return "";
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdlen = 0;
+    if(!X509_digest(holder, EVP_sha256(), md, &mdlen)) return "";
+    key.append((const char*)md, mdlen);
+    std::string params = ca_cert_dir + '\0' + ca_cert_file + '\0' + vomsdir + '\0' + (verify?"1":"0");
+    for(int n = 0; n < vomscert_trust_dn.SizeChains(); ++n) {
+      const VOMSTrustChain& chain = vomscert_trust_dn.GetChain(n);
+      params += '\1';
+      for(VOMSTrustChain::const_iterator dn = chain.begin(); dn != chain.end(); ++dn) params += '\0' + *dn;
+    }
+    for(int n = 0; n < vomscert_trust_dn.SizeRegexs(); ++n) {
+      params += '\2' + vomscert_trust_dn.GetRegex(n).getPattern();
+    }
+    if(!digest_append(params, key)) return "";
+    return key;
+  }
+
+  static void voms_ac_cache_report(void) {
+    unsigned long long int total = voms_ac_cache_hits + voms_ac_cache_misses;
+    if((total % VOMS_AC_CACHE_REPORT) != 0) return;
+    CredentialLogger.msg(VERBOSE, "VOMS: AC cache hit rate %s%% (%s hits, %s misses, %u entries)",
+                         tostring(voms_ac_cache_hits * 100.0 / total, 0, 1),
+                         tostring(voms_ac_cache_hits), tostring(voms_ac_cache_misses),
+                         (unsigned int)voms_ac_cache.size());
+  }
+
+  static bool voms_ac_cache_get(const std::string& key, VOMSACInfo& info, bool& result) {
+    if(key.empty()) return false;
+    Glib::Mutex::Lock lock(voms_ac_cache_lock);
+    std::map<std::string,VOMSACCacheEntry>::iterator entry = voms_ac_cache.find(key);
+    if(entry != voms_ac_cache.end()) {
+      if((entry->second.expires <= time(NULL)) ||
+         ((!entry->second.lsc.empty()) && (file_stamp(entry->second.lsc) != entry->second.lsc_stamp))) {
+        voms_ac_cache.erase(entry);
+        entry = voms_ac_cache.end();
+      }
+    }
+    if(entry == voms_ac_cache.end()) {
+      ++voms_ac_cache_misses;
+      voms_ac_cache_report();
+      return false;
+    }
+    ++voms_ac_cache_hits;
+    voms_ac_cache_report();
+    info = entry->second.info;
+    result = entry->second.result;
+    return true;
+  }
+
+  static void voms_ac_cache_put(const std::string& key, const VOMSACInfo& info, bool result, const std::string& lsc) {
+    if(key.empty()) return;
+    // Result depends on current time
+    if(info.status & VOMSACInfo::TimeValidFailed) return;
+    time_t now = time(NULL);
+    bool definite = result || (info.status & (VOMSACInfo::ParsingError | VOMSACInfo::TrustFailed | VOMSACInfo::CertRevoked));
+    time_t expires = now + (definite ? VOMS_AC_CACHE_TTL : VOMS_AC_CACHE_NEGATIVE_TTL);
+    if((info.till.GetTime() != Time::UNDEFINED) && (info.till.GetTime() < expires)) expires = info.till.GetTime();
+    if(expires <= now) return;
+    std::string lsc_stamp;
+    if(!lsc.empty()) lsc_stamp = file_stamp(lsc);
+    Glib::Mutex::Lock lock(voms_ac_cache_lock);
+    if(voms_ac_cache.size() >= VOMS_AC_CACHE_MAX) {
+      for(std::map<std::string,VOMSACCacheEntry>::iterator entry = voms_ac_cache.begin();
+                                           entry != voms_ac_cache.end();) {
+        if(entry->second.expires <= now) {
+          voms_ac_cache.erase(entry++);
+        } else {
+          ++entry;
+        }
+      }
+      // Too many valid entries - start from scratch
+      if(voms_ac_cache.size() >= VOMS_AC_CACHE_MAX) voms_ac_cache.clear();
+    }
+    VOMSACCacheEntry& entry = voms_ac_cache[key];
+    entry.info = info;
+    entry.result = result;
+    entry.expires = expires;
+    entry.lsc = lsc;
+    entry.lsc_stamp = lsc_stamp;
+  }
+
+  VOMSACCacheStatistics GetVOMSACCacheStatistics(void) {
+    VOMSACCacheStatistics stat;
+    Glib::Mutex::Lock lock(voms_ac_cache_lock);
+    stat.hits = voms_ac_cache_hits;
+    stat.misses = voms_ac_cache_misses;
+    stat.entries = voms_ac_cache.size();
+    return stat;
+  }
+
   bool parseVOMSAC(X509* holder,
         const std::string& ca_cert_dir, const std::string& ca_cert_file, 
         const std::string& vomsdir, VOMSTrustList& vomscert_trust_dn,
@@ -1654,10 +1836,20 @@ err:
     for (int i = 0; i < num; i++) {
       AC *ac = (AC *)sk_AC_value(aclist->acs, i);
       VOMSACInfo ac_info;
-      bool r = verifyVOMSAC(ac, ca_cert_dir, ca_cert_file,
-          vomsdir.empty()?default_vomsdir:vomsdir, vomscert_trust_dn, 
-          holder, ac_info.attributes, ac_info.voname, ac_info.holder, ac_info.issuer, 
-          ac_info.from, ac_info.till, ac_info.status, verify);
+      bool r = false;
+      const std::string& ac_vomsdir = vomsdir.empty()?default_vomsdir:vomsdir;
+      std::string cache_key = voms_ac_cache_key(ac, holder, ca_cert_dir, ca_cert_file,
+          ac_vomsdir, vomscert_trust_dn, verify);
+      if(voms_ac_cache_get(cache_key, ac_info, r)) {
+        CredentialLogger.msg(DEBUG,"VOMS: using cached result of AC verification for VO %s",ac_info.voname);
+      } else {
+        std::string lsc;
+        r = verifyVOMSAC(ac, ca_cert_dir, ca_cert_file,
+            ac_vomsdir, vomscert_trust_dn, 
+            holder, ac_info.attributes, ac_info.voname, ac_info.holder, ac_info.issuer, 
+            ac_info.from, ac_info.till, ac_info.status, verify, lsc);
+        voms_ac_cache_put(cache_key, ac_info, r, lsc);
+      }
       if(!r) verified = false;
       if(r || reportall) {
         if(critical) ac_info.status |= VOMSACInfo::IsCritical;
@@ -48,6 +48,17 @@ namespace Arc {
     VOMSACInfo(void):from(-1),till(-1),status(0) { };
   };
 
+  /// Statistics of cache of verified VOMS attribute certificates.
+  /** parseVOMSAC() keeps results of verification of attribute certificates
+      in process-wide cache and reuses them while certificates are valid. */
+  class VOMSACCacheStatistics {
+   public:
+    unsigned long long int hits;
+    unsigned long long int misses;
+    unsigned int entries;
+    VOMSACCacheStatistics(void):hits(0),misses(0),entries(0) { };
+  };
+
   /// Stores definitions for making decision if VOMS server is trusted.
   class VOMSTrustList {
     private:
@@ -264,6 +275,10 @@ namespace Arc {
                    std::vector<VOMSACInfo>& output,
                    bool verify = true, bool reportall = false);
 
+  /**Returns counters of cache used by parseVOMSAC() for verified
+    attribute certificates. */
+  VOMSACCacheStatistics GetVOMSACCacheStatistics(void);
+
   /**Parse the certificate or a chain of certificates, in string format */
   bool parseVOMSAC(const std::string& cert_str,
                    const std::string& ca_cert_dir,
@@ -9,6 +9,7 @@
 #include <openssl/evp.h>
 #include <arc/credential/CertUtil.h>
 #include <arc/credential/Credential.h>
+#include <arc/credential/TrustStore.h>
 #include <arc/Utils.h>
 
 class CredentialTest
@@ -18,6 +19,7 @@ class CredentialTest
   CPPUNIT_TEST(testCAcert);
   CPPUNIT_TEST(testhostcert);
   CPPUNIT_TEST(testusercert);
+  CPPUNIT_TEST(testtruststore);
   CPPUNIT_TEST(testproxy);
   CPPUNIT_TEST(testproxy2proxy);
   CPPUNIT_TEST(testproxycertinfo);
@@ -29,6 +31,7 @@ public:
   void testCAcert();
   void testhostcert();
   void testusercert();
+  void testtruststore();
   void testproxy();
   void testproxy2proxy();
   void testproxycertinfo(){};
@@ -234,6 +237,25 @@ void CredentialTest::testusercert() {
 
 }
 
+void CredentialTest::testtruststore() {
+
+  // Store is loaded once and shared
+  Arc::TrustStore& trust = Arc::TrustStore::Get(CAcert, "");
+  CPPUNIT_ASSERT(&trust == &Arc::TrustStore::Get(CAcert, ""));
+  CPPUNIT_ASSERT(trust.Generation() > 0);
+
+  X509_STORE* store = trust.Store();
+  CPPUNIT_ASSERT(store != NULL);
+  X509_STORE_free(store);
+
+  // There is no CRL hence nothing is revoked
+  Arc::Credential user_cert(user_cert_file, user_key_file, ".", CAcert, user_passphrase);
+  X509* cert = user_cert.GetCert();
+  CPPUNIT_ASSERT(cert != NULL);
+  CPPUNIT_ASSERT(!trust.IsRevoked(X509_get_issuer_name(cert), X509_get_serialNumber(cert)));
+  X509_free(cert);
+}
+
 void CredentialTest::testproxy() {
 
   int keybits = 2048;
@@ -132,6 +132,18 @@ void VOMSUtilTest::VOMSTrustListTest() {
   CPPUNIT_ASSERT_EQUAL(1,(int)attributes.size());
   CPPUNIT_ASSERT_EQUAL(4,(int)attributes[0].attributes.size());
 
+  // Second parsing must reuse cached verification result
+
+  Arc::VOMSACCacheStatistics stat = Arc::GetVOMSACCacheStatistics();
+  std::vector<Arc::VOMSACInfo> cached_attributes;
+  Arc::parseVOMSAC(voms_proxy, ".", CAcert, "", trust_dn, cached_attributes, true);
+  Arc::VOMSACCacheStatistics cached_stat = Arc::GetVOMSACCacheStatistics();
+
+  CPPUNIT_ASSERT_EQUAL(1,(int)cached_attributes.size());
+  CPPUNIT_ASSERT(attributes[0].attributes == cached_attributes[0].attributes);
+  CPPUNIT_ASSERT_EQUAL(attributes[0].status,cached_attributes[0].status);
+  CPPUNIT_ASSERT_EQUAL(stat.hits+1,cached_stat.hits);
+
 }
 
 CPPUNIT_TEST_SUITE_REGISTRATION(VOMSUtilTest);
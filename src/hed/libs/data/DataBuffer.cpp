@@ -11,6 +11,88 @@
 
 namespace Arc {
 
+  // Length of interval (microseconds) over which transfer is measured in adaptive mode
+  #define DATABUFFER_ADAPT_INTERVAL (1000000)
+  // Number of intervals buffers must stay underused before being released
+  #define DATABUFFER_ADAPT_IDLE (5)
+  // Buffers are never released below this number
+  #define DATABUFFER_MIN_BLOCKS (2)
+  // Default limit for memory allocated for buffers by all DataBuffer objects in process
+  #define DATABUFFER_MEMORY_BUDGET (256*1024*1024ULL)
+
+  static Glib::Mutex memory_lock;
+  static unsigned long long int memory_allocated = 0;
+  static unsigned long long int memory_limit = DATABUFFER_MEMORY_BUDGET;
+
+  static char* buffer_alloc(unsigned int size) {
+    char* buf = (char*)malloc(size);
+    if (buf) {
+      Glib::Mutex::Lock lock(memory_lock);
+      memory_allocated += size;
+    }
+    return buf;
+  }
+
+  static void buffer_free(char* buf, unsigned int size) {
+    if (!buf) return;
+    free(buf);
+    Glib::Mutex::Lock lock(memory_lock);
+    memory_allocated -= size;
+  }
+
+  class DataBuffer::Adaptive {
+   public:
+    /// buffers configuration requested in set()
+    unsigned int base_size;
+    int base_blocks;
+    /// size to be used for (re)allocated buffers
+    unsigned int block_size;
+    /// limits requested in adaptive()
+    unsigned int max_size;
+    int max_blocks;
+    /// start of current measurement interval
+    Glib::TimeVal start;
+    /// time (microseconds) spent waiting while all buffers were taken
+    unsigned long long int starved;
+    /// amount of data transferred before current measurement interval
+    unsigned long long int transferred;
+    /// transfer rate (bytes per second) in previous measurement interval
+    double rate;
+    /// maximal number of buffers holding data in current measurement interval
+    int peak;
+    /// number of subsequent intervals with buffers being underused
+    int idle;
+    Adaptive(unsigned int size, int blocks): max_size(size), max_blocks(blocks) {
+      reset(0, 0, 0);
+    }
+    void reset(unsigned int size, int blocks, unsigned long long int transferred_size) {
+      base_size = size;
+      base_blocks = blocks;
+      block_size = size;
+      start.assign_current_time();
+      starved = 0;
+      transferred = transferred_size;
+      rate = 0;
+      peak = 0;
+      idle = 0;
+    }
+  };
+
+  void DataBuffer::set_process_memory_budget(unsigned long long int budget) {
+    Glib::Mutex::Lock lock(memory_lock);
+    memory_limit = budget;
+  }
+
+  unsigned long long int DataBuffer::process_memory_budget() {
+    Glib::Mutex::Lock lock(memory_lock);
+    return memory_limit;
+  }
+
+  unsigned long long int DataBuffer::process_memory_used() {
+    Glib::Mutex::Lock lock(memory_lock);
+    return memory_allocated;
+  }
+
   bool DataBuffer::set(CheckSum *cksum, unsigned int size, int blocks) {
     lock.lock();
     if (blocks < 0) {
@@ -19,7 +101,7 @@ namespace Arc {
     }
     if (bufs != NULL) {
       for (int i = 0; i < bufs_n; i++) {
-        if (bufs[i].start) free(bufs[i].start);
+        buffer_free(bufs[i].start, bufs[i].size);
       }
       free(bufs);
       bufs_n = 0;
@@ -37,6 +119,12 @@ namespace Arc {
       return false;
     }
     bufs_n = blocks;
+    Adaptive* state = adaptive_state;
+    if (state) {
+      state->reset(size, blocks, speed.transferred_size());
+      if (state->max_size < size) state->max_size = size;
+      if (state->max_blocks < blocks) state->max_blocks = blocks;
+    }
     for (int i = 0; i < blocks; i++) {
       bufs[i].start = NULL;
       bufs[i].taken_for_read = false;
@@ -81,6 +169,7 @@ namespace Arc {
     bufs_n = 0;
     bufs = NULL;
     set_counter = 0;
+    adaptive_state = NULL;
     eof_read_flag = false;
     eof_write_flag = false;
     error_read_flag = false;
@@ -95,6 +184,7 @@ namespace Arc {
     bufs_n = 0;
     bufs = NULL;
     set_counter = 0;
+    adaptive_state = NULL;
     eof_read_flag = false;
     eof_write_flag = false;
     error_read_flag = false;
@@ -106,6 +196,126 @@ namespace Arc {
 
   DataBuffer::~DataBuffer() {
     set(NULL, 0, 0);
+    delete adaptive_state;
+  }
+
+  void DataBuffer::adaptive(unsigned int size, int blocks) {
+    lock.lock();
+    Adaptive* state = adaptive_state;
+    if (!state) {
+      state = new Adaptive(size, blocks);
+      if (bufs != NULL) state->reset(bufs[0].size, bufs_n, speed.transferred_size());
+      adaptive_state = state;
+    }
+    state->max_size = (size > state->base_size) ? size : state->base_size;
+    state->max_blocks = (blocks > state->base_blocks) ? blocks : state->base_blocks;
+    lock.unlock();
+  }
+
+  bool DataBuffer::adaptive() const {
+    return (adaptive_state != NULL);
+  }
+
+  int DataBuffer::buffer_num() const {
+    return bufs_n;
+  }
+
+  bool DataBuffer::all_taken() const {
+    for (int i = 0; i < bufs_n; i++) {
+      if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write)) return false;
+    }
+    return true;
+  }
+
+  void DataBuffer::account_wait(Adaptive& state, const Glib::TimeVal& stime) {
+    Glib::TimeVal etime;
+    etime.assign_current_time();
+    etime.subtract(stime);
+    if (etime.negative()) return;
+    state.starved += ((unsigned long long int)etime.tv_sec) * 1000000 + etime.tv_usec;
+  }
+
+  void DataBuffer::resize(Adaptive& state, int blocks) {
+    if (blocks > bufs_n) {
+      buf_desc *nbufs = (buf_desc*)realloc(bufs, sizeof(buf_desc) * blocks);
+      if (nbufs == NULL) return;
+      bufs = nbufs;
+      for (int i = bufs_n; i < blocks; i++) {
+        bufs[i].start = NULL;
+        bufs[i].taken_for_read = false;
+        bufs[i].taken_for_write = false;
+        bufs[i].size = state.block_size;
+        bufs[i].used = 0;
+        bufs[i].offset = 0;
+      }
+      bufs_n = blocks;
+      cond.broadcast();
+      return;
+    }
+    // Handles must stay valid, so only trailing unused buffers are released
+    while (bufs_n > blocks) {
+      buf_desc& buf = bufs[bufs_n - 1];
+      if (buf.taken_for_read || buf.taken_for_write || (buf.used != 0)) break;
+      buffer_free(buf.start, buf.size);
+      --bufs_n;
+    }
+  }
+
+  void DataBuffer::adapt() {
+    if (bufs == NULL) return;
+    Adaptive* state = adaptive_state;
+    if (!state) return;
+    int in_use = 0;
+    for (int i = 0; i < bufs_n; i++) {
+      if (bufs[i].taken_for_read || bufs[i].taken_for_write || (bufs[i].used != 0)) ++in_use;
+    }
+    if (in_use > state->peak) state->peak = in_use;
+    Glib::TimeVal now;
+    now.assign_current_time();
+    Glib::TimeVal elapsed = now;
+    elapsed.subtract(state->start);
+    long long int interval = ((long long int)elapsed.tv_sec) * 1000000 + elapsed.tv_usec;
+    if (interval < DATABUFFER_ADAPT_INTERVAL) return;
+    unsigned long long int transferred = speed.transferred_size();
+    double rate = ((double)(transferred - state->transferred)) * 1000000 / interval;
+    // Buffers are considered to limit transfer if both sides were waiting
+    // for each other with all buffers taken for more than 10% of time.
+    bool starved = ((state->starved * 10) > (unsigned long long int)interval);
+    unsigned long long int used = process_memory_used();
+    unsigned long long int budget = process_memory_budget();
+    if (budget && (used > budget)) {
+      // Too much memory used by all transfers - return to initial configuration
+      state->block_size = state->base_size;
+      resize(*state, state->base_blocks);
+      state->idle = 0;
+    } else if (starved && (rate >= (state->rate * 0.9))) {
+      // Keep growing while it does not make transfer slower
+      if (bufs_n < state->max_blocks) {
+        int blocks = bufs_n + (bufs_n + 1) / 2;
+        if (blocks > state->max_blocks) blocks = state->max_blocks;
+        if ((!budget) || ((used + (unsigned long long int)(blocks - bufs_n) * state->block_size) <= budget))
+          resize(*state, blocks);
+      } else if (state->block_size < state->max_size) {
+        unsigned int size = (state->block_size > (state->max_size / 2)) ? state->max_size : (state->block_size * 2);
+        if ((!budget) || ((used + (unsigned long long int)bufs_n * (size - state->block_size)) <= budget))
+          state->block_size = size;
+      }
+      state->idle = 0;
+    } else if ((!starved) && ((state->peak + 1) < bufs_n)) {
+      if (++state->idle >= DATABUFFER_ADAPT_IDLE) {
+        int blocks = state->peak + 1;
+        if (blocks < DATABUFFER_MIN_BLOCKS) blocks = DATABUFFER_MIN_BLOCKS;
+        resize(*state, blocks);
+        state->idle = 0;
+      }
+    } else {
+      state->idle = 0;
+    }
+    state->start = now;
+    state->starved = 0;
+    state->transferred = transferred;
+    state->rate = rate;
+    state->peak = in_use;
   }
 
   bool DataBuffer::eof_read() {
@@ -288,6 +498,7 @@ namespace Arc {
       lock.unlock();
       return false;
     }
+    Adaptive* state = adaptive_state;
     for (;;) {
       if (error()) { /* errors detected/set - any continuation is unusable */
         lock.unlock();
@@ -296,8 +507,14 @@ namespace Arc {
       for (int i = 0; i < bufs_n; i++) {
         if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
             (bufs[i].used == 0)) {
+          if ((bufs[i].start != NULL) && state && (bufs[i].size != state->block_size)) {
+            // size was changed in adaptive mode
+            buffer_free(bufs[i].start, bufs[i].size);
+            bufs[i].start = NULL;
+          }
           if (bufs[i].start == NULL) {
-            bufs[i].start = (char*)malloc(bufs[i].size);
+            if (state) bufs[i].size = state->block_size;
+            bufs[i].start = buffer_alloc(bufs[i].size);
             if (bufs[i].start == NULL) continue;
           }
           handle = i;
@@ -317,10 +534,17 @@ namespace Arc {
         lock.unlock();
         return false;
       }
+      Adaptive* starved = all_taken() ? adaptive_state : NULL;
+      Glib::TimeVal stime;
+      if (starved) stime.assign_current_time();
       if (!cond_wait()) {
         lock.unlock();
         return false;
       }
+      if (starved) {
+        account_wait(*starved, stime);
+        adapt();
+      }
     }
     lock.unlock();
     return false;
@@ -472,10 +696,17 @@ namespace Arc {
         lock.unlock();
         return false;
       }
+      Adaptive* starved = all_taken() ? adaptive_state : NULL;
+      Glib::TimeVal stime;
+      if (starved) stime.assign_current_time();
       if (!cond_wait()) {
         lock.unlock();
         return false;
       }
+      if (starved) {
+        account_wait(*starved, stime);
+        adapt();
+      }
     }
     lock.unlock();
     return false;
@@ -528,6 +759,7 @@ namespace Arc {
     bufs[handle].taken_for_write = false;
     bufs[handle].used = 0;
     bufs[handle].offset = 0;
+    adapt();
     cond.broadcast();
     lock.unlock();
     return true;
@@ -70,6 +70,17 @@ namespace Arc {
     };
     /// checksums to be computed in this buffer
     std::list<checksum_desc> checksums;
+    /// state of adaptive mode, NULL if adaptive mode is not turned on
+    class Adaptive;
+    Adaptive* adaptive_state;
+    /// true if all buffers are taken by reading or writing part
+    bool all_taken() const;
+    /// count time spent waiting since stime if all buffers were taken
+    void account_wait(Adaptive& state, const Glib::TimeVal& stime);
+    /// change number and size of buffers according to collected statistics
+    void adapt();
+    /// change number of buffers, only unused ones are removed
+    void resize(Adaptive& state, int blocks);
 
   public:
     /// This object controls transfer speed
@@ -104,6 +115,37 @@ namespace Arc {
      */
     bool set(CheckSum *cksum = NULL, unsigned int size = 1048576,
              int blocks = 3);
+    /// Turn on adaptive sizing of buffers.
+    /**
+     * In adaptive mode the number of buffers grows while both reading and
+     * writing parts keep all buffers taken and have to wait for each other,
+     * which is typical for high latency transfers. When all buffers are
+     * already in use the size of newly allocated buffers grows instead.
+     * Growth stops as soon as it does not improve transfer rate or it would
+     * exceed the memory budget of the process (see
+     * set_process_memory_budget()). Buffers which stay unused are
+     * released. Limits are never lower than parameters passed to set().
+     * \param size maximal size of every buffer in bytes.
+     * \param blocks maximal number of buffers.
+     */
+    void adaptive(unsigned int size, int blocks);
+    /// Returns true if adaptive sizing of buffers is turned on.
+    bool adaptive() const;
+    /// Returns current number of buffers.
+    int buffer_num() const;
+    /// Set amount of memory in bytes all DataBuffer objects in process may use.
+    /**
+     * Buffers grow in adaptive mode only while total amount of memory
+     * allocated for buffers in this process stays within budget. Initial
+     * buffers are always allocated. 0 means no limit. Budget is not shared
+     * with other processes, e.g. every DataStagingDelivery process has
+     * its own.
+     */
+    static void set_process_memory_budget(unsigned long long int budget);
+    /// Returns amount of memory DataBuffer objects in process may use.
+    static unsigned long long int process_memory_budget();
+    /// Returns amount of memory currently allocated for all buffers in process.
+    static unsigned long long int process_memory_used();
     /// Add a checksum object which will compute checksum of buffer.
     /**
      * \param cksum object which will compute checksum. Should not be
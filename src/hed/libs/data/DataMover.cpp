@@ -7,6 +7,7 @@
 #include <cstdlib>
 // NOTE: On Solaris errno is not working properly if cerrno is included first
 #include <cerrno>
+#include <set>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,6 +36,10 @@
 
 namespace Arc {
 
+  // Limits for buffers in adaptive mode
+  #define DATAMOVER_MAX_BUFFER_SIZE (16*1024*1024)
+  #define DATAMOVER_MAX_BUFFER_NUM (32)
+
   static void transfer_cb(unsigned long long int bytes_transferred) {
     fprintf (stderr, "\r%llu kB                  \r", bytes_transferred / 1024);
   }
@@ -55,7 +60,13 @@ namespace Arc {
       show_progress(NULL),
       cancelled(false) {}
 
+  // Objects with adaptive buffers turned on. Kept outside of DataMover
+  // objects in order to not change layout of the class.
+  static Glib::Mutex adaptive_lock;
+  static std::set<const DataMover*> adaptive_movers;
+
   DataMover::~DataMover() {
+    adaptive_buffers(false);
     Cancel();
     // Wait for Transfer() to finish with lock
     Glib::Mutex::Lock lock(lock_);
@@ -90,6 +101,17 @@ namespace Arc {
     do_checks = val;
   }
 
+  bool DataMover::adaptive_buffers() {
+    Glib::Mutex::Lock lock(adaptive_lock);
+    return (adaptive_movers.find(this) != adaptive_movers.end());
+  }
+
+  void DataMover::adaptive_buffers(bool val) {
+    Glib::Mutex::Lock lock(adaptive_lock);
+    if (val) adaptive_movers.insert(this);
+    else adaptive_movers.erase(this);
+  }
+
   typedef struct {
     DataPoint *source;
     DataPoint *destination;
@@ -524,8 +546,21 @@ namespace Arc {
       }
 
       /* create buffer and tune speed control */
+      bool adaptive = adaptive_buffers();
+      if (adaptive && source.CheckSize() && (source.GetSize() < (unsigned long long int)bufsize)) {
+        // Small files need no big buffers. Adaptive mode will grow them if needed.
+        long long int size = (source.GetSize() + 65535) & ~((long long int)65535);
+        if (size < 65536) size = 65536;
+        if (size < bufsize) {
+          bufsize = size;
+          logger.msg(VERBOSE, "Reducing buffer size to %lli for small file", bufsize);
+        }
+      }
       buffer.set(&crc, bufsize, bufnum);
       if (!buffer) logger.msg(WARNING, "Buffer creation failed !");
+      if (adaptive) {
+        buffer.adaptive(DATAMOVER_MAX_BUFFER_SIZE, DATAMOVER_MAX_BUFFER_NUM);
+      }
       buffer.speed.set_min_speed(min_speed, min_speed_time);
       buffer.speed.set_min_average_speed(min_average_speed);
       buffer.speed.set_max_inactivity_time(max_inactivity_time);
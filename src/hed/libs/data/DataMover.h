@@ -150,6 +150,16 @@ namespace Arc {
      * of metadata between index service and physical replica.
      */
     void checks(bool v);
+    /// Returns true if buffers used for transfer adapt to transfer conditions.
+    bool adaptive_buffers();
+    /// Set if buffers used for transfer adapt to transfer conditions.
+    /**
+     * If turned on, number and size of buffers grow for high latency
+     * transfers and shrink for transfers which do not use them. Memory
+     * used by all transfers in process is limited by
+     * DataBuffer::set_process_memory_budget().
+     */
+    void adaptive_buffers(bool v);
     /// Set minimal allowed transfer speed (default is 0) to 'min_speed'.
     /**
      * If speed drops below for time longer than 'min_speed_time', error
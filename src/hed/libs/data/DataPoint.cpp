@@ -5,6 +5,7 @@
 #endif
 
 #include <list>
+#include <map>
 
 #include <arc/Logger.h>
 #include <arc/XMLNode.h>
@@ -283,16 +284,77 @@ namespace Arc {
     return gfal_handle->Transfer3rdParty(source, destination, callback);
   }
 
+  // How long (seconds) scheme which no plugin accepted is remembered
+  #define DATAPOINT_UNKNOWN_SCHEME_TTL (60)
+
   DataPointLoader::DataPointLoader()
-    : Loader(BaseConfig().MakeConfig(Config()).Parent()) {}
+    : Loader(BaseConfig().MakeConfig(Config()).Parent()),
+      indexed_(false) {}
 
   DataPointLoader::~DataPointLoader() {}
 
+  void DataPointLoader::index() {
+    // Only descriptors are read here. Modules are loaded when
+    // first URL with corresponding scheme is requested.
+    std::list<ModuleDesc> modules;
+    factory_->scan(FinderLoader::GetLibrariesList(), modules);
+    PluginsFactory::FilterByKind("HED:DMC", modules);
+    // URL schemes are declared by plugins in their descriptors. Plugins
+    // without such declaration are only found by trying all of them.
+    for (std::list<ModuleDesc>::iterator m = modules.begin(); m != modules.end(); ++m) {
+      for (std::list<PluginDesc>::iterator p = m->plugins.begin(); p != m->plugins.end(); ++p) {
+        for (std::list<std::string>::iterator scheme = p->protocols.begin(); scheme != p->protocols.end(); ++scheme) {
+          std::pair<std::string, std::list<std::string> >& provider = schemes_[*scheme];
+          // Same plugin may come in more than one module
+          if (!provider.first.empty() && (provider.first != p->name)) continue;
+          provider.first = p->name;
+          provider.second.push_back(m->name);
+        }
+      }
+    }
+    logger.msg(DEBUG, "Found data plugins for %u URL schemes", (unsigned int)schemes_.size());
+  }
+
   DataPoint* DataPointLoader::load(const URL& url, const UserConfig& usercfg) {
     DataPointPluginArgument arg(url, usercfg);
+    const std::string scheme = url.Protocol();
+    Glib::Mutex::Lock lock(lock_);
+    if (!indexed_) {
+      index();
+      indexed_ = true;
+    }
+    std::map<std::string, std::pair<std::string, std::list<std::string> > >::iterator s = schemes_.find(scheme);
+    if (s != schemes_.end()) {
+      // Entries are never modified after index is built
+      const std::string& plugin = s->second.first;
+      const std::list<std::string>& mnames = s->second.second;
+      lock.release();
+      for (std::list<std::string>::const_iterator mname = mnames.begin(); mname != mnames.end(); ++mname) {
+        factory_->load(*mname, "HED:DMC", plugin);
+      }
+      DataPoint* point = factory_->GetInstance<DataPoint>("HED:DMC", plugin, &arg, false);
+      if(!point) logger.msg(Arc::VERBOSE, "Failed to load plugin for URL %s", url.str());
+      return point;
+    }
+    std::map<std::string, time_t>::iterator unknown = unknown_.find(scheme);
+    if (unknown != unknown_.end()) {
+      if (unknown->second > time(NULL)) {
+        logger.msg(Arc::VERBOSE, "Failed to load plugin for URL %s", url.str());
+        return NULL;
+      }
+      unknown_.erase(unknown);
+    }
+    lock.release();
+    // Scheme of unknown plugin - try everything available
     factory_->load(FinderLoader::GetLibrariesList(), "HED:DMC");
     DataPoint* point = factory_->GetInstance<DataPoint>("HED:DMC", &arg, false);
-    if(!point) logger.msg(Arc::VERBOSE, "Failed to load plugin for URL %s", url.str());
+    if(!point) {
+      logger.msg(Arc::VERBOSE, "Failed to load plugin for URL %s", url.str());
+      // Plugin could reject this particular URL only. So scheme is not
+      // blocked for long - only repeated scans of all plugins are avoided.
+      lock.acquire();
+      unknown_[scheme] = time(NULL) + DATAPOINT_UNKNOWN_SCHEME_TTL;
+    }
     return point;
   }
 
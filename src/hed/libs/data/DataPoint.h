@@ -63,9 +63,12 @@ namespace Arc {
 #define __ARC_DATAPOINT_H__
 
 #include <list>
+#include <map>
 #include <set>
 #include <string>
 
+#include <glibmm/thread.h>
+
 #include <arc/DateTime.h>
 #include <arc/URL.h>
 #include <arc/UserConfig.h>
@@ -852,8 +855,16 @@ namespace Arc {
   class DataPointLoader
     : public Loader {
   private:
+    Glib::Mutex lock_;
+    // Index is built on first use from module descriptors
+    bool indexed_;
+    // URL scheme -> name of plugin and modules providing it
+    std::map<std::string, std::pair<std::string, std::list<std::string> > > schemes_;
+    // Schemes which no plugin accepted and time till they are remembered
+    std::map<std::string, time_t> unknown_;
     DataPointLoader();
     ~DataPointLoader();
+    void index();
     DataPoint* load(const URL& url, const UserConfig& usercfg);
     friend class DataHandle;
   };
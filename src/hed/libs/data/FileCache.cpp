@@ -6,6 +6,7 @@
 
 #include <cerrno>
 #include <cmath>
+#include <cstdlib>
 #include <algorithm>
 
 #include <sys/types.h>
@@ -14,6 +15,7 @@
 #include <unistd.h>
 #include <sys/utsname.h>
 #include <sys/statvfs.h>
+#include <dirent.h>
 
 #include <glibmm.h>
 
@@ -21,6 +23,7 @@
 #include <arc/FileUtils.h>
 #include <arc/FileLock.h>
 #include <arc/StringConv.h>
+#include <arc/Thread.h>
 #include <arc/Utils.h>
 
 #include "FileCache.h"
@@ -390,21 +393,8 @@ namespace Arc {
       return false;
     }
 
-    // create per-job hard link dir if necessary, making the final dir readable only by the job user
-    if (!DirCreate(hard_link_path, S_IRWXU | S_IRGRP | S_IROTH | S_IXGRP | S_IXOTH, true)) {
-      logger.msg(ERROR, "Cannot create directory %s for per-job hard links", hard_link_path);
-      return false;
-    }
-    if (errno != EEXIST) {
-      if (chmod(hard_link_path.c_str(), S_IRWXU) != 0) {
-        logger.msg(ERROR, "Cannot change permission of %s: %s ", hard_link_path, StrError(errno));
-        return false;
-      }
-      if (chown(hard_link_path.c_str(), _uid, _gid) != 0) {
-        logger.msg(ERROR, "Cannot change owner of %s: %s ", hard_link_path, StrError(errno));
-        return false;
-      }
-    }
+    // create per-job hard link dir if necessary
+    if (!_createJobDir(hard_link_path)) return false;
 
     std::string filename = dest_path.substr(dest_path.rfind("/") + 1);
     std::string hard_link_file = hard_link_path + "/" + filename;
@@ -530,6 +520,287 @@ namespace Arc {
     return true;
   }
 
+  // Files of one call to Link() for set of files. Per-file vectors are
+  // filled before linking starts and only read by threads afterwards.
+  class FileCache::LinkSet {
+   public:
+    FileCache& cache;
+    std::vector<CacheLink>& links;
+    std::vector<std::string> cache_files;
+    std::vector<std::string> hard_link_paths;
+    std::vector<std::string> cache_link_paths;
+    std::vector<int> job_dir_fds;
+    std::vector<Arc::Time> modtimes;
+    Glib::Mutex lock;
+    unsigned int next;
+    LinkSet(FileCache& cache, std::vector<CacheLink>& links)
+      : cache(cache), links(links), cache_files(links.size()),
+        hard_link_paths(links.size()), cache_link_paths(links.size()),
+        job_dir_fds(links.size(), -1), modtimes(links.size()), next(0) {}
+  };
+
+  bool FileCache::Link(std::vector<CacheLink>& links, unsigned int threads) {
+
+    if (!(*this))
+      return false;
+
+    LinkSet set(*this, links);
+    // per-job dirs and their descriptors, -1 if dir can't be used
+    std::map<std::string, int> job_dirs;
+    // session dirs and whether they could be created
+    std::map<std::string, bool> session_dirs;
+    bool recently_modified = false;
+
+    for (unsigned int n = 0; n < links.size(); ++n) {
+      CacheLink& link = links[n];
+      link.linked = false;
+      link.try_again = false;
+      std::string cache_file = File(link.url);
+      set.cache_files[n] = cache_file;
+
+      // check the original file exists, File() mapped url to its cache
+      struct stat fileStat;
+      if (!FileStat(cache_file, &fileStat, false)) {
+        if (errno == ENOENT) {
+          logger.msg(WARNING, "Cache file %s does not exist", cache_file);
+          link.try_again = true;
+        }
+        else {
+          logger.msg(ERROR, "Error accessing cache file %s: %s", cache_file, StrError(errno));
+        }
+        continue;
+      }
+      const struct CacheParameters& cache_params = _cache_map[link.url];
+      std::string hard_link_path = cache_params.cache_path + "/" + CACHE_JOB_DIR + "/" + _id;
+      std::map<std::string, int>::iterator job_dir = job_dirs.find(hard_link_path);
+      if (job_dir == job_dirs.end()) {
+        int fd = -1;
+        if (_createJobDir(hard_link_path)) {
+          fd = ::open(hard_link_path.c_str(), O_RDONLY | O_DIRECTORY);
+          if (fd == -1) logger.msg(ERROR, "Failed to open directory %s: %s", hard_link_path, StrError(errno));
+        }
+        job_dir = job_dirs.insert(std::make_pair(hard_link_path, fd)).first;
+      }
+      if (job_dir->second == -1) continue;
+
+      // the session dir should already exist but in the case of arccp with cache it may not
+      std::string session_dir = link.link_path.substr(0, link.link_path.rfind("/"));
+      std::map<std::string, bool>::iterator sdir = session_dirs.find(session_dir);
+      if (sdir == session_dirs.end()) {
+        bool created = DirCreate(session_dir, _uid, _gid, S_IRWXU, true);
+        if (!created) logger.msg(ERROR, "Failed to create directory %s: %s", session_dir, StrError(errno));
+        sdir = session_dirs.insert(std::make_pair(session_dir, created)).first;
+      }
+      if (!sdir->second) continue;
+
+      set.hard_link_paths[n] = hard_link_path;
+      set.cache_link_paths[n] = cache_params.cache_link_path;
+      set.job_dir_fds[n] = job_dir->second;
+      set.modtimes[n] = Arc::Time(fileStat.st_mtime);
+      if (!link.holding_lock && set.modtimes[n].GetTime() == Arc::Time().GetTime()) recently_modified = true;
+    }
+
+    // one sleep for all files modified in the last second, see Link()
+    if (recently_modified) {
+      logger.msg(VERBOSE, "Some cache files were modified in the last second, sleeping 1 second to avoid race condition");
+      sleep(1);
+    }
+
+    if (threads > links.size()) threads = links.size();
+    SimpleCounter counter;
+    for (unsigned int t = 1; t < threads; ++t) {
+      if (!CreateThreadFunction(&_linkSetWorker, &set, &counter)) break;
+    }
+    _linkSetWorker(&set);
+    counter.wait();
+
+    for (std::map<std::string, int>::iterator job_dir = job_dirs.begin(); job_dir != job_dirs.end(); ++job_dir) {
+      if (job_dir->second != -1) ::close(job_dir->second);
+    }
+    for (unsigned int n = 0; n < links.size(); ++n) {
+      if (!links[n].linked) return false;
+    }
+    return true;
+  }
+
+  void FileCache::_linkSetWorker(void* arg) {
+    LinkSet& set = *((LinkSet*)arg);
+    FileAccess* fa = NULL;
+    for (;;) {
+      unsigned int n;
+      {
+        Glib::Mutex::Lock lock(set.lock);
+        if (set.next >= set.links.size()) break;
+        n = set.next++;
+      }
+      // files which failed during preparation have no per-job dir
+      if (set.job_dir_fds[n] == -1) continue;
+      set.cache._linkFromSet(set, n, fa);
+    }
+    if (fa) FileAccess::Release(fa);
+  }
+
+  // Makes sure fa is FileAccess object working under uid and gid
+  static bool acquire_file_access(FileAccess*& fa, uid_t uid, gid_t gid) {
+    if (fa) return true;
+    fa = FileAccess::Acquire();
+    if (!fa) return false;
+    if (!fa->fa_setuid(uid, gid)) {
+      errno = fa->geterrno();
+      FileAccess::Release(fa);
+      fa = NULL;
+      return false;
+    }
+    return true;
+  }
+
+  // Removes hard link relative to per-job dir after linking failed
+  static void clean_hard_link(int job_dir_fd, const std::string& filename, const std::string& hard_link_file, Logger& logger) {
+    if (::unlinkat(job_dir_fd, filename.c_str(), 0) != 0)
+      logger.msg(ERROR, "Failed to clean up file %s: %s", hard_link_file, StrError(errno));
+  }
+
+  void FileCache::_linkFromSet(LinkSet& set, unsigned int n, FileAccess*& fa) {
+
+    CacheLink& link = set.links[n];
+    const std::string& cache_file = set.cache_files[n];
+    const std::string& cache_link_path = set.cache_link_paths[n];
+    int job_dir_fd = set.job_dir_fds[n];
+    std::string filename = link.link_path.substr(link.link_path.rfind("/") + 1);
+    std::string hard_link_file = set.hard_link_paths[n] + "/" + filename;
+
+    // make the hard link, relative to already open per-job dir
+    if (::linkat(AT_FDCWD, cache_file.c_str(), job_dir_fd, filename.c_str(), 0) != 0) {
+      // if the link we want to make already exists, delete and make new one
+      if (errno == EEXIST) {
+        if (::unlinkat(job_dir_fd, filename.c_str(), 0) != 0) {
+          logger.msg(ERROR, "Failed to remove existing hard link at %s: %s", hard_link_file, StrError(errno));
+          return;
+        }
+        if (::linkat(AT_FDCWD, cache_file.c_str(), job_dir_fd, filename.c_str(), 0) != 0) {
+          logger.msg(ERROR, "Failed to create hard link from %s to %s: %s", hard_link_file, cache_file, StrError(errno));
+          return;
+        }
+      }
+      else if (errno == ENOENT) {
+        // another process could have deleted the cache file, so try again
+        logger.msg(WARNING, "Cache file %s not found", cache_file);
+        link.try_again = true;
+        return;
+      }
+      else {
+        logger.msg(ERROR, "Failed to create hard link from %s to %s: %s", hard_link_file, cache_file, StrError(errno));
+        return;
+      }
+    }
+    if (::fchmodat(job_dir_fd, filename.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, 0) != 0) {
+      logger.msg(ERROR, "Failed to change permissions or set owner of hard link %s: %s", hard_link_file, StrError(errno));
+      return;
+    }
+
+    // same checks as in Link() for single file
+    if (link.holding_lock) {
+      FileLock lock(cache_file, CACHE_LOCK_TIMEOUT);
+      if (!lock.release()) {
+        logger.msg(WARNING, "Failed to release lock on cache file %s", cache_file);
+        clean_hard_link(job_dir_fd, filename, hard_link_file, logger);
+        link.try_again = true;
+        return;
+      }
+      Glib::Mutex::Lock set_lock(set.lock);
+      _urls_unlocked.insert(link.url);
+    }
+    else {
+      struct stat fileStat;
+      bool changed = false;
+      if (FileStat(cache_file+FileLock::getLockSuffix(), &fileStat, false)) {
+        logger.msg(WARNING, "Cache file %s was locked during link/copy, must start again", cache_file);
+        changed = true;
+      }
+      else if (!FileStat(cache_file, &fileStat, false)) {
+        logger.msg(WARNING, "Cache file %s was deleted during link/copy, must start again", cache_file);
+        changed = true;
+      }
+      else if (Arc::Time(fileStat.st_mtime) > set.modtimes[n]) {
+        logger.msg(WARNING, "Cache file %s was modified while linking, must start again", cache_file);
+        changed = true;
+      }
+      if (changed) {
+        clean_hard_link(job_dir_fd, filename, hard_link_file, logger);
+        link.try_again = true;
+        return;
+      }
+    }
+
+    // session dir is accessed as mapped user, through FileAccess shared
+    // by all files of this thread if switching user is needed
+    bool switch_user = (_uid && (_uid != getuid())) || (_gid && (_gid != getgid()));
+    if (link.copy || link.executable || cache_link_path == "." || cache_link_path == "replicate") {
+      bool copied = false;
+      if (!switch_user) {
+        copied = FileCopy(hard_link_file, link.link_path);
+      }
+      else if (acquire_file_access(fa, _uid, _gid)) {
+        copied = fa->fa_copy(hard_link_file, link.link_path, S_IRUSR | S_IWUSR);
+        if (!copied) errno = fa->geterrno();
+      }
+      if (!copied) {
+        logger.msg(ERROR, "Failed to copy file %s to %s: %s", hard_link_file, link.link_path, StrError(errno));
+        return;
+      }
+      if (link.executable) {
+        if (!acquire_file_access(fa, _uid, _gid)) {
+          logger.msg(ERROR, "Failed to set executable bit on file %s", link.link_path);
+          return;
+        }
+        if (!fa->fa_chmod(link.link_path, S_IRWXU)) {
+          errno = fa->geterrno();
+          logger.msg(ERROR, "Failed to set executable bit on file %s: %s", link.link_path, StrError(errno));
+          return;
+        }
+      }
+    }
+    else {
+      std::string target(hard_link_file);
+      if (!cache_link_path.empty())
+        target = cache_link_path + "/" + CACHE_JOB_DIR + "/" + _id + "/" + filename;
+      if (switch_user && !acquire_file_access(fa, _uid, _gid)) {
+        logger.msg(ERROR, "Failed to create symbolic link from %s to %s: %s", link.link_path, target, StrError(errno));
+        return;
+      }
+      for (int attempt = 0; ; ++attempt) {
+        bool linked = false;
+        if (switch_user) {
+          linked = fa->fa_softlink(target, link.link_path);
+          if (!linked) errno = fa->geterrno();
+        }
+        else {
+          linked = (::symlink(target.c_str(), link.link_path.c_str()) == 0);
+        }
+        if (linked) break;
+        // if the link we want to make already exists, delete and make new one
+        if ((errno != EEXIST) || (attempt > 0)) {
+          logger.msg(ERROR, "Failed to create symbolic link from %s to %s: %s", link.link_path, target, StrError(errno));
+          return;
+        }
+        bool deleted = false;
+        if (switch_user) {
+          deleted = fa->fa_unlink(link.link_path);
+          if (!deleted) errno = fa->geterrno();
+        }
+        else {
+          deleted = (::unlink(link.link_path.c_str()) == 0);
+        }
+        if (!deleted) {
+          logger.msg(ERROR, "Failed to remove existing symbolic link at %s: %s", link.link_path, StrError(errno));
+          return;
+        }
+      }
+    }
+    // file was safely linked/copied
+    link.linked = true;
+  }
+
   bool FileCache::Release() const {
 
     // go through all caches (including read-only and draining caches)
@@ -542,20 +813,72 @@ namespace Arc {
     for (int i = 0; i < (int)_readonly_caches.size(); i++)
       job_dirs.push_back(_readonly_caches[i].cache_path + "/" + CACHE_JOB_DIR + "/" + _id);
 
+    // failure in one cache must not leave links in the others
+    bool result = true;
     for (int i = 0; i < (int)job_dirs.size(); i++) {
       std::string job_dir = job_dirs[i];
-      // check if job dir exists
-      struct stat fileStat;
-      if (!FileStat(job_dir, &fileStat, true) && errno == ENOENT)
-        continue;
-
-      logger.msg(DEBUG, "Removing %s", job_dir);
-      if (!DirDelete(job_dir)) {
+      if (!_removeJobDir(job_dir)) {
         logger.msg(WARNING, "Failed to remove cache per-job dir %s: %s", job_dir, StrError(errno));
-        return false;
+        result = false;
       }
     }
-    return true;
+    return result;
+  }
+
+  bool FileCache::_removeJobDir(const std::string& job_dir) {
+    // Per-job dir normally only contains hard links. They are removed
+    // relative to dir descriptor while reading it, without stat of each.
+    int fd = ::open(job_dir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd == -1) {
+      // job dir does not exist - nothing to release
+      if (errno == ENOENT) return true;
+      // per-job dir may be a symlink to another place - clean the
+      // directory it points to and then remove the link itself
+      if (errno == ELOOP) {
+        char* target = ::realpath(job_dir.c_str(), NULL);
+        if (target) {
+          std::string real_dir(target);
+          ::free(target);
+          if (!_removeJobDir(real_dir)) return false;
+        } else if (errno != ENOENT) {
+          return false;
+        }
+        return (::unlink(job_dir.c_str()) == 0);
+      }
+      return false;
+    }
+    logger.msg(DEBUG, "Removing %s", job_dir);
+    DIR* dir = ::fdopendir(fd);
+    if (!dir) {
+      int err = errno;
+      ::close(fd);
+      errno = err;
+      return false;
+    }
+    bool result = true;
+    int err = 0;
+    for (;;) {
+      errno = 0;
+      struct dirent* entry = ::readdir(dir);
+      if (!entry) {
+        if (errno != 0) {
+          err = errno;
+          result = false;
+        }
+        break;
+      }
+      std::string name(entry->d_name);
+      if ((name == ".") || (name == "..")) continue;
+      if (::unlinkat(fd, name.c_str(), 0) == 0) continue;
+      // anything which is not a file is handled generically
+      if (((errno == EISDIR) || (errno == EPERM)) && DirDelete(job_dir + "/" + name)) continue;
+      err = errno;
+      result = false;
+    }
+    ::closedir(dir);
+    if (result && (::rmdir(job_dir.c_str()) != 0)) return false;
+    errno = err;
+    return result;
   }
 
   bool FileCache::AddDN(const std::string& url, const std::string& DN, const Time& exp_time) {
@@ -851,6 +1174,25 @@ namespace Arc {
     return space;
   }
 
+  bool FileCache::_createJobDir(const std::string& hard_link_path) const {
+    // create per-job hard link dir if necessary, making the final dir readable only by the job user
+    if (!DirCreate(hard_link_path, S_IRWXU | S_IRGRP | S_IROTH | S_IXGRP | S_IXOTH, true)) {
+      logger.msg(ERROR, "Cannot create directory %s for per-job hard links", hard_link_path);
+      return false;
+    }
+    if (errno != EEXIST) {
+      if (chmod(hard_link_path.c_str(), S_IRWXU) != 0) {
+        logger.msg(ERROR, "Cannot change permission of %s: %s ", hard_link_path, StrError(errno));
+        return false;
+      }
+      if (chown(hard_link_path.c_str(), _uid, _gid) != 0) {
+        logger.msg(ERROR, "Cannot change owner of %s: %s ", hard_link_path, StrError(errno));
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool FileCache::_cleanFilesAndReturnFalse(const std::string& hard_link_file,
                                             bool& locked) {
     if (!FileDelete(hard_link_file)) logger.msg(ERROR, "Failed to clean up file %s: %s", hard_link_file, StrError(errno));
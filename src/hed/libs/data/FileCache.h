@@ -14,6 +14,8 @@
 
 namespace Arc {
 
+  class FileAccess;
+
   /// Contains data on the parameters of a cache.
   /**
    * \ingroup data
@@ -24,6 +26,34 @@ namespace Arc {
     std::string cache_link_path;
   };
 
+  /// Describes one of files linked together by FileCache::Link().
+  /**
+   * Input fields correspond to arguments of single file Link(). Output
+   * fields are filled by Link().
+   * \ingroup data
+   * \headerfile FileCache.h arc/data/FileCache.h
+   */
+  struct CacheLink {
+    /// Path to the session dir for soft-link or new file
+    std::string link_path;
+    /// URL of file to link to or copy
+    std::string url;
+    /// If true the file is copied rather than soft-linked
+    bool copy;
+    /// If true then file is copied and given execute permissions
+    bool executable;
+    /// Should be set to true if the caller already holds the lock
+    bool holding_lock;
+    /// Set to true if file was linked or copied
+    bool linked;
+    /// Set to true if file was locked, deleted or modified during linking
+    bool try_again;
+    CacheLink(const std::string& link_path, const std::string& url,
+              bool copy = false, bool executable = false, bool holding_lock = false)
+      : link_path(link_path), url(url), copy(copy), executable(executable),
+        holding_lock(holding_lock), linked(false), try_again(false) {};
+  };
+
   /// FileCache provides an interface to all cache operations.
   /**
    * When it is decided a file should be downloaded to the cache, Start()
@@ -123,6 +153,17 @@ namespace Arc {
     float _getCacheInfo(const std::string& path) const;
     /// For cleaning up after a cache file was locked during Link()
     bool _cleanFilesAndReturnFalse(const std::string& hard_link_file, bool& locked);
+    /// Create per-job dir for hard links if it does not exist yet
+    bool _createJobDir(const std::string& hard_link_path) const;
+    /// Files being linked by Link() for set of files and shared resources
+    class LinkSet;
+    /// Thread function processing files of LinkSet
+    static void _linkSetWorker(void* arg);
+    /// Link one file of LinkSet after per-job directory was prepared.
+    /// FileAccess object is acquired on first use and kept in fa.
+    void _linkFromSet(LinkSet& set, unsigned int n, FileAccess*& fa);
+    /// Remove per-job dir with hard links
+    static bool _removeJobDir(const std::string& job_dir);
 
     /// Logger for messages
     static Logger logger;
@@ -315,6 +356,25 @@ namespace Arc {
               bool holding_lock,
               bool& try_again);
 
+    /// Link set of cache files to places they will be used.
+    /**
+     * Does the same as Link() for every file in links, but work common
+     * to all files is done only once. Per-job directories are created
+     * and opened once and hard links are made relative to them, session
+     * directories are created once, the session directory is accessed
+     * through one FileAccess object per thread and files modified in the
+     * last second cause one common sleep instead of one per file.
+     *
+     * Results for each file are stored in its linked and try_again
+     * fields, and files which failed may be processed again starting
+     * from Start().
+     *
+     * @param links files to link
+     * @param threads maximal number of files processed in parallel
+     * @return true if all files were linked or copied
+     */
+    bool Link(std::vector<CacheLink>& links, unsigned int threads = 1);
+
     /// Release cache files used in this cache.
     /**
      * Release claims on input files for the job specified by id.
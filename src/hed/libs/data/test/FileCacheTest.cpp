@@ -8,6 +8,7 @@
 
 #include <cerrno>
 #include <list>
+#include <vector>
 
 #include <unistd.h>
 #include <utime.h>
@@ -31,6 +32,7 @@ class FileCacheTest
   CPPUNIT_TEST(testLinkFile);
   CPPUNIT_TEST(testLinkFileLinkCache);
   CPPUNIT_TEST(testCopyFile);
+  CPPUNIT_TEST(testLinkSet);
   CPPUNIT_TEST(testFile);
   CPPUNIT_TEST(testRelease);
   CPPUNIT_TEST(testCheckDN);
@@ -51,6 +53,7 @@ public:
   void testLinkFile();
   void testLinkFileLinkCache();
   void testCopyFile();
+  void testLinkSet();
   void testFile();
   void testRelease();
   void testCheckDN();
@@ -546,6 +549,63 @@ void FileCacheTest::testCopyFile() {
   CPPUNIT_ASSERT(_fc1->Stop(_url));
 }
 
+void FileCacheTest::testLinkSet() {
+
+  // cache files for all but last url
+  std::vector<std::string> urls;
+  for (int n = 1; n <= 5; ++n) urls.push_back("http://host.org/set" + Arc::tostring(n));
+  for (unsigned int n = 0; n < urls.size() - 1; ++n) {
+    bool available = false;
+    bool is_locked = false;
+    CPPUNIT_ASSERT(_fc1->Start(urls[n], available, is_locked));
+    CPPUNIT_ASSERT(_createFile(_fc1->File(urls[n]), urls[n]));
+    CPPUNIT_ASSERT(_fc1->Stop(urls[n]));
+  }
+  // another process is writing third file
+  CPPUNIT_ASSERT(_createFile(_fc1->File(urls[2])+".lock", std::string("1@" + _hostname)));
+
+  std::vector<Arc::CacheLink> links;
+  for (unsigned int n = 0; n < urls.size(); ++n) {
+    links.push_back(Arc::CacheLink(_session_dir + "/" + _jobid + "/set" + Arc::tostring(n+1), urls[n]));
+  }
+  links[1].copy = true;
+  CPPUNIT_ASSERT(!_fc1->Link(links, 2));
+
+  struct stat fileStat;
+  for (unsigned int n = 0; n < links.size(); ++n) {
+    std::string hard_link(_cache_job_dir + "/" + _jobid + "/set" + Arc::tostring(n+1));
+    if (n == 2 || n == 4) {
+      // locked and missing files must be tried again and leave no links
+      CPPUNIT_ASSERT(!links[n].linked);
+      CPPUNIT_ASSERT(links[n].try_again);
+      CPPUNIT_ASSERT(stat(hard_link.c_str(), &fileStat) != 0);
+      CPPUNIT_ASSERT(lstat(links[n].link_path.c_str(), &fileStat) != 0);
+      continue;
+    }
+    CPPUNIT_ASSERT(links[n].linked);
+    CPPUNIT_ASSERT(!links[n].try_again);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("Could not stat hard link " + hard_link, 0, stat(hard_link.c_str(), &fileStat));
+    CPPUNIT_ASSERT_EQUAL(0, lstat(links[n].link_path.c_str(), &fileStat));
+    CPPUNIT_ASSERT_EQUAL(n != 1, (bool)S_ISLNK(fileStat.st_mode));
+    CPPUNIT_ASSERT_EQUAL(urls[n], _readFile(links[n].link_path));
+  }
+  CPPUNIT_ASSERT(stat((_cache_job_dir + "/" + _jobid).c_str(), &fileStat) == 0);
+  CPPUNIT_ASSERT((fileStat.st_mode & S_IRWXU) == S_IRWXU);
+
+  // existing links are replaced when linking again
+  CPPUNIT_ASSERT_EQUAL(0, remove((_fc1->File(urls[2])+".lock").c_str()));
+  CPPUNIT_ASSERT(!_fc1->Link(links));
+  CPPUNIT_ASSERT(links[0].linked);
+  CPPUNIT_ASSERT(links[2].linked);
+  CPPUNIT_ASSERT(!links[4].linked);
+
+  // release removes all hard links together with per-job dir
+  CPPUNIT_ASSERT(_fc1->Release());
+  CPPUNIT_ASSERT(stat(std::string(_cache_job_dir + "/" + _jobid).c_str(), &fileStat) != 0);
+  // cache files are still there
+  CPPUNIT_ASSERT_EQUAL(0, stat(_fc1->File(urls[0]).c_str(), &fileStat));
+}
+
 void FileCacheTest::testFile() {
   // test hash returned
   std::string hash = "/8a/929b8384300813ba1dd2d661c42835b80691a2";
@@ -612,6 +672,16 @@ void FileCacheTest::testRelease() {
 
   // release should not give an error, even though job dir does not exist
   CPPUNIT_ASSERT(_fc1->Release());
+
+  // per-job dir which is a symlink is cleaned and the link removed
+  std::string link_target(_testroot + "/joblinks_elsewhere");
+  std::string job_dir(_cache_job_dir + "/" + _jobid);
+  CPPUNIT_ASSERT(_createFile(link_target + "/file1"));
+  CPPUNIT_ASSERT(_createFile(_cache_job_dir + "/keep"));
+  CPPUNIT_ASSERT_EQUAL(0, symlink(link_target.c_str(), job_dir.c_str()));
+  CPPUNIT_ASSERT(_fc1->Release());
+  CPPUNIT_ASSERT(lstat(job_dir.c_str(), &fileStat) != 0);
+  CPPUNIT_ASSERT(stat(link_target.c_str(), &fileStat) != 0);
 }
 
 void FileCacheTest::testCheckDN() {
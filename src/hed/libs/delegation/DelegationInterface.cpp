@@ -10,6 +10,7 @@
 #include <openssl/x509v3.h>
 
 #include <string>
+#include <list>
 #include <iostream>
 #include <fstream>
 
@@ -42,6 +43,13 @@ namespace Arc {
 // GDS 2.1 was made on wire compatible with GDS 2.0 - so they use same namespace
 #define EMIDS_NAMESPACE "http://www.gridsite.org/namespaces/delegation-2"
 
+// Size of private keys of delegated credentials
+#define DELEGATION_KEY_BITS 2048
+
+// Delay (seconds) before next attempt after failed key generation in pool
+#define DELEGATION_KEY_RETRY_MIN 1
+#define DELEGATION_KEY_RETRY_MAX 60
+
 #define GLOBUS_LIMITED_PROXY_OID "1.3.6.1.4.1.3536.1.1.1.9"
 
 //#define SERIAL_RAND_BITS 64
@@ -440,9 +448,7 @@ bool DelegationConsumer::Restore(const std::string& content) {
   return rsa;
 }
 
-bool DelegationConsumer::Generate(void) {
-  bool res = false;
-  int num = 2048;
+static RSA* generate_key(int num) {
   //BN_GENCB cb;
   BIGNUM *bn = BN_new();
   RSA *rsa = RSA_new();
@@ -452,23 +458,136 @@ bool DelegationConsumer::Generate(void) {
     if(BN_set_word(bn,RSA_F4)) {
       //if(RSA_generate_key_ex(rsa,num,bn,&cb)) {
       if(RSA_generate_key_ex(rsa,num,bn,NULL)) {
-        if(key_) RSA_free((RSA*)key_);
-        key_=rsa; rsa=NULL; res=true;
+        BN_free(bn);
+        return rsa;
       } else {
-        LogError();
         std::cerr<<"RSA_generate_key_ex failed"<<std::endl;
       };
     } else {
-      LogError();
       std::cerr<<"BN_set_word failed"<<std::endl;
     };
   } else {
-    LogError();
     std::cerr<<"BN_new || RSA_new failed"<<std::endl;
   };
   if(bn) BN_free(bn);
   if(rsa) RSA_free(rsa);
-  return res;
+  return NULL;
+}
+
+// Keys ready to be used by new DelegationConsumer objects. Key generation
+// takes long time and delays responses to delegation requests. So keys are
+// made in advance by background thread. Every key is given away only once.
+class DelegationKeyPool {
+ public:
+  static DelegationKeyPool& Instance(void);
+  void Resize(unsigned int size);
+  RSA* Get(void);
+ private:
+  Glib::Mutex lock_;
+  Glib::Cond cond_;
+  std::list<RSA*> keys_;
+  unsigned int size_;
+  bool running_;
+  bool exit_;
+  DelegationKeyPool(void);
+  ~DelegationKeyPool(void);
+  static void refill(void* arg);
+};
+
+DelegationKeyPool& DelegationKeyPool::Instance(void) {
+  // Created on first use, after OpenSSL is initialized, so it is destroyed
+  // before OpenSSL cleans up at exit.
+  static DelegationKeyPool pool;
+  return pool;
+}
+
+DelegationKeyPool::DelegationKeyPool(void):size_(0),running_(false),exit_(false) {
+  OpenSSLInit();
+}
+
+DelegationKeyPool::~DelegationKeyPool(void) {
+  Glib::Mutex::Lock lock(lock_);
+  exit_ = true;
+  cond_.broadcast();
+  // Wait for key being generated now
+  while(running_) cond_.wait(lock_);
+  for(std::list<RSA*>::iterator key = keys_.begin(); key != keys_.end(); ++key) RSA_free(*key);
+  keys_.clear();
+}
+
+void DelegationKeyPool::Resize(unsigned int size) {
+  Glib::Mutex::Lock lock(lock_);
+  size_ = size;
+  while(keys_.size() > size_) {
+    RSA_free(keys_.front());
+    keys_.pop_front();
+  };
+  if((size_ > 0) && !running_) {
+    if(CreateThreadFunction(&refill,this)) running_ = true;
+  };
+  cond_.broadcast();
+}
+
+RSA* DelegationKeyPool::Get(void) {
+  Glib::Mutex::Lock lock(lock_);
+  if(keys_.empty()) return NULL;
+  RSA* key = keys_.front();
+  keys_.pop_front();
+  cond_.broadcast();
+  return key;
+}
+
+void DelegationKeyPool::refill(void* arg) {
+  DelegationKeyPool& it = *((DelegationKeyPool*)arg);
+  Glib::Mutex::Lock lock(it.lock_);
+  int retry = DELEGATION_KEY_RETRY_MIN;
+  for(;;) {
+    while(!it.exit_ && (it.keys_.size() >= it.size_)) it.cond_.wait(it.lock_);
+    if(it.exit_) break;
+    lock.release();
+    RSA* key = generate_key(DELEGATION_KEY_BITS);
+    lock.acquire();
+    if(!key) {
+      // Failure may be temporary (like lack of entropy). Try again later.
+      ERR_clear_error();
+      Glib::TimeVal etime;
+      etime.assign_current_time();
+      etime.add_seconds(retry);
+      while(!it.exit_) {
+        if(!it.cond_.timed_wait(it.lock_,etime)) break;
+      };
+      retry *= 2;
+      if(retry > DELEGATION_KEY_RETRY_MAX) retry = DELEGATION_KEY_RETRY_MAX;
+      continue;
+    };
+    retry = DELEGATION_KEY_RETRY_MIN;
+    if(it.exit_ || (it.keys_.size() >= it.size_)) {
+      RSA_free(key);
+    } else {
+      it.keys_.push_back(key);
+    };
+  };
+  it.running_ = false;
+  it.cond_.broadcast();
+}
+
+void DelegationConsumer::KeyPoolSize(unsigned int size) {
+  DelegationKeyPool::Instance().Resize(size);
+}
+
+bool DelegationConsumer::Generate(void) {
+  RSA *rsa = DelegationKeyPool::Instance().Get();
+  if(!rsa) {
+    // Pool is empty or not used
+    rsa = generate_key(DELEGATION_KEY_BITS);
+    if(!rsa) {
+      LogError();
+      return false;
+    };
+  };
+  if(key_) RSA_free((RSA*)key_);
+  key_=rsa;
+  return true;
 }
 
 bool DelegationConsumer::Request(std::string& content) {
@@ -32,6 +32,10 @@ class DelegationConsumer {
   /** Creates object with provided private key */
   DelegationConsumer(const std::string& content);
   ~DelegationConsumer(void);
+  /** Sets number of private keys generated in advance by background thread.
+     New objects take key from this pool and generate one themselves only
+     if pool is empty. Default is 0 - no keys are generated in advance. */
+  static void KeyPoolSize(unsigned int size);
   operator bool(void) { return key_ != NULL; };
   bool operator!(void) { return key_ == NULL; };
   /** Return identifier of this object - not implemented */
@@ -3,6 +3,7 @@
 #endif
 
 #include <sstream>
+#include <set>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -17,6 +18,7 @@ class DelegationInterfaceTest
   CPPUNIT_TEST(TestDelegationInterfaceDELEGATEGDS20);
   CPPUNIT_TEST(TestDelegationInterfaceDELEGATEEMIES);
   CPPUNIT_TEST(TestDelegationInterfaceDELEGATEEMIDS);
+  CPPUNIT_TEST(TestDelegationInterfaceKEYPOOL);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -27,6 +29,7 @@ public:
   void TestDelegationInterfaceDELEGATEGDS20();
   void TestDelegationInterfaceDELEGATEEMIES();
   void TestDelegationInterfaceDELEGATEEMIDS();
+  void TestDelegationInterfaceKEYPOOL();
 
 private:
   std::string credentials;
@@ -131,6 +134,26 @@ void DelegationInterfaceTest::TestDelegationInterfaceDELEGATEEMIDS() {
   CPPUNIT_ASSERT((bool)p.UpdateCredentials(m,&context,Arc::DelegationRestrictions(),Arc::DelegationProviderSOAP::EMIDS));
 }
 
+void DelegationInterfaceTest::TestDelegationInterfaceKEYPOOL() {
+  Arc::DelegationConsumer::KeyPoolSize(2);
+  // Keys may come from pool or be generated inline - all must be different
+  std::set<std::string> keys;
+  for(int n = 0; n < 4; ++n) {
+    Arc::DelegationConsumer consumer;
+    CPPUNIT_ASSERT((bool)consumer);
+    std::string key;
+    CPPUNIT_ASSERT(consumer.Backup(key));
+    CPPUNIT_ASSERT(keys.insert(key).second);
+  }
+  Arc::DelegationContainerSOAP c;
+  Arc::DelegationProviderSOAP p(credentials);
+  DirectMCC m(c,NULL);
+  Arc::MessageContext context;
+  CPPUNIT_ASSERT((bool)p.DelegateCredentialsInit(m,&context,Arc::DelegationProviderSOAP::ARCDelegation));
+  CPPUNIT_ASSERT((bool)p.UpdateCredentials(m,&context,Arc::DelegationRestrictions(),Arc::DelegationProviderSOAP::ARCDelegation));
+  Arc::DelegationConsumer::KeyPoolSize(0);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DelegationInterfaceTest);
 
 
@@ -143,6 +143,7 @@ namespace Arc {
       std::string description;
       uint32_t version;
       uint32_t priority;
+      std::string protocols;
       bool valid;
       ARCPluginDescriptor(std::ifstream& in):valid(false) {
         if(!in) return;
@@ -175,6 +176,8 @@ namespace Arc {
             if(!stringto(line,version)) return;
           } else if(tag == "priority") {
             if(!stringto(line,priority)) return;
+          } else if(tag == "protocols") {
+            protocols = line;
           }
         }
         if(name.empty()) return;
@@ -231,6 +234,7 @@ namespace Arc {
         pd.description = desc->description;
         pd.version = desc->version;
         pd.priority = desc->priority;
+        tokenize(desc->protocols,pd.protocols,",");
         descs.push_back(pd);
       };
     };
@@ -96,6 +96,23 @@ namespace Arc {
     get_plugin_instance instance; // Pointer to constructor function
   } PluginDescriptor;
 
+  /// Name of optional symbol refering to table of protocols.
+  /** Plugins which handle URLs (like DMCs) may declare accepted
+     URL schemes in array of PluginProtocolsDescriptor elements
+     exported under this name. Schemes are stored in *.apd files
+     so that plugin for URL can be found without loading all
+     modules. The array is terminated by element with all
+     components set to NULL. */
+  #define ARC_PLUGINS_PROTOCOLS_NAME __arc_plugins_protocols__
+  #define ARC_PLUGINS_PROTOCOLS_SYMB "__arc_plugins_protocols__"
+
+  /// URL schemes handled by ARC lodable component
+  typedef struct {
+    const char* name; // Name of plugin as in PluginDescriptor
+    const char* kind; // Kind of plugin as in PluginDescriptor
+    const char* protocols; // Comma separated list of URL schemes
+  } PluginProtocolsDescriptor;
+
 
   /// Description of plugin
   /** This class is used for reports */
@@ -106,6 +123,7 @@ namespace Arc {
     std::string description;
     uint32_t version;
     uint32_t priority;
+    std::list<std::string> protocols; // URL schemes if declared by plugin
     PluginDesc(void):version(0),priority(ARC_PLUGIN_DEFAULT_PRIORITY) { };
   };
 
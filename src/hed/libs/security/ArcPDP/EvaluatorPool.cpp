@@ -0,0 +1,215 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <arc/StringConv.h>
+#include <arc/security/ArcPDP/EvaluatorLoader.h>
+
+#include "EvaluatorPool.h"
+
+// How often policy files are checked for changes (seconds)
+#define POLICY_CHECK_PERIOD (10)
+
+// How often statistics of decision cache are reported (lookups)
+#define DECISION_CACHE_REPORT (10000)
+
+Arc::Logger ArcSec::EvaluatorPool::logger(Arc::Logger::rootLogger, "EvaluatorPool");
+
+namespace ArcSec {
+
+EvaluatorPool::EvaluatorPool(const std::string& evaluator_name, unsigned int cache_size):
+    evaluator_name_(evaluator_name),generation_(0),checked_(0),
+    cache_size_(cache_size),hits_(0),misses_(0) {
+}
+
+EvaluatorPool::~EvaluatorPool(void) {
+  Glib::Mutex::Lock lock(lock_);
+  for(std::list<Evaluator*>::iterator eval = free_.begin(); eval != free_.end(); ++eval) delete *eval;
+  free_.clear();
+  // Pool must not be destroyed while evaluators are in use
+}
+
+void EvaluatorPool::addPolicyLocation(const std::string& location) {
+  Glib::Mutex::Lock lock(lock_);
+  locations_.push_back(location);
+  flush();
+}
+
+void EvaluatorPool::addPolicy(Arc::XMLNode policy) {
+  Glib::Mutex::Lock lock(lock_);
+  policies_.AddNew(policy);
+  flush();
+}
+
+void EvaluatorPool::setCombiningAlg(const std::string& alg) {
+  Glib::Mutex::Lock lock(lock_);
+  combining_alg_ = alg;
+  flush();
+}
+
+void EvaluatorPool::setCacheSize(unsigned int cache_size) {
+  Glib::Mutex::Lock lock(lock_);
+  cache_size_ = cache_size;
+  decisions_.clear();
+  index_.clear();
+}
+
+bool EvaluatorPool::cacheEnabled(void) {
+  Glib::Mutex::Lock lock(lock_);
+  return (cache_size_ != 0);
+}
+
+// Must be called with lock_ held. Drops all evaluators and decisions.
+void EvaluatorPool::flush(void) {
+  ++generation_;
+  for(std::list<Evaluator*>::iterator eval = free_.begin(); eval != free_.end(); ++eval) delete *eval;
+  free_.clear();
+  decisions_.clear();
+  index_.clear();
+  stamp_ = stamp();
+  checked_ = time(NULL);
+}
+
+std::string EvaluatorPool::stamp(void) const {
+  std::string result;
+  for(std::list<std::string>::const_iterator location = locations_.begin();
+                                 location != locations_.end(); ++location) {
+    struct stat st;
+    if(::stat(location->c_str(), &st) != 0) {
+      result += "-;";
+    } else {
+      result += Arc::tostring(st.st_ino) + ":" + Arc::tostring(st.st_size) + ":" +
+                Arc::tostring(st.st_mtime) + ";";
+    };
+  };
+  return result;
+}
+
+// Must be called with lock_ held.
+void EvaluatorPool::check(void) {
+  if(locations_.empty()) return;
+  time_t now = time(NULL);
+  if((now >= checked_) && ((now - checked_) < POLICY_CHECK_PERIOD)) return;
+  checked_ = now;
+  std::string new_stamp = stamp();
+  if(new_stamp == stamp_) return;
+  logger.msg(Arc::VERBOSE, "Policy files changed - reloading policies");
+  flush();
+}
+
+Evaluator* EvaluatorPool::create(void) {
+  EvaluatorLoader eval_loader;
+  Evaluator* eval = eval_loader.getEvaluator(evaluator_name_);
+  if(!eval) {
+    logger.msg(Arc::ERROR, "Can not dynamically produce Evaluator");
+    return NULL;
+  };
+  for(std::list<std::string>::const_iterator it = locations_.begin(); it!= locations_.end(); ++it) {
+    eval->addPolicy(SourceFile(*it));
+  };
+  for(int n = 0;n<policies_.Size();++n) {
+    eval->addPolicy(Source(policies_[n]));
+  };
+  if(!combining_alg_.empty()) {
+    if(combining_alg_ == "EvaluatorFailsOnDeny") {
+      eval->setCombiningAlg(EvaluatorFailsOnDeny);
+    } else if(combining_alg_ == "EvaluatorStopsOnDeny") {
+      eval->setCombiningAlg(EvaluatorStopsOnDeny);
+    } else if(combining_alg_ == "EvaluatorStopsOnPermit") {
+      eval->setCombiningAlg(EvaluatorStopsOnPermit);
+    } else if(combining_alg_ == "EvaluatorStopsNever") {
+      eval->setCombiningAlg(EvaluatorStopsNever);
+    } else {
+      AlgFactory* factory = eval->getAlgFactory();
+      if(!factory) {
+        logger.msg(Arc::WARNING, "Evaluator does not support loadable Combining Algorithms");
+      } else {
+        CombiningAlg* algorithm = factory->createAlg(combining_alg_);
+        if(!algorithm) {
+          logger.msg(Arc::ERROR, "Evaluator does not support specified Combining Algorithm - %s",combining_alg_);
+        } else {
+          eval->setCombiningAlg(algorithm);
+        };
+      };
+    };
+  };
+  return eval;
+}
+
+Evaluator* EvaluatorPool::acquire(void) {
+  Glib::Mutex::Lock lock(lock_);
+  check();
+  Evaluator* eval = NULL;
+  if(!free_.empty()) {
+    eval = free_.front();
+    free_.pop_front();
+  } else {
+    // Policies are parsed under lock in order to avoid
+    // concurrent access to same policy documents.
+    eval = create();
+    if(!eval) return NULL;
+  };
+  busy_[eval] = generation_;
+  return eval;
+}
+
+void EvaluatorPool::release(Evaluator* eval) {
+  if(!eval) return;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<Evaluator*,unsigned int>::iterator busy = busy_.find(eval);
+  if(busy == busy_.end()) return;
+  bool current = (busy->second == generation_);
+  busy_.erase(busy);
+  if(current) {
+    free_.push_front(eval);
+  } else {
+    // Policies were changed while evaluator was in use
+    delete eval;
+  };
+}
+
+bool EvaluatorPool::getDecision(const std::string& request, bool& decision) {
+  Glib::Mutex::Lock lock(lock_);
+  if(cache_size_ == 0) return false;
+  check();
+  std::map<std::string,DecisionList::iterator>::iterator entry = index_.find(request);
+  bool found = (entry != index_.end());
+  if(found) {
+    ++hits_;
+    // Move to front of LRU list
+    decisions_.splice(decisions_.begin(), decisions_, entry->second);
+    decision = entry->second->second;
+  } else {
+    ++misses_;
+  };
+  if(((hits_ + misses_) % DECISION_CACHE_REPORT) == 0) {
+    logger.msg(Arc::VERBOSE, "Decision cache: %s hits, %s misses, %u entries",
+               Arc::tostring(hits_), Arc::tostring(misses_), (unsigned int)index_.size());
+  };
+  return found;
+}
+
+void EvaluatorPool::putDecision(Evaluator* eval, const std::string& request, bool decision) {
+  Glib::Mutex::Lock lock(lock_);
+  if(cache_size_ == 0) return;
+  std::map<Evaluator*,unsigned int>::iterator busy = busy_.find(eval);
+  if((busy == busy_.end()) || (busy->second != generation_)) return;
+  std::map<std::string,DecisionList::iterator>::iterator entry = index_.find(request);
+  if(entry != index_.end()) {
+    entry->second->second = decision;
+    decisions_.splice(decisions_.begin(), decisions_, entry->second);
+    return;
+  };
+  while(index_.size() >= cache_size_) {
+    index_.erase(decisions_.back().first);
+    decisions_.pop_back();
+  };
+  decisions_.push_front(std::pair<std::string,bool>(request,decision));
+  index_[request] = decisions_.begin();
+}
+
+} // namespace ArcSec
@@ -0,0 +1,94 @@
+#ifndef __ARC_SEC_EVALUATORPOOL_H__
+#define __ARC_SEC_EVALUATORPOOL_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <glibmm/thread.h>
+#include <arc/XMLNode.h>
+#include <arc/Logger.h>
+#include <arc/security/ArcPDP/Evaluator.h>
+
+namespace ArcSec {
+
+///Pool of evaluators with policies loaded once and shared between connections.
+/** Parsing policies is expensive. Instead of creating evaluator with
+  fresh policies for every connection PDPs acquire ready evaluator from
+  pool and return it after evaluation. Policy objects keep evaluation state
+  hence each evaluator is used by one thread at a time. When any of policy
+  files changes all pooled evaluators are dropped and new ones are created
+  with reloaded policies.
+  Pool also keeps LRU cache of decisions indexed by serialized request.
+  Because request is made of exported security attributes identical
+  requests produce identical keys. */
+class EvaluatorPool {
+ public:
+  /** Creates pool of evaluators of type evaluator_name. Up to cache_size
+    decisions are remembered. Cache is disabled if cache_size is 0. */
+  EvaluatorPool(const std::string& evaluator_name, unsigned int cache_size = 0);
+  ~EvaluatorPool(void);
+
+  /**Adds policy file to be loaded into every evaluator. Files are checked
+    for changes at most every few seconds. */
+  void addPolicyLocation(const std::string& location);
+
+  /**Adds policy document to be loaded into every evaluator. */
+  void addPolicy(Arc::XMLNode policy);
+
+  /**Specifies combining algorithm by name. In addition to names supported
+    by evaluator's AlgFactory legacy EvaluatorFailsOnDeny, EvaluatorStopsOnDeny,
+    EvaluatorStopsOnPermit and EvaluatorStopsNever are accepted. */
+  void setCombiningAlg(const std::string& alg);
+
+  /**Sets maximal number of remembered decisions. */
+  void setCacheSize(unsigned int cache_size);
+
+  /**Returns true if decisions are cached. Serialized request is
+    only needed in that case. */
+  bool cacheEnabled(void);
+
+  /**Returns evaluator for exclusive use by caller. It must be passed
+    back to release() after evaluation. Returns NULL on failure. */
+  Evaluator* acquire(void);
+
+  /**Returns evaluator obtained by acquire() back to pool. */
+  void release(Evaluator* eval);
+
+  /**Fetches cached decision for serialized request. Returns false if
+    there is no such decision in cache. */
+  bool getDecision(const std::string& request, bool& decision);
+
+  /**Stores decision made by evaluator for serialized request. Must be
+    called before evaluator is released. Decisions made with outdated
+    policies are not stored. */
+  void putDecision(Evaluator* eval, const std::string& request, bool decision);
+
+ private:
+  typedef std::list< std::pair<std::string,bool> > DecisionList;
+  Glib::Mutex lock_;
+  std::string evaluator_name_;
+  std::list<std::string> locations_;
+  Arc::XMLNodeContainer policies_;
+  std::string combining_alg_;
+  std::list<Evaluator*> free_;
+  std::map<Evaluator*,unsigned int> busy_;
+  unsigned int generation_;
+  std::string stamp_;
+  time_t checked_;
+  unsigned int cache_size_;
+  DecisionList decisions_;
+  std::map<std::string,DecisionList::iterator> index_;
+  unsigned long long int hits_;
+  unsigned long long int misses_;
+  EvaluatorPool(const EvaluatorPool&);
+  EvaluatorPool& operator=(const EvaluatorPool&);
+  Evaluator* create(void);
+  std::string stamp(void) const;
+  void check(void);
+  void flush(void);
+  static Arc::Logger logger;
+};
+
+} // namespace ArcSec
+
+#endif /* __ARC_SEC_EVALUATORPOOL_H__ */
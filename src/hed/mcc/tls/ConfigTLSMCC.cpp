@@ -5,7 +5,9 @@
 #include <glibmm/miscutils.h>
 #include <openssl/err.h>
 
+#include <arc/StringConv.h>
 #include <arc/credential/Credential.h>
+#include <arc/credential/TrustStore.h>
 
 #include "PayloadTLSStream.h"
 
@@ -52,6 +54,18 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
   handshake_ = (cfg["Handshake"] == "SSLv3")?ssl3_handshake:tls_handshake;
   proxy_file_ = (std::string)(cfg["ProxyPath"]);
   credential_ = (std::string)(cfg["Credential"]);
+  // SSL context is built once and shared by all connections unless disabled
+  shared_context_ = (((std::string)(cfg["SharedContext"])) != "false");
+  // Sessions are not cached unless enabled explicitly
+  session_cache_ = 0;
+  if((bool)(cfg["SessionCache"])) {
+    if(!stringto((std::string)(cfg["SessionCache"]),session_cache_) || (session_cache_ < 0)) {
+      failure_ = "Wrong value of SessionCache - "+(std::string)(cfg["SessionCache"]);
+      session_cache_ = 0;
+    };
+  };
+  session_tickets_ = (((std::string)(cfg["SessionTickets"])) == "true");
+  endpoint_ = (std::string)(cfg["Endpoint"]);
   if(client) {
     // Client is using safest setup by default
     cipher_list_ = "TLSv1:SSLv3:!eNULL:!aNULL";
@@ -136,11 +150,14 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
 
 bool ConfigTLSMCC::Set(SSL_CTX* sslctx) {
   if((!ca_file_.empty()) || (!ca_dir_.empty())) {
-    if(!SSL_CTX_load_verify_locations(sslctx, ca_file_.empty()?NULL:ca_file_.c_str(), ca_dir_.empty()?NULL:ca_dir_.c_str())) {
+    // CA certificates and CRLs are loaded once and shared by all contexts
+    X509_STORE* store = TrustStore::Get(ca_file_, ca_dir_).Store();
+    if(!store) {
       failure_ = "Can not assign CA location - "+(ca_dir_.empty()?ca_file_:ca_dir_)+"\n";
       failure_ += HandleError();
       return false;
     };
+    SSL_CTX_set_cert_store(sslctx, store);
   };
   if(!credential_.empty()) {
     // First try to use in-memory credential
@@ -25,6 +25,10 @@ class ConfigTLSMCC {
   bool globus_policy_;
   bool globus_gsi_;
   bool globusio_gsi_;
+  bool shared_context_;
+  int session_cache_;
+  bool session_tickets_;
+  std::string endpoint_;
   enum {
     tls_handshake, // default
     ssl3_handshake,
@@ -59,6 +63,13 @@ class ConfigTLSMCC {
   bool GlobusPolicy(void) const { return globus_policy_; };
   bool GlobusGSI(void) const { return globus_gsi_; };
   bool GlobusIOGSI(void) const { return globusio_gsi_; };
+  bool SharedContext(void) const { return shared_context_; };
+  /** Lifetime of cached TLS sessions in seconds, 0 if caching is disabled */
+  int SessionCache(void) const { return session_cache_; };
+  bool SessionTickets(void) const { return session_tickets_; };
+  /** host:port of remote side, client only */
+  const std::string& Endpoint(void) const { return endpoint_; };
+  const std::string& Credential(void) const { return credential_; };
   const std::vector<std::string>& VOMSCertTrustDN(void) { return vomscert_trust_dn_; };
   bool Set(SSL_CTX* sslctx);
   bool IfClientAuthn(void) const { return client_authn_; };
@@ -6,9 +6,11 @@
 #include <fstream>
 #include <string>
 #include <list>
+#include <sstream>
 
 #include <arc/Logger.h>
 #include <arc/ArcRegex.h>
+#include <arc/credential/TrustStore.h>
 
 #include <openssl/x509.h>
 
@@ -228,18 +230,11 @@ bool GlobusSigningPolicy::match(const X509_NAME* issuer_subject,const X509_NAME*
   return false;
 }
 
-bool GlobusSigningPolicy::open(const X509_NAME* issuer_subject,const std::string& ca_path) {
+bool GlobusSigningPolicy::open(const X509_NAME* issuer_subject,TrustStore& trust) {
   close();
-  //std::string issuer_subject_str;
-  //X509_NAME_to_string(issuer_subject_str,issuer_subject);
-  unsigned long hash = X509_NAME_hash((X509_NAME*)issuer_subject);
-  char hash_str[32];
-  snprintf(hash_str,sizeof(hash_str)-1,"%08lx",hash);
-  hash_str[sizeof(hash_str)-1]=0;
-  std::string fname = ca_path+"/"+hash_str+policy_suffix;
-  std::ifstream* f = new std::ifstream(fname.c_str());
-  if(!(*f)) { delete f; return false; };
-  stream_ = f;
+  std::string policy;
+  if(!trust.SigningPolicy((X509_NAME*)issuer_subject,policy)) return false;
+  stream_ = new std::istringstream(policy);
   return true;
 }
 
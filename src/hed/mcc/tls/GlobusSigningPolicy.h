@@ -4,13 +4,18 @@
 
 #include <openssl/ssl.h>
 
+namespace Arc {
+  class TrustStore;
+}
+
 namespace ArcMCCTLS {
 
 class GlobusSigningPolicy {
   public:
     GlobusSigningPolicy(): stream_(NULL) { };
     ~GlobusSigningPolicy() { close(); };
-    bool open(const X509_NAME* issuer_subject,const std::string& ca_path);
+    /** Takes policy of issuer from preloaded trusted CAs */
+    bool open(const X509_NAME* issuer_subject,Arc::TrustStore& trust);
     void close() { delete stream_; stream_ = NULL; };
     bool match(const X509_NAME* issuer_subject,const X509_NAME* subject);
   private:
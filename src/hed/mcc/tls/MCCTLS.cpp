@@ -414,7 +414,7 @@ MCC_Status MCC_TLS_Service::process(Message& inmsg,Message& outmsg) {
    } else {
       // Creating new SSL object bound to stream of previous MCC
       // TODO: renew stream because it may be recreated by TCP MCC
-      stream = new PayloadTLSMCC(inpayload,config_,logger);
+      stream = new PayloadTLSMCC(inpayload,config_,logger,context_);
       // Check for established connection
       if(!*stream) {
         logger.msg(ERROR, "Failed to establish connection: %s", stream->Failure().operator std::string());
@@ -573,7 +573,7 @@ void MCC_TLS_Client::Next(MCCInterface* next,const std::string& label) {
    if(label.empty()) {
       if(stream_) delete stream_;
       stream_=NULL;
-      stream_=new PayloadTLSMCC(next,config_,logger);
+      stream_=new PayloadTLSMCC(next,config_,logger,context_);
       if(stream_ && !*stream_)
          logger.msg(ERROR, "Failed to establish connection: %s", stream_->Failure().operator std::string());
    };
@@ -586,7 +586,12 @@ void MCC_TLS_Client::Next(MCCInterface* next,const std::string& label) {
 //Glib::Mutex Arc::MCC_TLS::lock_;
 Arc::Logger ArcMCCTLS::MCC_TLS::logger(Arc::Logger::getRootLogger(), "MCC.TLS");
 
-ArcMCCTLS::MCC_TLS::MCC_TLS(Arc::Config& cfg,bool client,PluginArgument* parg) : Arc::MCC(&cfg,parg), config_(cfg,client) {
+ArcMCCTLS::MCC_TLS::MCC_TLS(Arc::Config& cfg,bool client,PluginArgument* parg) : Arc::MCC(&cfg,parg), config_(cfg,client), context_(NULL) {
+  if(config_.SharedContext()) context_ = new ContextTLSMCC(config_,client,logger);
+}
+
+ArcMCCTLS::MCC_TLS::~MCC_TLS(void) {
+  if(context_) delete context_;
 }
 
 static Arc::Plugin* get_mcc_service(Arc::PluginArgument* arg) {
@@ -7,6 +7,8 @@
 
 namespace ArcMCCTLS {
 
+  class ContextTLSMCC;
+
   //! A base class for TLS client and service MCCs.
   /*! This is a base class for TLS client and service MCCs. It
     provides some common functionality for them.
@@ -14,6 +16,7 @@ namespace ArcMCCTLS {
   class MCC_TLS : public MCC {
   public:
     MCC_TLS(Config& cfg,bool client,PluginArgument* parg);
+    virtual ~MCC_TLS(void);
   protected:
     //bool tls_random_seed(std::string filename, long n);
     static unsigned int ssl_initialized_;
@@ -25,6 +28,8 @@ namespace ArcMCCTLS {
     static unsigned long ssl_id_cb(void);
     //static void* ssl_idptr_cb(void);
     ConfigTLSMCC config_;
+    //! SSL context shared by connections, NULL if sharing is disabled
+    ContextTLSMCC* context_;
   };
 
 /** This MCC implements TLS server side functionality. Upon creation this 
@@ -4,14 +4,20 @@
 
 #include <fstream>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "GlobusSigningPolicy.h"
 
 #include "PayloadTLSMCC.h"
+#include "SessionTLSMCC.h"
 #include <openssl/err.h>
 #include <glibmm/miscutils.h>
+#include <glibmm/fileutils.h>
 #include <arc/DateTime.h>
 #include <arc/StringConv.h>
 #include <arc/crypto/OpenSSL.h>
+#include <arc/credential/TrustStore.h>
 
 namespace ArcMCCTLS {
 
@@ -30,6 +36,9 @@ static X509_VERIFY_PARAM *SSL_CTX_get0_param(SSL_CTX *ctx) {
 }
 #endif
 
+// How often (seconds) files used for shared context are checked for changes
+#define TLS_CONTEXT_CHECK_PERIOD (10)
+
 static const char * ex_data_id = "ARC_MCC_Payload_TLS";
 int PayloadTLSMCC::ex_data_index_ = -1;
 
@@ -106,7 +115,7 @@ static int verify_callback(int ok,X509_STORE_CTX *sctx) {
              (X509_NAME_cmp(X509_get_issuer_name(cert),X509_get_subject_name(cert)) != 0)) {
             //std::cerr<<"+++ additional verification: check signing policy - is not proxy"<<std::endl;
             GlobusSigningPolicy globus_policy;
-            if(globus_policy.open(X509_get_issuer_name(cert),it->Config().CADir())) {
+            if(globus_policy.open(X509_get_issuer_name(cert),TrustStore::Get(it->Config().CAFile(),it->Config().CADir()))) {
               //std::cerr<<"+++ additional verification: policy is open"<<std::endl;
               if(!globus_policy.match(X509_get_issuer_name(cert),X509_get_subject_name(cert))) {
                 it->SetFailure(std::string("Certificate ")+subject_name+" failed Globus signing policy");
@@ -148,23 +157,29 @@ static int no_passphrase_callback(char*, int, int, void*) {
    return -1;
 }
 
+static Glib::Mutex ex_data_lock_;
+
 bool PayloadTLSMCC::StoreInstance(void) {
-   if(ex_data_index_ == -1) {
-      // In case of race condition we will have 2 indices assigned - harmless?
-      ex_data_index_=OpenSSLAppDataIndex(ex_data_id);
+   {
+      // Instance is attached to SSL object because context may be
+      // shared by many connections.
+      Glib::Mutex::Lock lock(ex_data_lock_);
+      if(ex_data_index_ == -1) {
+         ex_data_index_=SSL_get_ex_new_index(0,(void*)ex_data_id,NULL,NULL,NULL);
+      };
    };
    if(ex_data_index_ == -1) {
       logger_.msg(WARNING,"Failed to store application data");
       return false;
    };
-   if(!sslctx_) return false;
-   SSL_CTX_set_ex_data(sslctx_,ex_data_index_,this);
+   if(!ssl_) return false;
+   SSL_set_ex_data(ssl_,ex_data_index_,this);
    return true;
 }
 
 bool PayloadTLSMCC::ClearInstance(void) {
-  if((ex_data_index_ != -1) && sslctx_) {
-    SSL_CTX_set_ex_data(sslctx_,ex_data_index_,NULL);
+  if((ex_data_index_ != -1) && ssl_) {
+    SSL_set_ex_data(ssl_,ex_data_index_,NULL);
     return true;
   };
   return false;
@@ -175,10 +190,7 @@ PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   if(ex_data_index_ != -1) {
     SSL* ssl = (SSL*)X509_STORE_CTX_get_ex_data(container,SSL_get_ex_data_X509_STORE_CTX_idx());
     if(ssl != NULL) {
-      SSL_CTX* ssl_ctx = SSL_get_SSL_CTX(ssl);
-      if(ssl_ctx != NULL) {
-        it = (PayloadTLSMCC*)SSL_CTX_get_ex_data(ssl_ctx,ex_data_index_);
-      }
+      it = (PayloadTLSMCC*)SSL_get_ex_data(ssl,ex_data_index_);
     };
   };
   if(it == NULL) {
@@ -187,108 +199,246 @@ PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   return it;
 }
 
+PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(SSL* ssl) {
+  if((ex_data_index_ == -1) || (ssl == NULL)) return NULL;
+  return (PayloadTLSMCC*)SSL_get_ex_data(ssl,ex_data_index_);
+}
 
-PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger):
-    PayloadTLSStream(logger),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0) {
-   // Client mode
-   int err = SSL_ERROR_NONE;
-   char gsi_cmd[1] = { '0' };
-   master_=true;
-   // Creating BIO for communication through stream which it will
-   // extract from provided MCC
-   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
-   // Initialize the SSL Context object
-   long ctx_options = 0;
 
-   if(cfg.IfSSLv3Handshake()) {
+SSL_CTX* ContextTLSMCC::Create(const ConfigTLSMCC& cfg, bool client, Logger& logger, std::string& failure) {
+   SSL_CTX* sslctx = NULL;
+   long ctx_options = 0;
+   if(client) {
+      if(cfg.IfSSLv3Handshake()) {
 #if defined HAVE_SSLV3_METHOD
-     sslctx_=SSL_CTX_new(SSLv3_client_method());
+        sslctx=SSL_CTX_new(SSLv3_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options |= SSL_OP_NO_SSLv3;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+        ctx_options |= SSL_OP_NO_SSLv3;
+        sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv1Handshake()) {
+      } else if(cfg.IfTLSv1Handshake()) {
 #if defined HAVE_TLSV1_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_client_method());
+        sslctx=SSL_CTX_new(TLSv1_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+        ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
+        sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv11Handshake()) {
+      } else if(cfg.IfTLSv11Handshake()) {
 #if defined HAVE_TLSV1_1_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_1_client_method());
+        sslctx=SSL_CTX_new(TLSv1_1_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+        ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1;
+        sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv12Handshake()) {
+      } else if(cfg.IfTLSv12Handshake()) {
 #ifdef HAVE_TLSV1_2_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_2_client_method());
+        sslctx=SSL_CTX_new(TLSv1_2_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+        ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1;
+        sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfDTLSHandshake()) {
+      } else if(cfg.IfDTLSHandshake()) {
 #if defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
+        sslctx=SSL_CTX_new(DTLS_client_method());
 #endif
-   } else if(cfg.IfDTLSv1Handshake()) {
+      } else if(cfg.IfDTLSv1Handshake()) {
 #if defined HAVE_DTLSV1_METHOD
-     sslctx_=SSL_CTX_new(DTLSv1_client_method());
+        sslctx=SSL_CTX_new(DTLSv1_client_method());
 #elif defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
-     ctx_options |= SSL_OP_NO_DTLSv1_2;
+        sslctx=SSL_CTX_new(DTLS_client_method());
+        ctx_options |= SSL_OP_NO_DTLSv1_2;
 #endif
-   } else if(cfg.IfDTLSv12Handshake()) {
+      } else if(cfg.IfDTLSv12Handshake()) {
 #if defined HAVE_DTLSV1_2_METHOD
-     sslctx_=SSL_CTX_new(DTLSv1_2_client_method());
+        sslctx=SSL_CTX_new(DTLSv1_2_client_method());
 #elif defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
-     ctx_options |= SSL_OP_NO_DTLSv1;
+        sslctx=SSL_CTX_new(DTLS_client_method());
+        ctx_options |= SSL_OP_NO_DTLSv1;
 #endif
+      } else {
+#if defined HAVE_TLS_METHOD
+        sslctx=SSL_CTX_new(TLS_client_method());
+#else
+        sslctx=SSL_CTX_new(SSLv23_client_method());
+#endif
+      };
    } else {
+      if(cfg.IfTLSHandshake()) {
 #if defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_client_method());
+        sslctx=SSL_CTX_new(TLS_server_method());
 #else
-     sslctx_=SSL_CTX_new(SSLv23_client_method());
+        sslctx=SSL_CTX_new(SSLv23_server_method());
 #endif
+      } else {
+#if defined HAVE_SSLV3_METHOD
+        sslctx=SSL_CTX_new(SSLv3_server_method());
+#elif defined HAVE_TLS_METHOD
+        sslctx=SSL_CTX_new(TLS_server_method());
+        ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
+#endif
+      };
    };
-   if(sslctx_==NULL){
+   if(sslctx==NULL){
       logger.msg(ERROR, "Can not create the SSL Context object");
-      goto error;
+      return NULL;
    };
-   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
-   if(!config_.Set(sslctx_)) {
-      SetFailure(config_.Failure());
-      goto error;
+   SSL_CTX_set_mode(sslctx,SSL_MODE_ENABLE_PARTIAL_WRITE);
+   if(client) {
+     SessionTLSMCC::SetupClient(sslctx, cfg, ctx_options);
+   } else {
+     SessionTLSMCC::SetupServer(sslctx, cfg, ctx_options);
+   };
+   if(client) {
+     SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &verify_callback);
+   } else if(cfg.IfClientAuthn()) {
+     SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+   } else {
+     //SSL_CTX_set_verify(sslctx, SSL_VERIFY_NONE, NULL);
+     // Ask for client certificate but do not fail if not provided
+     SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+   };
+   // Set() records failure in configuration object hence work on copy
+   ConfigTLSMCC config(cfg);
+   if(!config.Set(sslctx)) {
+      failure = config.Failure();
+      SSL_CTX_free(sslctx);
+      return NULL;
    };
-   SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &verify_callback);
 
    // Allow proxies, request CRL check
-   if(SSL_CTX_get0_param(sslctx_) == NULL) {
+   if(SSL_CTX_get0_param(sslctx) == NULL) {
       logger.msg(ERROR,"Can't set OpenSSL verify flags");
-      goto error;
+      SSL_CTX_free(sslctx);
+      return NULL;
    } else {
-      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
+      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
    };
-   StoreInstance();
-#ifdef SSL_OP_NO_TICKET
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL | SSL_OP_NO_TICKET;
-#else
+   // Session tickets are controlled by SessionTLSMCC
    ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
-#endif
-   SSL_CTX_set_options(sslctx_, ctx_options);
+   SSL_CTX_set_options(sslctx, ctx_options);
+   SSL_CTX_set_default_passwd_cb(sslctx, no_passphrase_callback);
+   return sslctx;
+}
+
+ContextTLSMCC::ContextTLSMCC(const ConfigTLSMCC& cfg, bool client, Logger& logger):
+    config_(cfg),client_(client),logger_(logger),sslctx_(NULL),checked_(0) {
+}
+
+ContextTLSMCC::~ContextTLSMCC(void) {
+  // SSL objects still in use hold own references to context
+  if(sslctx_) SSL_CTX_free(sslctx_);
+  sslctx_ = NULL;
+}
+
+static void stamp_file(const std::string& path, std::string& stamp) {
+  struct stat st;
+  if(::stat(path.c_str(),&st) != 0) {
+    stamp += path + ":-;";
+    return;
+  };
+  stamp += path + ":" + tostring(st.st_ino) + ":" + tostring(st.st_size) + ":" + tostring(st.st_mtime) + ";";
+}
+
+// Collects information about files used to build context.
+// Any difference means context must be rebuilt.
+std::string ContextTLSMCC::Stamp(void) {
+  std::string stamp;
+  if(!config_.CertFile().empty()) stamp_file(config_.CertFile(),stamp);
+  if(!config_.KeyFile().empty()) stamp_file(config_.KeyFile(),stamp);
+  if((!config_.CAFile().empty()) || (!config_.CADir().empty())) {
+    // CA certificates and CRLs are watched by trust store
+    stamp += "trust:" + tostring(TrustStore::Get(config_.CAFile(),config_.CADir()).Generation());
+  };
+  return stamp;
+}
+
+// Rebuilds context if there is none or if files it was built
+// from have changed. Files are checked not more often than
+// once per TLS_CONTEXT_CHECK_PERIOD. Other connections keep using
+// current context while new one is being built.
+void ContextTLSMCC::Refresh(void) {
+  {
+    Glib::Mutex::Lock lock(lock_);
+    if(sslctx_ && ((time(NULL) - checked_) < TLS_CONTEXT_CHECK_PERIOD)) return;
+  };
+  Glib::Mutex::Lock rlock(refresh_lock_);
+  {
+    // Could be refreshed by other thread while waiting
+    Glib::Mutex::Lock lock(lock_);
+    if(sslctx_ && ((time(NULL) - checked_) < TLS_CONTEXT_CHECK_PERIOD)) return;
+  };
+  std::string stamp = Stamp();
+  {
+    Glib::Mutex::Lock lock(lock_);
+    if(sslctx_ && (stamp == stamp_)) {
+      checked_ = time(NULL);
+      return;
+    };
+  };
+  std::string failure;
+  SSL_CTX* sslctx = Create(config_,client_,logger_,failure);
+  Glib::Mutex::Lock lock(lock_);
+  checked_ = time(NULL);
+  if(!sslctx) {
+    if(failure.empty()) failure = ConfigTLSMCC::HandleError();
+    failure_ = failure;
+    if(sslctx_) {
+      // Keep using previous context and retry later
+      logger_.msg(WARNING, "Failed to reload TLS credentials, keeping previous ones: %s", failure);
+    };
+    return;
+  };
+  if(sslctx_) {
+    logger_.msg(INFO, "TLS credentials changed on disk, SSL context reloaded");
+    SSL_CTX_free(sslctx_);
+  };
+  sslctx_ = sslctx;
+  stamp_ = stamp;
+  failure_.clear();
+}
 
-   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
-   /* Get DN from certificate, and put it into message's attribute */
+SSL* ContextTLSMCC::NewSSL(std::string& failure) {
+  Refresh();
+  Glib::Mutex::Lock lock(lock_);
+  if(!sslctx_) {
+    failure = failure_;
+    return NULL;
+  };
+  // SSL object holds own reference to context
+  SSL* ssl = SSL_new(sslctx_);
+  if(!ssl) logger_.msg(ERROR, "Can not create the SSL object");
+  return ssl;
+}
 
+
+PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger, ContextTLSMCC* context):
+    PayloadTLSStream(logger),shared_(false),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0) {
+   // Client mode
+   int err = SSL_ERROR_NONE;
+   char gsi_cmd[1] = { '0' };
+   std::string failure;
+   bool resuming = false;
+   master_=true;
+   // Creating BIO for communication through stream which it will
+   // extract from provided MCC
+   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
    // Creating SSL object for handling connection
-   ssl_ = SSL_new(sslctx_);
-   if (ssl_ == NULL){
-      logger.msg(ERROR, "Can not create the SSL object");
+   if(context) {
+      shared_=true;
+      ssl_ = context->NewSSL(failure);
+      if(ssl_) sslctx_ = SSL_get_SSL_CTX(ssl_);
+   } else {
+      sslctx_ = ContextTLSMCC::Create(config_, true, logger, failure);
+      if(sslctx_) {
+         ssl_ = SSL_new(sslctx_);
+         if (ssl_ == NULL) logger.msg(ERROR, "Can not create the SSL object");
+      };
+   };
+   if (ssl_ == NULL) {
+      if(!failure.empty()) SetFailure(failure);
       goto error;
    };
+   StoreInstance();
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -299,10 +449,13 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
          logger.msg(WARNING, "Faile to assign hostname extension");
       };
    };
+   resuming = SessionTLSMCC::Resume(ssl_, config_);
    SSL_set_bio(ssl_,bio,bio); bio=NULL;
    //SSL_set_connect_state(ssl_);
    if((err=SSL_connect(ssl_)) != 1) {
       err = SSL_get_error(ssl_,err);
+      // Do not try same session again
+      if(resuming) SessionTLSMCC::Forget(config_);
       /* TODO: Print nice message when server side certificate has
        *       expired. Still to investigate if this case is only when
        *       server side certificate has expired.
@@ -314,6 +467,13 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       goto error;
    };
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(DEBUG, "TLS session resumed");
+   if(!SessionTLSMCC::Check(ssl_, failure)) {
+      SessionTLSMCC::Forget(config_);
+      logger.msg(ERROR, "%s", failure);
+      SetFailure(failure);
+      goto error;
+   };
    // if(SSL_in_init(ssl_)){
    //handle error
    // }
@@ -324,72 +484,36 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
-   if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
+   if(sslctx_) { if(!shared_) SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
 
-PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC& cfg, Logger& logger):
-    PayloadTLSStream(logger),sslctx_(NULL),config_(cfg),flags_(0) {
+PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC& cfg, Logger& logger, ContextTLSMCC* context):
+    PayloadTLSStream(logger),shared_(false),sslctx_(NULL),config_(cfg),flags_(0) {
    // Server mode
    int err = SSL_ERROR_NONE;
+   std::string failure;
    master_=true;
    // Creating BIO for communication through provided stream
    BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(stream):BIO_new_MCC(stream));
-   // Initialize the SSL Context object
-   long ctx_options = 0;
-   if(cfg.IfTLSHandshake()) {
-#if defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-#else
-     sslctx_=SSL_CTX_new(SSLv23_server_method());
-#endif
+   // Creating SSL object for handling connection
+   if(context) {
+      shared_=true;
+      ssl_ = context->NewSSL(failure);
+      if(ssl_) sslctx_ = SSL_get_SSL_CTX(ssl_);
    } else {
-#if defined HAVE_SSLV3_METHOD
-     sslctx_=SSL_CTX_new(SSLv3_server_method());
-#elif defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-     ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
-#endif
+      sslctx_ = ContextTLSMCC::Create(config_, false, logger, failure);
+      if(sslctx_) {
+         ssl_ = SSL_new(sslctx_);
+         if (ssl_ == NULL) logger.msg(ERROR, "Can not create the SSL object");
+      };
    };
-   if(sslctx_==NULL){
-      logger.msg(ERROR, "Can not create the SSL Context object");
+   if (ssl_ == NULL) {
+      if(!failure.empty()) SetFailure(failure);
       goto error;
    };
-   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
-   if(config_.IfClientAuthn()) {
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   else {
-     //SSL_CTX_set_verify(sslctx_, SSL_VERIFY_NONE, NULL);
-     // Ask for client certificate but do not fail if not provided
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   if(!config_.Set(sslctx_)) {
-      SetFailure(config_.Failure());
-      goto error;
-   }
-
-   // Allow proxies, request CRL check
-   if(SSL_CTX_get0_param(sslctx_) == NULL) {
-      logger.msg(ERROR,"Can't set OpenSSL verify flags");
-      goto error;
-   } else {
-      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
-   };
-
    StoreInstance();
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
-   SSL_CTX_set_options(sslctx_, ctx_options);
-   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
-
-   // Creating SSL object for handling connection
-   ssl_ = SSL_new(sslctx_);
-   if (ssl_ == NULL){
-      logger.msg(ERROR, "Can not create the SSL object");
-      goto error;
-   };
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -402,7 +526,13 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
       logger.msg(ERROR, "Failed to accept SSL connection");
       goto error;
    };
+   if(!SessionTLSMCC::Check(ssl_, failure)) {
+      logger.msg(ERROR, "%s", failure);
+      SetFailure(failure);
+      goto error;
+   };
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(DEBUG, "TLS session resumed");
    //handle error
    // if(SSL_in_init(ssl_)){
    //handle error
@@ -411,14 +541,15 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
-   if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
+   if(sslctx_) { if(!shared_) SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
 
 PayloadTLSMCC::PayloadTLSMCC(PayloadTLSMCC& stream):
     PayloadTLSStream(stream), config_(stream.config_), flags_(0) {
    master_=false;
+   shared_=stream.shared_;
    sslctx_=stream.sslctx_;
    ssl_=stream.ssl_;
    bio_=stream.bio_;
@@ -463,8 +594,11 @@ PayloadTLSMCC::~PayloadTLSMCC(void) {
     ssl_ = NULL;
   }
   if(sslctx_) {
-    SSL_CTX_set_verify(sslctx_,SSL_VERIFY_NONE,NULL);
-    SSL_CTX_free(sslctx_);
+    // Shared context is owned by MCC and may still be used by other connections
+    if(!shared_) {
+      SSL_CTX_set_verify(sslctx_,SSL_VERIFY_NONE,NULL);
+      SSL_CTX_free(sslctx_);
+    }
     sslctx_ = NULL;
   }
   // bio_ was passed to ssl_ and hence does not need to
@@ -7,6 +7,7 @@
 #include <arc/message/PayloadStream.h>
 #include <arc/message/MCC.h>
 #include <arc/Logger.h>
+#include <arc/Thread.h>
 
 #include "BIOMCC.h"
 #include "BIOGSIMCC.h"
@@ -15,12 +16,42 @@
 
 namespace ArcMCCTLS {
 
+// SSL context shared by connections handled by one TLS MCC. It is
+// created on first use and rebuilt if credentials or CA/CRL files
+// change on disk. Connections already using previous context keep
+// their reference to it.
+class ContextTLSMCC {
+ private:
+  Glib::Mutex lock_;
+  Glib::Mutex refresh_lock_;
+  ConfigTLSMCC config_;
+  bool client_;
+  Logger& logger_;
+  SSL_CTX* sslctx_;
+  std::string stamp_;
+  std::string failure_;
+  time_t checked_;
+  std::string Stamp(void);
+  void Refresh(void);
+ public:
+  ContextTLSMCC(const ConfigTLSMCC& cfg, bool client, Logger& logger);
+  ~ContextTLSMCC(void);
+  /** Creates SSL object bound to current context. Returns NULL and
+    fills failure if context could not be created. */
+  SSL* NewSSL(std::string& failure);
+  /** Creates new SSL context. Used for shared context and for
+    connections which do not share context. */
+  static SSL_CTX* Create(const ConfigTLSMCC& cfg, bool client, Logger& logger, std::string& failure);
+};
+
 // This class extends PayloadTLSStream with initialization procedure to 
 // connect it to next MCC or Stream interface.
 class PayloadTLSMCC: public PayloadTLSStream {
  private:
   /** Specifies if this object owns internal SSL objects */
   bool master_;
+  /** Specifies if SSL context is shared and must not be altered */
+  bool shared_;
   /** SSL context */
   SSL_CTX* sslctx_;
   BIO* bio_;
@@ -34,12 +65,14 @@ class PayloadTLSMCC: public PayloadTLSStream {
  public:
   /** Constructor - creates ssl object which is bound to next MCC.
     This instance must be used on client side. It obtains Stream interface
-    from next MCC dynamically. */
-  PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger);
+    from next MCC dynamically. If context is provided SSL object
+    is created from that shared context. */
+  PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger, ContextTLSMCC* context = NULL);
   /** Constructor - creates ssl object which is bound to stream. 
     This constructor to be used on server side. Provided stream
-    is NOT destroyed in destructor. */
-  PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC& cfg, Logger& logger);
+    is NOT destroyed in destructor. If context is provided SSL object
+    is created from that shared context. */
+  PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC& cfg, Logger& logger, ContextTLSMCC* context = NULL);
   /** Copy constructor with new logger.
     Created object shares same SSL objects but does not destroy them 
     in destructor. Main instance must be destroyed after all copied ones. */
@@ -47,6 +80,7 @@ class PayloadTLSMCC: public PayloadTLSStream {
   virtual ~PayloadTLSMCC(void);
   const ConfigTLSMCC& Config(void) { return config_; };
   static PayloadTLSMCC* RetrieveInstance(X509_STORE_CTX* container);
+  static PayloadTLSMCC* RetrieveInstance(SSL* ssl);
   unsigned long Flags(void) { return flags_; };
   void Flags(unsigned long flags) { flags_=flags; };
   void SetFailure(const std::string& err);
@@ -14,6 +14,8 @@
 
 #include "ConfigTLSMCC.h"
 
+#include "SessionTLSMCC.h"
+
 #include "PayloadTLSStream.h"
 
 namespace ArcMCCTLS {
@@ -97,6 +99,8 @@ STACK_OF(X509)* PayloadTLSStream::GetPeerChain(void){
   if(ssl_ == NULL) return NULL;
   if((err=SSL_get_verify_result(ssl_)) == X509_V_OK){
     peerchain=SSL_get_peer_cert_chain (ssl_);
+    // Resumed server side session does not carry chain
+    if(peerchain==NULL) peerchain=SessionTLSMCC::RestoredChain(ssl_);
     if(peerchain!=NULL) return peerchain;
     SetFailure("Peer certificate chain cannot be extracted\n"+ConfigTLSMCC::HandleError());
   } else {
@@ -0,0 +1,398 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <map>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <arc/DateTime.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+
+#include "PayloadTLSMCC.h"
+
+#include "SessionTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+#define X509_getm_notAfter X509_get_notAfter
+#endif
+
+// Maximal number of sessions kept by client
+#define TLS_CLIENT_SESSIONS_MAX (256)
+
+Time asn1_to_utctime(const ASN1_UTCTIME *s);
+
+static const char* session_id_context = "ARC_MCC_TLS";
+
+// ----------------------------------------------------------------------
+// Lifetime of session must not exceed lifetime of credentials it
+// was established with.
+
+static void session_limit_time(time_t& limit, X509* cert) {
+  if(!cert) return;
+  time_t t = asn1_to_utctime(X509_getm_notAfter(cert)).GetTime();
+  if((limit == 0) || (t < limit)) limit = t;
+}
+
+static void session_limit_lifetime(SSL_SESSION* session, X509* cert, STACK_OF(X509)* chain) {
+  time_t limit = 0;
+  session_limit_time(limit, cert);
+  if(chain) {
+    for(int idx = 0; idx < sk_X509_num(chain); ++idx) session_limit_time(limit, sk_X509_value(chain,idx));
+  };
+  if(limit == 0) return;
+  long lifetime = limit - SSL_SESSION_get_time(session);
+  if(lifetime < 0) lifetime = 0;
+  if(lifetime < SSL_SESSION_get_timeout(session)) SSL_SESSION_set_timeout(session, lifetime);
+}
+
+static bool session_expired(X509* cert) {
+  return (X509_cmp_current_time(X509_getm_notAfter(cert)) <= 0);
+}
+
+// ----------------------------------------------------------------------
+// Chain of peer certificates is not preserved in session tickets and
+// is not available for sessions resumed from server side cache either.
+// So it is stored in session as application data and attached to SSL
+// object when session is resumed.
+
+static Glib::Mutex chain_index_lock;
+static int chain_index = -1;
+
+static void chain_free(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp) {
+  if(ptr) sk_X509_pop_free((STACK_OF(X509)*)ptr, X509_free);
+}
+
+static int get_chain_index(void) {
+  Glib::Mutex::Lock lock(chain_index_lock);
+  if(chain_index == -1) {
+    chain_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, &chain_free);
+  };
+  return chain_index;
+}
+
+STACK_OF(X509)* SessionTLSMCC::RestoredChain(SSL* ssl) {
+  if(!ssl) return NULL;
+  int idx = get_chain_index();
+  if(idx == -1) return NULL;
+  return (STACK_OF(X509)*)SSL_get_ex_data(ssl, idx);
+}
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+// Stores verified peer chain of established session in session itself
+static bool chain_store(SSL* ssl, SSL_SESSION* session) {
+  STACK_OF(X509)* chain = SSL_get_peer_cert_chain(ssl);
+  if(!chain) chain = SessionTLSMCC::RestoredChain(ssl);
+  std::string data;
+  if(chain) {
+    for(int idx = 0; idx < sk_X509_num(chain); ++idx) {
+      X509* cert = sk_X509_value(chain, idx);
+      int l = i2d_X509(cert, NULL);
+      if(l <= 0) return false;
+      std::string::size_type p = data.length();
+      data.resize(p + l);
+      unsigned char* d = (unsigned char*)&(data[p]);
+      if(i2d_X509(cert, &d) != l) return false;
+    };
+  };
+  X509* cert = SSL_get_peer_certificate(ssl);
+  session_limit_lifetime(session, cert, chain);
+  if(cert) X509_free(cert);
+  return (SSL_SESSION_set1_ticket_appdata(session, data.c_str(), data.length()) == 1);
+}
+
+// Attaches chain stored in resumed session to SSL object
+static bool chain_restore(SSL* ssl, SSL_SESSION* session) {
+  void* data = NULL;
+  size_t length = 0;
+  // Session without chain must not be resumed
+  if(SSL_SESSION_get0_ticket_appdata(session, &data, &length) != 1) return false;
+  STACK_OF(X509)* chain = sk_X509_new_null();
+  if(!chain) return false;
+  const unsigned char* p = (const unsigned char*)data;
+  const unsigned char* e = p + length;
+  while(p < e) {
+    X509* cert = d2i_X509(NULL, &p, e - p);
+    if((!cert) || session_expired(cert)) {
+      if(cert) X509_free(cert);
+      sk_X509_pop_free(chain, X509_free);
+      return false;
+    };
+    sk_X509_push(chain, cert);
+  };
+  X509* cert = SSL_SESSION_get0_peer(session);
+  if(cert && session_expired(cert)) {
+    sk_X509_pop_free(chain, X509_free);
+    return false;
+  };
+  int idx = get_chain_index();
+  if(idx == -1) {
+    sk_X509_pop_free(chain, X509_free);
+    return false;
+  };
+  STACK_OF(X509)* old_chain = (STACK_OF(X509)*)SSL_get_ex_data(ssl, idx);
+  if(old_chain) sk_X509_pop_free(old_chain, X509_free);
+  SSL_set_ex_data(ssl, idx, chain);
+  return true;
+}
+
+static int ticket_generate(SSL* ssl, void* arg) {
+  SSL_SESSION* session = SSL_get_session(ssl);
+  if(!session) return 1;
+  return chain_store(ssl, session) ? 1 : 0;
+}
+
+static SSL_TICKET_RETURN ticket_decrypt(SSL* ssl, SSL_SESSION* session,
+                                        const unsigned char* keyname, size_t keyname_length,
+                                        SSL_TICKET_STATUS status, void* arg) {
+  switch(status) {
+    case SSL_TICKET_SUCCESS:
+    case SSL_TICKET_SUCCESS_RENEW:
+      break;
+    case SSL_TICKET_EMPTY:
+    case SSL_TICKET_NO_DECRYPT:
+      return SSL_TICKET_RETURN_IGNORE_RENEW;
+    default:
+      return SSL_TICKET_RETURN_ABORT;
+  };
+  // Ticket without valid chain - make full handshake
+  if(!chain_restore(ssl, session)) return SSL_TICKET_RETURN_IGNORE_RENEW;
+  return (status == SSL_TICKET_SUCCESS)?SSL_TICKET_RETURN_USE:SSL_TICKET_RETURN_USE_RENEW;
+}
+
+static int server_session_new(SSL* ssl, SSL_SESSION* session) {
+  // Session which can't carry chain is not usable
+  if(!chain_store(ssl, session)) SSL_SESSION_set_timeout(session, 0);
+  // Session is kept in internal cache of context
+  return 0;
+}
+#endif
+
+void SessionTLSMCC::SetupServer(SSL_CTX* sslctx, const ConfigTLSMCC& cfg, long& ctx_options) {
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+  if(cfg.SessionCache() > 0) {
+    SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(sslctx,cfg.SessionCache());
+    // Session id context is required for resumption if peer is verified
+    SSL_CTX_set_session_id_context(sslctx,(const unsigned char*)session_id_context,strlen(session_id_context));
+    SSL_CTX_sess_set_new_cb(sslctx,&server_session_new);
+    if(cfg.SessionTickets()) {
+      SSL_CTX_set_session_ticket_cb(sslctx,&ticket_generate,&ticket_decrypt,NULL);
+    } else {
+      ctx_options |= SSL_OP_NO_TICKET;
+    };
+    return;
+  };
+#endif
+  // Older OpenSSL has no means to keep peer chain with session.
+  // So resumption is not supported there.
+  SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_OFF);
+#ifdef SSL_OP_NO_TICKET
+  // Tickets would make it possible to resume session without cache
+  ctx_options |= SSL_OP_NO_TICKET;
+#endif
+}
+
+// Runs verification of peer chain against current CA certificates, CRLs
+// and signing policies the same way as during full handshake.
+static bool session_verify(SSL* ssl, X509* cert, STACK_OF(X509)* chain) {
+  if(!cert) return true;
+  X509_STORE* store = SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl));
+  if(!store) return false;
+  X509_STORE_CTX* sctx = X509_STORE_CTX_new();
+  if(!sctx) return false;
+  bool result = false;
+  if(X509_STORE_CTX_init(sctx, store, cert, chain) == 1) {
+    // Let verify callback find TLS stream the same way as in handshake
+    X509_STORE_CTX_set_ex_data(sctx, SSL_get_ex_data_X509_STORE_CTX_idx(), ssl);
+    X509_STORE_CTX_set_default(sctx, SSL_is_server(ssl) ? "ssl_client" : "ssl_server");
+    X509_VERIFY_PARAM_set1(X509_STORE_CTX_get0_param(sctx), SSL_get0_param(ssl));
+    int (*callback)(int, X509_STORE_CTX*) = SSL_get_verify_callback(ssl);
+    if(callback) X509_STORE_CTX_set_verify_cb(sctx, callback);
+    result = (X509_verify_cert(sctx) == 1);
+  };
+  X509_STORE_CTX_free(sctx);
+  return result;
+}
+
+bool SessionTLSMCC::Check(SSL* ssl, std::string& failure) {
+  if(!SSL_session_reused(ssl)) return true;
+  STACK_OF(X509)* chain = SSL_get_peer_cert_chain(ssl);
+  if(!chain) chain = RestoredChain(ssl);
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+  // Session resumed from server side cache
+  if(!chain && SSL_is_server(ssl) && SSL_get_session(ssl)) {
+    if(chain_restore(ssl, SSL_get_session(ssl))) chain = RestoredChain(ssl);
+  };
+#endif
+  // Certificates were verified when session was established.
+  // Make sure they did not expire and were not revoked since then.
+  bool valid = true;
+  X509* cert = SSL_get_peer_certificate(ssl);
+  if(cert) {
+    if(session_expired(cert)) valid = false;
+    if(SSL_is_server(ssl) && !chain) valid = false;
+  };
+  if(chain) {
+    for(int idx = 0; idx < sk_X509_num(chain); ++idx) {
+      if(session_expired(sk_X509_value(chain,idx))) valid = false;
+    };
+  };
+  if(!valid) {
+    failure = "Credentials of resumed TLS session have expired";
+  } else if(!session_verify(ssl, cert, chain)) {
+    failure = "Credentials of resumed TLS session failed verification";
+    valid = false;
+  };
+  if(cert) X509_free(cert);
+  if(!valid) {
+    SSL_SESSION* session = SSL_get_session(ssl);
+    if(session) SSL_CTX_remove_session(SSL_get_SSL_CTX(ssl),session);
+  };
+  return valid;
+}
+
+// ----------------------------------------------------------------------
+// Client side sessions are shared by all connections in process because
+// client chains and their contexts are usually created per connection.
+
+class ClientSessions {
+ private:
+  class Session {
+   public:
+    SSL_SESSION* session;
+    time_t expires;
+  };
+  Glib::Mutex lock_;
+  std::map<std::string,Session> sessions_;
+ public:
+  ~ClientSessions(void) {
+    for(std::map<std::string,Session>::iterator s = sessions_.begin(); s != sessions_.end(); ++s) {
+      SSL_SESSION_free(s->second.session);
+    };
+  };
+  // Takes over reference to session
+  void Store(const std::string& key, SSL_SESSION* session, int lifetime) {
+    Glib::Mutex::Lock lock(lock_);
+    time_t now = time(NULL);
+    std::map<std::string,Session>::iterator s = sessions_.find(key);
+    if(s != sessions_.end()) {
+      SSL_SESSION_free(s->second.session);
+      sessions_.erase(s);
+    } else if(sessions_.size() >= TLS_CLIENT_SESSIONS_MAX) {
+      // Drop expired sessions, or the one expiring first
+      std::map<std::string,Session>::iterator first = sessions_.end();
+      for(s = sessions_.begin(); s != sessions_.end();) {
+        if(s->second.expires <= now) {
+          SSL_SESSION_free(s->second.session);
+          sessions_.erase(s++);
+          continue;
+        };
+        if((first == sessions_.end()) || (s->second.expires < first->second.expires)) first = s;
+        ++s;
+      };
+      if((sessions_.size() >= TLS_CLIENT_SESSIONS_MAX) && (first != sessions_.end())) {
+        SSL_SESSION_free(first->second.session);
+        sessions_.erase(first);
+      };
+    };
+    Session& entry = sessions_[key];
+    entry.session = session;
+    entry.expires = now + lifetime;
+  };
+  bool Use(const std::string& key, SSL* ssl) {
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string,Session>::iterator s = sessions_.find(key);
+    if(s == sessions_.end()) return false;
+    if(s->second.expires <= time(NULL)) {
+      SSL_SESSION_free(s->second.session);
+      sessions_.erase(s);
+      return false;
+    };
+    // SSL object acquires own reference
+    return (SSL_set_session(ssl, s->second.session) == 1);
+  };
+  void Remove(const std::string& key) {
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string,Session>::iterator s = sessions_.find(key);
+    if(s == sessions_.end()) return;
+    SSL_SESSION_free(s->second.session);
+    sessions_.erase(s);
+  };
+};
+
+static ClientSessions client_sessions;
+
+static std::string file_stamp(const std::string& path) {
+  struct stat st;
+  if(::stat(path.c_str(),&st) != 0) return path;
+  return path + ":" + tostring(st.st_ino) + ":" + tostring(st.st_mtime);
+}
+
+// Session may only be reused for same endpoint and with same credentials
+static std::string session_key(const ConfigTLSMCC& cfg) {
+  if(cfg.Endpoint().empty()) return "";
+  std::string key = cfg.Endpoint() + "|" + cfg.Hostname() + "|";
+  if(!cfg.Credential().empty()) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdlen = 0;
+    if(!EVP_Digest(cfg.Credential().c_str(), cfg.Credential().length(),
+                   md, &mdlen, EVP_sha256(), NULL)) return "";
+    for(unsigned int n = 0; n < mdlen; ++n) {
+      char buf[3];
+      snprintf(buf, sizeof(buf), "%02x", (unsigned int)(md[n]));
+      key += buf;
+    };
+  } else {
+    if(!cfg.CertFile().empty()) key += file_stamp(cfg.CertFile());
+    key += "|";
+    if(!cfg.KeyFile().empty()) key += file_stamp(cfg.KeyFile());
+  };
+  key += "|" + cfg.CAFile() + "|" + cfg.CADir();
+  return key;
+}
+
+static int client_session_new(SSL* ssl, SSL_SESSION* session) {
+  PayloadTLSMCC* it = PayloadTLSMCC::RetrieveInstance(ssl);
+  if(!it) return 0;
+  if(it->Config().SessionCache() <= 0) return 0;
+  std::string key = session_key(it->Config());
+  if(key.empty()) return 0;
+  client_sessions.Store(key, session, it->Config().SessionCache());
+  return 1;
+}
+
+void SessionTLSMCC::SetupClient(SSL_CTX* sslctx, const ConfigTLSMCC& cfg, long& ctx_options) {
+  if((cfg.SessionCache() <= 0) || cfg.Endpoint().empty()) {
+    SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_OFF);
+#ifdef SSL_OP_NO_TICKET
+    ctx_options |= SSL_OP_NO_TICKET;
+#endif
+    return;
+  };
+  SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(sslctx,&client_session_new);
+}
+
+bool SessionTLSMCC::Resume(SSL* ssl, const ConfigTLSMCC& cfg) {
+  if(cfg.SessionCache() <= 0) return false;
+  std::string key = session_key(cfg);
+  if(key.empty()) return false;
+  return client_sessions.Use(key, ssl);
+}
+
+void SessionTLSMCC::Forget(const ConfigTLSMCC& cfg) {
+  std::string key = session_key(cfg);
+  if(key.empty()) return;
+  client_sessions.Remove(key);
+}
+
+} // namespace ArcMCCTLS
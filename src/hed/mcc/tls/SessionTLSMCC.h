@@ -0,0 +1,39 @@
+#ifndef __ARC_SESSIONTLSMCC_H__
+#define __ARC_SESSIONTLSMCC_H__
+
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include "ConfigTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+// Support for TLS session resumption. Server side sessions are kept
+// in cache of shared SSL context and optionally in session tickets.
+// Client side sessions are kept in process-wide cache indexed by
+// remote endpoint and used credentials.
+class SessionTLSMCC {
+ public:
+  /** Configures session caching of server side context. Options which
+    must be applied to context are added to ctx_options. */
+  static void SetupServer(SSL_CTX* sslctx, const ConfigTLSMCC& cfg, long& ctx_options);
+  /** Configures session caching of client side context. */
+  static void SetupClient(SSL_CTX* sslctx, const ConfigTLSMCC& cfg, long& ctx_options);
+  /** Assigns previously cached session to new client side SSL object.
+    Returns true if session was assigned. */
+  static bool Resume(SSL* ssl, const ConfigTLSMCC& cfg);
+  /** Removes client side session which failed to be resumed. */
+  static void Forget(const ConfigTLSMCC& cfg);
+  /** Checks if credentials of resumed session are still valid and
+    pass verification against current CRLs and signing policies.
+    Returns false and fills failure otherwise. */
+  static bool Check(SSL* ssl, std::string& failure);
+  /** Returns peer certificates chain restored from resumed server
+    side session. Such sessions do not carry chain by themselves. */
+  static STACK_OF(X509)* RestoredChain(SSL* ssl);
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_SESSIONTLSMCC_H__ */
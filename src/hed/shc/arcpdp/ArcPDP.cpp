@@ -12,6 +12,7 @@
 #include <arc/Logger.h>
 #include <arc/security/ArcPDP/Response.h>
 #include <arc/security/ArcPDP/attr/AttributeValue.h>
+#include <arc/StringConv.h>
 #include <arc/security/ArcPDP/EvaluatorLoader.h>
 
 #include "ArcPDP.h"
@@ -40,30 +41,6 @@ Plugin* ArcPDP::get_arc_pdp(PluginArgument* arg) {
     return new ArcPDP((Arc::Config*)(*pdparg),arg);
 }
 
-// This class is used to store Evaluator per connection
-class ArcPDPContext:public Arc::MessageContextElement {
- friend class ArcPDP;
- private:
-  Evaluator* eval;
- public:
-  ArcPDPContext(Evaluator* e);
-  ArcPDPContext(void);
-  virtual ~ArcPDPContext(void);
-};
-
-ArcPDPContext::~ArcPDPContext(void) {
-  if(eval) delete eval;
-}
-
-ArcPDPContext::ArcPDPContext(Evaluator* e):eval(e) {
-}
-
-ArcPDPContext::ArcPDPContext(void):eval(NULL) {
-  std::string evaluator = "arc.evaluator"; 
-  EvaluatorLoader eval_loader;
-  eval = eval_loader.getEvaluator(evaluator);
-}
-
 ArcPDP::ArcPDP(Config* cfg,Arc::PluginArgument* parg):PDP(cfg,parg) /*, eval(NULL)*/ {
   XMLNode pdp_node(*cfg);
 
@@ -74,14 +51,23 @@ ArcPDP::ArcPDP(Config* cfg,Arc::PluginArgument* parg):PDP(cfg,parg) /*, eval(NUL
     for(;(bool)select_attr;++select_attr) select_attrs.push_back((std::string)select_attr);
     for(;(bool)reject_attr;++reject_attr) reject_attrs.push_back((std::string)reject_attr);
   };
+  unsigned int cache_size = 0;
+  XMLNode cache_size_node = (*cfg)["DecisionCacheSize"];
+  if((bool)cache_size_node) {
+    if(!Arc::stringto((std::string)cache_size_node,cache_size)) {
+      logger.msg(ERROR, "Wrong value of DecisionCacheSize: %s",(std::string)cache_size_node);
+      cache_size = 0;
+    };
+  };
+  pool = new EvaluatorPool("arc.evaluator",cache_size);
   XMLNode policy_store = (*cfg)["PolicyStore"];
   for(;(bool)policy_store;++policy_store) {
     XMLNode policy_location = policy_store["Location"];
-    policy_locations.push_back((std::string)policy_location);
+    pool->addPolicyLocation((std::string)policy_location);
   };
   XMLNode policy = (*cfg)["Policy"];
-  for(;(bool)policy;++policy) policies.AddNew(policy);
-  policy_combining_alg = (std::string)((*cfg)["PolicyCombiningAlg"]);
+  for(;(bool)policy;++policy) pool->addPolicy(policy);
+  pool->setCombiningAlg((std::string)((*cfg)["PolicyCombiningAlg"]));
 }
 
 PDPStatus ArcPDP::isPermitted(Message *msg) const {
@@ -97,68 +83,6 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
     </RequestItem>
   </Request>
   */
-  Evaluator* eval = NULL;
-
-  std::string ctxid = "arcsec.arcpdp";
-  try {
-    Arc::MessageContextElement* mctx = (*(msg->Context()))[ctxid];
-    if(mctx) {
-      ArcPDPContext* pdpctx = dynamic_cast<ArcPDPContext*>(mctx);
-      if(pdpctx) {
-        eval=pdpctx->eval;
-      }
-      else { logger.msg(INFO, "Can not find ArcPDPContext"); }
-    };
-  } catch(std::exception& e) { };
-  if(!eval) {
-    ArcPDPContext* pdpctx = new ArcPDPContext();
-    if(pdpctx) {
-      eval=pdpctx->eval;
-      if(eval) {
-        //for(Arc::AttributeIterator it = (msg->Attributes())->getAll("PDP:POLICYLOCATION"); it.hasMore(); it++) {
-        //  eval->addPolicy(SourceFile(*it));
-        //}
-        for(std::list<std::string>::const_iterator it = policy_locations.begin(); it!= policy_locations.end(); it++) {
-          eval->addPolicy(SourceFile(*it));
-        }
-        for(int n = 0;n<policies.Size();++n) {
-          eval->addPolicy(Source(const_cast<Arc::XMLNodeContainer&>(policies)[n]));
-        }
-        if(!policy_combining_alg.empty()) {
-          if(policy_combining_alg == "EvaluatorFailsOnDeny") {
-            eval->setCombiningAlg(EvaluatorFailsOnDeny);
-          } else if(policy_combining_alg == "EvaluatorStopsOnDeny") {
-            eval->setCombiningAlg(EvaluatorStopsOnDeny);
-          } else if(policy_combining_alg == "EvaluatorStopsOnPermit") {
-            eval->setCombiningAlg(EvaluatorStopsOnPermit);
-          } else if(policy_combining_alg == "EvaluatorStopsNever") {
-            eval->setCombiningAlg(EvaluatorStopsNever);
-          } else {
-            AlgFactory* factory = eval->getAlgFactory();
-            if(!factory) {
-              logger.msg(WARNING, "Evaluator does not support loadable Combining Algorithms");
-            } else {
-              CombiningAlg* algorithm = factory->createAlg(policy_combining_alg);
-              if(!algorithm) {
-                logger.msg(ERROR, "Evaluator does not support specified Combining Algorithm - %s",policy_combining_alg);
-              } else {
-                eval->setCombiningAlg(algorithm);
-              };
-            };
-          };
-        };
-        msg->Context()->Add(ctxid, pdpctx);
-      } else {
-        delete pdpctx;
-      }
-    }
-    if(!eval) logger.msg(ERROR, "Can not dynamically produce Evaluator");
-  }
-  if(!eval) {
-    logger.msg(ERROR,"Evaluator for ArcPDP was not loaded"); 
-    return false;
-  };
-
   MessageAuth* mauth = msg->Auth()->Filter(select_attrs,reject_attrs);
   MessageAuth* cauth = msg->AuthContext()->Filter(select_attrs,reject_attrs);
   if((!mauth) && (!cauth)) {
@@ -183,19 +107,32 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
     };
     delete cauth;
   };
-  {
-    std::string s;
-    requestxml.GetXML(s);
-    logger.msg(DEBUG,"ARC Auth. request: %s",s);
-  };
+  // Serialized request is also used as key for decision cache
+  std::string request_str;
+  requestxml.GetXML(request_str);
+  logger.msg(DEBUG,"ARC Auth. request: %s",request_str);
   if(requestxml.Size() <= 0) {
     logger.msg(ERROR,"No requested security information was collected");
     return false;
   };
 
+  bool cached_result = false;
+  if(pool->getDecision(request_str,cached_result)) {
+    if(cached_result) logger.msg(VERBOSE, "Authorized by arc.pdp (cached decision)");
+    else logger.msg(INFO, "Not authorized by arc.pdp (cached decision)");
+    return cached_result;
+  };
+
+  Evaluator* eval = pool->acquire();
+  if(!eval) {
+    logger.msg(ERROR,"Evaluator for ArcPDP was not loaded"); 
+    return false;
+  };
+
   //Call the evaluation functionality inside Evaluator
   Response *resp = eval->evaluate(requestxml);
   if(!resp) {
+    pool->release(eval);
     logger.msg(ERROR, "Not authorized by arc.pdp - failed to get response from Evaluator");
     return false;
   };
@@ -246,14 +183,14 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
   else logger.msg(INFO, "Not authorized by arc.pdp - some of the RequestItem elements do not satisfy Policy");
   
   if(resp) delete resp;
+  pool->putDecision(eval,request_str,result);
+  pool->release(eval);
     
   return result;
 }
 
 ArcPDP::~ArcPDP(){
-  //if(eval)
-  //  delete eval;
-  //eval = NULL;
+  delete pool;
 }
 
 } // namespace ArcSec
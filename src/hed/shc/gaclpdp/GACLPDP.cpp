@@ -4,6 +4,7 @@
 
 #include <arc/security/ArcPDP/Evaluator.h>
 #include <arc/security/ArcPDP/EvaluatorLoader.h>
+#include <arc/StringConv.h>
 /*
 #include <iostream>
 #include <fstream>
@@ -47,28 +48,6 @@ Plugin* GACLPDP::get_gacl_pdp(PluginArgument* arg) {
     return new GACLPDP((Config*)(*pdparg),arg);
 }
 
-class GACLPDPContext:public Arc::MessageContextElement {
- friend class GACLPDP;
- private:
-  Evaluator* eval;
- public:
-  GACLPDPContext(Evaluator* e);
-  GACLPDPContext(void);
-  virtual ~GACLPDPContext(void);
-};
-
-GACLPDPContext::~GACLPDPContext(void) {
-  if(eval) delete eval;
-}
-
-GACLPDPContext::GACLPDPContext(Evaluator* e):eval(e) {
-}
-
-GACLPDPContext::GACLPDPContext(void):eval(NULL) {
-  EvaluatorLoader eval_loader;
-  eval = eval_loader.getEvaluator(std::string("gacl.evaluator"));
-}
-
 GACLPDP::GACLPDP(Config* cfg, Arc::PluginArgument* parg):PDP(cfg,parg) {
   XMLNode pdp_node(*cfg);
 
@@ -79,49 +58,23 @@ GACLPDP::GACLPDP(Config* cfg, Arc::PluginArgument* parg):PDP(cfg,parg) {
     for(;(bool)select_attr;++select_attr) select_attrs.push_back((std::string)select_attr);
     for(;(bool)reject_attr;++reject_attr) reject_attrs.push_back((std::string)reject_attr);
   };
+  unsigned int cache_size = 0;
+  XMLNode cache_size_node = (*cfg)["DecisionCacheSize"];
+  if((bool)cache_size_node) {
+    if(!Arc::stringto((std::string)cache_size_node,cache_size)) {
+      logger.msg(ERROR, "Wrong value of DecisionCacheSize: %s",(std::string)cache_size_node);
+      cache_size = 0;
+    };
+  };
+  pool = new EvaluatorPool("gacl.evaluator",cache_size);
   XMLNode policy_store = (*cfg)["PolicyStore"];
   XMLNode policy_location = policy_store["Location"];
-  for(;(bool)policy_location;++policy_location) policy_locations.push_back((std::string)policy_location);
+  for(;(bool)policy_location;++policy_location) pool->addPolicyLocation((std::string)policy_location);
   XMLNode policy_doc = policy_store["Policy"];
-  for(;(bool)policy_doc;++policy_doc) policy_docs.AddNew(policy_doc);
+  for(;(bool)policy_doc;++policy_doc) pool->addPolicy(policy_doc);
 }
 
 PDPStatus GACLPDP::isPermitted(Message *msg) const{
-  Evaluator* eval = NULL;
-
-  std::string ctxid = "arcsec.gaclpdp";
-  try {
-    Arc::MessageContextElement* mctx = (*(msg->Context()))[ctxid];
-    if(mctx) {
-      GACLPDPContext* pdpctx = dynamic_cast<GACLPDPContext*>(mctx);
-      if(pdpctx) {
-        eval=pdpctx->eval;
-      };
-    };
-  } catch(std::exception& e) { };
-  if(!eval) {
-    GACLPDPContext* pdpctx = new GACLPDPContext();
-    if(pdpctx) {
-      eval=pdpctx->eval;
-      if(eval) {
-        for(std::list<std::string>::const_iterator it = policy_locations.begin(); it!= policy_locations.end(); it++) {
-          eval->addPolicy(SourceFile(*it));
-        }
-        for(int n = 0;n<policy_docs.Size();++n) {
-          eval->addPolicy(Source(const_cast<Arc::XMLNodeContainer&>(policy_docs)[n]));
-        }
-        msg->Context()->Add(ctxid, pdpctx);
-      } else {
-        delete pdpctx;
-      }
-    }
-    if(!eval) logger.msg(ERROR, "Can not dynamically produce Evaluator");
-  }
-  if(!eval) {
-    logger.msg(ERROR,"Evaluator for GACLPDP was not loaded"); 
-    return false;
-  };
-
   MessageAuth* mauth = msg->Auth()->Filter(select_attrs,reject_attrs);
   MessageAuth* cauth = msg->AuthContext()->Filter(select_attrs,reject_attrs);
   if((!mauth) && (!cauth)) {
@@ -146,31 +99,46 @@ PDPStatus GACLPDP::isPermitted(Message *msg) const{
     };
     delete cauth;
   };
-  if(DEBUG >= logger.getThreshold()) {
-    std::string s;
-    requestxml.GetXML(s);
-    logger.msg(DEBUG,"GACL Auth. request: %s",s);
+  // Serialized request is also used as key for decision cache
+  bool use_cache = pool->cacheEnabled();
+  std::string request_str;
+  if(use_cache || logger.isEnabled(DEBUG)) {
+    requestxml.GetXML(request_str);
+    logger.msg(DEBUG,"GACL Auth. request: %s",request_str);
   };
   if(requestxml.Size() <= 0) {
     logger.msg(ERROR,"No requested security information was collected");
     return false;
   };
 
+  bool result = false;
+  if(use_cache && pool->getDecision(request_str,result)) return result;
+
+  Evaluator* eval = pool->acquire();
+  if(!eval) {
+    logger.msg(ERROR,"Evaluator for GACLPDP was not loaded"); 
+    return false;
+  };
+
   //Call the evaluation functionality inside Evaluator
   Response *resp = eval->evaluate(requestxml);
-  if(!resp) return false;
+  if(!resp) { pool->release(eval); return false; };
   ResponseList rlist = resp->getResponseItems();
 
   // Current implementation of GACL Evaluator returns only one item
   // and only PERMIT/DENY results.
-  if(rlist.size() <= 0) { delete resp; return false; };
-  ResponseItem* item = rlist[0];
-  if(item->res != DECISION_PERMIT) { delete resp; return false; };
+  if(rlist.size() > 0) {
+    ResponseItem* item = rlist[0];
+    result = (item->res == DECISION_PERMIT);
+  };
   delete resp;
-  return true;
+  if(use_cache) pool->putDecision(eval,request_str,result);
+  pool->release(eval);
+  return result;
 }
 
 GACLPDP::~GACLPDP(){
+  delete pool;
 }
 
 } // namespace ArcSec
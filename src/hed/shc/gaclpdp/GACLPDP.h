@@ -6,6 +6,7 @@
 #include <arc/security/PDP.h>
 #include <arc/loader/Loader.h>
 #include <arc/message/SecAttr.h>
+#include <arc/security/ArcPDP/EvaluatorPool.h>
 /*
 #include <stdlib.h>
 
@@ -26,8 +27,7 @@ class GACLPDP: public PDP {
  private:
   std::list<std::string> select_attrs;
   std::list<std::string> reject_attrs;
-  std::list<std::string> policy_locations;
-  Arc::XMLNodeContainer policy_docs;
+  EvaluatorPool* pool;
  protected:
   static Arc::Logger logger;
 };
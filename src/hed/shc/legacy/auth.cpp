@@ -316,6 +316,18 @@ void AuthUser::subst(std::string& str) {
   };
 }
 
+std::string AuthUser::identity(void) const {
+  std::string id = subject_;
+  for(std::vector<struct voms_t>::const_iterator v = voms_data_.begin();v!=voms_data_.end();++v) {
+    for(std::vector<voms_fqan_t>::const_iterator f = v->fqans.begin();f!=v->fqans.end();++f) {
+      std::string fqan;
+      f->str(fqan);
+      id.append(1,'\n'); id.append(fqan);
+    };
+  };
+  return id;
+}
+
 bool AuthUser::store_credentials(void) {
   if(!filename.empty()) return true;
   Arc::SecAttr* sattr = message_.Auth()->get("TLS");
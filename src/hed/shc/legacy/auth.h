@@ -126,6 +126,8 @@ class AuthUser {
   // Evaluate authentication rules
   AuthResult evaluate(const char* line);
   const char* subject(void) const { return subject_.c_str(); };
+  // Subject and VOMS attributes in form suitable for comparing users
+  std::string identity(void) const;
   const char* proxy(void) const {
     (const_cast<AuthUser*>(this))->store_credentials();
     return filename.c_str();
@@ -5,24 +5,20 @@
 #include <string>
 
 #include <arc/StringConv.h>
-#include <arc/Run.h>
-
 #include "auth.h"
+#include "pluginrunner.h"
 
 namespace ArcSHCLegacy {
 
 static Arc::Logger logger(Arc::Logger::getRootLogger(),"AuthUser");
 
 AuthResult AuthUser::match_plugin(const char* line) {
-  // plugin = timeout path [argument ...] - Run external executable or
+  // plugin = options path [argument ...] - Run external executable or
   if(!line) return AAA_NO_MATCH;
   for(;*line;line++) if(!isspace(*line)) break;
   if(*line == 0) return AAA_NO_MATCH;
-  char* p;
-  long int to = strtol(line,&p,0);
-  if(p == line) return AAA_NO_MATCH;
-  if(to < 0) return AAA_NO_MATCH;
-  line=p;
+  PluginRunner::Options options;
+  if(!options.parse(line)) return AAA_NO_MATCH;
   for(;*line;line++) if(!isspace(*line)) break;
   if(*line == 0) return AAA_NO_MATCH;
   std::list<std::string> args;
@@ -32,27 +28,26 @@ AuthResult AuthUser::match_plugin(const char* line) {
           arg != args.end();++arg) {
     subst(*arg);
   };
-  std::string stdout_str;
-  std::string stderr_str;
-  Arc::Run run(args);
-  run.AssignStdout(stdout_str);
-  run.AssignStderr(stderr_str);
-  if(run.Start()) {
-    if(run.Wait(to)) {
-      if(run.Result() == 0) {
+  // Substituted arguments may refer to per-connection files. So
+  // results are cached per command and user identity instead.
+  std::string key = std::string(line) + '\0' + identity();
+  PluginRunner::Result result;
+  PluginRunner::run(args,key,options,result);
+  if(result.started) {
+    if(result.finished) {
+      if(result.code == 0) {
         return AAA_POSITIVE_MATCH;
       } else {
-        logger.msg(Arc::ERROR,"Plugin %s returned: %u",args.front(),run.Result());
+        logger.msg(Arc::ERROR,"Plugin %s returned: %u",args.front(),result.code);
       };
     } else {
-      run.Kill(1);
-      logger.msg(Arc::ERROR,"Plugin %s timeout after %u seconds",args.front(),to);
+      logger.msg(Arc::ERROR,"Plugin %s timeout after %u seconds",args.front(),options.timeout);
     };
   } else {
     logger.msg(Arc::ERROR,"Plugin %s failed to start",args.front());
   };
-  if(!stdout_str.empty()) logger.msg(Arc::INFO,"Plugin %s printed: %s",args.front(),stdout_str);
-  if(!stderr_str.empty()) logger.msg(Arc::ERROR,"Plugin %s error: %s",args.front(),stderr_str);
+  if(!result.out.empty()) logger.msg(Arc::INFO,"Plugin %s printed: %s",args.front(),result.out);
+  if(!result.err.empty()) logger.msg(Arc::ERROR,"Plugin %s error: %s",args.front(),result.err);
   return AAA_NO_MATCH; // ??
 }
 
@@ -0,0 +1,284 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "pluginrunner.h"
+
+namespace ArcSHCLegacy {
+
+static Arc::Logger logger(Arc::Logger::getRootLogger(),"PluginRunner");
+
+#define PLUGIN_CACHE_MAX (1024)
+
+// Maximal length of reply from persistent plugin
+#define PLUGIN_REPLY_MAX (4096)
+
+Glib::Mutex PluginRunner::cache_lock_;
+std::map<std::string,PluginRunner::CacheEntry> PluginRunner::cache_;
+Glib::Mutex PluginRunner::helpers_lock_;
+std::map<std::string,PluginRunner::Helper*> PluginRunner::helpers_;
+
+// Persistent plugin process. Requests are serialized through acquire()
+// and release().
+class PluginRunner::Helper {
+ public:
+  Arc::Run* run;
+  Helper(void):run(NULL),busy_(false) { };
+  ~Helper(void) { stop(); };
+  bool acquire(const Arc::Time& deadline);
+  void release(void);
+  bool start(const std::string& path);
+  void stop(void);
+  bool write(const std::string& str, const Arc::Time& deadline);
+  bool readline(std::string& str, const Arc::Time& deadline);
+ private:
+  Glib::Mutex lock_;
+  Glib::Cond cond_;
+  bool busy_;
+};
+
+// Stops persistent plugins when module is unloaded
+static class PluginRunnerCleaner {
+ public:
+  ~PluginRunnerCleaner(void) { PluginRunner::stop(); };
+} cleaner;
+
+static int time_left(const Arc::Time& deadline) {
+  Arc::Period left = deadline - Arc::Time();
+  int l = left.GetPeriod()*1000 + left.GetPeriodNanoseconds()/1000000;
+  return (l < 0) ? 0 : l;
+}
+
+bool PluginRunner::Helper::acquire(const Arc::Time& deadline) {
+  Glib::TimeVal etime(deadline.GetTime(), deadline.GetTimeNanoseconds()/1000);
+  Glib::Mutex::Lock lock(lock_);
+  while(busy_) {
+    if(!cond_.timed_wait(lock_, etime)) return false;
+  };
+  busy_ = true;
+  return true;
+}
+
+void PluginRunner::Helper::release(void) {
+  Glib::Mutex::Lock lock(lock_);
+  busy_ = false;
+  cond_.signal();
+}
+
+bool PluginRunner::Helper::start(const std::string& path) {
+  stop();
+  std::list<std::string> argv;
+  argv.push_back(path);
+  run = new Arc::Run(argv);
+  run->KeepStdin(false);
+  run->KeepStdout(false);
+  run->KeepStderr(true);
+  if(!(run->Start())) {
+    delete run;
+    run = NULL;
+    return false;
+  };
+  return true;
+}
+
+void PluginRunner::Helper::stop(void) {
+  if(!run) return;
+  run->CloseStdin();
+  run->Kill(1);
+  delete run;
+  run = NULL;
+}
+
+bool PluginRunner::Helper::write(const std::string& str, const Arc::Time& deadline) {
+  const char* buf = str.c_str();
+  int size = str.length();
+  while(size > 0) {
+    int l = run->WriteStdin(time_left(deadline),buf,size);
+    if(l <= 0) return false;
+    buf += l; size -= l;
+  };
+  return true;
+}
+
+bool PluginRunner::Helper::readline(std::string& str, const Arc::Time& deadline) {
+  str.clear();
+  for(;;) {
+    char c;
+    if(run->ReadStdout(time_left(deadline),&c,1) != 1) return false;
+    if(c == '\n') break;
+    if(str.length() >= PLUGIN_REPLY_MAX) return false;
+    str += c;
+  };
+  return true;
+}
+
+bool PluginRunner::Options::parse(const char*& line) {
+  char* p;
+  timeout = strtol(line,&p,0);
+  if(p == line) {
+    // Also accept timeout=... form
+    if(strncmp(line,"timeout=",8) != 0) return false;
+    line += 8;
+    timeout = strtol(line,&p,0);
+    if(p == line) return false;
+  };
+  if(timeout < 0) return false;
+  line = p;
+  while(*line == ',') {
+    ++line;
+    const char* end = line;
+    for(;*end;++end) if((*end == ',') || isspace(*end)) break;
+    std::string option(line,end-line);
+    line = end;
+    std::string::size_type pos = option.find('=');
+    std::string key = option.substr(0,pos);
+    std::string value = (pos == std::string::npos) ? "" : option.substr(pos+1);
+    if(key == "cache") {
+      if(!Arc::stringto(value,cache) || (cache < 0)) return false;
+    } else if(key == "negcache") {
+      if(!Arc::stringto(value,negcache) || (negcache < 0)) return false;
+    } else if(key == "persistent") {
+      if(value.empty() || (value == "yes")) persistent = true;
+      else if(value == "no") persistent = false;
+      else return false;
+    } else {
+      logger.msg(Arc::ERROR,"Unknown plugin option: %s",key);
+      return false;
+    };
+  };
+  if((*line != 0) && !isspace(*line)) return false;
+  return true;
+}
+
+void PluginRunner::run(const std::list<std::string>& args, const std::string& key, const Options& options, Result& result) {
+  result = Result();
+  if(args.empty()) return;
+  bool cached = !key.empty() && ((options.cache > 0) || (options.negcache > 0));
+  if(cached) {
+    Glib::Mutex::Lock lock(cache_lock_);
+    std::map<std::string,CacheEntry>::iterator entry = cache_.find(key);
+    if(entry != cache_.end()) {
+      if(entry->second.expires > time(NULL)) {
+        logger.msg(Arc::DEBUG,"Plugin %s: using cached result %i",args.front(),entry->second.result.code);
+        result = entry->second.result;
+        return;
+      };
+      cache_.erase(entry);
+    };
+  };
+  if(options.persistent) {
+    run_persistent(args,options,result);
+  } else {
+    run_once(args,options,result);
+  };
+  if(!cached || !result.finished) return;
+  int ttl = (result.code == 0) ? options.cache : options.negcache;
+  if(ttl <= 0) return;
+  time_t now = time(NULL);
+  Glib::Mutex::Lock lock(cache_lock_);
+  if(cache_.size() >= PLUGIN_CACHE_MAX) {
+    for(std::map<std::string,CacheEntry>::iterator entry = cache_.begin(); entry != cache_.end();) {
+      if(entry->second.expires <= now) {
+        cache_.erase(entry++);
+      } else {
+        ++entry;
+      };
+    };
+    if(cache_.size() >= PLUGIN_CACHE_MAX) cache_.clear();
+  };
+  CacheEntry& entry = cache_[key];
+  entry.expires = now + ttl;
+  entry.result = result;
+}
+
+void PluginRunner::stop(void) {
+  Glib::Mutex::Lock lock(helpers_lock_);
+  for(std::map<std::string,Helper*>::iterator h = helpers_.begin(); h != helpers_.end(); ++h) {
+    delete h->second;
+  };
+  helpers_.clear();
+}
+
+void PluginRunner::run_once(const std::list<std::string>& args, const Options& options, Result& result) {
+  Arc::Run run(args);
+  run.AssignStdout(result.out);
+  run.AssignStderr(result.err);
+  if(!run.Start()) return;
+  result.started = true;
+  if(!run.Wait(options.timeout)) {
+    run.Kill(1);
+    return;
+  };
+  result.finished = true;
+  result.code = run.Result();
+}
+
+void PluginRunner::run_persistent(const std::list<std::string>& args, const Options& options, Result& result) {
+  const std::string& path = args.front();
+  // Time spent waiting for other requests counts against timeout too
+  Arc::Time deadline = Arc::Time() + Arc::Period(options.timeout);
+  Helper* helper = NULL;
+  {
+    Glib::Mutex::Lock lock(helpers_lock_);
+    std::map<std::string,Helper*>::iterator h = helpers_.find(path);
+    if(h == helpers_.end()) h = helpers_.insert(std::pair<std::string,Helper*>(path,new Helper)).first;
+    helper = h->second;
+  };
+  std::string request;
+  std::list<std::string>::const_iterator arg = args.begin();
+  for(++arg; arg != args.end(); ++arg) {
+    if(!request.empty()) request += " ";
+    request += Arc::uri_encode(*arg,true);
+  };
+  request += "\n";
+  if(!helper->acquire(deadline)) {
+    // Reported as timeout
+    result.started = true;
+    return;
+  };
+  run_request(*helper,path,request,deadline,result);
+  helper->release();
+}
+
+void PluginRunner::run_request(Helper& helper, const std::string& path, const std::string& request, const Arc::Time& deadline, Result& result) {
+  // If helper exited since previous request try once more with new instance
+  for(int attempt = 0; attempt < 2; ++attempt) {
+    bool restarted = false;
+    if(!(helper.run) || !(helper.run->Running())) {
+      if(!helper.start(path)) return;
+      logger.msg(Arc::VERBOSE,"Started persistent plugin %s",path);
+      restarted = true;
+    };
+    result.started = true;
+    std::string reply;
+    if(!helper.write(request,deadline)) {
+      helper.stop();
+      if(restarted) return;
+      continue;
+    };
+    if(!helper.readline(reply,deadline)) {
+      // Reply is lost or late - state of helper is unknown
+      helper.stop();
+      return;
+    };
+    std::string::size_type pos = reply.find(' ');
+    if(!Arc::stringto(reply.substr(0,pos),result.code)) {
+      logger.msg(Arc::ERROR,"Plugin %s sent malformed reply: %s",path,reply);
+      helper.stop();
+      return;
+    };
+    if(pos != std::string::npos) result.out = Arc::uri_unencode(reply.substr(pos+1));
+    result.finished = true;
+    return;
+  };
+}
+
+} // namespace ArcSHCLegacy
+
@@ -0,0 +1,68 @@
+#include <string>
+#include <list>
+#include <map>
+
+#include <glibmm/thread.h>
+
+#include <arc/DateTime.h>
+#include <arc/Run.h>
+
+namespace ArcSHCLegacy {
+
+// Runs external plugins for authorization and mapping rules.
+// Plugin options are specified in configuration in place of timeout as
+//   timeout[,cache=seconds][,negcache=seconds][,persistent]
+// Results of plugin with cache/negcache set are remembered for specified
+// time keyed by command line before substitutions and identity of user.
+// Exit code 0 is considered positive result, any other exit code -
+// negative. Timeouts and failures to run plugin are never cached.
+// Persistent plugin is started once and then receives requests through
+// stdin. Each request is one line of space separated arguments (excluding
+// executable itself) with every argument URI-encoded. Plugin must reply
+// with one line consisting of exit code optionally followed by space and
+// URI-encoded output.
+class PluginRunner {
+ public:
+  class Options {
+   public:
+    long int timeout;
+    int cache;
+    int negcache;
+    bool persistent;
+    Options(void):timeout(0),cache(0),negcache(0),persistent(false) { };
+    // Parses options at beginning of line and advances line past them.
+    // Returns false if options are malformed.
+    bool parse(const char*& line);
+  };
+  class Result {
+   public:
+    bool started;  // plugin was started
+    bool finished; // plugin finished in time
+    int code;      // exit code of plugin
+    std::string out;
+    std::string err;
+    Result(void):started(false),finished(false),code(-1) { };
+  };
+  // Runs plugin specified by args (with substitutions already applied).
+  // Result is cached under key unless key is empty.
+  static void run(const std::list<std::string>& args, const std::string& key, const Options& options, Result& result);
+  // Stops all persistent plugins.
+  static void stop(void);
+ private:
+  class Helper;
+  class CacheEntry {
+   public:
+    time_t expires;
+    Result result;
+  };
+  static Glib::Mutex cache_lock_;
+  static std::map<std::string,CacheEntry> cache_;
+  static Glib::Mutex helpers_lock_;
+  static std::map<std::string,Helper*> helpers_;
+  static void run_once(const std::list<std::string>& args, const Options& options, Result& result);
+  static void run_persistent(const std::list<std::string>& args, const Options& options, Result& result);
+  static void run_request(Helper& helper, const std::string& path, const std::string& request, const Arc::Time& deadline, Result& result);
+};
+
+} // namespace ArcSHCLegacy
+
@@ -0,0 +1,186 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fstream>
+#include <list>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <glibmm/miscutils.h>
+
+#include <arc/FileUtils.h>
+
+#include "../pluginrunner.h"
+
+using namespace ArcSHCLegacy;
+
+class PluginRunnerTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PluginRunnerTest);
+  CPPUNIT_TEST(TestOptions);
+  CPPUNIT_TEST(TestCache);
+  CPPUNIT_TEST(TestTimeout);
+  CPPUNIT_TEST(TestPersistent);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestOptions();
+  void TestCache();
+  void TestTimeout();
+  void TestPersistent();
+
+private:
+  std::string dir;
+  std::string script(const std::string& name, const std::string& body);
+  int calls(void);
+};
+
+void PluginRunnerTest::setUp() {
+  dir = Glib::get_current_dir() + "/pluginrunner.test";
+  Arc::DirDelete(dir);
+  CPPUNIT_ASSERT(Arc::DirCreate(dir, 0700, true));
+}
+
+void PluginRunnerTest::tearDown() {
+  PluginRunner::stop();
+  Arc::DirDelete(dir);
+}
+
+std::string PluginRunnerTest::script(const std::string& name, const std::string& body) {
+  std::string path = dir + "/" + name;
+  std::ofstream f(path.c_str());
+  f << "#!/bin/sh" << std::endl << body << std::endl;
+  f.close();
+  CPPUNIT_ASSERT_EQUAL(0, ::chmod(path.c_str(), S_IRWXU));
+  return path;
+}
+
+// Number of times plugin was executed
+int PluginRunnerTest::calls(void) {
+  std::ifstream f((dir + "/calls").c_str());
+  int n = 0;
+  std::string line;
+  while (std::getline(f, line)) ++n;
+  return n;
+}
+
+void PluginRunnerTest::TestOptions() {
+  PluginRunner::Options options;
+  const char* line = "30,cache=600,negcache=60,persistent /bin/true";
+  CPPUNIT_ASSERT(options.parse(line));
+  CPPUNIT_ASSERT_EQUAL(30L, options.timeout);
+  CPPUNIT_ASSERT_EQUAL(600, options.cache);
+  CPPUNIT_ASSERT_EQUAL(60, options.negcache);
+  CPPUNIT_ASSERT(options.persistent);
+  CPPUNIT_ASSERT_EQUAL(std::string(" /bin/true"), std::string(line));
+
+  PluginRunner::Options defaults;
+  line = "timeout=10 /bin/true";
+  CPPUNIT_ASSERT(defaults.parse(line));
+  CPPUNIT_ASSERT_EQUAL(10L, defaults.timeout);
+  CPPUNIT_ASSERT_EQUAL(0, defaults.cache);
+  CPPUNIT_ASSERT_EQUAL(0, defaults.negcache);
+  CPPUNIT_ASSERT(!defaults.persistent);
+
+  line = "/bin/true";
+  CPPUNIT_ASSERT(!PluginRunner::Options().parse(line));
+  line = "10,unknown=1 /bin/true";
+  CPPUNIT_ASSERT(!PluginRunner::Options().parse(line));
+  line = "10,cache=-1 /bin/true";
+  CPPUNIT_ASSERT(!PluginRunner::Options().parse(line));
+}
+
+void PluginRunnerTest::TestCache() {
+  std::list<std::string> args;
+  args.push_back(script("plugin", "echo $1 >> " + dir + "/calls\nexit $2"));
+  args.push_back("/tmp/x509up_1");
+  args.push_back("0");
+  PluginRunner::Options options;
+  options.timeout = 10;
+  options.cache = 600;
+  PluginRunner::Result result;
+
+  PluginRunner::run(args, "plugin user1", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(0, result.code);
+  CPPUNIT_ASSERT_EQUAL(1, calls());
+
+  // Arguments changed by substitution do not affect cache
+  args.back() = "1";
+  PluginRunner::run(args, "plugin user1", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(0, result.code);
+  CPPUNIT_ASSERT_EQUAL(1, calls());
+
+  // Other user
+  PluginRunner::run(args, "plugin user2", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(1, result.code);
+  CPPUNIT_ASSERT_EQUAL(2, calls());
+
+  // Negative results are not cached by default
+  PluginRunner::run(args, "plugin user2", options, result);
+  CPPUNIT_ASSERT_EQUAL(3, calls());
+
+  // Empty key disables cache
+  args.back() = "0";
+  PluginRunner::run(args, "", options, result);
+  PluginRunner::run(args, "", options, result);
+  CPPUNIT_ASSERT_EQUAL(0, result.code);
+  CPPUNIT_ASSERT_EQUAL(5, calls());
+}
+
+void PluginRunnerTest::TestTimeout() {
+  std::list<std::string> args;
+  args.push_back(script("slow", "echo >> " + dir + "/calls\nsleep 10"));
+  PluginRunner::Options options;
+  options.timeout = 1;
+  options.cache = 600;
+  options.negcache = 600;
+  PluginRunner::Result result;
+  PluginRunner::run(args, "slow", options, result);
+  CPPUNIT_ASSERT(result.started);
+  CPPUNIT_ASSERT(!result.finished);
+  // Timeouts are not cached
+  PluginRunner::run(args, "slow", options, result);
+  CPPUNIT_ASSERT(!result.finished);
+  CPPUNIT_ASSERT_EQUAL(2, calls());
+}
+
+void PluginRunnerTest::TestPersistent() {
+  std::list<std::string> args;
+  args.push_back(script("helper", "echo >> " + dir + "/calls\n"
+                                  "while read code out; do echo \"$code $out\"; done"));
+  args.push_back("1");
+  args.push_back("user name");
+  PluginRunner::Options options;
+  options.timeout = 10;
+  options.persistent = true;
+  PluginRunner::Result result;
+
+  PluginRunner::run(args, "", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(1, result.code);
+  CPPUNIT_ASSERT_EQUAL(std::string("user name"), result.out);
+
+  *(++args.begin()) = "0";
+  PluginRunner::run(args, "", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(0, result.code);
+  // Same process served both requests
+  CPPUNIT_ASSERT_EQUAL(1, calls());
+
+  // Stopped helper is started again
+  PluginRunner::stop();
+  PluginRunner::run(args, "", options, result);
+  CPPUNIT_ASSERT(result.finished);
+  CPPUNIT_ASSERT_EQUAL(2, calls());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PluginRunnerTest);
@@ -7,11 +7,11 @@
 
 #include <arc/Logger.h>
 #include <arc/StringConv.h>
-#include <arc/Run.h>
 
 #include "simplemap.h"
 
 #include "unixmap.h"
+#include "pluginrunner.h"
 
 namespace ArcSHCLegacy {
 
@@ -151,7 +151,7 @@ AuthResult UnixMap::mapgroup(const char* rule, const char* line) {
 // -----------------------------------------------------------
 
 AuthResult UnixMap::map_mapplugin(const AuthUser& /* user */ ,unix_user_t& unix_user,const char* line) {
-  // ... timeout path arg ...
+  // ... options path arg ...
   if(!line) {
     logger.msg(Arc::ERROR,"Plugin (user mapping) command is empty");
     return AAA_FAILURE;
@@ -161,17 +161,11 @@ AuthResult UnixMap::map_mapplugin(const AuthUser& /* user */ ,unix_user_t& unix_
     logger.msg(Arc::ERROR,"Plugin (user mapping) command is empty");
     return AAA_FAILURE;
   };
-  char* p;
-  long int to = strtol(line,&p,0);
-  if(p == line) {
-    logger.msg(Arc::ERROR,"Plugin (user mapping) timeout is not a number: %s", line);
+  PluginRunner::Options options;
+  if(!options.parse(line)) {
+    logger.msg(Arc::ERROR,"Plugin (user mapping) options are wrong: %s", line);
     return AAA_FAILURE;
   };
-  if(to < 0) {
-    logger.msg(Arc::ERROR,"Plugin (user mapping) timeout is wrong number: %s", line);
-    return AAA_FAILURE;
-  };
-  line=p;
   skip_spaces(line);
   if(*line == 0) {
     logger.msg(Arc::ERROR,"Plugin (user mapping) command is empty");
@@ -187,14 +181,16 @@ AuthResult UnixMap::map_mapplugin(const AuthUser& /* user */ ,unix_user_t& unix_
           arg != args.end();++arg) {
     user_.subst(*arg);
   };
-  std::string stdout_channel;
-  std::string stderr_channel;
-  Arc::Run run(args);
-  run.AssignStdout(stdout_channel);
-  run.AssignStderr(stderr_channel);
-  if(run.Start()) {
-    if(run.Wait(to)) {
-      if(run.Result() == 0) {
+  // Substituted arguments may refer to per-connection files. So
+  // results are cached per command and user identity instead.
+  std::string key = std::string(line) + '\0' + user_.identity();
+  PluginRunner::Result result;
+  PluginRunner::run(args,key,options,result);
+  const std::string& stdout_channel = result.out;
+  const std::string& stderr_channel = result.err;
+  if(result.started) {
+    if(result.finished) {
+      if(result.code == 0) {
         if(stdout_channel.length() <= 512) { // sane name
           // Plugin should print user[:group] at stdout or nothing if no suitable mapping found
           unix_user.name = stdout_channel;
@@ -207,16 +203,15 @@ AuthResult UnixMap::map_mapplugin(const AuthUser& /* user */ ,unix_user_t& unix_
         } else {
           logger.msg(Arc::ERROR,"Plugin %s returned too much: %s",args.front(),stdout_channel);
         };
-      } else if(run.Result() == 1) {
+      } else if(result.code == 1) {
         logger.msg(Arc::ERROR,"Plugin %s returned no mapping",args.front());
         if(!stderr_channel.empty()) logger.msg(Arc::ERROR,"Plugin %s error: %s",args.front(),stderr_channel);
         return AAA_NO_MATCH;
       } else {
-        logger.msg(Arc::ERROR,"Plugin %s returned: %u",args.front(),run.Result());
+        logger.msg(Arc::ERROR,"Plugin %s returned: %u",args.front(),result.code);
       };
     } else {
-      run.Kill(1);
-      logger.msg(Arc::ERROR,"Plugin %s timeout after %u seconds",args.front(),to);
+      logger.msg(Arc::ERROR,"Plugin %s timeout after %u seconds",args.front(),options.timeout);
     };
   } else {
     logger.msg(Arc::ERROR,"Plugin %s failed to start",args.front());
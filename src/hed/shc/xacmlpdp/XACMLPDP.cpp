@@ -12,6 +12,7 @@
 #include <arc/Logger.h>
 #include <arc/security/ArcPDP/Response.h>
 #include <arc/security/ArcPDP/attr/AttributeValue.h>
+#include <arc/StringConv.h>
 #include <arc/security/ArcPDP/EvaluatorLoader.h>
 
 #include "XACMLPDP.h"
@@ -29,30 +30,6 @@ Plugin* XACMLPDP::get_xacml_pdp(PluginArgument* arg) {
     return new XACMLPDP((Arc::Config*)(*pdparg),arg);
 }
 
-// This class is used to store Evaluator per connection
-class XACMLPDPContext:public Arc::MessageContextElement {
- friend class XACMLPDP;
- private:
-  Evaluator* eval;
- public:
-  XACMLPDPContext(Evaluator* e);
-  XACMLPDPContext(void);
-  virtual ~XACMLPDPContext(void);
-};
-
-XACMLPDPContext::~XACMLPDPContext(void) {
-  if(eval) delete eval;
-}
-
-XACMLPDPContext::XACMLPDPContext(Evaluator* e):eval(e) {
-}
-
-XACMLPDPContext::XACMLPDPContext(void):eval(NULL) {
-  std::string evaluator = "xacml.evaluator"; 
-  EvaluatorLoader eval_loader;
-  eval = eval_loader.getEvaluator(evaluator);
-}
-
 XACMLPDP::XACMLPDP(Config* cfg, Arc::PluginArgument* parg):PDP(cfg,parg) /*, eval(NULL)*/ {
   XMLNode pdp_node(*cfg);
 
@@ -63,80 +40,27 @@ XACMLPDP::XACMLPDP(Config* cfg, Arc::PluginArgument* parg):PDP(cfg,parg) /*, eva
     for(;(bool)select_attr;++select_attr) select_attrs.push_back((std::string)select_attr);
     for(;(bool)reject_attr;++reject_attr) reject_attrs.push_back((std::string)reject_attr);
   };
+  unsigned int cache_size = 0;
+  XMLNode cache_size_node = (*cfg)["DecisionCacheSize"];
+  if((bool)cache_size_node) {
+    if(!Arc::stringto((std::string)cache_size_node,cache_size)) {
+      logger.msg(ERROR, "Wrong value of DecisionCacheSize: %s",(std::string)cache_size_node);
+      cache_size = 0;
+    };
+  };
+  pool = new EvaluatorPool("xacml.evaluator",cache_size);
   XMLNode policy_store = (*cfg)["PolicyStore"];
   XMLNode policy_location = policy_store["Location"];
-  for(;(bool)policy_location;++policy_location) policy_locations.push_back((std::string)policy_location);
+  for(;(bool)policy_location;++policy_location) pool->addPolicyLocation((std::string)policy_location);
   XMLNode policy = (*cfg)["Policy"];
-  for(;(bool)policy;++policy) policies.AddNew(policy);
-  policy_combining_alg = (std::string)((*cfg)["PolicyCombiningAlg"]);
+  for(;(bool)policy;++policy) pool->addPolicy(policy);
+  pool->setCombiningAlg((std::string)((*cfg)["PolicyCombiningAlg"]));
 }
 
 PDPStatus XACMLPDP::isPermitted(Message *msg) const {
   //Compose Request based on the information inside message, the Request will be
   //compatible to xacml request schema
 
-  Evaluator* eval = NULL;
-
-  const std::string ctxid = "arcsec.xacmlpdp";
-  try {
-    Arc::MessageContextElement* mctx = (*(msg->Context()))[ctxid];
-    if(mctx) {
-      XACMLPDPContext* pdpctx = dynamic_cast<XACMLPDPContext*>(mctx);
-      if(pdpctx) {
-        eval=pdpctx->eval;
-      }
-      else { logger.msg(INFO, "Can not find XACMLPDPContext"); }
-    };
-  } catch(std::exception& e) { };
-  if(!eval) {
-    XACMLPDPContext* pdpctx = new XACMLPDPContext();
-    if(pdpctx) {
-      eval=pdpctx->eval;
-      if(eval) {
-        //for(Arc::AttributeIterator it = (msg->Attributes())->getAll("PDP:POLICYLOCATION"); it.hasMore(); it++) {
-        //  eval->addPolicy(SourceFile(*it));
-        //}
-        for(std::list<std::string>::const_iterator it = policy_locations.begin(); it!= policy_locations.end(); it++) {
-          eval->addPolicy(SourceFile(*it));
-        }
-        for(int n = 0;n<policies.Size();++n) {
-          eval->addPolicy(Source(const_cast<Arc::XMLNodeContainer&>(policies)[n]));
-        }
-        if(!policy_combining_alg.empty()) {
-          if(policy_combining_alg == "EvaluatorFailsOnDeny") {
-            eval->setCombiningAlg(EvaluatorFailsOnDeny);
-          } else if(policy_combining_alg == "EvaluatorStopsOnDeny") {
-            eval->setCombiningAlg(EvaluatorStopsOnDeny);
-          } else if(policy_combining_alg == "EvaluatorStopsOnPermit") {
-            eval->setCombiningAlg(EvaluatorStopsOnPermit);
-          } else if(policy_combining_alg == "EvaluatorStopsNever") {
-            eval->setCombiningAlg(EvaluatorStopsNever);
-          } else {
-            AlgFactory* factory = eval->getAlgFactory();
-            if(!factory) {
-              logger.msg(WARNING, "Evaluator does not support loadable Combining Algorithms");
-            } else {
-              CombiningAlg* algorithm = factory->createAlg(policy_combining_alg);
-              if(!algorithm) {
-                logger.msg(ERROR, "Evaluator does not support specified Combining Algorithm - %s",policy_combining_alg);
-              } else {
-                eval->setCombiningAlg(algorithm);
-              };
-            };
-          };
-        };
-        msg->Context()->Add(ctxid, pdpctx);
-      } else {
-        delete pdpctx;
-      }
-    }
-    if(!eval) logger.msg(ERROR, "Can not dynamically produce Evaluator");
-  }
-  if(!eval) {
-    logger.msg(ERROR,"Evaluator for XACMLPDP was not loaded"); 
-    return false;
-  };
-
   MessageAuth* mauth = msg->Auth()->Filter(select_attrs,reject_attrs);
   MessageAuth* cauth = msg->AuthContext()->Filter(select_attrs,reject_attrs);
   if((!mauth) && (!cauth)) {
@@ -161,30 +85,48 @@ PDPStatus XACMLPDP::isPermitted(Message *msg) const {
     };
     delete cauth;
   };
-  {
-    std::string s;
-    requestxml.GetXML(s);
-    logger.msg(DEBUG,"XACML request: %s",s);
-  };
+  // Serialized request is also used as key for decision cache
+  std::string request_str;
+  requestxml.GetXML(request_str);
+  logger.msg(DEBUG,"XACML request: %s",request_str);
   if(requestxml.Size() <= 0) {
     logger.msg(ERROR,"No requested security information was collected");
     return false;
   };
 
+  bool result = false;
+  if(pool->getDecision(request_str,result)) {
+    if(result) logger.msg(INFO, "Authorized from xacml.pdp (cached decision)");
+    else logger.msg(ERROR, "UnAuthorized from xacml.pdp (cached decision)");
+    return result;
+  };
+
+  Evaluator* eval = pool->acquire();
+  if(!eval) {
+    logger.msg(ERROR,"Evaluator for XACMLPDP was not loaded"); 
+    return false;
+  };
+
   //Call the evaluation functionality inside Evaluator
   Response *resp = eval->evaluate(requestxml);
+  if(!resp) {
+    pool->release(eval);
+    logger.msg(ERROR, "UnAuthorized from xacml.pdp");
+    return false;
+  };
   ArcSec::ResponseList rlist = resp->getResponseItems();
-  std::cout<<rlist[0]->res<<std::endl;
-  bool result = false;
-  if(rlist[0]->res == DECISION_PERMIT) { logger.msg(INFO, "Authorized from xacml.pdp"); result = true; }
+  if((rlist.size() > 0) && (rlist[0]->res == DECISION_PERMIT)) { logger.msg(INFO, "Authorized from xacml.pdp"); result = true; }
   else logger.msg(ERROR, "UnAuthorized from xacml.pdp");
   
-  if(resp) delete resp;
+  delete resp;
+  pool->putDecision(eval,request_str,result);
+  pool->release(eval);
     
   return result;
 }
 
 XACMLPDP::~XACMLPDP(){
+  delete pool;
 }
 
 } // namespace ArcSec
@@ -6,6 +6,7 @@
 //#include <arc/loader/ClassLoader.h>
 #include <arc/ArcConfig.h>
 #include <arc/security/ArcPDP/Evaluator.h>
+#include <arc/security/ArcPDP/EvaluatorPool.h>
 #include <arc/security/PDP.h>
 
 namespace ArcSec {
@@ -23,9 +24,7 @@ class XACMLPDP : public PDP {
   // Arc::ClassLoader* classloader;
   std::list<std::string> select_attrs;
   std::list<std::string> reject_attrs;
-  std::list<std::string> policy_locations;
-  Arc::XMLNodeContainer policies;
-  std::string policy_combining_alg;
+  EvaluatorPool* pool;
  protected:
   static Arc::Logger logger;
 };
@@ -17,13 +17,14 @@ namespace DataStaging {
     DataDeliveryComm* comm;
     bool cancelled;
     Arc::SimpleCounter thread_count;
-    delivery_pair_t(DTR_ptr request, const TransferParameters& params);
+    Arc::SimpleCondition* wakeup;
+    delivery_pair_t(DTR_ptr request, const TransferParameters& params, Arc::SimpleCondition* wakeup);
     ~delivery_pair_t();
     void start();
   };
 
-  DataDelivery::delivery_pair_t::delivery_pair_t(DTR_ptr request, const TransferParameters& params)
-    :dtr(request),params(params),comm(NULL),cancelled(false) {}
+  DataDelivery::delivery_pair_t::delivery_pair_t(DTR_ptr request, const TransferParameters& params, Arc::SimpleCondition* wakeup)
+    :dtr(request),params(params),comm(NULL),cancelled(false),wakeup(wakeup) {}
 
   DataDelivery::delivery_pair_t::~delivery_pair_t() {
     if (comm) delete comm;
@@ -31,6 +32,7 @@ namespace DataStaging {
 
   void DataDelivery::delivery_pair_t::start() {
     comm = DataDeliveryComm::CreateInstance(dtr, params);
+    if (comm) comm->SetWakeUp(wakeup);
   }
 
   DataDelivery::DataDelivery(): delivery_state(INITIATED) {
@@ -55,7 +57,7 @@ namespace DataStaging {
                dtr->get_id(), dtr->get_source()->CurrentLocation().str(), dtr->get_destination()->CurrentLocation().str());
 
     dtr->set_status(DTRStatus::TRANSFERRING);
-    delivery_pair_t* d = new delivery_pair_t(dtr, transfer_params);
+    delivery_pair_t* d = new delivery_pair_t(dtr, transfer_params, &cond);
     dtr_list_lock.lock();
     dtr_list.push_back(d);
     dtr_list_lock.unlock();
@@ -224,7 +226,13 @@ namespace DataStaging {
           }
           continue;
         }
-        // ongoing transfer - get status
+        // ongoing transfer - nothing to do if status did not change
+        if (!dp->comm->Updated()) {
+          dtr_list_lock.lock();
+          ++d;
+          dtr_list_lock.unlock();
+          continue;
+        }
         DataDeliveryComm::Status status;
         status = dp->comm->GetStatus();
         dp->dtr->set_bytes_transferred(status.transferred);
@@ -312,8 +320,9 @@ namespace DataStaging {
         dtr_list_lock.unlock();
       }
       	
-      // Go through main loop every half a second or when new transfer arrives
-      cond.wait(100);
+      // Go through main loop every second to collect progress or
+      // immediately when new transfer arrives or some transfer finishes
+      cond.wait(1000);
     }
     // Kill any transfers still running
     dtr_list_lock.lock();
@@ -2,10 +2,25 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#include <glibmm/timeval.h>
+
 #include "DataDeliveryComm.h"
 #include "DataDeliveryRemoteComm.h"
 #include "DataDeliveryLocalComm.h"
 
+// Period for polling objects without watched handles (ms)
+#define DELIVERY_POLL_PERIOD (500)
+// Period for checking objects with watched handles (ms)
+#define DELIVERY_CHECK_PERIOD (10000)
+// Minimal period between processing of reports, to coalesce progress updates (ms)
+#define DELIVERY_MIN_PERIOD (100)
+// Number of handle events processed at once
+#define DELIVERY_MAX_EVENTS (256)
+
 namespace DataStaging {
 
   DataDeliveryComm* DataDeliveryComm::CreateInstance(DTR_ptr dtr, const TransferParameters& params) {
@@ -15,7 +30,7 @@ namespace DataStaging {
   }
 
   DataDeliveryComm::DataDeliveryComm(DTR_ptr dtr, const TransferParameters& params)
-    : status_pos_(0),transfer_params(params),logger_(dtr->get_logger()) {
+    : status_pos_(0),updated_(true),wakeup_(NULL),transfer_params(params),logger_(dtr->get_logger()) {
     handler_= DataDeliveryCommHandler::getInstance();
   }
 
@@ -25,14 +40,39 @@ namespace DataStaging {
     return tmp;
   }
 
+  bool DataDeliveryComm::Updated(void) {
+    Glib::Mutex::Lock lock(lock_);
+    bool updated = updated_;
+    updated_ = false;
+    return updated;
+  }
+
+  void DataDeliveryComm::SetWakeUp(Arc::SimpleCondition* cond) {
+    Glib::Mutex::Lock lock(lock_);
+    wakeup_ = cond;
+  }
+
+  void DataDeliveryComm::PullAndNotify(void) {
+    PullStatus();
+    Glib::Mutex::Lock lock(lock_);
+    if(!wakeup_ || !updated_) return;
+    // Progress is collected by owner at its own pace, only end of
+    // transfer needs immediate attention
+    if((status_.commstatus == CommExited) || (status_.commstatus == CommClosed) ||
+       (status_.commstatus == CommFailed) || !(*this)) wakeup_->signal();
+  }
+
   bool DataDeliveryComm::CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg) {
     if (!dtr->get_delivery_endpoint() || dtr->get_delivery_endpoint() == DTR::LOCAL_DELIVERY)
       return DataDeliveryLocalComm::CheckComm(dtr, allowed_dirs, load_avg);
     return DataDeliveryRemoteComm::CheckComm(dtr, allowed_dirs, load_avg);
   }
 
-  DataDeliveryCommHandler::DataDeliveryCommHandler(void) {
+  DataDeliveryCommHandler::DataDeliveryCommHandler(void): epoll_(-1) {
     Glib::Mutex::Lock lock(lock_);
+#ifdef HAVE_SYS_EPOLL_H
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+#endif
     Arc::CreateThreadFunction(&func,this);
   }
 
@@ -41,6 +81,22 @@ namespace DataStaging {
     items_.push_back(item);
   }
 
+  void DataDeliveryCommHandler::Watch(DataDeliveryComm* item, int handle) {
+    if(handle == -1) return;
+#ifdef HAVE_SYS_EPOLL_H
+    Glib::Mutex::Lock lock(lock_);
+    if(epoll_ == -1) return;
+    // One-shot handles are re-armed after status is pulled. That way
+    // handles left open by exited transfer can't keep waking us up.
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = handle;
+    if(::epoll_ctl(epoll_, EPOLL_CTL_ADD, handle, &event) != 0) return;
+    handles_[handle] = item;
+    watched_.insert(item);
+#endif
+  }
+
   void DataDeliveryCommHandler::Remove(DataDeliveryComm* item) {
     Glib::Mutex::Lock lock(lock_);
     for(std::list<DataDeliveryComm*>::iterator i = items_.begin();
@@ -51,6 +107,17 @@ namespace DataStaging {
         ++i;
       }
     }
+    // Handles are closed by now and hence already removed from epoll.
+    // Same numbers may be already reused by another object.
+    for(std::map<int, DataDeliveryComm*>::iterator h = handles_.begin();
+                        h!=handles_.end();) {
+      if(h->second == item) {
+        handles_.erase(h++);
+      } else {
+        ++h;
+      }
+    }
+    watched_.erase(item);
   }
 
   DataDeliveryCommHandler* DataDeliveryCommHandler::comm_handler = NULL;
@@ -60,8 +127,10 @@ namespace DataStaging {
     return (comm_handler = new DataDeliveryCommHandler);
   }
 
-  // This is a dedicated thread which periodically checks for
-  // new state reported by comm instances and modifies states accordingly
+  // This is a dedicated thread which checks for new state reported by
+  // comm instances and modifies states accordingly. Instances reporting
+  // through watched handles are processed as soon as they report and
+  // the rest is polled 2 times per second.
   void DataDeliveryCommHandler::func(void* arg) {
     if(!arg) return;
 
@@ -69,20 +138,65 @@ namespace DataStaging {
     Arc::Logger::getRootLogger().setThreadContext();
     Arc::Logger::getRootLogger().removeDestinations();
 
-    // We do not need extremely low latency, so this
-    // thread simply polls for data 2 times per second.
     DataDeliveryCommHandler& it = *(DataDeliveryCommHandler*)arg;
+    Glib::TimeVal last_poll(0,0);
+    Glib::TimeVal last_check(0,0);
     for(;;) {
-      {
+      Glib::TimeVal start;
+      start.assign_current_time();
+      bool waited = false;
+      bool busy = false;
+#ifdef HAVE_SYS_EPOLL_H
+      if(it.epoll_ != -1) {
+        struct epoll_event events[DELIVERY_MAX_EVENTS];
+        int n = ::epoll_wait(it.epoll_, events, DELIVERY_MAX_EVENTS, DELIVERY_POLL_PERIOD);
+        waited = true;
+        busy = (n == DELIVERY_MAX_EVENTS);
+        Glib::Mutex::Lock lock(it.lock_);
+        for(int e = 0; e < n; ++e) {
+          std::map<int, DataDeliveryComm*>::iterator h = it.handles_.find(events[e].data.fd);
+          if(h == it.handles_.end()) continue;
+          DataDeliveryComm* comm = h->second;
+          comm->PullAndNotify();
+          if(!(*comm)) continue; // handle is gone together with child
+          struct epoll_event event;
+          event.events = EPOLLIN | EPOLLONESHOT;
+          event.data.fd = h->first;
+          ::epoll_ctl(it.epoll_, EPOLL_CTL_MOD, h->first, &event);
+        }
+      }
+#endif
+      if(!waited) Glib::usleep(DELIVERY_POLL_PERIOD*1000);
+      Glib::TimeVal now;
+      now.assign_current_time();
+      Glib::TimeVal since_poll(now); since_poll -= last_poll;
+      Glib::TimeVal since_check(now); since_check -= last_check;
+      bool do_poll = (since_poll.as_double()*1000.0 >= DELIVERY_POLL_PERIOD);
+      bool do_check = (since_check.as_double()*1000.0 >= DELIVERY_CHECK_PERIOD);
+      if(do_poll || do_check) {
         Glib::Mutex::Lock lock(it.lock_);
         for(std::list<DataDeliveryComm*>::iterator i = it.items_.begin();
                   i != it.items_.end();++i) {
           DataDeliveryComm* comm = *i;
-          if(comm)
-            comm->PullStatus();
+          if(!comm) continue;
+          // Watched instances are only checked for inactivity
+          if(it.watched_.find(comm) != it.watched_.end()) {
+            if(!do_check) continue;
+          } else {
+            if(!do_poll) continue;
+          }
+          comm->PullAndNotify();
         }
+        if(do_poll) last_poll = now;
+        if(do_check) last_check = now;
       }
-      Glib::usleep(500000);
+      if(busy) continue;
+      // Do not spin on frequently reporting instances. Their reports
+      // accumulate in pipes meanwhile and are taken in one go.
+      now.assign_current_time();
+      now -= start;
+      double left = DELIVERY_MIN_PERIOD - now.as_double()*1000.0;
+      if(left > 0) Glib::usleep((unsigned long)(left*1000.0));
     }
   }
 
@@ -1,6 +1,9 @@
 #ifndef DATA_DELIVERY_COMM_H_
 #define DATA_DELIVERY_COMM_H_
 
+#include <map>
+#include <set>
+
 #include "DTR.h"
 
 namespace DataStaging {
@@ -18,9 +21,10 @@ namespace DataStaging {
    * CreateInstance() should be used to get a pointer to the instantiated
    * object. This also starts the transfer. Deleting this object stops the
    * transfer and cleans up any used resources. A singleton instance of
-   * DataDeliveryCommHandler regularly polls all active transfers using
-   * PullStatus() and fills the Status object with current information,
-   * which can be obtained through GetStatus().
+   * DataDeliveryCommHandler calls PullStatus() of active transfers when
+   * they report through their pipe or, for transfers without pipe, regularly
+   * and fills the Status object with current information, which can be
+   * obtained through GetStatus().
    * \ingroup datastaging
    * \headerfile DataDeliveryComm.h arc/data-staging/DataDeliveryComm.h
    */
@@ -69,6 +73,10 @@ namespace DataStaging {
     unsigned int status_pos_;
     /// Lock to protect access to status
     Glib::Mutex lock_;
+    /// Set when status changed and not yet seen through Updated()
+    bool updated_;
+    /// Condition to signal when transfer finishes
+    Arc::SimpleCondition* wakeup_;
     /// Pointer to singleton handler of all DataDeliveryComm objects
     DataDeliveryCommHandler* handler_;
     /// Transfer limits
@@ -86,6 +94,9 @@ namespace DataStaging {
      */
     virtual void PullStatus() = 0;
 
+    /// Call PullStatus() and signal wake up condition if transfer finished.
+    void PullAndNotify();
+
     /// Start transfer with parameters taken from DTR and supplied transfer limits.
     /**
      * Constructor should not be used directly, CreateInstance() should be used
@@ -103,6 +114,12 @@ namespace DataStaging {
     /// Obtain status of transfer
     Status GetStatus() const;
 
+    /// Returns true if status changed since previous call
+    bool Updated();
+
+    /// Set condition to be signalled as soon as transfer finishes
+    void SetWakeUp(Arc::SimpleCondition* cond);
+
     /// Check the delivery method is available. Calls CheckComm of the appropriate subclass.
     /**
      * \param dtr DTR from which credentials are used
@@ -133,6 +150,12 @@ namespace DataStaging {
     Glib::Mutex lock_;
     static void func(void* arg);
     std::list<DataDeliveryComm*> items_;
+    /// Objects reporting through pipe, by file descriptor of pipe
+    std::map<int, DataDeliveryComm*> handles_;
+    /// Objects which do not need regular polling
+    std::set<DataDeliveryComm*> watched_;
+    /// epoll instance watching handles_, -1 if not available
+    int epoll_;
     static DataDeliveryCommHandler* comm_handler;
 
     /// Constructor is private - getInstance() should be used instead
@@ -144,6 +167,13 @@ namespace DataStaging {
     ~DataDeliveryCommHandler() {};
     /// Add a new DataDeliveryComm instance to the handler
     void Add(DataDeliveryComm* item);
+    /// Pull status of item when data is available in handle.
+    /**
+     * Items with watched handles are not polled regularly any more but
+     * only occasionally to detect inactivity. Must be called after Add().
+     * If waiting on handles is not supported item is polled as usual.
+     */
+    void Watch(DataDeliveryComm* item, int handle);
     /// Remove a DataDeliveryComm instance from the handler
     void Remove(DataDeliveryComm* item);
     /// Get the singleton instance of the handler
@@ -173,6 +173,10 @@ namespace DataStaging {
       }
     }
     handler_->Add(this);
+    if(child_) {
+      handler_->Watch(this, child_->StdoutHandle());
+      handler_->Watch(this, child_->StderrHandle());
+    }
   }
 
   DataDeliveryLocalComm::~DataDeliveryLocalComm(void) {
@@ -219,6 +223,7 @@ namespace DataStaging {
               status_.commstatus = CommFailed;
             }
           }
+          updated_ = true;
           delete child_; child_=NULL; return;
         }
         if(l == 0) break;
@@ -228,6 +233,7 @@ namespace DataStaging {
       if(status_pos_ >= sizeof(status_buf_)) {
         status_buf_.error_desc[sizeof(status_buf_.error_desc)-1] = 0;
         status_=status_buf_;
+        updated_ = true;
         status_pos_-=sizeof(status_buf_);
       }
     }
@@ -238,6 +244,7 @@ namespace DataStaging {
       child_->Kill(1);
       delete child_;
       child_ = NULL;
+      updated_ = true;
     }
   }
 
@@ -228,6 +228,8 @@ namespace DataStaging {
     // TODO be more intelligent, using transfer rate and file size
     if (Arc::Time() - start_ < 20 && Arc::Time() - Arc::Time(status_.timestamp) < 1) return;
     if (Arc::Time() - start_ > 20 && Arc::Time() - Arc::Time(status_.timestamp) < 5) return;
+    // Any outcome of query below may change status
+    updated_ = true;
 
     Arc::NS ns;
     Arc::PayloadSOAP request(ns);
@@ -18,6 +18,12 @@
 
 using namespace Arc;
 
+// Initial size of transfer buffers and limits for their adaptive growth
+#define DELIVERY_BUFFER_SIZE (1048576)
+#define DELIVERY_MAX_BUFFER_SIZE (16*1048576)
+#define DELIVERY_MAX_BUFFER_NUM (32)
+#define DELIVERY_BUFFER_MEMORY (64*1048576ULL)
+
 static Arc::Logger logger(Arc::Logger::getRootLogger(), "DataDelivery");
 static bool delivery_shutdown = false;
 static Arc::Time start_time;
@@ -317,16 +323,25 @@ int main(int argc,char* argv[]) {
     source->AddCheckSumObject(&crc_source);
     dest->AddCheckSumObject(&crc_dest);
   }
-  buffer.set(&crc);
-
+  unsigned int buffer_size = DELIVERY_BUFFER_SIZE;
   if (!size.empty()) {
     unsigned long long int total_size;
     if (stringto(size, total_size)) {
       dest->SetSize(total_size);
+      if (total_size < buffer_size) {
+        // Small files need no big buffers. Adaptive mode will grow them if needed.
+        buffer_size = (total_size + 65535) & ~((unsigned long long int)65535);
+        if (buffer_size < 65536) buffer_size = 65536;
+      }
     } else {
       logger.msg(WARNING, "Cannot use supplied --size option");
     }
   }
+  buffer.set(&crc, buffer_size);
+  // Budget is per process and every delivery process serves single
+  // transfer, so it limits only this transfer.
+  DataBuffer::set_process_memory_budget(DELIVERY_BUFFER_MEMORY);
+  buffer.adaptive(DELIVERY_MAX_BUFFER_SIZE, DELIVERY_MAX_BUFFER_NUM);
 
   bool reported = false;
   bool eof_reached = false;
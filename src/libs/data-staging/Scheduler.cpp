@@ -5,14 +5,37 @@
 #include <unistd.h>
 #include <math.h>
 
+#include <algorithm>
 #include <set>
 
 #include <arc/FileUtils.h>
+#include <arc/StringConv.h>
 #include <arc/Utils.h>
 
 #include "Scheduler.h"
 #include "DataDeliveryRemoteComm.h"
 
+// How often delivery services are probed (seconds)
+#define DELIVERY_PROBE_INTERVAL (60)
+// Number of consecutive failed transfers after which delivery service is taken out
+#define DELIVERY_MAX_FAILURES (3)
+// Share of transfers given to delivery service when it is taken back
+#define DELIVERY_START_WEIGHT (0.25)
+// Longest time (seconds) delivery service is kept out after repeated failures
+#define DELIVERY_MAX_HOLD (1800)
+// Concurrency window given to storage endpoint when first seen
+#define ENDPOINT_INITIAL_WINDOW (2)
+// Factor applied to window of storage endpoint on congestion
+#define ENDPOINT_DECREASE (0.5)
+// Time (seconds) after decrease during which window is not decreased again
+#define ENDPOINT_DECREASE_HOLD (10)
+// Transfers smaller than this (bytes) are not used for measuring rate
+#define ENDPOINT_RATE_MIN_SIZE (10485760)
+// Transfer slower than this part of average rate is sign of congestion
+#define ENDPOINT_SLOW_RATE (0.5)
+// Time (seconds) after which idle storage endpoint is forgotten
+#define ENDPOINT_IDLE_TIME (3600)
+
 namespace DataStaging {
 	
   Arc::Logger Scheduler::logger(Arc::Logger::getRootLogger(), "DataStaging.Scheduler");
@@ -28,7 +51,8 @@ namespace DataStaging {
     return scheduler_instance;
   }
 
-  Scheduler::Scheduler(): remote_size_limit(0), scheduler_state(INITIATED) {
+  Scheduler::Scheduler(): delivery_probed(false), delivery_probe_wanted(true), probe_started(false), probe_stop(false),
+                          remote_size_limit(0), scheduler_state(INITIATED) {
     // Conservative defaults
     PreProcessorSlots = 20;
     DeliverySlots = 10;
@@ -486,6 +510,14 @@ namespace DataStaging {
     if (request->error())
       request->get_logger()->msg(Arc::ERROR, "Transfer failed: %s", request->get_error_status().GetDesc());
 
+    // Delivery marks service problematic if it could not be used
+    if (request->get_delivery_endpoint() != DTR::LOCAL_DELIVERY) {
+      const std::vector<Arc::URL>& problems = request->get_problematic_delivery_services();
+      report_delivery_service(request->get_delivery_endpoint(),
+                              std::find(problems.begin(), problems.end(), request->get_delivery_endpoint()) == problems.end());
+    }
+    report_storage_endpoints(request);
+
     // Resuming normal workflow after the DTR has finished transferring
     // The next state is RELEASE_REQUEST
 
@@ -823,45 +855,42 @@ namespace DataStaging {
     // Remember current endpoint
     Arc::URL delivery_endpoint(request->get_delivery_endpoint());
 
-    // Check delivery services when the first DTR is processed, and every 5
-    // minutes after that. The ones that work are the only ones that will be
-    // used until the next check.
-    // This method assumes that the DTR has permission on all services,
-    // which may not be true if DN filtering is used on those services.
-    if (usable_delivery_services.empty() || Arc::Time() - delivery_last_checked > 300) {
-      delivery_last_checked = Arc::Time();
-      usable_delivery_services.clear();
-      for (std::vector<Arc::URL>::iterator service = configured_delivery_services.begin();
-           service != configured_delivery_services.end(); ++service) {
-        request->set_delivery_endpoint(*service);
-        std::vector<std::string> allowed_dirs;
-        std::string load_avg;
-        if (!DataDeliveryComm::CheckComm(request, allowed_dirs, load_avg)) {
-          log_to_root_logger(Arc::WARNING, "Error with delivery service at " +
-                             request->get_delivery_endpoint().str() + " - This service will not be used");
-        }
-        else {
-          usable_delivery_services[*service] = allowed_dirs;
-          // This is not a timing measurement so use dummy timestamps
-          timespec dummy;
-          job_perf_log.Log("DTR_load_" + service->Host(), load_avg, dummy, dummy);
-        }
-      }
-      request->set_delivery_endpoint(delivery_endpoint);
-      if (usable_delivery_services.empty()) {
-        log_to_root_logger(Arc::ERROR, "No usable delivery services found, will use local delivery");
-        return;
-      }
+    // Services are checked by probing thread. It uses credentials of one
+    // of DTRs, so it is assumed that the DTR has permission on all
+    // services, which may not be true if DN filtering is used on those
+    // services.
+    Glib::Mutex::Lock lock(delivery_services_lock);
+    if (delivery_probe_wanted) {
+      lock.release();
+      DTR_ptr probe(new DTR(request->get_source_str(), request->get_destination_str(),
+                            request->get_usercfg(), request->get_parent_job_id(),
+                            request->get_local_user().get_uid(),
+                            std::list<DTRLogDestination>(), "DataStaging.DeliveryProbe"));
+      probe->host_cert_for_remote_delivery(request->host_cert_for_remote_delivery());
+      lock.acquire();
+      delivery_probe = probe;
+      delivery_probe_wanted = false;
+      // Probing thread waits for first DTR
+      if (!delivery_probed) probe_signal.signal();
+    }
+    if (!delivery_probed) {
+      // Wait for probing results
+      request->set_delivery_endpoint(Arc::URL());
+      return;
     }
 
     // Make a list of the delivery services that this DTR can use
     std::vector<Arc::URL> possible_delivery_services;
+    // Relative cost of using each possible service
+    std::vector<double> costs;
     bool can_use_local = false;
-    for (std::map<Arc::URL, std::vector<std::string> >::iterator service = usable_delivery_services.begin();
-         service != usable_delivery_services.end(); ++service) {
+    for (std::map<Arc::URL, DeliveryServiceState>::iterator service = delivery_services.begin();
+         service != delivery_services.end(); ++service) {
+      if (!service->second.usable || service->second.weight <= 0) continue;
       if (service->first == DTR::LOCAL_DELIVERY) can_use_local = true;
 
-      for (std::vector<std::string>::iterator dir = service->second.begin(); dir != service->second.end(); ++dir) {
+      for (std::vector<std::string>::iterator dir = service->second.allowed_dirs.begin(); dir != service->second.allowed_dirs.end(); ++dir) {
+        bool possible = false;
         if (request->get_destination()->Local()) {
 
           // check for caching
@@ -870,25 +899,31 @@ namespace DataStaging {
 
           if (dest.find(*dir) == 0) {
             request->get_logger()->msg(Arc::DEBUG, "Delivery service at %s can copy to %s", service->first.str(), *dir);
-            possible_delivery_services.push_back(service->first);
-            break;
+            possible = true;
           }
         }
         else if (request->get_source()->Local()) {
 
           if (request->get_source()->TransferLocations()[0].Path().find(*dir) == 0) {
             request->get_logger()->msg(Arc::DEBUG, "Delivery service at %s can copy from %s", service->first.str(), *dir);
-            possible_delivery_services.push_back(service->first);
-            break;
+            possible = true;
           }
         }
         else {
           // copy between two remote endpoints so any service is ok
+          possible = true;
+        }
+        if (possible) {
+          // Busier and more loaded services and those only taken back cost more
+          double load = (service->second.load > 0) ? service->second.load : 0;
+          costs.push_back((delivery_hosts[service->first.Host()] + 1) * (1 + load) / service->second.weight);
           possible_delivery_services.push_back(service->first);
           break;
         }
       }
     }
+    lock.release();
+
     if (possible_delivery_services.empty()) {
       request->get_logger()->msg(Arc::WARNING, "Could not find any useable delivery service,"
                                                " forcing local transfer");
@@ -903,13 +938,13 @@ namespace DataStaging {
     }
 
     // Exclude full services with transfers greater than slots/no services
-    for (std::vector<Arc::URL>::iterator possible = possible_delivery_services.begin();
-         possible != possible_delivery_services.end();) {
-      if (delivery_hosts[possible->Host()] > (int)(DeliverySlots/configured_delivery_services.size())) {
-        request->get_logger()->msg(Arc::DEBUG, "Not using delivery service at %s because it is full", possible->str());
-        possible = possible_delivery_services.erase(possible);
+    for (unsigned int n = 0; n < possible_delivery_services.size();) {
+      if (delivery_hosts[possible_delivery_services[n].Host()] > (int)(DeliverySlots/configured_delivery_services.size())) {
+        request->get_logger()->msg(Arc::DEBUG, "Not using delivery service at %s because it is full", possible_delivery_services[n].str());
+        possible_delivery_services.erase(possible_delivery_services.begin() + n);
+        costs.erase(costs.begin() + n);
       } else {
-        ++possible;
+        ++n;
       }
     }
 
@@ -919,42 +954,265 @@ namespace DataStaging {
       return;
     }
 
-    // First try, use any service
-    if (request->get_tries_left() == request->get_initial_tries()) {
-      delivery_endpoint = possible_delivery_services.at(rand() % possible_delivery_services.size());
-      request->set_delivery_endpoint(delivery_endpoint);
-      return;
-    }
     // Retry, try not to use a previous problematic service. If all are
     // problematic then default to local (even if not configured)
-    for (std::vector<Arc::URL>::iterator possible = possible_delivery_services.begin();
-         possible != possible_delivery_services.end();) {
-
-      std::vector<Arc::URL>::const_iterator problem = request->get_problematic_delivery_services().begin();
-      while (problem != request->get_problematic_delivery_services().end()) {
-        if (*possible == *problem) {
-          request->get_logger()->msg(Arc::VERBOSE, "Not using delivery service %s due to previous failure", problem->str());
-          possible = possible_delivery_services.erase(possible);
-          break;
+    if (request->get_tries_left() != request->get_initial_tries()) {
+      for (unsigned int n = 0; n < possible_delivery_services.size();) {
+        std::vector<Arc::URL>::const_iterator problem = request->get_problematic_delivery_services().begin();
+        while (problem != request->get_problematic_delivery_services().end()) {
+          if (possible_delivery_services[n] == *problem) {
+            request->get_logger()->msg(Arc::VERBOSE, "Not using delivery service %s due to previous failure", problem->str());
+            possible_delivery_services.erase(possible_delivery_services.begin() + n);
+            costs.erase(costs.begin() + n);
+            break;
+          }
+          ++problem;
         }
-        ++problem;
+        if (problem == request->get_problematic_delivery_services().end()) ++n;
+      }
+      if (possible_delivery_services.empty()) {
+        // force local
+        if (!can_use_local) request->get_logger()->msg(Arc::WARNING, "No remote delivery services "
+                                                       "are useable, forcing local delivery");
+        request->set_delivery_endpoint(DTR::LOCAL_DELIVERY);
+        return;
       }
-      if (problem == request->get_problematic_delivery_services().end()) ++possible;
     }
-    if (possible_delivery_services.empty()) {
-      // force local
-      if (!can_use_local) request->get_logger()->msg(Arc::WARNING, "No remote delivery services "
-                                                     "are useable, forcing local delivery");
-      request->set_delivery_endpoint(DTR::LOCAL_DELIVERY);
-    } else {
-      // Find a random service different from the previous one, looping a
-      // limited number of times in case all delivery services are the same url
-      Arc::URL ep(possible_delivery_services.at(rand() % possible_delivery_services.size()));
-      for (unsigned int i = 0; ep == delivery_endpoint && i < possible_delivery_services.size() * 10; ++i) {
-        ep = possible_delivery_services.at(rand() % possible_delivery_services.size());
+
+    // Pick two random services and use the cheaper one. On retry prefer
+    // service different from the previous one.
+    unsigned int first = rand() % possible_delivery_services.size();
+    unsigned int chosen = first;
+    if (possible_delivery_services.size() > 1) {
+      unsigned int second = rand() % (possible_delivery_services.size() - 1);
+      if (second >= first) ++second;
+      if (costs[second] < costs[first]) chosen = second;
+      if (request->get_tries_left() != request->get_initial_tries() &&
+          possible_delivery_services[chosen] == delivery_endpoint) {
+        chosen = (chosen == first) ? second : first;
+      }
+    }
+    request->set_delivery_endpoint(possible_delivery_services[chosen]);
+  }
+
+  void Scheduler::report_delivery_service(const Arc::URL& endpoint, bool success) {
+    Glib::Mutex::Lock lock(delivery_services_lock);
+    std::map<Arc::URL, DeliveryServiceState>::iterator service = delivery_services.find(endpoint);
+    if (service == delivery_services.end()) return;
+    DeliveryServiceState& state = service->second;
+    if (success) {
+      state.failures = 0;
+      return;
+    }
+    if (!state.usable) return;
+    if (++state.failures < DELIVERY_MAX_FAILURES) return;
+    // Take service out till probing takes it back. Every next time
+    // service keeps failing it stays out longer.
+    state.usable = false;
+    state.weight = 0;
+    state.failures = 0;
+    ++state.removals;
+    int hold = DELIVERY_PROBE_INTERVAL << ((state.removals < 5) ? state.removals : 5);
+    if (hold > DELIVERY_MAX_HOLD) hold = DELIVERY_MAX_HOLD;
+    state.hold_until = Arc::Time() + Arc::Period(hold);
+    lock.release();
+    log_to_root_logger(Arc::WARNING, "Delivery service at " + endpoint.str() +
+                       " failed " + Arc::tostring(DELIVERY_MAX_FAILURES) +
+                       " transfers in a row, not using it for " + Arc::tostring(hold) + " seconds");
+  }
+
+  void Scheduler::probe_delivery_services(void) {
+    Glib::Mutex::Lock lock(delivery_services_lock);
+    DTR_ptr probe = delivery_probe;
+    // Fresh DTR for next time, so credentials are not too old
+    delivery_probe_wanted = true;
+    lock.release();
+    if (!probe) return;
+    for (std::vector<Arc::URL>::iterator service = configured_delivery_services.begin();
+         service != configured_delivery_services.end(); ++service) {
+      probe->set_delivery_endpoint(*service);
+      std::vector<std::string> allowed_dirs;
+      std::string load_avg;
+      bool result = DataDeliveryComm::CheckComm(probe, allowed_dirs, load_avg);
+      Arc::Time now;
+      lock.acquire();
+      DeliveryServiceState& state = delivery_services[*service];
+      if (!result) {
+        if (state.usable || !state.seen) {
+          logger.msg(Arc::WARNING, "Error with delivery service at %s - This service will not be used", service->str());
+        }
+        state.usable = false;
+        state.weight = 0;
+      } else {
+        state.allowed_dirs = allowed_dirs;
+        if (!Arc::stringto(load_avg, state.load)) state.load = -1;
+        if (!state.seen) {
+          // Service available from start
+          state.usable = true;
+          state.weight = 1;
+        } else if (!state.usable) {
+          if (now >= state.hold_until) {
+            // Take service back but give it only part of load at first
+            logger.msg(Arc::INFO, "Delivery service at %s is used again", service->str());
+            state.usable = true;
+            state.weight = DELIVERY_START_WEIGHT;
+          }
+        } else if (state.weight < 1) {
+          state.weight *= 2;
+          if (state.weight >= 1) {
+            state.weight = 1;
+            state.removals = 0;
+          }
+        }
+        state.seen = true;
+        // This is not a timing measurement so use dummy timestamps
+        timespec dummy;
+        job_perf_log.Log("DTR_load_" + service->Host(), load_avg, dummy, dummy);
+      }
+      lock.release();
+    }
+    lock.acquire();
+    if (!delivery_probed) {
+      delivery_probed = true;
+      bool usable = false;
+      for (std::map<Arc::URL, DeliveryServiceState>::iterator service = delivery_services.begin();
+           service != delivery_services.end(); ++service) {
+        if (service->second.usable) usable = true;
+      }
+      if (!usable) logger.msg(Arc::ERROR, "No usable delivery services found, will use local delivery");
+    }
+  }
+
+  void Scheduler::probe_thread(void* arg) {
+    Scheduler* sched = (Scheduler*)arg;
+    while (true) {
+      sched->probe_delivery_services();
+      Glib::Mutex::Lock lock(sched->delivery_services_lock);
+      if (sched->probe_stop) break;
+      // Before first DTR arrives there are no credentials to probe with
+      int interval = sched->delivery_probed ? DELIVERY_PROBE_INTERVAL : 1;
+      lock.release();
+      sched->probe_signal.wait(interval * 1000);
+    }
+    sched->probe_exit.signal();
+  }
+
+  // Remote storage endpoints used by transfer of DTR. Local files are not
+  // limited.
+  static void storage_endpoints(DTR_ptr request, std::set<std::string>& endpoints) {
+    if (request->get_mapped_source().empty()) {
+      const Arc::URL& source = request->get_source()->CurrentLocation();
+      if (source.Protocol() != "file" && !source.Host().empty()) endpoints.insert(source.ConnectionURL());
+    }
+    const Arc::URL& destination = request->get_destination()->CurrentLocation();
+    if (destination.Protocol() != "file" && !destination.Host().empty()) endpoints.insert(destination.ConnectionURL());
+  }
+
+  bool Scheduler::endpoint_window_open(DTR_ptr request) {
+    std::set<std::string> endpoints;
+    storage_endpoints(request, endpoints);
+    Glib::Mutex::Lock lock(endpoint_windows_lock);
+    for (std::set<std::string>::iterator e = endpoints.begin(); e != endpoints.end(); ++e) {
+      std::map<std::string, StorageEndpointWindow>::iterator w = endpoint_windows.find(*e);
+      if (w == endpoint_windows.end()) continue;
+      if (w->second.active >= (unsigned int)w->second.window) return false;
+    }
+    return true;
+  }
+
+  void Scheduler::endpoint_window_take(DTR_ptr request) {
+    std::set<std::string> endpoints;
+    storage_endpoints(request, endpoints);
+    Glib::Mutex::Lock lock(endpoint_windows_lock);
+    for (std::set<std::string>::iterator e = endpoints.begin(); e != endpoints.end(); ++e) {
+      StorageEndpointWindow& w = endpoint_windows[*e];
+      if (w.window == 0) w.window = std::min((double)ENDPOINT_INITIAL_WINDOW, (double)DeliverySlots);
+      ++w.active;
+      w.last_used = Arc::Time();
+    }
+  }
+
+  void Scheduler::report_storage_endpoints(DTR_ptr request) {
+    // Cancelled transfer tells nothing about endpoint
+    if (request->cancel_requested()) return;
+
+    std::set<std::string> endpoints;
+    storage_endpoints(request, endpoints);
+    std::string source(request->get_source()->CurrentLocation().ConnectionURL());
+    std::string destination(request->get_destination()->CurrentLocation().ConnectionURL());
+
+    const DTRErrorStatus& error = request->get_error_status();
+    double rate = 0;
+    if (!request->error() && request->get_transfer_time() > 0 &&
+        request->get_bytes_transferred() >= ENDPOINT_RATE_MIN_SIZE) {
+      rate = (double)request->get_bytes_transferred() * 1000000000.0 / (double)request->get_transfer_time();
+    }
+    Arc::Time now;
+
+    Glib::Mutex::Lock lock(endpoint_windows_lock);
+    for (std::set<std::string>::iterator e = endpoints.begin(); e != endpoints.end(); ++e) {
+      std::map<std::string, StorageEndpointWindow>::iterator i = endpoint_windows.find(*e);
+      if (i == endpoint_windows.end()) continue;
+      StorageEndpointWindow& w = i->second;
+      w.last_used = now;
+
+      // Only temporary errors caused by endpoint or slow transfers point
+      // to overload. Errors like missing file do not change window.
+      bool congested = false;
+      if (request->error()) {
+        if (error == DTRErrorStatus::TRANSFER_SPEED_ERROR) {
+          congested = true;
+        } else if (error == DTRErrorStatus::TEMPORARY_REMOTE_ERROR) {
+          congested = (error.GetErrorLocation() == DTRErrorStatus::ERROR_SOURCE && *e == source) ||
+                      (error.GetErrorLocation() == DTRErrorStatus::ERROR_DESTINATION && *e == destination);
+        }
+        if (!congested) continue;
+        ++w.failures;
+      } else {
+        ++w.successes;
+        if (rate > 0) {
+          // Much slower transfer while endpoint is fully used means adding
+          // more transfers only divides the same bandwidth
+          if (w.rate > 0 && rate < w.rate * ENDPOINT_SLOW_RATE && w.active + 1 >= (unsigned int)w.window) {
+            congested = true;
+          }
+          w.rate = (w.rate > 0) ? (w.rate * 0.8 + rate * 0.2) : rate;
+        }
       }
-      request->set_delivery_endpoint(ep);
+
+      if (congested) {
+        if (now < w.hold_until) continue; // already decreased for this burst
+        double window = std::max(1.0, w.window * ENDPOINT_DECREASE);
+        if (window < w.window) {
+          logger.msg(Arc::VERBOSE, "Decreasing number of concurrent transfers for %s to %u",
+                     *e, (unsigned int)window);
+        }
+        w.window = window;
+        w.slow_start = false;
+        w.hold_until = now + ENDPOINT_DECREASE_HOLD;
+      } else {
+        // Increase by 1 per transfer in slow start, otherwise by 1 per window
+        w.window += w.slow_start ? 1.0 : 1.0 / w.window;
+        if (w.window > DeliverySlots) w.window = DeliverySlots;
+      }
+    }
+  }
+
+  void Scheduler::dump_endpoint_windows(const std::string& path) {
+    std::string data;
+    endpoint_windows_lock.lock();
+    for (std::map<std::string, StorageEndpointWindow>::iterator w = endpoint_windows.begin();
+         w != endpoint_windows.end(); ++w) {
+      data += w->first + " " +
+              Arc::tostring(w->second.active) + " " +
+              Arc::tostring((unsigned int)w->second.window) + " " +
+              Arc::tostring((unsigned long long int)w->second.rate) + " " +
+              Arc::tostring(w->second.successes) + " " +
+              Arc::tostring(w->second.failures) + "\n";
     }
+    endpoint_windows_lock.unlock();
+
+    Arc::FileCreate(path, data);
   }
 
   void Scheduler::process_events(void){
@@ -966,6 +1224,13 @@ namespace DataStaging {
       DTR_ptr tmp = *event;
       event_lock.unlock();
 
+      // DTR back from process frees slot of its share
+      std::map<std::string, DTRStatus::DTRStatusType>::iterator running = running_dtrs.find(tmp->get_id());
+      if (running != running_dtrs.end()) {
+        queue_shares[running->second].finished(tmp->get_transfer_share());
+        running_dtrs.erase(running);
+      }
+
       if (tmp->get_process_time() <= now) {
         map_state_and_process(tmp);
         // If final state, the DTR is returned to the generator and deleted
@@ -979,6 +1244,7 @@ namespace DataStaging {
         if (tmp->is_destined_for_pre_processor() ||
             tmp->is_destined_for_delivery() ||
             tmp->is_destined_for_post_processor()) {
+          queue_shares[tmp->get_status().GetStatus()].queue_dtr(tmp);
           event_lock.lock();
           event = events.erase(event);
           continue;
@@ -1008,6 +1274,32 @@ namespace DataStaging {
       delivery_hosts[(*i)->get_delivery_endpoint().Host()]++;
     }
 
+    Arc::Time now;
+
+    // Recount transfers per storage endpoint and forget endpoints not
+    // used for long time
+    {
+      std::map<std::string, int> endpoint_transfers;
+      for (std::list<DTR_ptr>::const_iterator i = DTRRunningStates[DTRStatus::TRANSFERRING].begin();
+           i != DTRRunningStates[DTRStatus::TRANSFERRING].end(); i++) {
+        std::set<std::string> endpoints;
+        storage_endpoints(*i, endpoints);
+        for (std::set<std::string>::iterator e = endpoints.begin(); e != endpoints.end(); ++e) {
+          endpoint_transfers[*e]++;
+        }
+      }
+      Glib::Mutex::Lock lock(endpoint_windows_lock);
+      for (std::map<std::string, StorageEndpointWindow>::iterator w = endpoint_windows.begin();
+           w != endpoint_windows.end();) {
+        w->second.active = endpoint_transfers[w->first];
+        if (w->second.active == 0 && w->second.last_used + ENDPOINT_IDLE_TIME < now) {
+          endpoint_windows.erase(w++);
+          continue;
+        }
+        ++w;
+      }
+    }
+
     // Check for any requested changes in priority
     DtrList.check_priority_changes(std::string(dumplocation + ".prio"));
 
@@ -1029,8 +1321,6 @@ namespace DataStaging {
       }
     }
 
-    Arc::Time now;
-
     // Go through "to process" states, work out shares and push DTRs
     for (unsigned int i = 0; i < DTRStatus::ToProcessStates.size(); ++i) {
 
@@ -1042,20 +1332,30 @@ namespace DataStaging {
       // Map of job id to list of DTRs, used for grouping bulk requests
       std::map<std::string, std::set<DTR_ptr> > bulk_requests;
 
-      // Transfer shares for this queue
-      TransferShares transferShares(transferSharesConf);
+      // Transfer shares for this queue, configuration may have new shares
+      TransferShares& transferShares = queue_shares[DTRStatus::ToProcessStates.at(i)];
+      transferShares.set_shares_conf(transferSharesConf);
+
+      // DTRs which may be prepared this time, if limit applies
+      std::set<std::string> prepare_allowed;
 
-      // Sort the DTR queue according to the priorities the DTRs have.
+      // DTRs are started in order of priority through the queues of
+      // transfer shares. Only preparation of staged files below depends
+      // on order of the whole queue, so only that queue is sorted.
       // Highest priority will be at the beginning of the list.
-      DTRQueue.sort(dtr_sort_predicate);
+      if (DTRStatus::ToProcessStates.at(i) == DTRStatus::STAGE_PREPARE) {
+        DTRQueue.sort(dtr_sort_predicate);
+      }
 
       int highest_priority = 0;
+      for (std::list<DTR_ptr>::iterator dtr = DTRQueue.begin(); dtr != DTRQueue.end(); ++dtr) {
+        if (dtr == DTRQueue.begin() || (*dtr)->get_priority() > highest_priority) highest_priority = (*dtr)->get_priority();
+      }
 
       // First go over the queue and check for cancellation and timeout
       for (std::list<DTR_ptr>::iterator dtr = DTRQueue.begin(); dtr != DTRQueue.end();) {
 
         DTR_ptr tmp = *dtr;
-        if (dtr == DTRQueue.begin()) highest_priority = tmp->get_priority();
 
         // There's no check for cancellation requests for the post-processor.
         // Most DTRs with cancellation requests will go to the post-processor
@@ -1087,6 +1387,7 @@ namespace DataStaging {
         if (tmp->get_timeout() < now && tmp->get_priority() < highest_priority) {
           tmp->set_priority(tmp->get_priority() + 1);
           tmp->set_timeout(300);
+          transferShares.queue_dtr(tmp);
         }
 
         // STAGE_PREPARE is a special case where we have to apply a limit to
@@ -1103,6 +1404,7 @@ namespace DataStaging {
             // add to the staging queue and sort to put highest priority first
             staged_queue[tmp->get_transfer_share()].push_front(tmp);
             staged_queue[tmp->get_transfer_share()].sort(dtr_sort_predicate);
+            prepare_allowed.insert(tmp->get_id());
           }
           else {
             // Past limit - this DTR cannot be processed this time so erase from queue
@@ -1134,7 +1436,6 @@ namespace DataStaging {
           }
         }
 
-        transferShares.increase_transfer_share(tmp->get_transfer_share());
         ++dtr;
       }
 
@@ -1166,7 +1467,6 @@ namespace DataStaging {
           ++dtr;
           continue;
         }
-        transferShares.increase_transfer_share((*dtr)->get_transfer_share());
         ++dtr;
       }
 
@@ -1178,87 +1478,97 @@ namespace DataStaging {
       if (DTRQueue.front()->is_destined_for_pre_processor()) slot_limit = PreProcessorSlots;
       else if (DTRQueue.front()->is_destined_for_post_processor()) slot_limit = PostProcessorSlots;
 
-      // Calculate the slots available for each active share
-      transferShares.calculate_shares(slot_limit);
-
-      // Shares which have at least one DTR active and running.
-      // Shares can only use emergency slots if they are not in this list.
-      std::set<std::string> active_shares;
       unsigned int running = ActiveDTRs.size();
 
-      // Go over the active DTRs again and decrease slots in corresponding shares
-      for (std::list<DTR_ptr>::iterator dtr = ActiveDTRs.begin(); dtr != ActiveDTRs.end(); ++dtr) {
-        transferShares.decrease_number_of_slots((*dtr)->get_transfer_share());
-        active_shares.insert((*dtr)->get_transfer_share());
-      }
+      // DTRs taken from queue which can't start now, queued again after
+      // this pass
+      std::list<DTR_ptr> postponed;
+      const DTRStatus::DTRStatusType queue_state = DTRStatus::ToProcessStates.at(i);
 
-      // Now at the beginning of the queue we have DTRs that should be
-      // launched first. Launch them, but with respect to the transfer shares.
-      for (std::list<DTR_ptr>::iterator dtr = DTRQueue.begin(); dtr != DTRQueue.end(); ++dtr) {
+      // Now launch DTRs in the order given by the transfer shares - highest
+      // priority DTR of the share which uses the fewest slots relative to
+      // its priority goes first.
+      for (;;) {
+        // Hard limit with all emergency slots used
+        if (running >= slot_limit + EmergencySlots) break;
 
-        DTR_ptr tmp = *dtr;
+        // With all regular slots used only shares without running DTRs
+        // can use emergency slots
+        if (running >= slot_limit) transferShares.restrict_to_idle_shares();
 
-        // Check if there are any shares left in the queue which might need
-        // an emergency share - if not we are done
-        if (running >= slot_limit &&
-            transferShares.active_shares().size() == active_shares.size()) break;
+        DTR_ptr tmp;
+        if (!transferShares.next_dtr(tmp)) break;
 
         // Check if this DTR is still in a queue state (was not sent already
-        // in a bulk operation)
+        // in a bulk operation or cancelled)
         if (tmp->get_status() != DTRStatus::ToProcessStates.at(i)) continue;
 
-        // Are there slots left for this share?
-        bool can_start = transferShares.can_start(tmp->get_transfer_share());
-        // Check if it is possible to use an emergency share
-        if (running >= slot_limit &&
-            active_shares.find(tmp->get_transfer_share()) != active_shares.end()) {
-          can_start = false;
+        // Over limit of prepared files
+        if (DTRStatus::ToProcessStates.at(i) == DTRStatus::STAGE_PREPARE &&
+            prepare_allowed.find(tmp->get_id()) == prepare_allowed.end()) {
+          postponed.push_back(tmp);
+          continue;
         }
 
-        if (can_start) {
-          transferShares.decrease_number_of_slots(tmp->get_transfer_share());
-
-          // Send to processor/delivery
-          if (tmp->is_destined_for_pre_processor()) {
-            // Check for bulk
-            if (tmp->bulk_possible()) {
-              std::set<DTR_ptr> bulk_set(bulk_requests[tmp->get_parent_job_id()]);
-              if (bulk_set.size() > 1 &&
-                  bulk_set.find(tmp) != bulk_set.end()) {
-                tmp->get_logger()->msg(Arc::INFO, "Will use bulk request");
-                unsigned int dtr_no = 0;
-                for (std::set<DTR_ptr>::iterator i = bulk_set.begin(); i != bulk_set.end(); ++i) {
-                  if (dtr_no == 0) (*i)->set_bulk_start(true);
-                  if (dtr_no == bulk_set.size() - 1) (*i)->set_bulk_end(true);
-                  DTR::push(*i, PRE_PROCESSOR);
-                  ++dtr_no;
+        // Storage endpoint of DTR may be saturated. DTR stays in queue and
+        // does not take slot of share, so DTRs for other endpoints can go.
+        if (tmp->is_destined_for_delivery() && !endpoint_window_open(tmp)) {
+          tmp->get_logger()->msg(Arc::DEBUG, "Storage endpoint is busy, will try later");
+          postponed.push_back(tmp);
+          continue;
+        }
+
+        // Send to processor/delivery
+        if (tmp->is_destined_for_pre_processor()) {
+          // Check for bulk
+          if (tmp->bulk_possible()) {
+            std::set<DTR_ptr> bulk_set(bulk_requests[tmp->get_parent_job_id()]);
+            if (bulk_set.size() > 1 &&
+                bulk_set.find(tmp) != bulk_set.end()) {
+              tmp->get_logger()->msg(Arc::INFO, "Will use bulk request");
+              unsigned int dtr_no = 0;
+              for (std::set<DTR_ptr>::iterator i = bulk_set.begin(); i != bulk_set.end(); ++i) {
+                if (dtr_no == 0) (*i)->set_bulk_start(true);
+                if (dtr_no == bulk_set.size() - 1) (*i)->set_bulk_end(true);
+                if (*i != tmp) {
+                  // Leaves queue together with tmp
+                  transferShares.remove_dtr(*i);
+                  transferShares.add_running((*i)->get_transfer_share());
+                  running_dtrs[(*i)->get_id()] = queue_state;
                 }
-              } else {
-                DTR::push(tmp, PRE_PROCESSOR);
+                DTR::push(*i, PRE_PROCESSOR);
+                ++dtr_no;
               }
             } else {
               DTR::push(tmp, PRE_PROCESSOR);
             }
+          } else {
+            DTR::push(tmp, PRE_PROCESSOR);
           }
-          else if (tmp->is_destined_for_post_processor()) DTR::push(tmp, POST_PROCESSOR);
-          else if (tmp->is_destined_for_delivery()) {
-            choose_delivery_service(tmp);
-            if (!tmp->get_delivery_endpoint()) {
-              // With a large queue waiting for delivery and different dirs per
-              // delivery service this could slow things down as it could go
-              // through every DTR in the queue
-              tmp->get_logger()->msg(Arc::DEBUG, "No delivery endpoints available, will try later");
-              continue;
-            }
-            DTR::push(tmp, DELIVERY);
-            delivery_hosts[tmp->get_delivery_endpoint().Host()]++;
+        }
+        else if (tmp->is_destined_for_post_processor()) DTR::push(tmp, POST_PROCESSOR);
+        else if (tmp->is_destined_for_delivery()) {
+          choose_delivery_service(tmp);
+          if (!tmp->get_delivery_endpoint()) {
+            // With a large queue waiting for delivery and different dirs per
+            // delivery service this could slow things down as it could go
+            // through every DTR in the queue
+            tmp->get_logger()->msg(Arc::DEBUG, "No delivery endpoints available, will try later");
+            postponed.push_back(tmp);
+            continue;
           }
-
-          ++running;
-          active_shares.insert(tmp->get_transfer_share());
+          DTR::push(tmp, DELIVERY);
+          delivery_hosts[tmp->get_delivery_endpoint().Host()]++;
+          endpoint_window_take(tmp);
         }
-        // Hard limit with all emergency slots used
-        if (running == slot_limit + EmergencySlots) break;
+
+        transferShares.started(tmp->get_transfer_share());
+        running_dtrs[tmp->get_id()] = queue_state;
+        ++running;
+      }
+      transferShares.allow_all_shares();
+      for (std::list<DTR_ptr>::iterator dtr = postponed.begin(); dtr != postponed.end(); ++dtr) {
+        transferShares.queue_dtr(*dtr);
       }
     }
   }
@@ -1328,6 +1638,7 @@ namespace DataStaging {
     while (sched->scheduler_state == RUNNING && !sched->dumplocation.empty()) {
       // every second, dump state
       sched->DtrList.dumpState(sched->dumplocation);
+      sched->dump_endpoint_windows(sched->dumplocation + ".endpoints");
       // Performance metric - total number of DTRs in the system
       timespec dummy;
       sched->job_perf_log.Log("DTR_total", Arc::tostring(sched->DtrList.size()), dummy, dummy);
@@ -1353,6 +1664,14 @@ namespace DataStaging {
     scheduler_state = TO_STOP;
     run_signal.wait();
     scheduler_state = STOPPED;
+    if (probe_started) {
+      delivery_services_lock.lock();
+      probe_stop = true;
+      delivery_services_lock.unlock();
+      probe_signal.signal();
+      probe_exit.wait();
+      probe_started = false;
+    }
 
     state_lock.unlock();
     return true;
@@ -1379,10 +1698,26 @@ namespace DataStaging {
       else logger.msg(Arc::INFO, "  Delivery service: %s", i->str());
     }
 
+    // Nothing is queued or running after previous run
+    queue_shares.clear();
+    running_dtrs.clear();
+
     // Start thread dumping DTR state
     if (!Arc::CreateThreadFunction(&dump_thread, this))
       logger.msg(Arc::ERROR, "Failed to create DTR dump thread");
 
+    // Start thread probing delivery services unless only local is used
+    if (!(configured_delivery_services.size() == 1 && configured_delivery_services.front() == DTR::LOCAL_DELIVERY)) {
+      if (Arc::CreateThreadFunction(&probe_thread, this)) probe_started = true;
+      else {
+        logger.msg(Arc::ERROR, "Failed to create delivery services probing thread, will use local delivery");
+        // Without probing results no service is known, so local delivery is chosen
+        Glib::Mutex::Lock lock(delivery_services_lock);
+        delivery_probed = true;
+        delivery_probe_wanted = false;
+      }
+    }
+
     // Disconnect from root logger so that messages are logged to per-DTR Logger
     Arc::Logger::getRootLogger().setThreadContext();
     root_destinations = Arc::Logger::getRootLogger().getDestinations();
@@ -1413,7 +1748,11 @@ namespace DataStaging {
     }
     // make sure final state is dumped before exit
     dump_signal.signal();
-    if (!dumplocation.empty()) DtrList.dumpState(dumplocation);
+    probe_signal.signal();
+    if (!dumplocation.empty()) {
+      DtrList.dumpState(dumplocation);
+      dump_endpoint_windows(dumplocation + ".endpoints");
+    }
 
     log_to_root_logger(Arc::INFO, "Scheduler loop exited");
     run_signal.signal();
@@ -49,6 +49,14 @@ class Scheduler: public DTRCallback {
     /// Configuration of transfer shares
     TransferSharesConf transferSharesConf;
 
+    /// Transfer shares of every queue state. They are kept between passes
+    /// of revise_queues() and updated when DTRs enter queues and when they
+    /// are started and return from processes. Used only by main thread.
+    std::map<DTRStatus::DTRStatusType, TransferShares> queue_shares;
+
+    /// Ids of DTRs started from queues, mapped to queue state
+    std::map<std::string, DTRStatus::DTRStatusType> running_dtrs;
+
     /// URLMap containing information on any local mappings defined in the configuration
     Arc::URLMap url_map;
 
@@ -87,12 +95,56 @@ class Scheduler: public DTRCallback {
     /// Endpoints of delivery services from configuration
     std::vector<Arc::URL> configured_delivery_services;
 
-    /// Map of delivery services and directories they can access, filled after
-    /// querying all services when the first DTR is processed
-    std::map<Arc::URL, std::vector<std::string> > usable_delivery_services;
-
-    /// Timestamp of last check of delivery services
-    Arc::Time delivery_last_checked;
+    /// State of delivery service as seen by probing and by transfers
+    class DeliveryServiceState {
+     public:
+      /// Directories the service can access
+      std::vector<std::string> allowed_dirs;
+      /// Load average reported by service, negative if unknown
+      double load;
+      /// Whether the service may be used
+      bool usable;
+      /// Whether the service ever answered probe
+      bool seen;
+      /// Consecutive failed transfers
+      unsigned int failures;
+      /// How many times in a row the service was taken out
+      unsigned int removals;
+      /// Service is not taken back before this time
+      Arc::Time hold_until;
+      /// Share of transfers given to service, grows after service is taken back
+      double weight;
+      DeliveryServiceState(): load(-1), usable(false), seen(false),
+        failures(0), removals(0), hold_until(0), weight(0) {};
+    };
+
+    /// Cached state of delivery services, filled by probing thread
+    std::map<Arc::URL, DeliveryServiceState> delivery_services;
+
+    /// Lock for delivery_services, delivery_probe and related flags
+    Glib::Mutex delivery_services_lock;
+
+    /// Whether all delivery services were probed at least once
+    bool delivery_probed;
+
+    /// DTR used by probing thread for credentials. Created from one of
+    /// DTRs being processed when probing thread asks for it.
+    DTR_ptr delivery_probe;
+
+    /// Set by probing thread when it needs new delivery_probe
+    bool delivery_probe_wanted;
+
+    /// Condition to wake up probing thread
+    Arc::SimpleCondition probe_signal;
+
+    /// Condition to signal end of probing thread
+    Arc::SimpleCondition probe_exit;
+
+    /// Whether probing thread was started
+    bool probe_started;
+
+    /// Tells probing thread to exit, protected by delivery_services_lock
+    bool probe_stop;
 
     /// File size limit (in bytes) under which local transfer is used
     unsigned long long int remote_size_limit;
@@ -100,6 +152,35 @@ class Scheduler: public DTRCallback {
     /// Counter of transfers per delivery service
     std::map<std::string, int> delivery_hosts;
 
+    /// Concurrency window of remote storage endpoint (protocol://host:port)
+    class StorageEndpointWindow {
+     public:
+      /// Number of transfers allowed at the same time, 0 if not set yet
+      double window;
+      /// Number of transfers currently running
+      unsigned int active;
+      /// Whether window still grows fast because no congestion was seen
+      bool slow_start;
+      /// Average rate (bytes/s) of recent big transfers, 0 if unknown
+      double rate;
+      /// Number of successful transfers
+      unsigned int successes;
+      /// Number of transfers failed because of endpoint
+      unsigned int failures;
+      /// Window is not decreased again before this time
+      Arc::Time hold_until;
+      /// Last time transfer was started or finished
+      Arc::Time last_used;
+      StorageEndpointWindow(): window(0), active(0), slow_start(true), rate(0),
+        successes(0), failures(0), hold_until(0) {};
+    };
+
+    /// Windows of storage endpoints, adjusted after every transfer
+    std::map<std::string, StorageEndpointWindow> endpoint_windows;
+
+    /// Lock for endpoint_windows, which are also read by dump thread
+    Glib::Mutex endpoint_windows_lock;
+
     /// Logger object
     static Arc::Logger logger;
 
@@ -175,10 +256,29 @@ class Scheduler: public DTRCallback {
     void map_stuck_state(DTR_ptr request);
 
     /// Choose a delivery service for the DTR, based on the file system paths
-    /// each service can access. These paths are determined by calling all the
-    /// configured services when the first DTR is received.
+    /// each service can access and on the load of services. These are
+    /// collected by probing thread, so no service is contacted here.
     void choose_delivery_service(DTR_ptr request);
 
+    /// Record outcome of transfer made through a delivery service. Repeated
+    /// failures take service out of use until it is probed again.
+    void report_delivery_service(const Arc::URL& endpoint, bool success);
+
+    /// Check if transfer of DTR fits into windows of its storage endpoints
+    bool endpoint_window_open(DTR_ptr request);
+
+    /// Account transfer of DTR as running at its storage endpoints
+    void endpoint_window_take(DTR_ptr request);
+
+    /// Adjust windows of storage endpoints after transfer of DTR finished.
+    /** Window grows additively with successful transfers and shrinks
+     * multiplicatively on errors pointing at endpoint or when transfers
+     * become much slower while endpoint is fully used. */
+    void report_storage_endpoints(DTR_ptr request);
+
+    /// Write state of storage endpoint windows to file
+    void dump_endpoint_windows(const std::string& path);
+
     /// Go through all DTRs waiting to go into a processing state and decide
     /// whether to push them into that state, depending on shares and limits.
     void revise_queues();
@@ -208,6 +308,11 @@ class Scheduler: public DTRCallback {
     /// Thread method for dumping state
     static void dump_thread(void* arg);
 
+    /// Thread method for periodic probing of delivery services
+    static void probe_thread(void* arg);
+    /// Probe all configured delivery services once
+    void probe_delivery_services(void);
+
     /// Static version of main_thread, used when thread is created
     static void main_thread(void* arg);
     /// Main thread, which runs until stopped
@@ -269,6 +374,8 @@ class Scheduler: public DTRCallback {
     void SetRemoteSizeLimit(unsigned long long int limit);
 
     /// Set location for periodic dump of DTR state (only file paths currently supported)
+    /** Windows of storage endpoints are dumped to same path with suffix
+     * ".endpoints". */
     void SetDumpLocation(const std::string& location);
 
     /// Set JobPerfLog object for performance metrics logging
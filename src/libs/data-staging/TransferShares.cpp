@@ -6,6 +6,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include <arc/StringConv.h>
 
 namespace DataStaging {
@@ -89,13 +91,22 @@ namespace DataStaging {
 
 
   TransferShares::TransferShares(const TransferSharesConf& shares_conf) :
-    conf(shares_conf) {
+    conf(shares_conf), QueuedCount(0), IdleOnly(false) {
     ActiveShares.clear();
     ActiveSharesSlots.clear();
   }
 
   void TransferShares::set_shares_conf(const TransferSharesConf& shares_conf) {
     conf = shares_conf;
+    // Queues kept from before may need new weights
+    for (std::map<std::string, ShareQueue>::iterator i = ShareQueues.begin(); i != ShareQueues.end(); ++i) {
+      int weight = conf.get_basic_priority(i->first);
+      if (weight < 1) weight = 1;
+      if (weight == i->second.weight) continue;
+      bool in_order = (DispatchOrder.erase(ShareKey(i->first, i->second)) > 0);
+      i->second.weight = weight;
+      if (in_order) DispatchOrder.insert(ShareKey(i->first, i->second));
+    }
   }
 
   void TransferShares::calculate_shares(int TotalNumberOfSlots) {
@@ -173,4 +184,115 @@ namespace DataStaging {
     return ActiveShares;
   }
 
+  TransferShares::ShareQueue& TransferShares::share_queue(const std::string& Share) {
+    std::map<std::string, ShareQueue>::iterator i = ShareQueues.find(Share);
+    if (i != ShareQueues.end()) return i->second;
+    ShareQueue& queue = ShareQueues[Share];
+    // Priority 0 would mean share never gets a slot
+    queue.weight = conf.get_basic_priority(Share);
+    if (queue.weight < 1) queue.weight = 1;
+    return queue;
+  }
+
+  bool TransferShares::dispatched(const ShareQueue& Queue) const {
+    // Shares are dispatched while they have queued DTRs
+    return (!Queue.queued.empty() && !(IdleOnly && Queue.running > 0));
+  }
+
+  void TransferShares::change_running(const std::string& Share, int Change) {
+    ShareQueue& queue = share_queue(Share);
+    DispatchOrder.erase(ShareKey(Share, queue));
+    queue.running += Change;
+    if (queue.running < 0) queue.running = 0;
+    if (dispatched(queue)) {
+      DispatchOrder.insert(ShareKey(Share, queue));
+    } else if (queue.queued.empty() && queue.running == 0) {
+      // Forget share with nothing to do
+      ShareQueues.erase(Share);
+    }
+  }
+
+  void TransferShares::queue_dtr(DTR_ptr DTRToQueue) {
+    int priority = DTRToQueue->get_priority();
+    std::map<std::string, int>::iterator queued = QueuedDTRs.find(DTRToQueue->get_id());
+    if (queued != QueuedDTRs.end()) {
+      if (queued->second == priority) return;
+      // Entry with old priority is dropped when it reaches top of queue
+      queued->second = priority;
+    } else {
+      QueuedDTRs[DTRToQueue->get_id()] = priority;
+    }
+    std::string share(DTRToQueue->get_transfer_share());
+    ShareQueue& queue = share_queue(share);
+    queue.queued.push_back(QueuedDTR(DTRToQueue, priority, QueuedCount++));
+    std::push_heap(queue.queued.begin(), queue.queued.end());
+    // Position of share does not depend on its queued DTRs
+    if (dispatched(queue)) DispatchOrder.insert(ShareKey(share, queue));
+  }
+
+  void TransferShares::remove_dtr(DTR_ptr DTRToRemove) {
+    // Entry is dropped when it reaches top of queue
+    QueuedDTRs.erase(DTRToRemove->get_id());
+  }
+
+  void TransferShares::add_running(const std::string& ShareRunning) {
+    change_running(ShareRunning, 1);
+  }
+
+  void TransferShares::finished(const std::string& ShareFinished) {
+    change_running(ShareFinished, -1);
+  }
+
+  bool TransferShares::next_dtr(DTR_ptr& NextDTR) {
+    while (!DispatchOrder.empty()) {
+      std::set<ShareKey>::iterator first = DispatchOrder.begin();
+      ShareQueue& queue = share_queue(first->name);
+      if (queue.queued.empty()) {
+        // all DTRs of share were taken without being started
+        std::string share(first->name);
+        DispatchOrder.erase(first);
+        if (queue.running == 0) ShareQueues.erase(share);
+        continue;
+      }
+      std::pop_heap(queue.queued.begin(), queue.queued.end());
+      QueuedDTR entry(queue.queued.back());
+      queue.queued.pop_back();
+      std::map<std::string, int>::iterator queued = QueuedDTRs.find(entry.dtr->get_id());
+      // DTR was removed or queued again with other priority
+      if (queued == QueuedDTRs.end() || queued->second != entry.priority) continue;
+      if (entry.dtr->get_priority() != entry.priority) {
+        // Priority changed while in queue - put it back to proper place
+        queued->second = entry.dtr->get_priority();
+        queue.queued.push_back(QueuedDTR(entry.dtr, queued->second, entry.order));
+        std::push_heap(queue.queued.begin(), queue.queued.end());
+        continue;
+      }
+      QueuedDTRs.erase(queued);
+      NextDTR = entry.dtr;
+      return true;
+    }
+    return false;
+  }
+
+  void TransferShares::started(const std::string& ShareStarted) {
+    change_running(ShareStarted, 1);
+  }
+
+  void TransferShares::restrict_to_idle_shares() {
+    if (IdleOnly) return;
+    IdleOnly = true;
+    // busy shares are ordered after all idle ones
+    std::set<ShareKey>::iterator first_busy = DispatchOrder.begin();
+    while (first_busy != DispatchOrder.end() && !first_busy->busy) ++first_busy;
+    DispatchOrder.erase(first_busy, DispatchOrder.end());
+  }
+
+  void TransferShares::allow_all_shares() {
+    if (!IdleOnly) return;
+    IdleOnly = false;
+    for (std::map<std::string, ShareQueue>::iterator i = ShareQueues.begin(); i != ShareQueues.end(); ++i) {
+      if (dispatched(i->second)) DispatchOrder.insert(ShareKey(i->first, i->second));
+    }
+  }
+
 }
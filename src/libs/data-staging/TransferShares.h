@@ -2,6 +2,8 @@
 #define TRANSFERSHARES_H_
 
 #include <map>
+#include <set>
+#include <vector>
 
 #include "DTR.h"
 
@@ -82,6 +84,17 @@ namespace DataStaging {
    * configuration and the currently active shares (the DTRs already in the
    * process). can_start() is the method called by the Scheduler to
    * determine whether a particular share has an available slot in the process.
+   *
+   * Alternatively DTRs may be dispatched through weighted fair queueing.
+   * Queued DTRs are put into per-share priority queues with queue_dtr()
+   * when they enter the queue and running DTRs are counted with started()
+   * or add_running() and released with finished(). next_dtr() then gives
+   * the DTR to start next, taking it from the share which uses the fewest
+   * slots relative to its priority. Each share without running DTRs is
+   * served first, so every share has a chance to start. The state is kept
+   * between dispatching rounds, so queueing, choosing and finishing a DTR
+   * each cost O(log n) in the number of shares and queued DTRs, independent
+   * of how many DTRs wait in the queue.
    * \ingroup datastaging
    * \headerfile TransferShares.h arc/data-staging/TransferShares.h
    */
@@ -98,10 +111,81 @@ namespace DataStaging {
     /// How many transfer slots each active share can grab
     std::map<std::string, int> ActiveSharesSlots;
 
+    /// DTR waiting in priority queue of share
+    class QueuedDTR {
+     public:
+      DTR_ptr dtr;
+      int priority;
+      /// Order of arrival, to keep DTRs of same priority in queue order
+      unsigned int order;
+      QueuedDTR(DTR_ptr dtr, int priority, unsigned int order):
+        dtr(dtr), priority(priority), order(order) {};
+      /// Heap ordering - DTR with highest priority is on top
+      bool operator<(const QueuedDTR& other) const {
+        if (priority != other.priority) return priority < other.priority;
+        return order > other.order;
+      };
+    };
+
+    /// Queued and running DTRs of share for weighted fair queueing
+    class ShareQueue {
+     public:
+      /// Weight of share, its priority
+      int weight;
+      /// Number of slots used by share
+      int running;
+      /// Heap of queued DTRs
+      std::vector<QueuedDTR> queued;
+      ShareQueue(): weight(1), running(0) {};
+    };
+
+    /// Position of share in dispatching order
+    class ShareKey {
+     public:
+      /// Shares without running DTRs go first
+      bool busy;
+      /// Slots used by share after starting next DTR relative to its weight
+      double finish;
+      std::string name;
+      ShareKey(const std::string& name, const ShareQueue& queue):
+        busy(queue.running > 0), finish(double(queue.running + 1) / double(queue.weight)), name(name) {};
+      bool operator<(const ShareKey& other) const {
+        if (busy != other.busy) return other.busy;
+        if (finish != other.finish) return finish < other.finish;
+        return name < other.name;
+      };
+    };
+
+    /// Priority queues of shares with queued or running DTRs
+    std::map<std::string, ShareQueue> ShareQueues;
+
+    /// Shares with queued DTRs in the order they are going to be served
+    std::set<ShareKey> DispatchOrder;
+
+    /// Counter of DTRs queued with queue_dtr()
+    unsigned int QueuedCount;
+
+    /// Ids of DTRs in queues and priorities of their valid entries. Entries
+    /// of DTRs not listed here or with other priority are dropped when they
+    /// reach top of queue.
+    std::map<std::string, int> QueuedDTRs;
+
+    /// Only shares without running DTRs may start new DTRs
+    bool IdleOnly;
+
+    /// Get queue of share, creating it with weight of share if necessary
+    ShareQueue& share_queue(const std::string& Share);
+
+    /// Change number of running DTRs of share, updating its dispatching order
+    void change_running(const std::string& Share, int Change);
+
+    /// Whether share with given queue takes part in dispatching
+    bool dispatched(const ShareQueue& Queue) const;
+
    public:
 
     /// Create a new TransferShares with default configuration
-    TransferShares() {};
+    TransferShares() : QueuedCount(0), IdleOnly(false) {};
 
     /// Create a new TransferShares with given configuration
     TransferShares(const TransferSharesConf& shares_conf);
@@ -138,6 +222,49 @@ namespace DataStaging {
     /// Returns the map of active shares
     std::map<std::string, int> active_shares() const;
 
+    /// Put a queued DTR into the priority queue of its share.
+    /**
+     * Called when DTR enters the queue. If DTR is already queued this only
+     * takes into account change of its priority.
+     */
+    void queue_dtr(DTR_ptr DTRToQueue);
+
+    /// Take DTR out of queue without starting it through next_dtr().
+    void remove_dtr(DTR_ptr DTRToRemove);
+
+    /// Count one slot of the given share as used by a running DTR.
+    void add_running(const std::string& ShareRunning);
+
+    /// Free slot of the given share used by DTR which finished processing.
+    void finished(const std::string& ShareFinished);
+
+    /// Take the next DTR to start out of the queues.
+    /**
+     * The DTR with highest priority is taken from the share with fewest
+     * used slots relative to its priority, preferring shares which have no
+     * running DTRs. The share keeps its position until started() is called,
+     * so if the DTR can not be started the next DTR of the same share is
+     * taken by the following call. Returned DTR is not in queue anymore
+     * and must be queued again with queue_dtr() if it was not started.
+     * Caller must also check that DTR is still in the queue state because
+     * DTRs which left queue in other ways are dropped only here.
+     * @return false if there are no more DTRs which may be started
+     */
+    bool next_dtr(DTR_ptr& NextDTR);
+
+    /// Count DTR of the given share obtained from next_dtr() as started.
+    void started(const std::string& ShareStarted);
+
+    /// From now on allow only shares without running DTRs to start DTRs.
+    /**
+     * This is used when all regular slots are taken and the remaining
+     * emergency slots are reserved for shares which have nothing running.
+     */
+    void restrict_to_idle_shares();
+
+    /// Allow all shares to start DTRs again after restrict_to_idle_shares().
+    void allow_all_shares();
+
   }; // class TransferShares
 
 } // namespace DataStaging
@@ -0,0 +1,232 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ctime>
+#include <deque>
+#include <list>
+#include <map>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/StringConv.h>
+
+#include "../TransferShares.h"
+
+using namespace DataStaging;
+
+class TransferSharesTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(TransferSharesTest);
+  CPPUNIT_TEST(TestPriorityOrder);
+  CPPUNIT_TEST(TestFairness);
+  CPPUNIT_TEST(TestEmergencySlots);
+  CPPUNIT_TEST(TestFinished);
+  CPPUNIT_TEST(TestDispatchCost);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestPriorityOrder();
+  void TestFairness();
+  void TestEmergencySlots();
+  void TestFinished();
+  void TestDispatchCost();
+
+  void setUp();
+  void tearDown();
+
+private:
+  std::list<DTRLogDestination> logs;
+  char const * log_name;
+  Arc::UserConfig cfg;
+  TransferSharesConf conf;
+  DTR_ptr CreateDTR(const std::string& share, int priority);
+};
+
+void TransferSharesTest::setUp() {
+  logs.clear();
+  const std::list<Arc::LogDestination*>& destinations = Arc::Logger::getRootLogger().getDestinations();
+  for(std::list<Arc::LogDestination*>::const_iterator dest = destinations.begin(); dest != destinations.end(); ++dest) {
+    logs.push_back(*dest);
+  }
+  log_name = "DataStagingTest";
+  std::map<std::string, int> ref_shares;
+  ref_shares["a"] = 60;
+  ref_shares["b"] = 30;
+  ref_shares["c"] = 10;
+  conf.set_reference_shares(ref_shares);
+}
+
+void TransferSharesTest::tearDown() {
+}
+
+DTR_ptr TransferSharesTest::CreateDTR(const std::string& share, int priority) {
+  static int count = 0;
+  ++count;
+  std::string source("mock://mocksrc/" + Arc::tostring(count));
+  std::string destination("mock://mockdest/" + Arc::tostring(count));
+  DTR_ptr dtr(new DTR(source, destination, cfg, "123456789", Arc::User().get_uid(), logs, log_name));
+  CPPUNIT_ASSERT(*dtr);
+  dtr->set_transfer_share(share);
+  dtr->set_priority(priority);
+  return dtr;
+}
+
+void TransferSharesTest::TestPriorityOrder() {
+  TransferShares shares(conf);
+  std::list<DTR_ptr> dtrs;
+  int priorities[] = { 50, 70, 50, 10, 90 };
+  for (int n = 0; n < 5; ++n) {
+    DTR_ptr dtr(CreateDTR("a", priorities[n]));
+    dtrs.push_back(dtr);
+    shares.queue_dtr(dtr);
+  }
+  std::list<DTR_ptr>::iterator first50 = dtrs.begin();
+  std::list<DTR_ptr>::iterator second50 = first50; ++second50; ++second50;
+
+  DTR_ptr next;
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT_EQUAL(90, next->get_priority());
+  // DTR which was not started is not returned again
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT_EQUAL(70, next->get_priority());
+  shares.started("a");
+  // DTRs of same priority keep queue order
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT(next == *first50);
+  shares.started("a");
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT(next == *second50);
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT_EQUAL(10, next->get_priority());
+  CPPUNIT_ASSERT(!shares.next_dtr(next));
+}
+
+void TransferSharesTest::TestFairness() {
+  // Simulate Scheduler loops with all shares having long queues. Each loop
+  // some transfers finish in order they were started and free slots are
+  // filled again. Slots must always be divided according to priorities.
+  const unsigned int slots = 10;
+  std::map<std::string, std::deque<DTR_ptr> > queued;
+  const char* names[] = { "a", "b", "c" };
+  for (int s = 0; s < 3; ++s) {
+    for (int n = 0; n < 80; ++n) queued[names[s]].push_back(CreateDTR(names[s], 50));
+  }
+  std::deque<DTR_ptr> running;
+  std::map<std::string, int> started;
+  for (int loop = 0; loop < 20; ++loop) {
+    for (int n = 0; n < 3 && !running.empty(); ++n) running.pop_front();
+
+    TransferShares shares(conf);
+    for (std::map<std::string, std::deque<DTR_ptr> >::iterator q = queued.begin(); q != queued.end(); ++q) {
+      for (std::deque<DTR_ptr>::iterator dtr = q->second.begin(); dtr != q->second.end(); ++dtr) {
+        shares.queue_dtr(*dtr);
+      }
+    }
+    for (std::deque<DTR_ptr>::iterator dtr = running.begin(); dtr != running.end(); ++dtr) {
+      shares.add_running((*dtr)->get_transfer_share());
+    }
+    DTR_ptr next;
+    while (running.size() < slots && shares.next_dtr(next)) {
+      std::string share(next->get_transfer_share());
+      shares.started(share);
+      running.push_back(next);
+      ++started[share];
+      std::deque<DTR_ptr>& queue = queued[share];
+      for (std::deque<DTR_ptr>::iterator dtr = queue.begin(); dtr != queue.end(); ++dtr) {
+        if (*dtr == next) {
+          queue.erase(dtr);
+          break;
+        }
+      }
+    }
+
+    std::map<std::string, int> used;
+    for (std::deque<DTR_ptr>::iterator dtr = running.begin(); dtr != running.end(); ++dtr) {
+      ++used[(*dtr)->get_transfer_share()];
+    }
+    CPPUNIT_ASSERT_EQUAL(6, used["a"]);
+    CPPUNIT_ASSERT_EQUAL(3, used["b"]);
+    CPPUNIT_ASSERT_EQUAL(1, used["c"]);
+  }
+  CPPUNIT_ASSERT(started["a"] > started["b"]);
+  CPPUNIT_ASSERT(started["b"] > started["c"]);
+}
+
+void TransferSharesTest::TestEmergencySlots() {
+  TransferShares shares(conf);
+  for (int n = 0; n < 5; ++n) {
+    shares.queue_dtr(CreateDTR("a", 50));
+    shares.queue_dtr(CreateDTR("d", 50));
+  }
+  // All regular slots are used by share a
+  for (int n = 0; n < 10; ++n) shares.add_running("a");
+  shares.restrict_to_idle_shares();
+
+  // Only one DTR of share without running DTRs may start
+  DTR_ptr next;
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT_EQUAL(std::string("d"), next->get_transfer_share());
+  shares.started("d");
+  CPPUNIT_ASSERT(!shares.next_dtr(next));
+}
+
+void TransferSharesTest::TestFinished() {
+  // State is kept between passes, so finishing transfers moves share back
+  TransferShares shares(conf);
+  for (int n = 0; n < 2; ++n) {
+    shares.queue_dtr(CreateDTR("a", 50));
+    shares.queue_dtr(CreateDTR("b", 50));
+  }
+  DTR_ptr next;
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  std::string first(next->get_transfer_share());
+  shares.started(first);
+  // Share without running transfers goes first
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  std::string second(next->get_transfer_share());
+  CPPUNIT_ASSERT(first != second);
+  shares.started(second);
+  shares.finished(first);
+  shares.finished(second);
+  shares.started(second);
+  CPPUNIT_ASSERT(shares.next_dtr(next));
+  CPPUNIT_ASSERT_EQUAL(first, next->get_transfer_share());
+  shares.started(first);
+  CPPUNIT_ASSERT(!shares.next_dtr(next));
+}
+
+static double DispatchTime(TransferShares& shares, unsigned int rounds) {
+  // Steady state: one transfer finishes and is replaced from the queue
+  // which keeps its length constant.
+  std::clock_t start = std::clock();
+  DTR_ptr next;
+  for (unsigned int n = 0; n < rounds; ++n) {
+    if (!shares.next_dtr(next)) break;
+    std::string share(next->get_transfer_share());
+    shares.started(share);
+    shares.finished(share);
+    shares.queue_dtr(next);
+  }
+  return (double)(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+void TransferSharesTest::TestDispatchCost() {
+  // Cost of each dispatch must not grow with queue length
+  const char* names[] = { "a", "b", "c" };
+  const unsigned int rounds = 20000;
+  TransferShares short_queue(conf);
+  TransferShares long_queue(conf);
+  for (int n = 0; n < 30; ++n) short_queue.queue_dtr(CreateDTR(names[n%3], 50));
+  for (int n = 0; n < 3000; ++n) long_queue.queue_dtr(CreateDTR(names[n%3], 50));
+  // Warm up caches before measuring
+  DispatchTime(short_queue, rounds);
+  DispatchTime(long_queue, rounds);
+  double short_time = DispatchTime(short_queue, rounds);
+  double long_time = DispatchTime(long_queue, rounds);
+  // Queue is 100 times longer, logarithmic heap cost is allowed
+  CPPUNIT_ASSERT(long_time < 5 * short_time + 0.05);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TransferSharesTest);
@@ -24,6 +24,7 @@
 #include <arc/otokens/openid_metadata.h>
 #include "grid-manager/log/JobLog.h"
 #include "grid-manager/log/JobsMetrics.h"
+#include "grid-manager/log/JobsSummary.h"
 #include "grid-manager/log/HeartBeatMetrics.h"
 #include "grid-manager/log/SpaceMetrics.h"
 #include "grid-manager/run/RunPlugin.h"
@@ -1091,6 +1092,7 @@ ARexService::ARexService(Arc::Config *cfg,Arc::PluginArgument *parg):Arc::Servic
   valid = false;
   config_.SetJobLog(new JobLog());
   config_.SetJobsMetrics(new JobsMetrics());
+  config_.SetJobsSummary(new JobsSummary());
   config_.SetHeartBeatMetrics(new HeartBeatMetrics());
   config_.SetSpaceMetrics(new SpaceMetrics());
   config_.SetJobPerfLog(new Arc::JobPerfLog());
@@ -1143,6 +1145,8 @@ ARexService::ARexService(Arc::Config *cfg,Arc::PluginArgument *parg):Arc::Servic
       break;
     };
     delegation_stores_.SetDbType(deleg_db_type);
+    // Have keys for new delegations ready in advance
+    Arc::DelegationConsumer::KeyPoolSize(config_.DelegationKeyPool());
   };
 
   // Set default queue if none given
@@ -1210,6 +1214,7 @@ ARexService::~ARexService(void) {
   delete config_.GetJobLog();
   delete config_.GetJobPerfLog();
   delete config_.GetJobsMetrics();
+  delete config_.GetJobsSummary();
   delete config_.GetHeartBeatMetrics();
   delete config_.GetSpaceMetrics();
 }
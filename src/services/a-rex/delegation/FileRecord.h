@@ -4,6 +4,8 @@
 #include <list>
 #include <string>
 
+#include <glibmm/thread.h>
+
 namespace ARex {
 
 class FileRecord {
@@ -11,6 +13,7 @@ class FileRecord {
   std::string basepath_;
   int error_num_;
   std::string error_str_;
+  Glib::Mutex error_lock_; // protects error_num_ and error_str_
   bool valid_;
   std::string uid_to_path(const std::string& uid);
   bool make_file(const std::string& uid);
@@ -51,7 +54,10 @@ class FileRecord {
   bool operator!(void) { return !valid_; };
 
   /// Returns textual description of last error.
-  std::string Error(void) { return error_str_; };
+  std::string Error(void) {
+    Glib::Mutex::Lock lock(error_lock_);
+    return error_str_;
+  };
 
   /// Obtain an iterator for walking through existing credentials slots.
   virtual Iterator* NewIterator(void) = 0;
@@ -29,8 +29,65 @@ namespace ARex {
 
   #define FR_DB_NAME "list"
 
+  // Maximal number of idle connections kept for lookups
+  #define FR_MAX_READERS (8)
+
+  // Use of prepared statement. Statement is reset and its bindings
+  // cleared on destruction so that it can be used again.
+  class SQLiteStatement {
+   public:
+    SQLiteStatement(sqlite3_stmt* stmt): stmt_(stmt) {};
+    ~SQLiteStatement(void) {
+      if(stmt_) {
+        (void)sqlite3_reset(stmt_);
+        (void)sqlite3_clear_bindings(stmt_);
+      };
+    };
+    operator bool(void) const { return (stmt_ != NULL); };
+    bool operator!(void) const { return (stmt_ == NULL); };
+    void bind(int n, const std::string& val) {
+      (void)sqlite3_bind_text(stmt_, n, val.c_str(), val.length(), SQLITE_TRANSIENT);
+    };
+    void bind(int n, sqlite3_int64 val) {
+      (void)sqlite3_bind_int64(stmt_, n, val);
+    };
+    int step(void) {
+      int err;
+      while((err = sqlite3_step(stmt_)) == SQLITE_BUSY) {
+        struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+        (void)::nanosleep(&delay, NULL);
+      };
+      return err;
+    };
+    const char* text(int n) {
+      return (const char*)sqlite3_column_text(stmt_, n);
+    };
+    std::string str(int n) {
+      const char* t = text(n);
+      return t ? std::string(t) : std::string();
+    };
+    sqlite3_int64 int64(int n) {
+      return sqlite3_column_int64(stmt_, n);
+    };
+   private:
+    sqlite3_stmt* stmt_;
+  };
+
+  class FileRecordSQLite::Reader {
+   public:
+    Reader(FileRecordSQLite& frec): frec_(frec), conn_(frec.acquire_reader()) {};
+    ~Reader(void) { if(conn_) frec_.release_reader(conn_); };
+    operator bool(void) const { return (conn_ != NULL); };
+    bool operator!(void) const { return (conn_ == NULL); };
+    Connection& operator*(void) { return *conn_; };
+   private:
+    FileRecordSQLite& frec_;
+    Connection* conn_;
+  };
+
   bool FileRecordSQLite::dberr(const char* s, int err) {
     if(err == SQLITE_OK) return true;
+    Glib::Mutex::Lock lock(error_lock_);
     error_num_ = err;
 #ifdef HAVE_SQLITE3_ERRSTR
     error_str_ = std::string(s)+": "+sqlite3_errstr(err);
@@ -40,9 +97,13 @@ namespace ARex {
     return false;
   }
 
+  void FileRecordSQLite::seterr(const std::string& s) {
+    Glib::Mutex::Lock lock(error_lock_);
+    error_str_ = s;
+  }
+
   FileRecordSQLite::FileRecordSQLite(const std::string& base, bool create):
-      FileRecord(base, create),
-      db_(NULL) {
+      FileRecord(base, create) {
     valid_ = open(create);
   }
 
@@ -58,7 +119,7 @@ namespace ARex {
   int FileRecordSQLite::sqlite3_exec_nobusy(const char *sql, int (*callback)(void*,int,char**,char**), 
     void *arg, char **errmsg) {
       int err;
-      while((err = sqlite3_exec(db_, sql, callback, arg, errmsg)) == SQLITE_BUSY) {
+      while((err = sqlite3_exec(db_.handle, sql, callback, arg, errmsg)) == SQLITE_BUSY) {
         // Access to database is designed in such way that it should not block for long time.
         // So it should be safe to simply wait for lock to be released without any timeout.
         struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
@@ -67,53 +128,126 @@ namespace ARex {
       return err;
   }
 
-  bool FileRecordSQLite::open(bool create) {
+  bool FileRecordSQLite::open_connection(Connection& conn, int flags) {
     std::string dbpath = basepath_ + G_DIR_SEPARATOR_S + FR_DB_NAME;
-    if(db_ != NULL) return true; // already open
-
-    int flags = SQLITE_OPEN_READWRITE; // it will open read-only if access is protected
-    if(create) {
-      flags |= SQLITE_OPEN_CREATE;
-    };
     int err;
-    while((err = sqlite3_open_v2(dbpath.c_str(), &db_, flags, NULL)) == SQLITE_BUSY) {
+    while((err = sqlite3_open_v2(dbpath.c_str(), &conn.handle, flags, NULL)) == SQLITE_BUSY) {
       // In case something prevents databasre from open right now - retry
-      if(db_) (void)sqlite3_close(db_);
-      db_ = NULL;
+      if(conn.handle) (void)sqlite3_close(conn.handle);
+      conn.handle = NULL;
       struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
       (void)::nanosleep(&delay, NULL);
     };
     if(!dberr("Error opening database", err)) {
-      if(db_) (void)sqlite3_close(db_);
-      db_ = NULL;
+      if(conn.handle) (void)sqlite3_close(conn.handle);
+      conn.handle = NULL;
+      return false;
+    };
+    return true;
+  }
+
+  void FileRecordSQLite::close_connection(Connection& conn) {
+    for(std::map<std::string,sqlite3_stmt*>::iterator s = conn.statements.begin();
+                                           s != conn.statements.end(); ++s) {
+      (void)sqlite3_finalize(s->second);
+    };
+    conn.statements.clear();
+    if(conn.handle) {
+      (void)sqlite3_close(conn.handle); // todo: handle error
+      conn.handle = NULL;
+    };
+  }
+
+  sqlite3_stmt* FileRecordSQLite::prepare(Connection& conn, const char* sql) {
+    std::map<std::string,sqlite3_stmt*>::iterator s = conn.statements.find(sql);
+    if(s != conn.statements.end()) return s->second;
+    sqlite3_stmt* stmt = NULL;
+    int err;
+    while((err = sqlite3_prepare_v2(conn.handle, sql, -1, &stmt, NULL)) == SQLITE_BUSY) {
+      struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+      (void)::nanosleep(&delay, NULL);
+    };
+    if(!dberr("Failed to prepare database statement", err)) {
+      if(stmt) (void)sqlite3_finalize(stmt);
+      return NULL;
+    };
+    conn.statements[sql] = stmt;
+    return stmt;
+  }
+
+  FileRecordSQLite::Connection* FileRecordSQLite::acquire_reader(void) {
+    {
+      Glib::Mutex::Lock lock(readers_lock_);
+      if(!readers_.empty()) {
+        Connection* conn = readers_.front();
+        readers_.pop_front();
+        return conn;
+      };
+    };
+    // Each connection is used by single thread at a time hence no need for SQLite mutexes.
+    Connection* conn = new Connection;
+    if(!open_connection(*conn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX)) {
+      delete conn;
+      return NULL;
+    };
+    return conn;
+  }
+
+  void FileRecordSQLite::release_reader(Connection* conn) {
+    {
+      Glib::Mutex::Lock lock(readers_lock_);
+      if(valid_ && (readers_.size() < FR_MAX_READERS)) {
+        readers_.push_back(conn);
+        return;
+      };
+    };
+    close_connection(*conn);
+    delete conn;
+  }
+
+  static int JournalModeCallback(void* arg, int colnum, char** texts, char** names) {
+    if((colnum > 0) && texts[0]) *((std::string*)arg) = texts[0];
+    return 0;
+  }
+
+  bool FileRecordSQLite::open(bool create) {
+    if(db_.handle != NULL) return true; // already open
+
+    int flags = SQLITE_OPEN_READWRITE; // it will open read-only if access is protected
+    if(create) {
+      flags |= SQLITE_OPEN_CREATE;
+    };
+    if(!open_connection(db_, flags)) {
       return false;
     };
     if(create) {
       if(!dberr("Error creating table rec", sqlite3_exec_nobusy("CREATE TABLE IF NOT EXISTS rec(id, owner, uid, meta, UNIQUE(id, owner), UNIQUE(uid))", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+        close_connection(db_);
         return false;
       };
       if(!dberr("Error creating table lock", sqlite3_exec_nobusy("CREATE TABLE IF NOT EXISTS lock(lockid, uid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+        close_connection(db_);
         return false;
       };
       if(!dberr("Error creating index lockid", sqlite3_exec_nobusy("CREATE INDEX IF NOT EXISTS lockid ON lock (lockid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+        close_connection(db_);
         return false;
       };
       if(!dberr("Error creating index uid", sqlite3_exec_nobusy("CREATE INDEX IF NOT EXISTS uid ON lock (uid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+        close_connection(db_);
         return false;
       };
+      // Write-ahead log lets lookups proceed while records are being modified.
+      // It is not available on every file system (f.e. NFS), so failure is not fatal.
+      std::string mode;
+      (void)sqlite3_exec_nobusy("PRAGMA journal_mode=WAL", &JournalModeCallback, &mode, NULL);
+      if(mode == "wal") {
+        (void)sqlite3_exec_nobusy("PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+      };
     } else {
       // SQLite opens database in lazy way. But we still want to know if it is good database.
       if(!dberr("Error checking database", sqlite3_exec_nobusy("PRAGMA schema_version;", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+        close_connection(db_);
         return false;
       };
     };
@@ -122,19 +256,35 @@ namespace ARex {
 
   void FileRecordSQLite::close(void) {
     valid_ = false;
-    if(db_) {
-      (void)sqlite3_close(db_); // todo: handle error
-      db_ = NULL;
+    {
+      Glib::Mutex::Lock lock(readers_lock_);
+      for(std::list<Connection*>::iterator conn = readers_.begin(); conn != readers_.end(); ++conn) {
+        close_connection(**conn);
+        delete *conn;
+      };
+      readers_.clear();
     };
+    close_connection(db_);
   }
 
-  void store_strings(const std::list<std::string>& strs, std::string& buf) {
-    if(!strs.empty()) {
-      for(std::list<std::string>::const_iterator str = strs.begin(); ; ++str) {
-        buf += sql_escape(*str);
-        if (str == strs.end()) break;
-        buf += '#';
-      };
+  bool FileRecordSQLite::begin(void) {
+    return dberr("Failed to start transaction", sqlite3_exec_nobusy("BEGIN IMMEDIATE", NULL, NULL, NULL));
+  }
+
+  bool FileRecordSQLite::commit(void) {
+    if(dberr("Failed to commit transaction", sqlite3_exec_nobusy("COMMIT", NULL, NULL, NULL))) return true;
+    rollback();
+    return false;
+  }
+
+  void FileRecordSQLite::rollback(void) {
+    (void)sqlite3_exec_nobusy("ROLLBACK", NULL, NULL, NULL);
+  }
+
+  static void store_strings(const std::list<std::string>& strs, std::string& buf) {
+    for(std::list<std::string>::const_iterator str = strs.begin(); str != strs.end(); ++str) {
+      buf += sql_escape(*str);
+      buf += '#';
     };
   }
 
@@ -148,153 +298,61 @@ namespace ARex {
     };
   }
 
+  bool FileRecordSQLite::find_uid(Connection& conn, const std::string& id, const std::string& owner, std::string& uid) {
+    SQLiteStatement stmt(prepare(conn, "SELECT uid FROM rec WHERE ((id = ?) AND (owner = ?))"));
+    if(!stmt) return false;
+    stmt.bind(1, sql_escape(id));
+    stmt.bind(2, sql_escape(owner));
+    int err = stmt.step();
+    if(err == SQLITE_ROW) {
+      uid = stmt.str(0);
+    } else if(err != SQLITE_DONE) {
+      return dberr("Failed to retrieve record from database", err);
+    };
+    return true;
+  }
+
   bool FileRecordSQLite::Recover(void) {
     Glib::Mutex::Lock lock(lock_);
     // Real recovery not implemented yet.
     close();
+    Glib::Mutex::Lock elock(error_lock_);
     error_num_ = -1;
     error_str_ = "Recovery not implemented yet.";
     return false;
   }
 
-  struct FindCallbackRecArg {
-    sqlite3_int64 rowid;
-    std::string id;
-    std::string owner;
-    std::string uid;
-    std::list<std::string> meta;
-    FindCallbackRecArg(): rowid(-1) {};
-  };
-
-  static int FindCallbackRec(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if((strcmp(names[n], "rowid") == 0) || (strcmp(names[n], "_rowid_") == 0)) {
-          (void)Arc::stringto(texts[n], ((FindCallbackRecArg*)arg)->rowid);
-        } else if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackRecArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "id") == 0) {
-          ((FindCallbackRecArg*)arg)->id = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          ((FindCallbackRecArg*)arg)->owner = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackRecArg*)arg)->meta, texts[n]);
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackUidMetaArg {
-    std::string& uid;
-    std::list<std::string>& meta;
-    FindCallbackUidMetaArg(std::string& uid, std::list<std::string>& meta): uid(uid), meta(meta) {};
-  };
-
-  static int FindCallbackUidMeta(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackUidMetaArg*)arg)->meta, texts[n]);
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackUidArg {
-    std::string& uid;
-    FindCallbackUidArg(std::string& uid): uid(uid) {};
-  };
-
-  static int FindCallbackUid(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackCountArg {
-    int count;
-    FindCallbackCountArg():count(0) {};
-  };
-
-  static int FindCallbackCount(void* arg, int colnum, char** texts, char** names) {
-    ((FindCallbackCountArg*)arg)->count += 1;
-    return 0;
-  }
-
-  struct FindCallbackIdOwnerArg {
-    std::list< std::pair<std::string,std::string> >& records;
-    FindCallbackIdOwnerArg(std::list< std::pair<std::string,std::string> >& recs): records(recs) {};
-  };
-
-  static int FindCallbackIdOwner(void* arg, int colnum, char** texts, char** names) {
-    std::pair<std::string,std::string> rec;
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "id") == 0) {
-          rec.first = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          rec.second = sql_unescape(texts[n]);
-        };
-      };
-    };
-    if(!rec.first.empty()) ((FindCallbackIdOwnerArg*)arg)->records.push_back(rec);
-    return 0;
-  }
-
-  struct FindCallbackLockArg {
-    std::list< std::string >& records;
-    FindCallbackLockArg(std::list< std::string >& recs): records(recs) {};
-  };
-
-  static int FindCallbackLock(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "lockid") == 0) {
-          std::string rec = sql_unescape(texts[n]);
-          if(!rec.empty()) ((FindCallbackLockArg*)arg)->records.push_back(rec);
-        };
-      };
-    };
-    return 0;
-  }
-
-
   std::string FileRecordSQLite::Add(std::string& id, const std::string& owner, const std::list<std::string>& meta) {
     if(!valid_) return "";
     int uidtries = 10; // some sane number
     std::string uid;
+    std::string metas;
+    store_strings(meta, metas);
     while(true) {
       if(!(uidtries--)) {
-        error_str_ = "Out of tries adding record to database";
+        seterr("Out of tries adding record to database");
         return "";
       };
       Glib::Mutex::Lock lock(lock_);
       uid = rand_uid64().substr(4);
-      std::string metas;
-      store_strings(meta, metas);
-      std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-               sql_escape(id.empty()?uid:id)+"', '"+
-               sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-      int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
+      SQLiteStatement stmt(prepare(db_, "INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)"));
+      if(!stmt) return "";
+      stmt.bind(1, sql_escape(id.empty()?uid:id));
+      stmt.bind(2, sql_escape(owner));
+      stmt.bind(3, uid);
+      stmt.bind(4, metas);
+      int dbres = stmt.step();
       if(dbres == SQLITE_CONSTRAINT) {
         // retry due to non-unique id
         uid.resize(0);
         continue;
       };
-      if(!dberr("Failed to add record to database", dbres)) {
+      if(dbres != SQLITE_DONE) {
+        dberr("Failed to add record to database", dbres);
         return "";
       };
-      if(sqlite3_changes(db_) != 1) {
-        error_str_ = "Failed to add record to database";
+      if(sqlite3_changes(db_.handle) != 1) {
+        seterr("Failed to add record to database");
         return "";
       };
       break;
@@ -309,15 +367,18 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-             sql_escape(id.empty()?uid:id)+"', '"+
-             sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-    int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
-    if(!dberr("Failed to add record to database", dbres)) {
-      return false;
-    };
-    if(sqlite3_changes(db_) != 1) {
-      error_str_ = "Failed to add record to database";
+    SQLiteStatement stmt(prepare(db_, "INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)"));
+    if(!stmt) return false;
+    stmt.bind(1, sql_escape(id.empty()?uid:id));
+    stmt.bind(2, sql_escape(owner));
+    stmt.bind(3, uid);
+    stmt.bind(4, metas);
+    int dbres = stmt.step();
+    if(dbres != SQLITE_DONE) {
+      return dberr("Failed to add record to database", dbres);
+    };
+    if(sqlite3_changes(db_.handle) != 1) {
+      seterr("Failed to add record to database");
       return false;
     };
     return true;
@@ -325,17 +386,30 @@ namespace ARex {
 
   std::string FileRecordSQLite::Find(const std::string& id, const std::string& owner, std::list<std::string>& meta) {
     if(!valid_) return "";
-    Glib::Mutex::Lock lock(lock_);
-    std::string sqlcmd = "SELECT uid, meta FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
     std::string uid;
-    FindCallbackUidMetaArg arg(uid, meta);
-    if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUidMeta, &arg, NULL))) {
-      return "";
+    // Lookups use own connections and do not wait for modifications
+    std::list<std::string> dbmeta;
+    {
+      Reader reader(*this);
+      if(!reader) return "";
+      SQLiteStatement stmt(prepare(*reader, "SELECT uid, meta FROM rec WHERE ((id = ?) AND (owner = ?))"));
+      if(!stmt) return "";
+      stmt.bind(1, sql_escape(id));
+      stmt.bind(2, sql_escape(owner));
+      int err = stmt.step();
+      if(err == SQLITE_ROW) {
+        uid = stmt.str(0);
+        parse_strings(dbmeta, stmt.text(1));
+      } else if(err != SQLITE_DONE) {
+        dberr("Failed to retrieve record from database", err);
+        return "";
+      };
     };
     if(uid.empty()) {
-      error_str_ = "Failed to retrieve record from database";
+      seterr("Failed to retrieve record from database");
       return "";
     };
+    meta.insert(meta.end(), dbmeta.begin(), dbmeta.end());
     return uid_to_path(uid);
   }
 
@@ -344,12 +418,17 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "UPDATE rec SET meta = '"+metas+"' WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-    if(!dberr("Failed to update record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
-      return false;
-    };
-    if(sqlite3_changes(db_) < 1) {
-      error_str_ = "Failed to find record in database";
+    SQLiteStatement stmt(prepare(db_, "UPDATE rec SET meta = ? WHERE ((id = ?) AND (owner = ?))"));
+    if(!stmt) return false;
+    stmt.bind(1, metas);
+    stmt.bind(2, sql_escape(id));
+    stmt.bind(3, sql_escape(owner));
+    int dbres = stmt.step();
+    if(dbres != SQLITE_DONE) {
+      return dberr("Failed to update record in database", dbres);
+    };
+    if(sqlite3_changes(db_.handle) < 1) {
+      seterr("Failed to find record in database");
       return false;
     };
     return true;
@@ -358,39 +437,52 @@ namespace ARex {
   bool FileRecordSQLite::Remove(const std::string& id, const std::string& owner) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    if(!begin()) return false;
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(db_, id, owner, uid)) {
+      rollback();
+      return false; // No such record?
     };
     if(uid.empty()) {
-      error_str_ = "Record not found";
+      rollback();
+      seterr("Record not found");
       return false; // No such record
     };
+    int dbres = SQLITE_ERROR;
     {
-      std::string sqlcmd = "SELECT uid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackCountArg arg;
-      if(!dberr("Failed to find locks in database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackCount, &arg, NULL))) {
-        return false;
-      };
-      if(arg.count > 0) {
-        error_str_ = "Record has active locks";
-        return false; // have locks
+      SQLiteStatement stmt(prepare(db_, "SELECT uid FROM lock WHERE (uid = ?) LIMIT 1"));
+      if(stmt) {
+        stmt.bind(1, uid);
+        dbres = stmt.step();
       };
     };
+    if(dbres == SQLITE_ROW) {
+      rollback();
+      seterr("Record has active locks");
+      return false; // have locks
+    };
+    if(dbres != SQLITE_DONE) {
+      rollback();
+      return dberr("Failed to find locks in database", dbres);
+    };
+    dbres = SQLITE_ERROR;
     {
-      std::string sqlcmd = "DELETE FROM rec WHERE (uid = '"+uid+"')";
-      if(!dberr("Failed to delete record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
-        return false;
-      };
-      if(sqlite3_changes(db_) < 1) {
-        error_str_ = "Failed to delete record in database";
-        return false; // no such record
+      SQLiteStatement stmt(prepare(db_, "DELETE FROM rec WHERE (uid = ?)"));
+      if(stmt) {
+        stmt.bind(1, uid);
+        dbres = stmt.step();
       };
     };
+    if(dbres != SQLITE_DONE) {
+      rollback();
+      return dberr("Failed to delete record in database", dbres);
+    };
+    if(sqlite3_changes(db_.handle) < 1) {
+      rollback();
+      seterr("Failed to delete record in database");
+      return false; // no such record
+    };
+    if(!commit()) return false;
     remove_file(uid);
     return true;
   }
@@ -398,189 +490,203 @@ namespace ARex {
   bool FileRecordSQLite::AddLock(const std::string& lock_id, const std::list<std::string>& ids, const std::string& owner) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    // All locks are added in single transaction
+    if(!begin()) return false;
     for(std::list<std::string>::const_iterator id = ids.begin(); id != ids.end(); ++id) {
       std::string uid;
-      {
-        std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(*id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-        FindCallbackUidArg arg(uid);
-        if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-          return false; // No such record?
-        };
+      if(!find_uid(db_, *id, owner, uid)) {
+        rollback();
+        return false; // No such record?
       };
       if(uid.empty()) {
         // No such record
         continue;
       };
-      std::string sqlcmd = "INSERT INTO lock(lockid, uid) VALUES ('"+sql_escape(lock_id)+"','"+uid+"')";
-      if(!dberr("addlock:put",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
-        return false;
+      int dbres = SQLITE_ERROR;
+      {
+        SQLiteStatement stmt(prepare(db_, "INSERT INTO lock(lockid, uid) VALUES (?, ?)"));
+        if(stmt) {
+          stmt.bind(1, sql_escape(lock_id));
+          stmt.bind(2, uid);
+          dbres = stmt.step();
+        };
+      };
+      if(dbres != SQLITE_DONE) {
+        rollback();
+        return dberr("addlock:put", dbres);
       };
     };
-    return true;
+    return commit();
   }
 
   bool FileRecordSQLite::RemoveLock(const std::string& lock_id) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
-    // map lock to id,owner 
-    {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
-        return false;
-      };
-      if(sqlite3_changes(db_) < 1) {
-        error_str_ = "";
-        return false;
-      };
+    SQLiteStatement stmt(prepare(db_, "DELETE FROM lock WHERE (lockid = ?)"));
+    if(!stmt) return false;
+    stmt.bind(1, sql_escape(lock_id));
+    int dbres = stmt.step();
+    if(dbres != SQLITE_DONE) {
+      return dberr("removelock:del", dbres);
+    };
+    if(sqlite3_changes(db_.handle) < 1) {
+      seterr("");
+      return false;
     };
     return true;
   }
 
+  // Collects id and owner of records locked by lock_id
+  static int ListLockedRecords(SQLiteStatement& stmt, const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids) {
+    stmt.bind(1, sql_escape(lock_id));
+    int err;
+    while((err = stmt.step()) == SQLITE_ROW) {
+      std::pair<std::string,std::string> rec(sql_unescape(stmt.str(0)), sql_unescape(stmt.str(1)));
+      if(!rec.first.empty()) ids.push_back(rec);
+    };
+    return err;
+  }
+
   bool FileRecordSQLite::RemoveLock(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    if(!begin()) return false;
     // map lock to id,owner 
     {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"'))";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("removelock:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        //return false;
+      SQLiteStatement stmt(prepare(db_, "SELECT id, owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = ?))"));
+      if(stmt) {
+        int dbres = ListLockedRecords(stmt, lock_id, ids);
+        if(dbres != SQLITE_DONE) {
+          (void)dberr("removelock:get", dbres);
+          //return false;
+        };
       };
     };
+    int dbres = SQLITE_ERROR;
     {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
-        return false;
-      };
-      if(sqlite3_changes(db_) < 1) {
-        error_str_ = "";
-        return false;
+      SQLiteStatement stmt(prepare(db_, "DELETE FROM lock WHERE (lockid = ?)"));
+      if(stmt) {
+        stmt.bind(1, sql_escape(lock_id));
+        dbres = stmt.step();
       };
     };
-    return true;
+    if(dbres != SQLITE_DONE) {
+      rollback();
+      return dberr("removelock:del", dbres);
+    };
+    if(sqlite3_changes(db_.handle) < 1) {
+      rollback();
+      seterr("");
+      return false;
+    };
+    return commit();
   }
 
-
   bool FileRecordSQLite::ListLocked(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids) {
     if(!valid_) return false;
-    Glib::Mutex::Lock lock(lock_);
+    Reader reader(*this);
+    if(!reader) return false;
     // map lock to id,owner 
-    {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"'))";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("listlocked:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        return false;
-      };
+    SQLiteStatement stmt(prepare(*reader, "SELECT id, owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = ?))"));
+    if(!stmt) return false;
+    int dbres = ListLockedRecords(stmt, lock_id, ids);
+    if(dbres != SQLITE_DONE) {
+      return dberr("listlocked:get", dbres);
     };
     //if(ids.empty()) return false;
     return true;
   }
 
+  // Collects lock ids returned by statement
+  static int ListLockIds(SQLiteStatement& stmt, std::list<std::string>& locks) {
+    int err;
+    while((err = stmt.step()) == SQLITE_ROW) {
+      std::string rec = sql_unescape(stmt.str(0));
+      if(!rec.empty()) locks.push_back(rec);
+    };
+    return err;
+  }
+
   bool FileRecordSQLite::ListLocks(std::list<std::string>& locks) {
     if(!valid_) return false;
-    Glib::Mutex::Lock lock(lock_);
-    {
-      std::string sqlcmd = "SELECT lockid FROM lock";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
-        return false;
-      };
+    Reader reader(*this);
+    if(!reader) return false;
+    SQLiteStatement stmt(prepare(*reader, "SELECT lockid FROM lock"));
+    if(!stmt) return false;
+    int dbres = ListLockIds(stmt, locks);
+    if(dbres != SQLITE_DONE) {
+      return dberr("listlocks:get", dbres);
     };
     return true;
   }
 
   bool FileRecordSQLite::ListLocks(const std::string& id, const std::string& owner, std::list<std::string>& locks) {
     if(!valid_) return false;
-    Glib::Mutex::Lock lock(lock_);
+    Reader reader(*this);
+    if(!reader) return false;
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(*reader, id, owner, uid)) {
+      return false; // No such record?
     };
     if(uid.empty()) {
-      error_str_ = "Record not found";
+      seterr("Record not found");
       return false; // No such record
     };
-    {
-      std::string sqlcmd = "SELECT lockid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
-        return false;
-      };
+    SQLiteStatement stmt(prepare(*reader, "SELECT lockid FROM lock WHERE (uid = ?)"));
+    if(!stmt) return false;
+    stmt.bind(1, uid);
+    int dbres = ListLockIds(stmt, locks);
+    if(dbres != SQLITE_DONE) {
+      return dberr("listlocks:get", dbres);
     };
     return true;
   }
 
   FileRecordSQLite::Iterator::Iterator(FileRecordSQLite& frec):FileRecord::Iterator(frec) {
     rowid_ = -1;
-    Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec ORDER BY _rowid_ LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        return;
-      };
-      if(arg.uid.empty()) {
-        return;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
+    if(!fetch("SELECT _rowid_, id, owner, uid, meta FROM rec WHERE (_rowid_ > ?) ORDER BY _rowid_ ASC LIMIT 1")) {
+      rowid_ = -1;
     };
   }
 
   FileRecordSQLite::Iterator::~Iterator(void) {
   }
 
+  bool FileRecordSQLite::Iterator::fetch(const char* sql) {
+    FileRecordSQLite& frec((FileRecordSQLite&)frec_);
+    FileRecordSQLite::Reader reader(frec);
+    if(!reader) return false;
+    SQLiteStatement stmt(frec.prepare(*reader, sql));
+    if(!stmt) return false;
+    stmt.bind(1, rowid_);
+    int dbres = stmt.step();
+    if(dbres != SQLITE_ROW) {
+      if(dbres != SQLITE_DONE) (void)frec.dberr("listlocks:get", dbres);
+      return false;
+    };
+    std::string uid = stmt.str(3);
+    if(uid.empty()) return false;
+    rowid_ = stmt.int64(0);
+    id_ = sql_unescape(stmt.str(1));
+    owner_ = sql_unescape(stmt.str(2));
+    uid_ = uid;
+    meta_.clear();
+    parse_strings(meta_, stmt.text(4));
+    return true;
+  }
+
   FileRecordSQLite::Iterator& FileRecordSQLite::Iterator::operator++(void) {
     if(rowid_ == -1) return *this;
-    FileRecordSQLite& frec((FileRecordSQLite&)frec_);
-    Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ > " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ ASC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
+    if(!fetch("SELECT _rowid_, id, owner, uid, meta FROM rec WHERE (_rowid_ > ?) ORDER BY _rowid_ ASC LIMIT 1")) {
+      rowid_ = -1;
     };
     return *this;
   }
 
   FileRecordSQLite::Iterator& FileRecordSQLite::Iterator::operator--(void) {
     if(rowid_ == -1) return *this;
-    FileRecordSQLite& frec((FileRecordSQLite&)frec_);
-    Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ < " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ DESC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
+    if(!fetch("SELECT _rowid_, id, owner, uid, meta FROM rec WHERE (_rowid_ < ?) ORDER BY _rowid_ DESC LIMIT 1")) {
+      rowid_ = -1;
     };
     return *this;
   }
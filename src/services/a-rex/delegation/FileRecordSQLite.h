@@ -2,6 +2,7 @@
 #define __ARC_DELEGATION_FILERECORDSQLITE_H__
 
 #include <list>
+#include <map>
 #include <string>
 
 #include <sqlite3.h>
@@ -14,11 +15,33 @@ namespace ARex {
 
 class FileRecordSQLite: public FileRecord {
  private:
-  Glib::Mutex lock_; // TODO: use DB locking
-  sqlite3* db_;
+  // Database connection together with statements prepared on it.
+  // Each connection is used by one thread at a time.
+  struct Connection {
+    sqlite3* handle;
+    std::map<std::string,sqlite3_stmt*> statements;
+    Connection(void): handle(NULL) {};
+  };
+  // Takes reading connection from pool and returns it back on destruction.
+  class Reader;
+  friend class Reader;
+  Glib::Mutex lock_; // serializes modifications and protects db_
+  Connection db_;    // connection used for modifications
+  Glib::Mutex readers_lock_;
+  std::list<Connection*> readers_; // idle connections used for lookups
   int sqlite3_exec_nobusy(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
   bool dberr(const char* s, int err);
+  void seterr(const std::string& s);
   bool open(bool create);
+  bool open_connection(Connection& conn, int flags);
+  void close_connection(Connection& conn);
+  sqlite3_stmt* prepare(Connection& conn, const char* sql);
+  Connection* acquire_reader(void);
+  void release_reader(Connection* conn);
+  bool find_uid(Connection& conn, const std::string& id, const std::string& owner, std::string& uid);
+  bool begin(void);
+  bool commit(void);
+  void rollback(void);
   void close(void);
   bool verify(void);
  public:
@@ -28,6 +51,7 @@ class FileRecordSQLite: public FileRecord {
     Iterator(const Iterator&); // disabled constructor
     Iterator(FileRecordSQLite& frec);
     sqlite3_int64 rowid_;
+    bool fetch(const char* sql);
    public:
     ~Iterator(void);
     virtual Iterator& operator++(void);
@@ -65,4 +89,3 @@ class FileRecordSQLite: public FileRecord {
 } // namespace ARex
 
 #endif // __ARC_DELEGATION_FiLERECORDSQLITE_H__
-
@@ -0,0 +1,114 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#include <arc/DateTime.h>
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+
+#include "FileRecordSQLite.h"
+
+// Measures how many delegation lookups per second several threads can do
+// sharing one FileRecordSQLite. Every 10th request also lists locks and
+// every 100th adds and removes a lock, similar to mix of REST requests and
+// job state transitions handled by A-REX.
+
+struct LookupArg {
+  ARex::FileRecordSQLite* frec;
+  unsigned int nrecords;
+  unsigned int nlookups;
+  unsigned int seed;
+  unsigned int failures;
+};
+
+static std::string owner_of(unsigned int n) {
+  return "/DC=org/DC=ugrid/O=people/O=KNU/CN=User " + Arc::tostring(n % 100);
+}
+
+static void lookup_thread(void* a) {
+  LookupArg& arg(*(LookupArg*)a);
+  for(unsigned int n = 0; n < arg.nlookups; ++n) {
+    unsigned int r = rand_r(&arg.seed) % arg.nrecords;
+    std::string id = "delegation-" + Arc::tostring(r);
+    std::list<std::string> meta;
+    if(arg.frec->Find(id, owner_of(r), meta).empty()) ++arg.failures;
+    if((n % 10) == 0) {
+      std::list<std::string> locks;
+      if(!arg.frec->ListLocks(id, owner_of(r), locks)) ++arg.failures;
+    };
+    if((n % 100) == 0) {
+      std::string lock_id = "job-" + Arc::tostring(arg.seed) + "-" + Arc::tostring(n);
+      std::list<std::string> ids;
+      ids.push_back(id);
+      if(!arg.frec->AddLock(lock_id, ids, owner_of(r))) ++arg.failures;
+      if(!arg.frec->RemoveLock(lock_id)) ++arg.failures;
+    };
+  };
+}
+
+int main(int argc, char **argv) {
+  // test_delegation_lookup [<threads> [<lookups per thread> [<records>]]]
+  unsigned int nthreads = 8;
+  unsigned int nlookups = 100000;
+  unsigned int nrecords = 1000;
+  if(((argc > 1) && (!Arc::stringto(argv[1], nthreads) || !nthreads)) ||
+     ((argc > 2) && (!Arc::stringto(argv[2], nlookups) || !nlookups)) ||
+     ((argc > 3) && (!Arc::stringto(argv[3], nrecords) || !nrecords))) {
+    std::cerr << "Usage: " << argv[0] << " [<threads> [<lookups per thread> [<records>]]]" << std::endl;
+    return EXIT_FAILURE;
+  };
+  std::string base;
+  if(!Arc::TmpDirCreate(base)) {
+    std::cerr << "Failed to create temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  };
+  int result = EXIT_SUCCESS;
+  {
+    ARex::FileRecordSQLite frec(base, true);
+    if(!frec) {
+      std::cerr << "Failed to open database: " << frec.Error() << std::endl;
+      Arc::DirDelete(base);
+      return EXIT_FAILURE;
+    };
+    for(unsigned int n = 0; n < nrecords; ++n) {
+      std::string id = "delegation-" + Arc::tostring(n);
+      if(frec.Add(id, owner_of(n), std::list<std::string>()).empty()) {
+        std::cerr << "Failed to add record: " << frec.Error() << std::endl;
+        Arc::DirDelete(base);
+        return EXIT_FAILURE;
+      };
+    };
+    std::vector<LookupArg> args(nthreads);
+    Arc::SimpleCounter counter;
+    Arc::Time start;
+    for(unsigned int t = 0; t < nthreads; ++t) {
+      args[t].frec = &frec;
+      args[t].nrecords = nrecords;
+      args[t].nlookups = nlookups;
+      args[t].seed = t + 1;
+      args[t].failures = 0;
+      if(!Arc::CreateThreadFunction(&lookup_thread, &args[t], &counter)) {
+        std::cerr << "Failed to start thread" << std::endl;
+        result = EXIT_FAILURE;
+        break;
+      };
+    };
+    counter.wait();
+    Arc::Period elapsed = Arc::Time() - start;
+    double seconds = elapsed.GetPeriod() + elapsed.GetPeriodNanoseconds()/1000000000.0;
+    unsigned int failures = 0;
+    for(unsigned int t = 0; t < nthreads; ++t) failures += args[t].failures;
+    unsigned long long total = (unsigned long long)nthreads * nlookups;
+    std::cout << nthreads << " threads: " << total << " lookups in " << seconds << " s, "
+              << (seconds > 0 ? total/seconds : 0) << " lookups/s, "
+              << failures << " failures" << std::endl;
+    if(failures) result = EXIT_FAILURE;
+  };
+  Arc::DirDelete(base);
+  return result;
+}
@@ -14,6 +14,7 @@
 #include "jobs/CommFIFO.h"
 #include "log/JobLog.h"
 #include "log/JobsMetrics.h"
+#include "log/JobsSummary.h"
 #include "log/HeartBeatMetrics.h"
 #include "log/SpaceMetrics.h"
 #include "run/RunRedirected.h"
@@ -276,6 +277,13 @@ bool GridManager::thread() {
   jobs_ = &jobs;
   logger.msg(Arc::INFO,"Picking up left jobs");
   jobs.RestartJobs();
+  JobsSummary* summary = config_.GetJobsSummary();
+  if(summary) {
+    // Full scan is done only once, later summary follows state changes
+    std::list<GMJobRef> alljobs;
+    JobsList::GetAllJobs(config_, alljobs);
+    summary->Load(config_, alljobs);
+  }
 
   logger.msg(Arc::INFO, "Starting data staging threads");
   std::string heartbeat_file("gm-heartbeat");
@@ -312,6 +320,7 @@ bool GridManager::thread() {
     }
     JobsMetrics* metrics = config_.GetJobsMetrics();
     if(metrics) metrics->Sync();
+    if(summary) summary->Sync(config_);
     // Process jobs which need attention ASAP
     jobs.ActJobsAttention();
     if(((int)(time(NULL) - poll_job_time)) >= 0) {
@@ -45,6 +45,15 @@ namespace ARex {
          * write record about job state change to accounting log 
          **/
         virtual bool addJobEvent(aar_jobevent_t& events, const std::string& jobid) = 0;
+        /// Start grouping of following updates
+        /**
+         * All updates done till commitTransaction() is called are
+         * written to the database at once. Default implementation
+         * does nothing.
+         **/
+        virtual bool beginTransaction() { return true; }
+        /// Write updates grouped since beginTransaction() call
+        virtual bool commitTransaction() { return true; }
     protected:
         const std::string name;
         bool isValid;
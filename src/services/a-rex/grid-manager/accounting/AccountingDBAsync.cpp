@@ -4,6 +4,7 @@
 
 #include <unistd.h>
 #include <arc/Utils.h>
+#include <arc/DateTime.h>
 
 #include "AccountingDBAsync.h"
 
@@ -12,6 +13,8 @@ namespace ARex {
    friend class AccountingDBAsync;
    public:
     static const std::size_t MaxQueueDepth = 10000;
+    static const unsigned int DefaultBatchSize = 100;
+    static const unsigned int DefaultFlushInterval = 5; // seconds
 
     static AccountingDBThread& Instance();
     bool Push(AccountingDBAsync::Event* event);
@@ -27,6 +30,8 @@ namespace ARex {
     std::map< std::string,Arc::AutoPointer<AccountingDB> > dbs_;
     std::list<AccountingDBAsync::Event*> queue_; // this queue is emptied in destructor
     bool exited_;
+    unsigned int batch_size_;
+    unsigned int flush_interval_;
   };
 
   AccountingDBThread& AccountingDBThread::Instance() {
@@ -34,7 +39,8 @@ namespace ARex {
     return instance;
   }
 
-  AccountingDBThread::AccountingDBThread():exited_(false) {
+  AccountingDBThread::AccountingDBThread():exited_(false),
+             batch_size_(DefaultBatchSize), flush_interval_(DefaultFlushInterval) {
     start();
   }
 
@@ -57,37 +63,68 @@ namespace ARex {
     return true;
   }
 
+  static bool IsQuit(AccountingDBAsync::Event* event) {
+    return (dynamic_cast<AccountingDBAsync::EventQuit*>(event) != NULL);
+  }
+
   void AccountingDBThread::thread() {
-    while(true) {
-      Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
-      if(queue_.empty()) {
-        lock_.wait_nonblock();
-        if(queue_.empty()) continue;
+    bool quit = false;
+    while(!quit) {
+      std::list<AccountingDBAsync::Event*> batch;
+      {
+        Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+        while(queue_.empty()) lock_.wait_nonblock();
+        // Updates are kept in queue till enough of them are collected. The
+        // database is locked for writing only while they are being written
+        // so other writers are not blocked by waiting for more updates.
+        Arc::Time batch_start;
+        while((queue_.size() < batch_size_) && !IsQuit(queue_.back())) {
+          Arc::Period elapsed = Arc::Time() - batch_start;
+          int left = flush_interval_*1000 - (elapsed.GetPeriod()*1000 + elapsed.GetPeriodNanoseconds()/1000000);
+          if(left <= 0) break;
+          (void)lock_.wait_nonblock(left);
+        }
+        batch.swap(queue_);
       }
-      Arc::AutoPointer<AccountingDBAsync::Event> event(queue_.front());
-      queue_.pop_front();
-      AccountingDBAsync::EventQuit* eventQuit = dynamic_cast<AccountingDBAsync::EventQuit*>(event.Ptr());
-      if(eventQuit) break;
-      std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator db = dbs_.find(event->name);
-      if(db == dbs_.end()) continue; // not expected
-      lock.unlock(); // no need to keep lock anymore - db and event are picked up
-
-      AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(event.Ptr());
-      if(eventCreateAAR) {
-        db->second->createAAR(eventCreateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(event.Ptr());
-      if(eventUpdateAAR) {
-        db->second->updateAAR(eventUpdateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(event.Ptr());
-      if(eventAddJobEvent) {
-        db->second->addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
-        continue;
+      // Consecutive updates of same database are written in one
+      // transaction. Every update carries whole AAR or event hence
+      // transaction is always committed on AAR boundary.
+      AccountingDB* batch_db = NULL;
+      for(std::list<AccountingDBAsync::Event*>::iterator e = batch.begin(); e != batch.end(); ++e) {
+        Arc::AutoPointer<AccountingDBAsync::Event> event(*e);
+        if(quit) continue; // nothing expected after quit request
+        if(IsQuit(event.Ptr())) {
+          quit = true;
+          continue;
+        }
+        std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator db = dbs_.find(event->name);
+        if(db == dbs_.end()) continue; // not expected
+        if(batch_db != db->second.Ptr()) {
+          if(batch_db) batch_db->commitTransaction();
+          batch_db = NULL;
+          if((batch.size() > 1) && db->second->beginTransaction()) batch_db = db->second.Ptr();
+        }
+
+        AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(event.Ptr());
+        if(eventCreateAAR) {
+          db->second->createAAR(eventCreateAAR->aar);
+          continue;
+        };
+        AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(event.Ptr());
+        if(eventUpdateAAR) {
+          db->second->updateAAR(eventUpdateAAR->aar);
+          continue;
+        };
+        AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(event.Ptr());
+        if(eventAddJobEvent) {
+          db->second->addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
+          continue;
+        };
       };
+      if(batch_db) batch_db->commitTransaction();
     };
+    Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+    exited_ = true;
   }
 
 
@@ -110,6 +147,13 @@ namespace ARex {
   AccountingDBAsync::~AccountingDBAsync() {
   }
 
+   void AccountingDBAsync::SetBatching(unsigned int batch_size, unsigned int flush_interval) {
+     AccountingDBThread& thread(AccountingDBThread::Instance());
+     Arc::AutoLock<Arc::SimpleCondition> lock(thread.lock_);
+     thread.batch_size_ = batch_size;
+     thread.flush_interval_ = flush_interval;
+   }
+
    bool AccountingDBAsync::createAAR(AAR& aar) {
      return AccountingDBThread::Instance().Push(new EventCreateAAR(name, aar));
    }
@@ -19,6 +19,15 @@ namespace ARex {
 
         virtual bool addJobEvent(aar_jobevent_t& events, const std::string& jobid);
 
+        /// Define how updates are grouped into transactions
+        /**
+         * Updates are queued till either batch_size of them are collected
+         * or flush_interval seconds passed since first of them arrived.
+         * Then they all are written in single transaction. Setting
+         * batch_size to 1 writes every update separately.
+         **/
+        static void SetBatching(unsigned int batch_size, unsigned int flush_interval);
+
         class Event {
          public:
           Event(std::string const& name);
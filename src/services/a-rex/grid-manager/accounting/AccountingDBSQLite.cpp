@@ -6,6 +6,7 @@
 #include <arc/DateTime.h>
 #include <arc/ArcLocation.h>
 #include <sys/stat.h>
+#include <vector>
 
 #include "../../SQLhelpers.h"
 
@@ -28,6 +29,59 @@ namespace ARex {
         return err;
     }
 
+    sqlite3_stmt* AccountingDBSQLite::SQLiteDB::prepare(const std::string& sql) {
+        std::map<std::string, sqlite3_stmt*>::iterator it = statements.find(sql);
+        if (it != statements.end()) {
+            (void)sqlite3_reset(it->second);
+            (void)sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+        sqlite3_stmt* stmt = NULL;
+        int err;
+        while((err = sqlite3_prepare_v2(aDB, sql.c_str(), -1, &stmt, NULL)) == SQLITE_BUSY) {
+            struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+            (void)::nanosleep(&delay, NULL);
+        };
+        if(err != SQLITE_OK) {
+            logError("Failed to prepare SQL statement", err, Arc::ERROR);
+            if (stmt) (void)sqlite3_finalize(stmt);
+            return NULL;
+        }
+        statements[sql] = stmt;
+        return stmt;
+    }
+
+    int AccountingDBSQLite::SQLiteDB::step(sqlite3_stmt* stmt, int (*callback)(void*,int,char**,char**), void *arg) {
+        if (!stmt) return SQLITE_MISUSE;
+        int colnum = sqlite3_column_count(stmt);
+        std::vector<char*> texts(colnum, (char*)NULL);
+        std::vector<char*> names(colnum, (char*)NULL);
+        int err;
+        while (true) {
+            err = sqlite3_step(stmt);
+            if (err == SQLITE_BUSY) {
+                // Same as in exec() - lock is expected to be released soon
+                struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+                (void)::nanosleep(&delay, NULL);
+                continue;
+            }
+            if (err != SQLITE_ROW) break;
+            if (!callback) continue;
+            for (int n = 0; n < colnum; ++n) {
+                names[n] = const_cast<char*>(sqlite3_column_name(stmt, n));
+                texts[n] = reinterpret_cast<char*>(const_cast<unsigned char*>(sqlite3_column_text(stmt, n)));
+            }
+            if ((*callback)(arg, colnum, colnum?&(texts[0]):NULL, colnum?&(names[0]):NULL) != 0) {
+                err = SQLITE_ABORT;
+                break;
+            }
+        }
+        // Keep statement ready for next use and release values bound to it
+        (void)sqlite3_reset(stmt);
+        (void)sqlite3_clear_bindings(stmt);
+        return (err == SQLITE_DONE) ? SQLITE_OK : err;
+    }
+
     AccountingDBSQLite::SQLiteDB::SQLiteDB(const std::string& name, bool create): aDB(NULL) {
         if (aDB != NULL) return; // already open
 
@@ -84,6 +138,10 @@ namespace ARex {
     }
 
     void AccountingDBSQLite::SQLiteDB::closeDB(void) {
+        for (std::map<std::string, sqlite3_stmt*>::iterator it = statements.begin(); it != statements.end(); ++it) {
+            (void)sqlite3_finalize(it->second);
+        }
+        statements.clear();
         if (aDB) {
             (void)sqlite3_close(aDB); // TODO: handle errors?
             aDB = NULL;
@@ -153,18 +211,99 @@ namespace ARex {
     }
 
     AccountingDBSQLite::~AccountingDBSQLite() {
+        if (db && db->inTransaction()) commitTransaction();
         closeSQLiteDB();
     }
 
+    void AccountingDBSQLite::resetCachedIds(void) {
+        db_queue.clear();
+        db_users.clear();
+        db_wlcgvos.clear();
+        db_status.clear();
+        db_endpoints.clear();
+        db_aars.clear();
+        db_aars_order.clear();
+    }
+
+    bool AccountingDBSQLite::beginTransaction() {
+        if (!isValid) return false;
+        initSQLiteDB();
+        Glib::Mutex::Lock lock(lock_);
+        if (db->inTransaction()) return true;
+        // Take write lock immediately to not fail on upgrading it later
+        int err = db->exec("BEGIN IMMEDIATE", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            db->logError("Failed to start database transaction", err, Arc::ERROR);
+            return false;
+        }
+        return true;
+    }
+
+    bool AccountingDBSQLite::commitTransaction() {
+        if (!isValid) return false;
+        initSQLiteDB();
+        Glib::Mutex::Lock lock(lock_);
+        if (!db->inTransaction()) {
+            // Transaction was rolled back by SQLite due to some error. Records
+            // inserted in it are lost and their IDs must not be used anymore.
+            resetCachedIds();
+            return false;
+        }
+        int err = db->exec("COMMIT", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            db->logError("Failed to commit database transaction", err, Arc::ERROR);
+            (void)db->exec("ROLLBACK", NULL, NULL, NULL);
+            resetCachedIds();
+            return false;
+        }
+        return true;
+    }
+
+    // All records of AAR are written at once. If caller already groups
+    // updates in transaction failed AAR is rolled back to savepoint so
+    // that other AARs in same transaction are still written.
+    AccountingDBSQLite::RecordScope AccountingDBSQLite::beginRecord(void) {
+        if (!db->inTransaction()) return beginTransaction() ? OwnTransaction : NoScope;
+        Glib::Mutex::Lock lock(lock_);
+        int err = db->exec("SAVEPOINT aar", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            db->logError("Failed to create savepoint in database transaction", err, Arc::ERROR);
+            return NoScope;
+        }
+        return SavePoint;
+    }
+
+    bool AccountingDBSQLite::endRecord(RecordScope scope, bool result) {
+        if (scope == NoScope) return result;
+        if (result) {
+            if (scope == OwnTransaction) return commitTransaction();
+            Glib::Mutex::Lock lock(lock_);
+            int err = db->exec("RELEASE aar", NULL, NULL, NULL);
+            if (err == SQLITE_OK) return true;
+            db->logError("Failed to release savepoint in database transaction", err, Arc::ERROR);
+        }
+        Glib::Mutex::Lock lock(lock_);
+        if (scope == OwnTransaction) {
+            (void)db->exec("ROLLBACK", NULL, NULL, NULL);
+        } else {
+            (void)db->exec("ROLLBACK TO aar", NULL, NULL, NULL);
+            (void)db->exec("RELEASE aar", NULL, NULL, NULL);
+        }
+        // records inserted since savepoint are lost together with their IDs
+        resetCachedIds();
+        return false;
+    }
+
     // perform insert query and return
     //  0 - failure
     //  id - autoincrement id of the inserted raw
-    unsigned int AccountingDBSQLite::GeneralSQLInsert(const std::string& sql) {
+    unsigned int AccountingDBSQLite::GeneralSQLInsert(sqlite3_stmt* stmt) {
         if (!isValid) return 0;
+        if (!stmt) return 0;
         initSQLiteDB();
         Glib::Mutex::Lock lock(lock_);
         int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
+        err = db->step(stmt);
         if (err != SQLITE_OK) {
             if (err == SQLITE_CONSTRAINT) {
                 db->logError("It seams record exists already", err, Arc::ERROR);
@@ -181,12 +320,13 @@ namespace ARex {
     }
 
     // perform update query
-    bool AccountingDBSQLite::GeneralSQLUpdate(const std::string& sql) {
+    bool AccountingDBSQLite::GeneralSQLUpdate(sqlite3_stmt* stmt) {
         if (!isValid) return false;
+        if (!stmt) return false;
         initSQLiteDB();
         Glib::Mutex::Lock lock(lock_);
         int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
+        err = db->step(stmt);
         if (err != SQLITE_OK ) {
             db->logError("Failed to update data in the database", err, Arc::ERROR);
             return false;
@@ -197,6 +337,20 @@ namespace ARex {
         return true;
     }
 
+    // helpers to bind values to prepared statements
+    // strings are escaped the same way as they always were stored in database
+    static void sql_bind(sqlite3_stmt* stmt, int idx, const std::string& val) {
+        (void)sqlite3_bind_text(stmt, idx, sql_escape(val).c_str(), -1, SQLITE_TRANSIENT);
+    }
+
+    static void sql_bind(sqlite3_stmt* stmt, int idx, const Arc::Time& val) {
+        (void)sqlite3_bind_text(stmt, idx, sql_escape(val).c_str(), -1, SQLITE_TRANSIENT);
+    }
+
+    static void sql_bind(sqlite3_stmt* stmt, int idx, sqlite3_int64 val) {
+        (void)sqlite3_bind_int64(stmt, idx, val);
+    }
+
     // callback to build (name,id) map from database table
     static int ReadIdNameCallback(void* arg, int colnum, char** texts, char** names) {
         name_id_map_t* name_id_map = static_cast<name_id_map_t*>(arg);
@@ -246,8 +400,9 @@ namespace ARex {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO " + sql_escape(table) + " (Name) VALUES ('" + sql_escape(iname) + "')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            sqlite3_stmt* stmt = db->prepare("INSERT INTO " + sql_escape(table) + " (Name) VALUES (?)");
+            if (stmt) sql_bind(stmt, 1, iname);
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 name_id_map->insert(std::pair <std::string, unsigned int>(iname, newid));
                 return newid;
@@ -322,8 +477,12 @@ namespace ARex {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO Endpoints (Interface, URL) VALUES ('" + sql_escape(endpoint.interface) + "', '" + sql_escape(endpoint.url) +"')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            sqlite3_stmt* stmt = db->prepare("INSERT INTO Endpoints (Interface, URL) VALUES (?, ?)");
+            if (stmt) {
+                sql_bind(stmt, 1, endpoint.interface);
+                sql_bind(stmt, 2, endpoint.url);
+            }
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 db_endpoints.insert(std::pair <aar_endpoint_t, unsigned int>(endpoint, newid));
                 return newid;
@@ -351,15 +510,32 @@ namespace ARex {
     unsigned int AccountingDBSQLite::getAARDBId(const AAR& aar) {
         if (!isValid) return 0;
         initSQLiteDB();
+        name_id_map_t::iterator it = db_aars.find(aar.jobid);
+        if (it != db_aars.end()) return it->second;
         unsigned int dbid = 0;
-        std::string sql = "SELECT RecordID FROM AAR WHERE JobID = '" + sql_escape(aar.jobid) + "'";
-        if (db->exec(sql.c_str(), &ReadIdCallback, &dbid, NULL) != SQLITE_OK ) {
+        sqlite3_stmt* stmt = db->prepare("SELECT RecordID FROM AAR WHERE JobID = ?");
+        if (!stmt) return 0;
+        sql_bind(stmt, 1, aar.jobid);
+        if (db->step(stmt, &ReadIdCallback, &dbid) != SQLITE_OK ) {
             logger.msg(Arc::ERROR, "Failed to query AAR database ID for job %s", aar.jobid);
             return 0;
         }
+        if (dbid) rememberAARDBId(aar.jobid, dbid);
         return dbid;
     }
 
+    void AccountingDBSQLite::rememberAARDBId(const std::string& jobid, unsigned int dbid) {
+        // Jobs are reported in order of their progress. Hence only
+        // most recently registered jobs are worth keeping.
+        if (db_aars.insert(std::pair<std::string, unsigned int>(jobid, dbid)).second) {
+            db_aars_order.push_back(jobid);
+            while (db_aars_order.size() > MaxAARIds) {
+                db_aars.erase(db_aars_order.front());
+                db_aars_order.pop_front();
+            }
+        }
+    }
+
     unsigned int AccountingDBSQLite::getAARDBId(const std::string& jobid) {
         AAR aar;
         aar.jobid = jobid;
@@ -369,6 +545,11 @@ namespace ARex {
     bool AccountingDBSQLite::createAAR(AAR& aar) {
         if (!isValid) return false;
         initSQLiteDB();
+        RecordScope scope = beginRecord();
+        return endRecord(scope, insertAAR(aar));
+    }
+
+    bool AccountingDBSQLite::insertAAR(AAR& aar) {
         // get the corresponding IDs in connected tables
         unsigned int endpointid = getDBEndpointId(aar.endpoint);
         if (!endpointid) return false;
@@ -381,38 +562,39 @@ namespace ARex {
         unsigned int statusid = getDBStatusId(aar.status);
         if (!statusid) return false;
         // construct insert statement
-        std::string sql = "INSERT INTO AAR ("
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO AAR ("
             "JobID, LocalJobID, EndpointID, QueueID, UserID, VOID, StatusID, ExitCode, "
             "SubmitTime, EndTime, NodeCount, CPUCount, UsedMemory, UsedVirtMem, UsedWalltime, "
             "UsedCPUUserTime, UsedCPUKernelTime, UsedScratch, StageInVolume, StageOutVolume ) "
-            "VALUES ('" +
-                sql_escape(aar.jobid) + "', '" +
-                sql_escape(aar.localid) + "', " +
-                sql_escape(endpointid) + ", " + 
-                sql_escape(queueid) + ", " + 
-                sql_escape(userid) + ", " + 
-                sql_escape(wlcgvoid) + ", " + 
-                sql_escape(statusid) + ", " +
-                sql_escape(aar.exitcode) + ", " +
-                sql_escape(aar.submittime.GetTime()) + ", " + 
-                sql_escape(aar.endtime.GetTime()) + ", " +
-                sql_escape(aar.nodecount) + ", " + 
-                sql_escape(aar.cpucount) + ", " + 
-                sql_escape(aar.usedmemory) + ", " + 
-                sql_escape(aar.usedvirtmemory) + ", " +
-                sql_escape(aar.usedwalltime) + ", " + 
-                sql_escape(aar.usedcpuusertime) + ", " + 
-                sql_escape(aar.usedcpukerneltime) + ", " +
-                sql_escape(aar.usedscratch) + ", " + 
-                sql_escape(aar.stageinvolume) + ", " + 
-                sql_escape(aar.stageoutvolume) +
-            ")";
-        unsigned int recordid = GeneralSQLInsert(sql);
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.jobid);
+            sql_bind(stmt, 2, aar.localid);
+            sql_bind(stmt, 3, endpointid);
+            sql_bind(stmt, 4, queueid);
+            sql_bind(stmt, 5, userid);
+            sql_bind(stmt, 6, wlcgvoid);
+            sql_bind(stmt, 7, statusid);
+            sql_bind(stmt, 8, aar.exitcode);
+            sql_bind(stmt, 9, aar.submittime.GetTime());
+            sql_bind(stmt, 10, aar.endtime.GetTime());
+            sql_bind(stmt, 11, aar.nodecount);
+            sql_bind(stmt, 12, aar.cpucount);
+            sql_bind(stmt, 13, aar.usedmemory);
+            sql_bind(stmt, 14, aar.usedvirtmemory);
+            sql_bind(stmt, 15, aar.usedwalltime);
+            sql_bind(stmt, 16, aar.usedcpuusertime);
+            sql_bind(stmt, 17, aar.usedcpukerneltime);
+            sql_bind(stmt, 18, aar.usedscratch);
+            sql_bind(stmt, 19, aar.stageinvolume);
+            sql_bind(stmt, 20, aar.stageoutvolume);
+        }
+        unsigned int recordid = GeneralSQLInsert(stmt);
         if (!recordid) {
             logger.msg(Arc::ERROR, "Failed to insert AAR into the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
+        rememberAARDBId(aar.jobid, recordid);
         // insert authtoken attributes
         if (!writeAuthTokenAttrs(aar.authtokenattrs, recordid)) {
             logger.msg(Arc::ERROR, "Failed to write authtoken attributes for job %s", aar.jobid);
@@ -427,6 +609,11 @@ namespace ARex {
     bool AccountingDBSQLite::updateAAR(AAR& aar) {
         if (!isValid) return false;
         initSQLiteDB();
+        RecordScope scope = beginRecord();
+        return endRecord(scope, modifyAAR(aar));
+    }
+
+    bool AccountingDBSQLite::modifyAAR(AAR& aar) {
         // get AAR ID in the database
         unsigned int recordid = getAARDBId(aar);
         if (!recordid) {
@@ -438,26 +625,32 @@ namespace ARex {
         
         // construct update statement 
         // NOTE: it only make sense update the dynamic information not available on submission time
-        std::string sql = "UPDATE AAR SET "
-            "LocalJobID = '" + sql_escape(aar.localid) + "', " +
-            "StatusID = " + sql_escape(statusid) + ", " +
-            "ExitCode = " + sql_escape(aar.exitcode) + ", " +
-            "EndTime = " + sql_escape(aar.endtime.GetTime()) + ", " +
-            "NodeCount = " + sql_escape(aar.nodecount) + ", " + 
-            "CPUCount = " + sql_escape(aar.cpucount) + ", " + 
-            "UsedMemory = " + sql_escape(aar.usedmemory) + ", " + 
-            "UsedVirtMem = " + sql_escape(aar.usedvirtmemory) + ", " +
-            "UsedWalltime = " + sql_escape(aar.usedwalltime) + ", " + 
-            "UsedCPUUserTime = " + sql_escape(aar.usedcpuusertime) + ", " + 
-            "UsedCPUKernelTime = " + sql_escape(aar.usedcpukerneltime) + ", " +
-            "UsedScratch = " + sql_escape(aar.usedscratch) + ", " + 
-            "StageInVolume = " + sql_escape(aar.stageinvolume) + ", " + 
-            "StageOutVolume = " + sql_escape(aar.stageoutvolume) + " " +
-            "WHERE RecordId = " + sql_escape(recordid);
+        sqlite3_stmt* stmt = db->prepare("UPDATE AAR SET "
+            "LocalJobID = ?, StatusID = ?, ExitCode = ?, EndTime = ?, "
+            "NodeCount = ?, CPUCount = ?, UsedMemory = ?, UsedVirtMem = ?, "
+            "UsedWalltime = ?, UsedCPUUserTime = ?, UsedCPUKernelTime = ?, "
+            "UsedScratch = ?, StageInVolume = ?, StageOutVolume = ? "
+            "WHERE RecordId = ?");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.localid);
+            sql_bind(stmt, 2, statusid);
+            sql_bind(stmt, 3, aar.exitcode);
+            sql_bind(stmt, 4, aar.endtime.GetTime());
+            sql_bind(stmt, 5, aar.nodecount);
+            sql_bind(stmt, 6, aar.cpucount);
+            sql_bind(stmt, 7, aar.usedmemory);
+            sql_bind(stmt, 8, aar.usedvirtmemory);
+            sql_bind(stmt, 9, aar.usedwalltime);
+            sql_bind(stmt, 10, aar.usedcpuusertime);
+            sql_bind(stmt, 11, aar.usedcpukerneltime);
+            sql_bind(stmt, 12, aar.usedscratch);
+            sql_bind(stmt, 13, aar.stageinvolume);
+            sql_bind(stmt, 14, aar.stageoutvolume);
+            sql_bind(stmt, 15, recordid);
+        }
         // run update
-        if (!GeneralSQLUpdate(sql)) {
+        if (!GeneralSQLUpdate(stmt)) {
             logger.msg(Arc::ERROR, "Failed to update AAR in the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
         // write RTE info
@@ -481,86 +674,75 @@ namespace ARex {
 
     bool AccountingDBSQLite::writeRTEs(std::list <std::string>& rtes, unsigned int recordid) {
         if (rtes.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES (?, ?)");
+        if (!stmt) return false;
+        bool result = true;
         for (std::list<std::string>::iterator it=rtes.begin(); it != rtes.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(*it) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, *it);
+            if(!GeneralSQLInsert(stmt)) result = false;
         }
-        return true;
+        return result;
     }
 
     bool AccountingDBSQLite::writeAuthTokenAttrs(std::list <aar_authtoken_t>& attrs, unsigned int recordid) {
         if (attrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        bool result = true;
         for (std::list <aar_authtoken_t>::iterator it=attrs.begin(); it!=attrs.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) result = false;
         }
-        return true;
+        return result;
     }
 
     bool AccountingDBSQLite::writeExtraInfo(std::map <std::string, std::string>& info, unsigned int recordid) {
         if (info.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        bool result = true;
         for (std::map<std::string,std::string>::iterator it=info.begin(); it!=info.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) result = false;
         }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
-        }
-        return true;
+        return result;
     }
 
     bool AccountingDBSQLite::writeDTRs(std::list <aar_data_transfer_t>& dtrs, unsigned int recordid) {
         if (dtrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO DataTransfers "
-            "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO DataTransfers "
+            "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES (?, ?, ?, ?, ?, ?)");
+        if (!stmt) return false;
+        bool result = true;
         for (std::list<aar_data_transfer_t>::iterator it=dtrs.begin(); it != dtrs.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + 
-                   sql_escape(it->url) + "', " +
-                   sql_escape(it->size) + ", " + 
-                   sql_escape(it->transferstart.GetTime()) + ", " + 
-                   sql_escape(it->transferend.GetTime()) + ", " + 
-                   sql_escape(static_cast<int>(it->type)) + "); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->url);
+            sql_bind(stmt, 3, it->size);
+            sql_bind(stmt, 4, it->transferstart.GetTime());
+            sql_bind(stmt, 5, it->transferend.GetTime());
+            sql_bind(stmt, 6, static_cast<int>(it->type));
+            if(!GeneralSQLInsert(stmt)) result = false;
         }
-        return true;
+        return result;
     }
 
     bool AccountingDBSQLite::writeEvents(std::list <aar_jobevent_t>& events, unsigned int recordid) {
         if (events.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        bool result = true;
         for (std::list<aar_jobevent_t>::iterator it=events.begin(); it != events.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) result = false;
         }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
-        }
-        return true;
+        return result;
     }
 
     bool AccountingDBSQLite::addJobEvent(aar_jobevent_t& event, const std::string& jobid) {
@@ -569,10 +751,12 @@ namespace ARex {
             logger.msg(Arc::ERROR, "Unable to add event: cannot find AAR for job %s in accounting database.", jobid);
             return false;
         }
-        std::string sql = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (" +
-            sql_escape(recordid) + ", '" + sql_escape(event.first) + "', '" + sql_escape(event.second) + "')";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        sql_bind(stmt, 1, recordid);
+        sql_bind(stmt, 2, event.first);
+        sql_bind(stmt, 3, event.second);
+        if(!GeneralSQLInsert(stmt)) {
             return false;
         }
         return true;
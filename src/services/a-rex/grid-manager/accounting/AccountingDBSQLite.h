@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <list>
 #include <sqlite3.h>
 #include <arc/Logger.h>
 #include <arc/Thread.h>
@@ -24,6 +25,10 @@ namespace ARex {
         bool updateAAR(AAR& aar);
         /// Add job event record to AAR (any other state changes)
         bool addJobEvent(aar_jobevent_t& events, const std::string& jobid);
+        /// Start transaction grouping all following updates
+        bool beginTransaction();
+        /// Commit transaction started by beginTransaction()
+        bool commitTransaction();
       private:
         static Arc::Logger logger;
         Glib::Mutex lock_;
@@ -34,6 +39,10 @@ namespace ARex {
         name_id_map_t db_status;
         // AAR specific structures representation
         std::map <aar_endpoint_t, unsigned int> db_endpoints;
+        // Recently used JobID to AAR RecordID mappings
+        name_id_map_t db_aars;
+        std::list<std::string> db_aars_order;
+        static const std::size_t MaxAARIds = 10000;
         // Class to handle SQLite DB Operations
         class SQLiteDB {
         public:
@@ -42,10 +51,16 @@ namespace ARex {
             bool isConnected(void);
             int changes(void) { return sqlite3_changes(aDB); }
             sqlite3_int64 insertID(void) { return sqlite3_last_insert_rowid(aDB); }
+            bool inTransaction(void) { return aDB && !sqlite3_get_autocommit(aDB); }
             int exec(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
+            /// Get prepared statement for sql. Statements are compiled only once and reused.
+            sqlite3_stmt* prepare(const std::string& sql);
+            /// Execute prepared statement. Rows of result are passed to callback the same way as in exec().
+            int step(sqlite3_stmt* stmt, int (*callback)(void*,int,char**,char**) = NULL, void *arg = NULL);
             void logError(const char* errpfx, int err, Arc::LogLevel level = Arc::DEBUG);
         private:
             sqlite3* aDB;
+            std::map<std::string, sqlite3_stmt*> statements;
             void closeDB();
         };
 
@@ -53,11 +68,18 @@ namespace ARex {
         /// Initialize and close connection to SQLite database
         void initSQLiteDB(void);
         void closeSQLiteDB(void);
+        /// Forget all cached database IDs. Used if transaction fails.
+        void resetCachedIds(void);
+        /// Make records of one AAR to be written either all or none
+        enum RecordScope { NoScope, OwnTransaction, SavePoint };
+        RecordScope beginRecord(void);
+        /// Finish writing AAR records. Returns false if they were discarded.
+        bool endRecord(RecordScope scope, bool result);
 
         /// General helper to execute INSERT statement and return the autoincrement ID
-        unsigned int GeneralSQLInsert(const std::string& sql);
+        unsigned int GeneralSQLInsert(sqlite3_stmt* stmt);
         /// General helper to execute UPDATE statement
-        bool GeneralSQLUpdate(const std::string& sql);
+        bool GeneralSQLUpdate(sqlite3_stmt* stmt);
 
         /// General helper that return accounting database ID for requested iname 
         /** 
@@ -101,6 +123,13 @@ namespace ARex {
         /// get DB ID for already registered job AAR
         unsigned int getAARDBId(const AAR& aar);
         unsigned int getAARDBId(const std::string& jobid);
+        /// store DB ID of AAR in memory to avoid querying it for every job event
+        void rememberAARDBId(const std::string& jobid, unsigned int dbid);
+
+        /// Write new AAR and its info tables
+        bool insertAAR(AAR& aar);
+        /// Write dynamic information of AAR and its info tables
+        bool modifyAAR(AAR& aar);
 
         // Write AAR dedicated info tables
         bool writeRTEs(std::list <std::string>& rtes, unsigned int recordid);
@@ -4,14 +4,93 @@
 
 #include <iostream>
 
+#include <arc/StringConv.h>
+
 #include "AccountingDBSQLite.h"
 #include "AAR.h"
 
+// Measures time needed to register, progress and finish njobs jobs
+// with updates grouped by batch_size in single transaction.
+static int throughput(ARex::AccountingDBSQLite& adb, unsigned int njobs, unsigned int batch_size) {
+    static const char* states[] = { "PREPARING", "SUBMIT", "INLRMS", "FINISHING", NULL };
+    std::string prefix = Arc::tostring(Arc::Time().GetTime()) + "-" + Arc::tostring(batch_size) + "-";
+    unsigned int updates = 0;
+    unsigned int committed = 0;
+    Arc::Time start;
+    if (batch_size > 1) adb.beginTransaction();
+    for (unsigned int n = 0; n < njobs; ++n) {
+        ARex::AAR aar;
+        aar.jobid = prefix + Arc::tostring(n);
+        aar.endpoint = { "org.nordugrid.arcrest", "https://arc6.univ.kiev.ua:443/arex" };
+        aar.queue = "grid";
+        aar.userdn = "/DC=org/DC=ugrid/O=people/O=KNU/CN=User " + Arc::tostring(n % 100);
+        aar.wlcgvo = "testbed.univ.kiev.ua";
+        aar.status = "in-progress";
+        aar.submittime = Arc::Time();
+        aar.authtokenattrs.push_back(ARex::aar_authtoken_t("vomsfqan", "/testbed.univ.kiev.ua"));
+        aar.jobevents.push_back(ARex::aar_jobevent_t("ACCEPTED", Arc::Time()));
+        if (!adb.createAAR(aar)) return 1;
+        ++updates;
+        for (int s = 0; states[s]; ++s) {
+            ARex::aar_jobevent_t event(states[s], Arc::Time());
+            if (!adb.addJobEvent(event, aar.jobid)) return 1;
+            ++updates;
+        }
+        aar.jobevents.clear();
+        aar.jobevents.push_back(ARex::aar_jobevent_t("FINISHED", Arc::Time()));
+        aar.status = "completed";
+        aar.exitcode = 0;
+        aar.endtime = Arc::Time();
+        aar.rtes.push_back("ENV/PROXY");
+        aar.transfers.push_back({"https://storage.univ.kiev.ua/data/input" + Arc::tostring(n), 1024, Arc::Time(), Arc::Time(), ARex::dtr_input});
+        aar.extrainfo.insert(std::pair <std::string, std::string>("jobname", "throughput"));
+        if (!adb.updateAAR(aar)) return 1;
+        ++updates;
+        if ((batch_size > 1) && ((updates - committed) >= batch_size)) {
+            adb.commitTransaction();
+            adb.beginTransaction();
+            committed = updates;
+        }
+    }
+    if (batch_size > 1) adb.commitTransaction();
+    Arc::Period elapsed = Arc::Time() - start;
+    double seconds = elapsed.GetPeriod() + elapsed.GetPeriodNanoseconds()/1000000000.0;
+    std::cout << "Batch size " << batch_size << ": " << njobs << " jobs (" << updates << " updates) in "
+              << seconds << " s, " << (seconds > 0 ? updates/seconds : 0) << " updates/s" << std::endl;
+    return 0;
+}
+
 int main(int argc, char **argv) {
     Arc::LogStream logcerr(std::cerr);
     Arc::Logger::getRootLogger().addDestination(logcerr);
     Arc::Logger::getRootLogger().setThreshold(Arc::DEBUG);
 
+    if (argc > 1) {
+        // test_adb <number of jobs> [<batch size>] - measure throughput
+        unsigned int njobs = 0;
+        unsigned int batch_size = 100;
+        if (!Arc::stringto(argv[1], njobs) || !njobs) {
+            std::cerr << "Usage: " << argv[0] << " [<number of jobs> [<batch size>]]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if ((argc > 2) && (!Arc::stringto(argv[2], batch_size) || !batch_size)) {
+            std::cerr << "Wrong batch size: " << argv[2] << std::endl;
+            return EXIT_FAILURE;
+        }
+        Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+        ARex::AccountingDBSQLite adb("/tmp/adb-throughput.sqlite");
+        if (!adb.IsValid()) {
+           std::cerr << "Database connection was not successfull" << std::endl;
+           return EXIT_FAILURE;
+        }
+        // compare with every update written separately
+        if (throughput(adb, njobs, 1) != 0) return EXIT_FAILURE;
+        if (batch_size > 1) {
+            if (throughput(adb, njobs, batch_size) != 0) return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     ARex::AccountingDBSQLite adb("/tmp/adb.sqlite");
     if (!adb.IsValid()) {
        std::cerr << "Database connection was not successfull" << std::endl;
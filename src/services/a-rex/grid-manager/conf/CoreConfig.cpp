@@ -87,6 +87,8 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
   // List of helper commands that will be substituted after all configuration is read
   std::list<std::string> helpers;
   std::string jobreport_publisher;
+  unsigned int accounting_batch_size = 100;
+  unsigned int accounting_flush_interval = 5;
   bool helper_log_is_set = false;
   bool job_log_log_is_set = false;
   Arc::ConfigIni cf(cfile);
@@ -244,6 +246,18 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
             logger.msg(Arc::ERROR,"Wrong number in wakeupperiod: %s",wakeup_s); return false;
           }
         }
+        else if (command == "accounting_batch_size") {
+          std::string batch_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(batch_s, accounting_batch_size) || (accounting_batch_size == 0)) {
+            logger.msg(Arc::ERROR,"Wrong number in accounting_batch_size: %s",batch_s); return false;
+          }
+        }
+        else if (command == "accounting_flush_interval") {
+          std::string interval_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(interval_s, accounting_flush_interval)) {
+            logger.msg(Arc::ERROR,"Wrong number in accounting_flush_interval: %s",interval_s); return false;
+          }
+        }
         else if (command == "mail") { // internal address from which to send mail
           config.support_email_address = rest;
           if (config.support_email_address.empty()) {
@@ -365,6 +379,12 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
             logger.msg(Arc::ERROR, "Wrong option in delegationdb"); return false;
           };
         }
+        else if (command == "delegationkeypool") {
+          std::string s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(s, config.deleg_key_pool)) {
+            logger.msg(Arc::ERROR, "Wrong number in delegationkeypool: %s", s); return false;
+          }
+        }
         else if (command == "forcedefaultvoms") {
           std::string str = rest;
           if (str.empty()) {
@@ -617,6 +637,7 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
 
   // Define accounting reporter and database manager if configured
   if(config.job_log) {
+    config.job_log->SetDBBatching(accounting_batch_size, accounting_flush_interval);
     if(!jobreport_publisher.empty()) {
       config.job_log->SetReporter(jobreport_publisher.c_str());
       if(!job_log_log_is_set) config.job_log->SetReporterLogFile("/var/log/arc/jura.log");
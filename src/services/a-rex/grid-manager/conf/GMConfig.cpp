@@ -36,6 +36,8 @@ namespace ARex {
 #define DEFAULT_JOB_RERUNS (5)
 // default maximal size of job description
 #define DEFAULT_MAX_JOB_DESC (5*1024*1024)
+// default number of delegation keys generated in advance
+#define DEFAULT_DELEG_KEY_POOL (10)
 // default wake up period for main job loop
 #define DEFAULT_WAKE_UP (600)
 
@@ -75,6 +77,7 @@ void GMConfig::SetDefaults() {
   conffile_is_temp = false;
   job_log = NULL;
   jobs_metrics = NULL;
+  jobs_summary = NULL;
   heartbeat_metrics = NULL;
   space_metrics = NULL;
   job_perf_log = NULL;
@@ -98,6 +101,7 @@ void GMConfig::SetDefaults() {
   max_scripts = -1;
 
   deleg_db = deleg_db_sqlite;
+  deleg_key_pool = DEFAULT_DELEG_KEY_POOL;
 
   enable_arc_interface = false;
   enable_emies_interface = false;
@@ -16,6 +16,7 @@ namespace ARex {
 class JobLog;
 class JobsMetrics;
 class HeartBeatMetrics;
+class JobsSummary;
 class SpaceMetrics;
 class ContinuationPlugins;
 class RunPlugin;
@@ -130,6 +131,8 @@ public:
   std::string DelegationDir() const;
   /// Database type to use for delegation storage
   deleg_db_t DelegationDBType() const;
+  /// Number of delegation private keys generated in advance
+  unsigned int DelegationKeyPool() const { return deleg_key_pool; }
   /// Helper(s) log file path
   const std::string& HelperLog() const { return helper_log; }
 
@@ -142,6 +145,8 @@ public:
   void SetJobPerfLog(Arc::JobPerfLog* log) { job_perf_log = log; }
   /// Set JobsMetrics object
   void SetJobsMetrics(JobsMetrics* metrics) { jobs_metrics = metrics; }
+  /// Set JobsSummary object
+  void SetJobsSummary(JobsSummary* summary) { jobs_summary = summary; }
   /// Set HeartBeatMetrics object
   void SetHeartBeatMetrics(HeartBeatMetrics* metrics) { heartbeat_metrics = metrics; }
   /// Set HeartBeatMetrics object
@@ -154,6 +159,8 @@ public:
   JobLog* GetJobLog() const { return job_log; }
   /// JobsMetrics object
   JobsMetrics* GetJobsMetrics() const { return jobs_metrics; }
+  /// JobsSummary object
+  JobsSummary* GetJobsSummary() const { return jobs_summary; }
   /// HeartBeatMetrics object
   HeartBeatMetrics* GetHeartBeatMetrics() const { return heartbeat_metrics; }
   /// SpaceMetrics object
@@ -273,6 +280,8 @@ private:
   JobLog* job_log;
   /// For reporting jobs metric to ganglia
   JobsMetrics* jobs_metrics;
+  /// Summary of jobs for information system
+  JobsSummary* jobs_summary;
   /// For reporting heartbeat metric to ganglia
   HeartBeatMetrics* heartbeat_metrics;
   /// For reporting free space metric to ganglia
@@ -363,6 +372,8 @@ private:
   std::string arex_endpoint;
   /// Delegation db type
   deleg_db_t deleg_db;
+  /// Number of delegation private keys generated in advance
+  unsigned int deleg_key_pool;
   /// Forced VOMS attribute for non-VOMS credentials per queue
   std::map<std::string,std::string> forced_voms;
   /// VOs authorized per queue
@@ -222,7 +222,7 @@ bool FileData::operator== (const char *name) {
   return (strcmp(pfn_,name) == 0);
 }
 
-bool FileData::has_lfn(void) {
+bool FileData::has_lfn(void) const {
   return (lfn.find(':') != std::string::npos);
 }
 
@@ -33,7 +33,7 @@ class FileData {
   FileData& operator= (const char* str);
   bool operator== (const char* name);
   bool operator== (const FileData& data);
-  bool has_lfn(void);
+  bool has_lfn(void) const;
 };
 std::istream &operator>> (std::istream &i,FileData &fd);
 std::ostream &operator<< (std::ostream &o,const FileData &fd);
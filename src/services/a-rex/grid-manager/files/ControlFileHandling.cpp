@@ -2,13 +2,16 @@
 #include <config.h>
 #endif
 
+#include <map>
 #include <sstream>
 #include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include <arc/FileAccess.h>
 #include <arc/FileUtils.h>
 #include <arc/FileLock.h>
+#include <arc/URL.h>
 
 #include "../run/RunRedirected.h"
 #include "../conf/GMConfig.h"
@@ -36,6 +39,8 @@ const char * const sfx_input       = ".input";         // Input files required b
 const char * const sfx_output      = ".output";        // Output files written by job
 const char * const sfx_inputstatus = ".input_status";  // Input files staged by client
 const char * const sfx_outputstatus = ".output_status";// Output files already staged out
+const char * const sfx_inputjournal = ".input_journal";// Input files staged in since job.ID.input was written
+const char * const sfx_outputjournal = ".output_journal";// Output files staged out since job.ID.output was written
 const char * const sfx_statistics  = ".statistics";    // Statistical information on data staging
 const char * const sfx_lrmsdone    = ".lrms_done";     // Job execution in lrms exit code and failure reason
 const char * const sfx_lrmsjob     = ".lrms_job";      // File LRMS backends keep their specific information
@@ -560,11 +565,29 @@ bool job_local_read_delegationid(const JobId &id,const GMConfig &config,std::str
 
 bool job_input_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files) {
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_input;
-  return job_Xput_write_file(fname,files) && fix_file_owner(fname,job) && fix_file_permissions(fname);
+  if(!(job_Xput_write_file(fname,files) && fix_file_owner(fname,job) && fix_file_permissions(fname))) return false;
+  // Written list includes everything recorded in journal
+  fname = config.ControlDir() + "/job." + job.get_id() + sfx_inputjournal; remove(fname.c_str());
+  return true;
 }
 
 bool job_input_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files) {
   std::string fname = config.ControlDir() + "/job." + id + sfx_input;
+  if(!job_Xput_read_file(fname,files)) return false;
+  std::list<FileData> done;
+  if(job_input_journal_read_file(id,config,done)) job_Xput_journal_apply(files,done);
+  return true;
+}
+
+bool job_input_journal_add(const GMJob &job,const GMConfig &config,const FileData& file) {
+  std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_inputjournal;
+  std::ostringstream line;
+  line<<file<<"\n";
+  return job_journal_add(fname,line.str()) && fix_file_owner(fname,job) && fix_file_permissions(fname);
+}
+
+bool job_input_journal_read_file(const JobId &id,const GMConfig &config,std::list<FileData>& files) {
+  std::string fname = config.ControlDir() + "/job." + id + sfx_inputjournal;
   return job_Xput_read_file(fname,files);
 }
 
@@ -606,23 +629,38 @@ bool job_input_status_read_file(const JobId &id,const GMConfig &config,std::list
 /* job.ID.output functions */
 bool job_output_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files,job_output_mode mode) {
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_output;
-  return job_Xput_write_file(fname,files,mode) && fix_file_owner(fname,job) && fix_file_permissions(fname);
+  if(!(job_Xput_write_file(fname,files,mode) && fix_file_owner(fname,job) && fix_file_permissions(fname))) return false;
+  // Written list includes everything recorded in journal
+  fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputjournal; remove(fname.c_str());
+  return true;
 }
 
 bool job_output_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files) {
   std::string fname = config.ControlDir() + "/job." + id + sfx_output;
+  if(!job_Xput_read_file(fname,files)) return false;
+  std::list<FileData> done;
+  if(job_output_journal_read_file(id,config,done)) job_Xput_journal_apply(files,done);
+  return true;
+}
+
+bool job_output_journal_add(const GMJob &job,const GMConfig &config,const FileData& file) {
+  std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputjournal;
+  std::ostringstream line;
+  line<<file<<"\n";
+  return job_journal_add(fname,line.str()) && fix_file_owner(fname,job) && fix_file_permissions(fname);
+}
+
+bool job_output_journal_read_file(const JobId &id,const GMConfig &config,std::list<FileData>& files) {
+  std::string fname = config.ControlDir() + "/job." + id + sfx_outputjournal;
   return job_Xput_read_file(fname,files);
 }
 
 bool job_output_status_add_file(const GMJob &job,const GMConfig &config,const FileData& file) {
   // Not using lock here because concurrent read/write is not expected
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputstatus;
-  std::string data;
-  if (!Arc::FileRead(fname, data) && errno != ENOENT) return false;
   std::ostringstream line;
   line<<file<<"\n";
-  data += line.str();
-  return Arc::FileCreate(fname, data) && fix_file_owner(fname,job) && fix_file_permissions(fname);
+  return job_journal_add(fname,line.str()) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_output_status_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files) {
@@ -666,6 +704,59 @@ bool job_Xput_write_file(const std::string &fname,std::list<FileData> &files,job
   return true;
 }
 
+void job_Xput_journal_apply(std::list<FileData> &files,const std::list<FileData> &done) {
+  if(done.empty()) return;
+  // Index entries by local name and normalised URL so that every entry
+  // is parsed only once. Applying same record twice changes nothing.
+  typedef std::multimap<std::pair<std::string,std::string>,std::list<FileData>::iterator> index_t;
+  index_t index;
+  for(std::list<FileData>::iterator i = files.begin(); i != files.end(); ++i) {
+    if(!i->has_lfn()) continue;
+    index.insert(std::make_pair(std::make_pair(i->pfn,Arc::URL(i->lfn).str()),i));
+  };
+  for(std::list<FileData>::const_iterator d = done.begin(); d != done.end(); ++d) {
+    if(!d->has_lfn()) continue;
+    std::pair<index_t::iterator,index_t::iterator> range = index.equal_range(std::make_pair(d->pfn,Arc::URL(d->lfn).str()));
+    for(index_t::iterator i = range.first; i != range.second; ++i) files.erase(i->second);
+    index.erase(range.first,range.second);
+  };
+}
+
+bool job_Xput_journal_compact(const GMJob &job,const GMConfig &config) {
+  bool result = true;
+  struct stat st;
+  std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_inputjournal;
+  if(lstat(fname.c_str(),&st) == 0) {
+    std::list<FileData> files;
+    if(!(job_input_read_file(job.get_id(),config,files) &&
+         job_input_write_file(job,config,files))) result = false;
+  };
+  fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputjournal;
+  if(lstat(fname.c_str(),&st) == 0) {
+    std::list<FileData> files;
+    if(!(job_output_read_file(job.get_id(),config,files) &&
+         job_output_write_file(job,config,files))) result = false;
+  };
+  return result;
+}
+
+bool job_journal_add(const std::string &fname,const std::string &record) {
+  int h = ::open(fname.c_str(),O_WRONLY | O_APPEND | O_CREAT,S_IRUSR | S_IWUSR);
+  if(h == -1) return false;
+  const char* buf = record.c_str();
+  std::string::size_type l = record.length();
+  while(l > 0) {
+    ssize_t ll = ::write(h,buf,l);
+    if(ll == -1) {
+      if(errno == EINTR) continue;
+      ::close(h);
+      return false;
+    };
+    buf += ll; l -= ll;
+  };
+  return (::close(h) == 0);
+}
+
 bool job_Xput_read_file(const std::string &fname,std::list<FileData> &files, uid_t uid, gid_t gid) {
   std::list<std::string> file_content;
   if (!Arc::FileRead(fname, file_content, uid, gid)) return false;
@@ -716,6 +807,8 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config,std::list<std::st
   fname = config.ControlDir()+"/"+subdir_new+"/job."+id+sfx_clean;  remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_output; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_input; remove(fname.c_str());
+  fname = config.ControlDir()+"/job."+id+sfx_outputjournal; remove(fname.c_str());
+  fname = config.ControlDir()+"/job."+id+sfx_inputjournal; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+".grami_log"; remove(fname.c_str());
   fname = session+sfx_lrmsoutput; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_outputstatus; remove(fname.c_str());
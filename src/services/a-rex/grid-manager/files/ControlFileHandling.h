@@ -167,6 +167,12 @@ bool job_local_read_delegationid(const JobId &id,const GMConfig &config,std::str
 bool job_input_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files);
 bool job_input_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files);
 
+// Append entry of transferred file to journal of input files. Entries listed
+// in journal are removed from list by job_input_read_file(). Journal is dropped
+// when list is written by job_input_write_file().
+bool job_input_journal_add(const GMJob &job,const GMConfig &config,const FileData& file);
+bool job_input_journal_read_file(const JobId &id,const GMConfig &config,std::list<FileData>& files);
+
 bool job_input_status_add_file(const GMJob &job,const GMConfig &config,const std::string& file = "");
 bool job_input_status_read_file(const JobId &id,const GMConfig &config,std::list<std::string>& files);
 
@@ -176,6 +182,11 @@ bool job_input_status_read_file(const JobId &id,const GMConfig &config,std::list
 bool job_output_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files,job_output_mode mode = job_output_all);
 bool job_output_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files);
 
+// Same as journal of input files but for output files. Journal is also applied
+// to user generated lists of dynamic output files.
+bool job_output_journal_add(const GMJob &job,const GMConfig &config,const FileData& file);
+bool job_output_journal_read_file(const JobId &id,const GMConfig &config,std::list<FileData>& files);
+
 bool job_output_status_add_file(const GMJob &job,const GMConfig &config,const FileData& file);
 bool job_output_status_write_file(const GMJob &job,const GMConfig &config,std::list<FileData>& files);
 bool job_output_status_read_file(const JobId &id,const GMConfig &config,std::list<FileData>& files);
@@ -184,6 +195,15 @@ bool job_output_status_read_file(const JobId &id,const GMConfig &config,std::lis
 bool job_Xput_read_file(const std::string &fname,std::list<FileData> &files, uid_t uid = 0, gid_t gid = 0);
 bool job_Xput_write_file(const std::string &fname,std::list<FileData> &files,
                          job_output_mode mode = job_output_all, uid_t uid = 0, gid_t gid = 0);
+// Remove entries which have same local name and URL (compared as normalised
+// by Arc::URL) as any of entries in done.
+void job_Xput_journal_apply(std::list<FileData> &files,const std::list<FileData> &done);
+// Append record to file without rewriting it.
+bool job_journal_add(const std::string &fname,const std::string &record);
+// Rewrite job.ID.input and job.ID.output with journals applied and drop
+// journals. Used before lists are passed to external tools which do not
+// know about journals.
+bool job_Xput_journal_compact(const GMJob &job,const GMConfig &config);
 
 // Return filename storing job's proxy.
 std::string job_proxy_filename(const JobId &id, const GMConfig &config);
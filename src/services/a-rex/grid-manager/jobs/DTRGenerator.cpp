@@ -42,6 +42,118 @@ bool GMJobQueueDTR::CanRemove(GMJob const& job) {
   return GMJobQueue::CanRemove(job);
 }
 
+// Lists of files are rewritten at least that often (seconds) while
+// there are new records in journal.
+#define LEDGER_COMPACT_INTERVAL (60)
+
+void DTRLedger::Files::Build() {
+  index.clear();
+  for (std::list<FileData>::iterator i = files.begin(); i != files.end(); ++i) {
+    index.insert(std::make_pair(Arc::URL(i->lfn).str(), i));
+  }
+}
+
+bool DTRLedger::Files::Remove(const std::string& url, const std::string& pfn, FileData& file) {
+  std::pair<Index::iterator, Index::iterator> range = index.equal_range(url);
+  if (range.first == range.second) return false;
+  Index::iterator i = range.first;
+  if (!pfn.empty()) {
+    for (Index::iterator r = range.first; r != range.second; ++r) {
+      if (r->second->pfn == pfn) { i = r; break; }
+    }
+  }
+  file = *(i->second);
+  files.erase(i->second);
+  index.erase(i);
+  changed = true;
+  return true;
+}
+
+DTRLedger::DTRLedger(const GMConfig& config, bool upload, uid_t uid, gid_t gid):
+    config(config), upload(upload), uid(uid), gid(gid),
+    journaled(0), journal_failed(false), compacted(time(NULL)) {
+}
+
+bool DTRLedger::Load(const GMJob& job, const std::string& session_dir, std::list<std::string>& failed) {
+  if (!upload) {
+    if (!job_input_read_file(job.get_id(), config, files.files)) return false;
+    files.Build();
+    return true;
+  }
+  if (!job_output_read_file(job.get_id(), config, files.files)) return false;
+  files.Build();
+  std::list<FileData> done;
+  job_output_journal_read_file(job.get_id(), config, done);
+  for (std::list<FileData>::iterator i = files.files.begin(); i != files.files.end(); ++i) {
+    if (i->pfn.size() > 1 && i->pfn[1] == '@') {
+      std::string path(session_dir + '/' + i->pfn.substr(2));
+      Files& dynamic_files = dynamic[path];
+      if (!job_Xput_read_file(path, dynamic_files.files, uid, gid)) {
+        dynamic.erase(path);
+        failed.push_back(path);
+        continue;
+      }
+      // Lists in session dir are rewritten without dropping journal
+      job_Xput_journal_apply(dynamic_files.files, done);
+      dynamic_files.Build();
+    }
+  }
+  return true;
+}
+
+bool DTRLedger::Complete(const GMJob& job, const std::string& url, const std::string& pfn, FileData& file) {
+  std::string key(Arc::URL(url).str());
+  std::list<FileData> done;
+  FileData removed;
+  if (!upload) {
+    // Every input file has its own DTR even if sources are same
+    if (files.Remove(key, pfn, removed)) done.push_back(removed);
+  } else {
+    for (std::map<std::string, Files>::iterator d = dynamic.begin(); d != dynamic.end(); ++d) {
+      if (d->second.Remove(key, "", removed)) done.push_back(removed);
+    }
+    // Main list may have the same destination more than once
+    while (files.Remove(key, "", removed)) done.push_back(removed);
+  }
+  if (done.empty()) return false;
+  for (std::list<FileData>::iterator d = done.begin(); d != done.end(); ++d) {
+    bool added = upload ? job_output_journal_add(job, config, *d) : job_input_journal_add(job, config, *d);
+    if (!added) journal_failed = true;
+    ++journaled;
+  }
+  file = done.back();
+  return true;
+}
+
+bool DTRLedger::NeedCompact() const {
+  if (journal_failed) return true;
+  if (journaled == 0) return false;
+  // Rewriting lists when journal becomes as long as lists keeps total
+  // amount of writing proportional to number of files.
+  unsigned int remaining = files.files.size();
+  for (std::map<std::string, Files>::const_iterator d = dynamic.begin(); d != dynamic.end(); ++d) {
+    remaining += d->second.files.size();
+  }
+  if (journaled >= remaining) return true;
+  return ((time(NULL) - compacted) >= LEDGER_COMPACT_INTERVAL);
+}
+
+bool DTRLedger::Compact(const GMJob& job) {
+  // Dynamic lists first - main list write drops journal
+  for (std::map<std::string, Files>::iterator d = dynamic.begin(); d != dynamic.end(); ++d) {
+    if (!d->second.changed) continue;
+    if (!job_Xput_write_file(d->first, d->second.files, job_output_all, uid, gid)) return false;
+    d->second.changed = false;
+  }
+  bool written = upload ? job_output_write_file(job, config, files.files) : job_input_write_file(job, config, files.files);
+  if (!written) return false;
+  files.changed = false;
+  journaled = 0;
+  journal_failed = false;
+  compacted = time(NULL);
+  return true;
+}
+
 Arc::Logger DTRGenerator::logger(Arc::Logger::getRootLogger(), "Generator");
 
 bool compare_job_description(GMJob const * first, GMJob const * second) {
@@ -236,6 +348,11 @@ DTRGenerator::~DTRGenerator() {
   event_lock.signal();
   run_condition.wait();
   generator_state = DataStaging::STOPPED;
+  // Journals left in control dir are applied when lists are read next time
+  for (std::map<std::string, DTRLedger*>::iterator l = ledgers.begin(); l != ledgers.end(); ++l) {
+    delete l->second;
+  }
+  ledgers.clear();
 }
 
 void DTRGenerator::receiveDTR(DataStaging::DTR_ptr dtr) {
@@ -392,6 +509,7 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
         finished_jobs[jobid] = std::string("Invalid Data Transfer Request");
         active_dtrs.erase(jobid);
       }
+      dropLedger(jobid, job);
       // Because it is not possible to find out if there will be more 
       // job's DTR coming, if possible return job back to jobs processing queue.
       if(job) {
@@ -407,6 +525,7 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
     // This job is not being processed anymore (somehow)
     logger.msg(Arc::ERROR, "%s: Received DTR belongs to inactive job", jobid);
     scheduler->cancelDTRs(jobid); // Cancel rest of such DTRs
+    dropLedger(jobid, job);
     Arc::AutoLock<Arc::SimpleCondition> dlock(dtrs_lock);
     finished_jobs[jobid] = std::string("Job was gone while performing data transfer");
     active_dtrs.erase(jobid);
@@ -450,59 +569,26 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
       dtr->get_logger()->msg(Arc::INFO, "%s: DTR %s to copy to %s failed but is not mandatory",
                              jobid, dtr->get_id(), dtr->get_destination_str());
     }
-    std::list<FileData> files;
-
     if (dtr->get_source()->Local()) {
       // output files
       dtr_transfer_statistics = "outputfile:url=" + dtr->get_destination()->str() + ',';
 
-      if (!job_output_read_file(jobid, config, files)) {
+      DTRLedger* ledger = getLedger(job, true, session_dir, job_uid, job_gid);
+      if (!ledger) {
         logger.msg(Arc::WARNING, "%s: Failed to read list of output files", jobid);
       } else {
         FileData uploaded_file;
-        // go through list and take out this file
-        for (std::list<FileData>::iterator i = files.begin(); i != files.end();) {
-          // compare 'standard' URLs
-          Arc::URL file_lfn(i->lfn);
-          Arc::URL dtr_lfn(dtr->get_destination()->str());
-
-          // check if it is in a dynamic list - if so remove from it
-          if (i->pfn.size() > 1 && i->pfn[1] == '@') {
-            std::string dynamic_output(session_dir+'/'+i->pfn.substr(2));
-            std::list<FileData> dynamic_files;
-            if (!job_Xput_read_file(dynamic_output, dynamic_files, job_uid, job_gid)) {
-              logger.msg(Arc::WARNING, "%s: Failed to read dynamic output files in %s", jobid, dynamic_output);
-            } else {
-              logger.msg(Arc::DEBUG, "%s: Going through files in list %s", jobid, dynamic_output);
-              for (std::list<FileData>::iterator dynamic_file = dynamic_files.begin();
-                   dynamic_file != dynamic_files.end(); ++dynamic_file) {
-                if (Arc::URL(dynamic_file->lfn).str() == dtr_lfn.str()) {
-                  logger.msg(Arc::DEBUG, "%s: Removing %s from dynamic output file %s", jobid, dtr_lfn.str(), dynamic_output);
-                  uploaded_file = *dynamic_file;
-                  dynamic_files.erase(dynamic_file);
-                  if (!job_Xput_write_file(dynamic_output, dynamic_files, job_output_all, job_uid, job_gid))
-                    logger.msg(Arc::WARNING, "%s: Failed to write back dynamic output files in %s", jobid, dynamic_output);
-                  break;
-                }
-              }
+        // take out this file from list and from dynamic lists
+        if (ledger->Complete(*job, dtr->get_destination()->str(), "", uploaded_file)) {
+          logger.msg(Arc::DEBUG, "%s: Removed %s from list of output files", jobid, dtr->get_destination()->str());
+          if(!uploaded_file.pfn.empty()) {
+            if(!job_output_status_add_file(*job, config, uploaded_file)) {
+              logger.msg(Arc::WARNING, "%s: Failed to write list of output status files", jobid);
             }
           }
-          if (file_lfn.str() == dtr_lfn.str()) {
-            uploaded_file = *i;
-            i = files.erase(i);
-          } else {
-            ++i;
-          }
-        } // files
-
-        // write back .output file
-        if (!job_output_write_file(*job, config, files)) {
-          logger.msg(Arc::WARNING, "%s: Failed to write list of output files", jobid);
         }
-        if(!uploaded_file.pfn.empty()) {
-          if(!job_output_status_add_file(*job, config, uploaded_file)) {
-            logger.msg(Arc::WARNING, "%s: Failed to write list of output status files", jobid);
-          }
+        if (ledger->NeedCompact() && !ledger->Compact(*job)) {
+          logger.msg(Arc::WARNING, "%s: Failed to write list of output files", jobid);
         }
       }
       if (dtr->get_source()->CheckSize()) dtr_transfer_statistics += "size=" + Arc::tostring(dtr->get_source()->GetSize()) + ',';
@@ -512,26 +598,20 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
     else if (dtr->get_destination()->Local()) {
       // input files
       dtr_transfer_statistics = "inputfile:url=" + dtr->get_source()->str() + ',';
-      if (!job_input_read_file(jobid, config, files)) {
+      DTRLedger* ledger = getLedger(job, false, session_dir, job_uid, job_gid);
+      if (!ledger) {
         logger.msg(Arc::WARNING,"%s: Failed to read list of input files", jobid);
       } else {
-        // go through list and take out this file
-        for (std::list<FileData>::iterator i = files.begin(); i != files.end();) {
-          // compare 'standard' URLs
-          Arc::URL file_lfn(i->lfn);
-          Arc::URL dtr_lfn(dtr->get_source()->str());
-          if (file_lfn.str() == dtr_lfn.str()) {
-            struct stat st;
-            Arc::FileStat(job->SessionDir() + i->pfn, &st, job_uid, job_gid, true);
-            dtr_transfer_statistics += "size=" + Arc::tostring(st.st_size) + ',';
-            i = files.erase(i);
-            break;
-          } else {
-            ++i;
-          }
+        // take out this file from list
+        FileData downloaded_file;
+        std::string pfn(dtr->get_destination()->GetURL().Path());
+        if (pfn.compare(0, job->SessionDir().length(), job->SessionDir()) == 0) pfn.erase(0, job->SessionDir().length());
+        if (ledger->Complete(*job, dtr->get_source()->str(), pfn, downloaded_file)) {
+          struct stat st;
+          Arc::FileStat(job->SessionDir() + downloaded_file.pfn, &st, job_uid, job_gid, true);
+          dtr_transfer_statistics += "size=" + Arc::tostring(st.st_size) + ',';
         }
-        // write back .input file
-        if (!job_input_write_file(*job, config, files)) {
+        if (ledger->NeedCompact() && !ledger->Compact(*job)) {
           logger.msg(Arc::WARNING, "%s: Failed to write list of input files", jobid);
         }
       }
@@ -557,6 +637,7 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
     finished_jobs[jobid] += std::string(""); // It is not clear either this is error. At least mark it as finished.
     dlock.unlock();
     logger.msg(Arc::WARNING, "No active job id %s", jobid);
+    dropLedger(jobid, job);
     // No DTRs recorded. But still we have job ref. It is probably safer to return it.
     jobs_processing.Erase(job);
     jobs.RequestAttention(job);
@@ -596,6 +677,9 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
                               dtr->get_status() == DataStaging::DTRStatus::CANCELLED);
   dlock.unlock();
 
+  // Lists must be up to date for cleaning and for further processing
+  dropLedger(jobid, job);
+
   if (dtr->get_source()->Local()) {
     // list of files to keep in session dir
     std::list<FileData> files;
@@ -674,6 +758,36 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
 }
 
 
+DTRLedger* DTRGenerator::getLedger(const GMJobRef& job, bool upload, const std::string& session_dir, uid_t uid, gid_t gid) {
+  std::map<std::string, DTRLedger*>::iterator l = ledgers.find(job->get_id());
+  if (l != ledgers.end()) {
+    if (l->second->Upload() == upload) return l->second;
+    dropLedger(job->get_id(), job);
+  }
+  DTRLedger* ledger = new DTRLedger(config, upload, uid, gid);
+  std::list<std::string> failed;
+  if (!ledger->Load(*job, session_dir, failed)) {
+    delete ledger;
+    return NULL;
+  }
+  for (std::list<std::string>::iterator f = failed.begin(); f != failed.end(); ++f) {
+    logger.msg(Arc::WARNING, "%s: Failed to read dynamic output files in %s", job->get_id(), *f);
+  }
+  ledgers[job->get_id()] = ledger;
+  return ledger;
+}
+
+void DTRGenerator::dropLedger(const std::string& jobid, const GMJobRef& job) {
+  std::map<std::string, DTRLedger*>::iterator l = ledgers.find(jobid);
+  if (l == ledgers.end()) return;
+  // Without job lists can't be written but journal still keeps them valid
+  if (job && !l->second->Compact(*job)) {
+    logger.msg(Arc::WARNING, "%s: Failed to write lists of transferred files", jobid);
+  }
+  delete l->second;
+  ledgers.erase(l);
+}
+
 bool DTRGenerator::processReceivedJob(GMJobRef& job) {
   if(!job) {
     logger.msg(Arc::ERROR, "DTRGenerator is requested to process null job");
@@ -712,6 +826,9 @@ bool DTRGenerator::processReceivedJob(GMJobRef& job) {
   f.close();
   fix_file_permissions(fname);
 
+  // Lists are going to be processed from scratch
+  dropLedger(jobid, job);
+
   // read in input/output files
   std::list<FileData> files;
   bool replication = false;
@@ -778,6 +895,10 @@ bool DTRGenerator::processReceivedJob(GMJobRef& job) {
   else if (job->get_state() == JOB_STATE_FINISHING) {
     files = output_files;
     std::list<FileData>::iterator it;
+    // Files already uploaded by previous A-REX run may still be present
+    // in user generated lists
+    std::list<FileData> uploaded_files;
+    job_output_journal_read_file(jobid, config, uploaded_files);
     // add any output files dynamically added by the user during the job and
     // resolve directories
     for (it = files.begin(); it != files.end() ;) {
@@ -803,6 +924,7 @@ bool DTRGenerator::processReceivedJob(GMJobRef& job) {
           CleanCacheJobLinks(config, job);
           return false;
         }
+        job_Xput_journal_apply(files_, uploaded_files);
         // Attach dynamic files and assign credentials to them unless already available
         for(std::list<FileData>::iterator it_ = files_.begin(); it_ != files_.end(); ++it_) {
           if(it_->cred.empty()) it_->cred = cred;
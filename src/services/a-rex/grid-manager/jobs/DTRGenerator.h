@@ -5,11 +5,12 @@
 #include <arc/data-staging/Scheduler.h>
 
 #include "../conf/StagingConfig.h"
+#include "../files/ControlFileContent.h"
 
 namespace ARex {
 
 class GMConfig;
-class FileData;
+class GMJob;
 class GMJobRef;
 class JobsList;
 class DTRGenerator;
@@ -30,6 +31,63 @@ class DTRInfo: public DataStaging::DTRCallback {
   virtual void receiveDTR(DataStaging::DTR_ptr dtr);
 };
 
+/**
+ * In-memory copy of job.id.input or job.id.output (and for outputs also of
+ * user generated lists of output files) of a job in data staging. Files are
+ * indexed by URL, so finished transfers are taken out without parsing and
+ * rewriting whole lists. Every finished file is appended to journal in
+ * control dir, which is applied when lists are read, and lists themselves
+ * are rewritten only from time to time. Content of files on disk is always
+ * authoritative, so ledger may be dropped at any time.
+ */
+class DTRLedger {
+ private:
+  typedef std::multimap<std::string, std::list<FileData>::iterator> Index;
+  class Files {
+   public:
+    std::list<FileData> files;
+    Index index;
+    bool changed;
+    Files(): changed(false) {};
+    /** Index entries by normalised URL */
+    void Build();
+    /** Take out entry with URL, preferring one with local name pfn if
+        it is not empty */
+    bool Remove(const std::string& url, const std::string& pfn, FileData& file);
+  };
+  const GMConfig& config;
+  bool upload;
+  uid_t uid;
+  gid_t gid;
+  Files files;
+  /** User generated lists of output files, mapped by path */
+  std::map<std::string, Files> dynamic;
+  /** Number of records in journal */
+  unsigned int journaled;
+  /** Writing journal failed - lists must be rewritten */
+  bool journal_failed;
+  /** Time when lists were written last time */
+  time_t compacted;
+  DTRLedger(const DTRLedger&);
+  DTRLedger& operator=(const DTRLedger&);
+ public:
+  DTRLedger(const GMConfig& config, bool upload, uid_t uid, gid_t gid);
+  bool Upload() const { return upload; };
+  /** Read lists with journal applied. Returns false if main list could
+      not be read. Unreadable user generated lists are reported in failed. */
+  bool Load(const GMJob& job, const std::string& session_dir, std::list<std::string>& failed);
+  /** Take out file with URL and record it in journal. Input files are
+      matched also by local name pfn, so inputs sharing same source stay
+      until their own transfer finishes. For outputs all entries with
+      URL are taken out. Removed entry is stored in file. Returns false
+      if there is no such file. */
+  bool Complete(const GMJob& job, const std::string& url, const std::string& pfn, FileData& file);
+  /** Whether enough records accumulated in journal for rewriting lists */
+  bool NeedCompact() const;
+  /** Write lists and drop journal */
+  bool Compact(const GMJob& job);
+};
+
 class GMJobQueueDTR: public GMJobQueue {
  private:
   DTRGenerator& generator;
@@ -75,6 +133,9 @@ class DTRGenerator: public DataStaging::DTRCallback {
   DataStaging::ProcessState generator_state;
   /** Grid manager configuration */
   const GMConfig& config;
+  /** Ledgers of files being transferred, mapped by job id.
+      This map is not protected and is used only from DTRGenerator::thread() */
+  std::map<std::string, DTRLedger*> ledgers;
   /** A list of files left mid-transfer from a previous process.
       This list is not protected and is used only from DTRGenerator::thread() */
   std::list<std::string> recovered_files;
@@ -108,6 +169,11 @@ class DTRGenerator: public DataStaging::DTRCallback {
   /** Process a cancelled job */
   bool processCancelledJob(const std::string& jobid);
 
+  /** Get ledger of job creating it if needed. Returns NULL if lists can't be read. */
+  DTRLedger* getLedger(const GMJobRef& job, bool upload, const std::string& session_dir, uid_t uid, gid_t gid);
+  /** Write lists of job if needed and drop its ledger */
+  void dropLedger(const std::string& jobid, const GMJobRef& job);
+
   /** Read in state left from previous process and fill recovered_files */
   void readDTRState(const std::string& dtr_log);
 
@@ -14,6 +14,7 @@
 #include "../mail/send_mail.h"
 #include "../log/JobLog.h"
 #include "../log/JobsMetrics.h"
+#include "../log/JobsSummary.h"
 #include "../misc/proxy.h"
 #include "../../delegation/DelegationStores.h"
 #include "../../delegation/DelegationStore.h"
@@ -133,6 +134,8 @@ void JobsList::SetJobState(GMJobRef i, job_state_t new_state, const char* reason
     if((i->job_state != new_state) || (i->job_pending)) {
       JobsMetrics* metrics = config.GetJobsMetrics();
       if(metrics) metrics->ReportJobStateChange(config, i, i->job_state, new_state);
+      JobsSummary* summary = config.GetJobsSummary();
+      if(summary) summary->ReportJobStateChange(config, i, new_state, false);
       std::string msg = Arc::Time().str(Arc::UTCTime);
       msg += " Job state change ";
       msg += i->get_state_name();
@@ -171,6 +174,8 @@ void JobsList::SetJobPending(GMJobRef i, const char* reason) {
       msg += "\n";
       i->job_pending = true;
       job_errors_mark_add(*i,config,msg);
+      JobsSummary* summary = config.GetJobsSummary();
+      if(summary) summary->ReportJobStateChange(config, i, i->job_state, true);
     };
   };
 }
@@ -512,6 +517,12 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
       // Have local id - skip running submition script
       return state_submitting_success(i,state_changed,local_id);
     }
+    // submit-X-job reads lists of files directly
+    if(!job_Xput_journal_compact(*i,config)) {
+      logger.msg(Arc::ERROR,"%s: Failed writing lists of transferred files",i->job_id);
+      i->AddFailure("Internal error: can't write list of files");
+      return false;
+    };
     // write grami file for submit-X-job
     if(!(i->GetLocalDescription(config))) {
       logger.msg(Arc::ERROR,"%s: Failed reading local information",i->job_id);
@@ -161,6 +161,10 @@ bool JobLog::SetReporterLogFile(const char* fname) {
   return true;
 }
 
+void JobLog::SetDBBatching(unsigned int batch_size, unsigned int flush_interval) {
+  AccountingDBAsync::SetBatching(batch_size, flush_interval);
+}
+
 static AccountingDB* AccountingDBCtor(std::string const & name) {
   return new AccountingDBSQLite(name);
 }
@@ -56,6 +56,8 @@ class JobLog {
   bool WriteJobRecord(GMJob &job,const GMConfig &config);
   /* Set credential file names for accessing logging service */
   void SetCredentials(std::string const &key_path,std::string const &certificate_path,std::string const &ca_certificates_dir);
+  /* Set how many accounting database updates are grouped and for how long */
+  void SetDBBatching(unsigned int batch_size, unsigned int flush_interval);
   /* Set accounting options (e.g. batch size for SGAS LUTS) */
   void SetOptions(std::string const &options) { report_config.push_back(std::string("accounting_options=")+options); }
 };
@@ -0,0 +1,195 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/stat.h>
+
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+
+#include "../conf/GMConfig.h"
+#include "../files/ControlFileHandling.h"
+
+#include "JobsSummary.h"
+
+// Minimal time (seconds) between writes of changed summary
+#define SUMMARY_WRITE_PERIOD (30)
+// Summary is rewritten at least that often (seconds) even if nothing
+// changed, so that reader can see it is up to date
+#define SUMMARY_REFRESH_PERIOD (300)
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+static const char* const summary_file = "/jobs.summary";
+
+// Values are stored one per line
+static void add_pair(std::string& out, const char* name, const std::string& value) {
+  if(value.empty()) return;
+  out += name;
+  out += '=';
+  for(std::string::size_type p = 0; p < value.length(); ++p) {
+    out += ((value[p] == '\n') || (value[p] == '\r')) ? ' ' : value[p];
+  };
+  out += '\n';
+}
+
+static void add_pair(std::string& out, const char* name, const Arc::Time& value) {
+  if(value == -1) return;
+  add_pair(out, name, value.str(Arc::MDSTime));
+}
+
+static void add_pair(std::string& out, const char* name, const std::list<std::string>& values) {
+  for(std::list<std::string>::const_iterator v = values.begin(); v != values.end(); ++v) {
+    add_pair(out, name, *v);
+  };
+}
+
+JobsSummary::JobsSummary(void):loaded(false),changed(false),last_write(0) {
+}
+
+JobsSummary::~JobsSummary(void) {
+}
+
+bool JobsSummary::Fill(const GMConfig& config, GMJobRef i, job_state_t state, bool pending, Record& record) {
+  record.status = pending ? "PENDING:" : "";
+  record.status += GMJob::get_state_name(state);
+  record.modified = time(NULL);
+  record.owner = i->get_user().Name();
+  record.errors.clear();
+  // Information provider tells failed and killed jobs by this content.
+  // Like scan of control dir it is read in any state, e.g. FINISHING
+  // after failure.
+  std::string failed = job_failed_mark_read(i->get_id(), config);
+  if(failed.length() > 1024) failed.resize(1024);
+  Arc::tokenize(failed, record.errors, "\n");
+  JobLocalDescription* local = i->GetLocalDescription(config);
+  if(!local) return false;
+  // Attributes of .local used by information provider, same names as in .local
+  record.queue = local->queue;
+  record.subject = local->DN;
+  record.local.clear();
+  add_pair(record.local, "globalid", local->globalid);
+  add_pair(record.local, "headnode", local->headnode);
+  add_pair(record.local, "interface", local->interface);
+  add_pair(record.local, "lrms", local->lrms);
+  add_pair(record.local, "queue", local->queue);
+  add_pair(record.local, "localid", local->localid);
+  add_pair(record.local, "subject", local->DN);
+  add_pair(record.local, "starttime", local->starttime);
+  add_pair(record.local, "lifetime", local->lifetime);
+  add_pair(record.local, "jobname", local->jobname);
+  add_pair(record.local, "jobreport", local->jobreport);
+  add_pair(record.local, "gmlog", local->stdlog);
+  add_pair(record.local, "cleanuptime", local->cleanuptime);
+  add_pair(record.local, "delegexpiretime", local->expiretime);
+  add_pair(record.local, "clientname", local->clientname);
+  add_pair(record.local, "clientsoftware", local->clientsoftware);
+  add_pair(record.local, "sessiondir", local->sessiondir);
+  add_pair(record.local, "diskspace", Arc::tostring(local->diskspace));
+  add_pair(record.local, "failedstate", local->failedstate);
+  add_pair(record.local, "voms", local->voms);
+  add_pair(record.local, "activityid", local->activityid);
+  return true;
+}
+
+void JobsSummary::Load(const GMConfig& config, const std::list<GMJobRef>& alljobs) {
+  std::map<std::string,Record> records;
+  for(std::list<GMJobRef>::const_iterator i = alljobs.begin(); i != alljobs.end(); ++i) {
+    bool pending = false;
+    job_state_t state = job_state_read_file((*i)->get_id(), config, pending);
+    if(state == JOB_STATE_UNDEFINED) continue;
+    Record& record = records[(*i)->get_id()];
+    if(!Fill(config, *i, state, pending, record)) {
+      records.erase((*i)->get_id());
+      continue;
+    };
+    time_t modified = job_state_time((*i)->get_id(), config);
+    if(modified != 0) record.modified = modified;
+  };
+  Glib::Mutex::Lock lock_(lock);
+  // Changes reported while loading are more recent
+  for(std::map<std::string,Record>::iterator r = jobs.begin(); r != jobs.end(); ++r) {
+    records[r->first] = r->second;
+  };
+  jobs.swap(records);
+  loaded = true;
+  changed = true;
+  logger.msg(Arc::VERBOSE, "Jobs summary loaded with %u jobs", (unsigned int)jobs.size());
+}
+
+void JobsSummary::ReportJobStateChange(const GMConfig& config, GMJobRef i, job_state_t new_state, bool pending) {
+  if(!i) return;
+  if(new_state == JOB_STATE_UNDEFINED) {
+    Glib::Mutex::Lock lock_(lock);
+    if(jobs.erase(i->get_id()) > 0) changed = true;
+    return;
+  };
+  Record record;
+  if(!Fill(config, i, new_state, pending, record)) {
+    Glib::Mutex::Lock lock_(lock);
+    if(jobs.erase(i->get_id()) > 0) changed = true;
+    return;
+  };
+  Glib::Mutex::Lock lock_(lock);
+  jobs[i->get_id()] = record;
+  changed = true;
+}
+
+std::string JobsSummary::Render(void) {
+  std::map<std::string,unsigned int> states;
+  std::map<std::string,unsigned int> queues;
+  std::map<std::string,unsigned int> users;
+  std::string records;
+  for(std::map<std::string,Record>::iterator r = jobs.begin(); r != jobs.end(); ++r) {
+    ++(states[r->second.status]);
+    if(!r->second.queue.empty()) ++(queues[r->second.queue]);
+    if(!r->second.subject.empty()) ++(users[r->second.subject]);
+    add_pair(records, "job", r->first);
+    add_pair(records, "status", r->second.status);
+    add_pair(records, "statusmodified", Arc::tostring(r->second.modified));
+    add_pair(records, "localowner", r->second.owner);
+    add_pair(records, "errors", r->second.errors);
+    records += r->second.local;
+  };
+  std::string out;
+  add_pair(out, "summary", Arc::tostring(time(NULL)));
+  add_pair(out, "jobs", Arc::tostring(jobs.size()));
+  for(std::map<std::string,unsigned int>::iterator s = states.begin(); s != states.end(); ++s) {
+    add_pair(out, "state", s->first + " " + Arc::tostring(s->second));
+  };
+  for(std::map<std::string,unsigned int>::iterator q = queues.begin(); q != queues.end(); ++q) {
+    add_pair(out, "queue", q->first + " " + Arc::tostring(q->second));
+  };
+  // Subject may contain spaces, so it goes last
+  for(std::map<std::string,unsigned int>::iterator u = users.begin(); u != users.end(); ++u) {
+    add_pair(out, "user", Arc::tostring(u->second) + " " + u->first);
+  };
+  out += records;
+  return out;
+}
+
+void JobsSummary::Sync(const GMConfig& config) {
+  std::string data;
+  {
+    Glib::Mutex::Lock lock_(lock);
+    if(!loaded) return;
+    time_t now = time(NULL);
+    if(changed) {
+      if((now - last_write) < SUMMARY_WRITE_PERIOD) return;
+    } else {
+      if((now - last_write) < SUMMARY_REFRESH_PERIOD) return;
+    };
+    data = Render();
+    changed = false;
+    last_write = now;
+  };
+  // Writing is done without lock because file may be big
+  std::string fname = config.ControlDir() + summary_file;
+  if(!Arc::FileCreate(fname, data, 0, 0, S_IRUSR | S_IWUSR)) {
+    logger.msg(Arc::WARNING, "Failed to write jobs summary to %s", fname);
+  };
+}
+
+} // namespace ARex
@@ -0,0 +1,63 @@
+/* keep compact summary of all jobs for information system */
+#ifndef __GM_JOBS_SUMMARY_H__
+#define __GM_JOBS_SUMMARY_H__
+
+#include <string>
+#include <list>
+#include <map>
+#include <ctime>
+
+#include <glibmm/thread.h>
+
+#include "../jobs/GMJob.h"
+
+namespace ARex {
+
+class GMConfig;
+
+/// Summary of all jobs in control directory kept up to date by job state
+/// changes. It is periodically written into single file jobs.summary in
+/// control directory, so information provider does not need to read status
+/// and .local files of every job. File consists of key=value lines. It starts
+/// with per-state, per-queue and per-user counts followed by records of jobs,
+/// each starting with job=<id> line.
+class JobsSummary {
+ private:
+  class Record {
+   public:
+    std::string status;   // as stored in status file
+    time_t modified;      // time of last state change
+    std::string owner;    // local user name
+    std::string queue;
+    std::string subject;
+    std::list<std::string> errors; // content of .failed for finished jobs
+    std::string local;    // selected .local attributes already formatted
+    Record(void):modified(0) {};
+  };
+  Glib::Mutex lock;
+  std::map<std::string,Record> jobs;
+  bool loaded;
+  bool changed;
+  time_t last_write;
+
+  /* Returns false if .local of job can't be read. Information provider
+     skips such jobs, so they are not put into summary either. */
+  bool Fill(const GMConfig& config, GMJobRef i, job_state_t state, bool pending, Record& record);
+  std::string Render(void);
+ public:
+  JobsSummary(void);
+  ~JobsSummary(void);
+
+  /* Fill summary from all jobs found in control directory */
+  void Load(const GMConfig& config, const std::list<GMJobRef>& alljobs);
+
+  /* Reflect new state of job. JOB_STATE_UNDEFINED means job was removed */
+  void ReportJobStateChange(const GMConfig& config, GMJobRef i, job_state_t new_state, bool pending);
+
+  /* Write summary file if it changed or is getting old */
+  void Sync(const GMConfig& config);
+};
+
+} // namespace ARex
+
+#endif
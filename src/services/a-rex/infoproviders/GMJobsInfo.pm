@@ -111,10 +111,237 @@ sub collect {
 }
 
 
+# Maximal age (seconds) of jobs summary written by A-REX which is still used
+our $summary_max_age = 900;
+
+#
+# Reads jobs summary which A-REX keeps in control directory. It holds status
+# and selected .local attributes of all jobs, so reading status and .local
+# files of every job is not needed. Returns undef if summary is missing or
+# too old.
+#
+sub read_summary {
+    my ($controldir) = @_;
+
+    my $summary_file = "$controldir/jobs.summary";
+    return undef unless open (SUMMARY, "<$summary_file");
+
+    my %gmjobs;
+    my $job;
+    my $written;
+    while (my $line = <SUMMARY>) {
+        next unless $line =~ m/^(\w+)=(.+)$/;
+        my ($key, $value) = ($1, $2);
+        if ($key eq 'job') {
+            $job = $gmjobs{$value} = { activityid => [] };
+        } elsif (not defined $job) {
+            # counts in header are not needed here
+            $written = $value if $key eq 'summary';
+        } elsif ($key eq 'activityid' or $key eq 'errors') {
+            push @{$job->{$key}}, $value;
+        } elsif ($key eq 'voms') {
+            push @{$job->{voms}}, $value;
+            unless (defined $job->{vomsvo}) {
+                my $vostring = $value;
+                if ($vostring =~ /^\/+(\w+)/) { $vostring = $1; };
+                $job->{vomsvo} = $vostring;
+            }
+        } else {
+            $job->{$key} = $value;
+        }
+    }
+    close SUMMARY;
+
+    unless (defined $written and $written >= time() - $summary_max_age) {
+        $log->verbose("Jobs summary $summary_file is outdated, scanning control directory");
+        return undef;
+    }
+    for my $ID (keys %gmjobs) {
+        $gmjobs{$ID}{statusread} = $written;
+    }
+    $log->verbose("Found ". scalar(keys %gmjobs). " jobs in $summary_file");
+    return \%gmjobs;
+}
+
+#
+# Common processing of job either read from per-job files or from summary.
+# Reads additional per-job files unless $nojobs is set.
+#
+sub complete_gmjob {
+    my ($controldir, $ID, $job, $nojobs) = @_;
+
+    my $gmjob_description = $controldir."/job.".$ID.".description";
+    my $gmjob_grami       = $controldir."/job.".$ID.".grami";
+    my $gmjob_diag        = $controldir."/job.".$ID.".diag";
+
+    # Extrasct jobID uri
+    if ($job->{globalid}) {
+        $job->{globalid} =~ s/.*JobSessionDir>([^<]+)<.*/$1/;
+    } else {
+        $log->debug("Job $ID: 'globalid' missing from .local file");
+    }
+    # Rename queue -> share
+    if (exists $job->{queue}) {
+        $job->{share} = $job->{queue};
+        delete $job->{queue};
+    } else {
+        $log->debug("Job $ID: 'queue' missing from .local file");
+    }
+
+    # check for interface field
+    if (! $job->{interface}) {
+        $log->debug("Job $ID: 'interface' missing from .local file, reverting to org.nordugrid.gridftpjob");
+        $job->{interface} = 'org.nordugrid.gridftpjob';
+    }
+
+    # completiontime
+    if ($job->{"status"} eq "FINISHED" and $job->{"statusmodified"}) {
+        my ($s,$m,$h,$D,$M,$Y) = gmtime($job->{"statusmodified"});
+        my $ts = sprintf("%4d%02d%02d%02d%02d%02d%1s",$Y+1900,$M+1,$D,$h,$m,$s,"Z");
+        $job->{"completiontime"} = $ts;
+    }
+
+    # check for localid
+    if (! $job->{localid}) {
+        if ($job->{status} eq 'INLRMS') {
+           $log->debug("Job $ID: has no local ID but is in INLRMS state, this should not happen");
+        } 
+        $job->{localid} = 'UNDEFINEDVALUE';
+    }
+
+    # Comes the splitting of the terminal job state
+
+    if ($job->{"status"} eq "FINISHED") {
+
+        #terminal job state mapping
+
+        if ( $job->{errors} ) {
+            if (grep /Job is canceled by external request/, @{$job->{errors}}) {
+                $job->{status} = "KILLED";
+            } elsif ( defined $job->{errors} ) {
+                $job->{status} = "FAILED";
+            }
+        }
+    }
+
+    # if jobs are not printed, it's sufficient to have jobid, status,
+    # subject, queue and share. Can skip the rest.
+    return if $nojobs;
+
+    # read the job.ID.grami file
+
+    unless ($job->{status} eq 'DELETED') {
+        unless ( open (GMJOB_GRAMI, "<$gmjob_grami") ) {
+            # this file is is kept by A-REX during the hole existence of the
+            # job. grid-manager from arc0, however, deletes it after the job
+            # has finished.
+            $log->debug("Job $ID: Can't open $gmjob_grami");
+        } else {
+            my $sessiondir = $job->{sessiondir} || '';
+
+            while (my $line = <GMJOB_GRAMI>) {
+
+                if ($line =~ m/^joboption_(\w+)='(.*)'$/) {
+                    my ($param, $value) = ($1, $2);
+                    $param =~ s/'\\''/'/g; # unescape quotes
+
+                    # These parameters are quoted by A-REX
+                    if ($param eq "stdin") {
+                        $job->{stdin} = $value;
+                        $job->{stdin} =~ s/^\Q$sessiondir\E\/*//;
+                    } elsif ($param eq "stdout") {
+                        $job->{stdout} = $value;
+                        $job->{stdout} =~ s/^\Q$sessiondir\E\/*//;
+                    } elsif ($param eq "stderr") {
+                        $job->{stderr} = $value;
+                        $job->{stderr} =~ s/^\Q$sessiondir\E\/*//;
+                    } elsif ($param =~ m/^runtime_/) {
+                        push @{$job->{runtimeenvironments}}, $value;
+                    }
+
+                } elsif ($line =~ m/^joboption_(\w+)=(\w+)$/) {
+                    my ($param, $value) = ($1, $2);
+
+                    # These parameters are not quoted by A-REX
+                    if ($param eq "count") {
+                        $job->{count} = int($value);
+                    } elsif ($param eq "walltime") {
+                        $job->{reqwalltime} = int($value);
+                    } elsif ($param eq "cputime") {
+                        $job->{reqcputime} = int($value);
+                    } elsif ($param eq "starttime") {
+                        $job->{starttime} = $value;
+                    }
+                }
+            }
+            close GMJOB_GRAMI;
+        }
+    }
+
+    #read the job.ID.description file
+
+    unless ($job->{status} eq 'DELETED') {
+        unless ( open (GMJOB_DESCRIPTION, "<$gmjob_description") ) {
+            $log->debug("Job $ID: Can't open $gmjob_description");
+        } else {
+            while (my $line = <GMJOB_DESCRIPTION>) {
+                chomp $line;
+                next unless $line;
+                if ($line =~ m/^\s*[&+|(]/) { $job->{description} = 'rsl'; last }
+                if ($line =~ m/http\:\/\/www.eu-emi.eu\/es\/2010\/12\/adl/) { $job->{description} = 'adl'; last }
+                my $nextline = <GMJOB_DESCRIPTION>;
+                if ($nextline =~ m/http\:\/\/www.eu-emi.eu\/es\/2010\/12\/adl/) { $job->{description} = 'adl'; last }
+                $log->debug("Job $ID: Can't identify job description language");
+                last;
+            }
+            close GMJOB_DESCRIPTION;
+        }
+    }
+
+    #read the job.ID.diag file
+
+
+    if (-s $gmjob_diag) {
+        unless ( open (GMJOB_DIAG, "<$gmjob_diag") ) {
+            $log->debug("Job $ID: Can't open $gmjob_diag");
+        } else {
+            my %nodenames;
+            my ($kerneltime, $usertime);
+            while (my $line = <GMJOB_DIAG>) {
+                $line=~m/^nodename=(\S+)/ and
+                    $nodenames{$1} = 1;
+                $line=~m/^WallTime=(\d+)(\.\d*)?/ and
+                    $job->{WallTime} = ceil($1);
+                $line=~m/^exitcode=(\d+)/ and
+                    $job->{exitcode} = $1;
+                $line=~m/^AverageTotalMemory=(\d+)kB/ and
+                    $job->{UsedMem} = ceil($1);
+                $line=~m/^KernelTime=(\d+)(\.\d*)?/ and
+                    $kerneltime=$1;
+                $line=~m/^UserTime=(\d+)(\.\d*)?/ and
+                    $usertime=$1;
+            }
+            close GMJOB_DIAG;
+
+            $job->{nodenames} = [ sort keys %nodenames ] if %nodenames;
+
+            $job->{CpuTime}= ceil($kerneltime + $usertime)
+                if defined $kerneltime and defined $usertime;
+        }
+    }
+}
+
 sub get_gmjobs {
 
     my ($controldir, $nojobs) = @_;
 
+    # Prefer summary maintained by A-REX over reading files of every job
+    my $summary = read_summary($controldir);
+    if ($summary) {
+        complete_gmjob($controldir, $_, $summary->{$_}, $nojobs) for keys %$summary;
+        return $summary;
+    }
+
     my %gmjobs;
 
     my $jobstoscan = 0;
@@ -144,9 +371,6 @@ sub get_gmjobs {
         my $gmjob_local       = $controldir."/job.".$ID.".local";
         my $gmjob_status      = $controlsubdir."/job.".$ID.".status";
         my $gmjob_failed      = $controldir."/job.".$ID.".failed";
-        my $gmjob_description = $controldir."/job.".$ID.".description";
-        my $gmjob_grami       = $controldir."/job.".$ID.".grami";
-        my $gmjob_diag        = $controldir."/job.".$ID.".diag";
 
         unless ( open (GMJOB_LOCAL, "<$gmjob_local") ) {
             $log->debug( "Job $ID: Can't read jobfile $gmjob_local, skipping job" );
@@ -188,26 +412,6 @@ sub get_gmjobs {
         }
         close GMJOB_LOCAL;
 
-        # Extrasct jobID uri
-        if ($job->{globalid}) {
-            $job->{globalid} =~ s/.*JobSessionDir>([^<]+)<.*/$1/;
-        } else {
-            $log->debug("Job $ID: 'globalid' missing from .local file");
-        }
-        # Rename queue -> share
-        if (exists $job->{queue}) {
-            $job->{share} = $job->{queue};
-            delete $job->{queue};
-        } else {
-            $log->debug("Job $ID: 'queue' missing from .local file");
-        }
-
-        # check for interface field
-        if (! $job->{interface}) {
-            $log->debug("Job $ID: 'interface' missing from .local file, reverting to org.nordugrid.gridftpjob");
-            $job->{interface} = 'org.nordugrid.gridftpjob';
-        }
-        
         # read the job.ID.status into "status"
         unless (open (GMJOB_STATUS, "<$gmjob_status")) {
             $log->debug("Job $ID: Can't open status file $gmjob_status, skipping job");
@@ -241,27 +445,12 @@ sub get_gmjobs {
 
                 $job->{"statusmodified"} = $file_stat[9];
                 $job->{"statusread"} = time();
-                # completiontime
-                if ($job->{"status"} eq "FINISHED") {
-                    my ($s,$m,$h,$D,$M,$Y) = gmtime($file_stat[9]);
-                    my $ts = sprintf("%4d%02d%02d%02d%02d%02d%1s",$Y+1900,$M+1,$D,$h,$m,$s,"Z");
-                    $job->{"completiontime"} = $ts;
-                }
 
             } else {
                 $log->debug("Job $ID: Cannot stat status file: $!");
             }
         }
         
-        # check for localid
-        if (! $job->{localid}) {
-            if ($job->{status} eq 'INLRMS') {
-               $log->debug("Job $ID: has no local ID but is in INLRMS state, this should not happen");
-            } 
-            $job->{localid} = 'UNDEFINEDVALUE';
-        }
-
-        # Comes the splitting of the terminal job state
         # check for job failure, (job.ID.failed )   "errors"
 
         if (-e $gmjob_failed) {
@@ -276,124 +465,8 @@ sub get_gmjobs {
             }
         }
 
-        if ($job->{"status"} eq "FINISHED") {
-
-            #terminal job state mapping
-
-            if ( $job->{errors} ) {
-                if (grep /Job is canceled by external request/, @{$job->{errors}}) {
-                    $job->{status} = "KILLED";
-                } elsif ( defined $job->{errors} ) {
-                    $job->{status} = "FAILED";
-                }
-            }
-        }
-
-        # if jobs are not printed, it's sufficient to have jobid, status,
-        # subject, queue and share. Can skip the rest.
-        next if $nojobs;
-
-        # read the job.ID.grami file
-
-        unless ($job->{status} eq 'DELETED') {
-            unless ( open (GMJOB_GRAMI, "<$gmjob_grami") ) {
-                # this file is is kept by A-REX during the hole existence of the
-                # job. grid-manager from arc0, however, deletes it after the job
-                # has finished.
-                $log->debug("Job $ID: Can't open $gmjob_grami");
-            } else {
-                my $sessiondir = $job->{sessiondir} || '';
-    
-                while (my $line = <GMJOB_GRAMI>) {
-    
-                    if ($line =~ m/^joboption_(\w+)='(.*)'$/) {
-                        my ($param, $value) = ($1, $2);
-                        $param =~ s/'\\''/'/g; # unescape quotes
-    
-                        # These parameters are quoted by A-REX
-                        if ($param eq "stdin") {
-                            $job->{stdin} = $value;
-                            $job->{stdin} =~ s/^\Q$sessiondir\E\/*//;
-                        } elsif ($param eq "stdout") {
-                            $job->{stdout} = $value;
-                            $job->{stdout} =~ s/^\Q$sessiondir\E\/*//;
-                        } elsif ($param eq "stderr") {
-                            $job->{stderr} = $value;
-                            $job->{stderr} =~ s/^\Q$sessiondir\E\/*//;
-                        } elsif ($param =~ m/^runtime_/) {
-                            push @{$job->{runtimeenvironments}}, $value;
-                        }
-    
-                    } elsif ($line =~ m/^joboption_(\w+)=(\w+)$/) {
-                        my ($param, $value) = ($1, $2);
-    
-                        # These parameters are not quoted by A-REX
-                        if ($param eq "count") {
-                            $job->{count} = int($value);
-                        } elsif ($param eq "walltime") {
-                            $job->{reqwalltime} = int($value);
-                        } elsif ($param eq "cputime") {
-                            $job->{reqcputime} = int($value);
-                        } elsif ($param eq "starttime") {
-                            $job->{starttime} = $value;
-                        }
-                    }
-                }
-                close GMJOB_GRAMI;
-            }
-        }
-
-        #read the job.ID.description file
+        complete_gmjob($controldir, $ID, $job, $nojobs);
 
-        unless ($job->{status} eq 'DELETED') {
-            unless ( open (GMJOB_DESCRIPTION, "<$gmjob_description") ) {
-                $log->debug("Job $ID: Can't open $gmjob_description");
-            } else {
-                while (my $line = <GMJOB_DESCRIPTION>) {
-                    chomp $line;
-                    next unless $line;
-                    if ($line =~ m/^\s*[&+|(]/) { $job->{description} = 'rsl'; last }
-                    if ($line =~ m/http\:\/\/www.eu-emi.eu\/es\/2010\/12\/adl/) { $job->{description} = 'adl'; last }
-                    my $nextline = <GMJOB_DESCRIPTION>;
-                    if ($nextline =~ m/http\:\/\/www.eu-emi.eu\/es\/2010\/12\/adl/) { $job->{description} = 'adl'; last }
-                    $log->debug("Job $ID: Can't identify job description language");
-                    last;
-                }
-                close GMJOB_DESCRIPTION;
-            }
-        }
-
-        #read the job.ID.diag file
-
-
-        if (-s $gmjob_diag) {
-            unless ( open (GMJOB_DIAG, "<$gmjob_diag") ) {
-                $log->debug("Job $ID: Can't open $gmjob_diag");
-            } else {
-                my %nodenames;
-                my ($kerneltime, $usertime);
-                while (my $line = <GMJOB_DIAG>) {
-                    $line=~m/^nodename=(\S+)/ and
-                        $nodenames{$1} = 1;
-                    $line=~m/^WallTime=(\d+)(\.\d*)?/ and
-                        $job->{WallTime} = ceil($1);
-                    $line=~m/^exitcode=(\d+)/ and
-                        $job->{exitcode} = $1;
-                    $line=~m/^AverageTotalMemory=(\d+)kB/ and
-                        $job->{UsedMem} = ceil($1);
-                    $line=~m/^KernelTime=(\d+)(\.\d*)?/ and
-                        $kerneltime=$1;
-                    $line=~m/^UserTime=(\d+)(\.\d*)?/ and
-                        $usertime=$1;
-                }
-                close GMJOB_DIAG;
-
-                $job->{nodenames} = [ sort keys %nodenames ] if %nodenames;
-
-                $job->{CpuTime}= ceil($kerneltime + $usertime)
-                    if defined $kerneltime and defined $usertime;
-            }
-        }
     } # job ID loop
 
     } # controlsubdir loop
@@ -325,6 +325,10 @@ Arc::MCC_Status CandyPond::CacheLink(Arc::XMLNode in, Arc::XMLNode out, const Ar
 
   std::map<std::string, std::string> to_download; // files not in cache (remote, local)
   bool error_happened = false; // if true then don't bother with downloads at the end
+  // files available in cache, linked together after checking all of them
+  std::vector<Arc::CacheLink> links;
+  std::vector<std::string> link_urls; // URL and name in request for every link
+  std::vector<std::string> link_names;
 
   // loop through all files
   for (int n = 0;;++n) {
@@ -386,12 +390,20 @@ Arc::MCC_Status CandyPond::CacheLink(Arc::XMLNode in, Arc::XMLNode out, const Ar
     }
 
     // link file
-    bool try_again = false;
     // TODO add executable and copy flags to request
-    if (!cache.Link(session_file, url, false, false, false, try_again)) {
+    links.push_back(Arc::CacheLink(session_file, url));
+    link_urls.push_back(fileurl);
+    link_names.push_back(filename);
+  }
+
+  // Link all available files in one go so per-job work is done once
+  if (!links.empty()) cache.Link(links);
+  for (unsigned int n = 0; n < links.size(); ++n) {
+    const std::string& fileurl = link_urls[n];
+    if (!links[n].linked) {
       // If locked, send to DTR and let it deal with the retry strategy
-      if (try_again) {
-        to_download[fileurl] = session_file;
+      if (links[n].try_again) {
+        to_download[fileurl] = links[n].link_path;
         continue;
       }
       // failed to link - report as if not there
@@ -402,12 +414,12 @@ Arc::MCC_Status CandyPond::CacheLink(Arc::XMLNode in, Arc::XMLNode out, const Ar
     // Successfully linked to session - move to scratch if necessary
     // Note: won't work if scratch is not mounted on CE
     if (!config.ScratchDir().empty()) {
-      std::string scratch_file(config.ScratchDir()+'/'+jobid+'/'+filename);
+      std::string scratch_file(config.ScratchDir()+'/'+jobid+'/'+link_names[n]);
       // Access session and scratch under mapped uid
       Arc::FileAccess fa;
       if (!fa.fa_setuid(mapped_user.get_uid(), mapped_user.get_gid()) ||
-          !fa.fa_rename(session_file, scratch_file)) {
-        logger.msg(Arc::ERROR, "Failed to move %s to %s: %s", session_file, scratch_file, Arc::StrError(errno));
+          !fa.fa_rename(links[n].link_path, scratch_file)) {
+        logger.msg(Arc::ERROR, "Failed to move %s to %s: %s", links[n].link_path, scratch_file, Arc::StrError(errno));
         add_result_element(results, fileurl, CandyPond::LinkError, "Failed to link to move file from session dir to scratch");
         error_happened = true;
         continue;
@@ -0,0 +1,112 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// arcpolicybench.cpp
+//
+// Measures rate of policy decisions for same policy and request when
+// evaluator with fresh policy is created for every decision (behavior of
+// PDPs with evaluator per connection), when evaluators are taken from
+// EvaluatorPool and when decisions are additionally cached.
+
+#include <iostream>
+#include <stdlib.h>
+
+#include <arc/XMLNode.h>
+#include <arc/StringConv.h>
+#include <arc/security/ArcPDP/Response.h>
+#include <arc/security/ArcPDP/EvaluatorLoader.h>
+#include <arc/security/ArcPDP/EvaluatorPool.h>
+
+using namespace ArcSec;
+
+static bool permitted(Response* resp) {
+  if(!resp) return false;
+  bool result = false;
+  ResponseList rlist = resp->getResponseItems();
+  for(int i = 0; i < rlist.size(); i++) {
+    if(rlist[i]->res == DECISION_DENY) { result = false; break; };
+    if(rlist[i]->res == DECISION_PERMIT) result = true;
+  };
+  delete resp;
+  return result;
+}
+
+static void report(const std::string& name, int iterations, const Glib::TimeVal& tBefore) {
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter -= tBefore;
+  double seconds = tAfter.as_double();
+  std::cout<<name<<": "<<iterations<<" decisions in "<<seconds<<" s, "
+           <<((seconds > 0)?(iterations/seconds):0)<<" decisions/s"<<std::endl;
+}
+
+int main(int argc,char* argv[]) {
+  if((argc != 3) && (argc != 4)) {
+    std::cerr<<"Wrong number of arguments. Expecting policy, request and optionally number of iterations."<<std::endl;
+    return -1;
+  };
+  int iterations = 1000;
+  if(argc == 4) {
+    if(!Arc::stringto(std::string(argv[3]),iterations) || (iterations <= 0)) {
+      std::cerr<<"Wrong number of iterations: "<<argv[3]<<std::endl;
+      return -1;
+    };
+  };
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::WARNING);
+
+  std::string evaluator = "arc.evaluator";
+  SourceFile request_source(argv[2]);
+  Arc::XMLNode request;
+  request_source.Get().New(request);
+  std::string request_str;
+  request.GetXML(request_str);
+
+  bool reference = false;
+  {
+    // Evaluator and policy per decision
+    EvaluatorLoader eval_loader;
+    Glib::TimeVal tBefore;
+    tBefore.assign_current_time();
+    for(int n = 0; n < iterations; ++n) {
+      Evaluator* eval = eval_loader.getEvaluator(evaluator);
+      if(!eval) {
+        std::cerr<<"Failed to create policy evaluator"<<std::endl;
+        return -1;
+      };
+      eval->addPolicy(SourceFile(argv[1]));
+      reference = permitted(eval->evaluate(Source(request)));
+      delete eval;
+    };
+    report("Evaluator per decision",iterations,tBefore);
+  };
+  std::cout<<"Decision: "<<(reference?"PERMIT":"DENY")<<std::endl;
+
+  for(int cache_size = 0; cache_size <= 1; ++cache_size) {
+    EvaluatorPool pool(evaluator,cache_size);
+    pool.addPolicyLocation(argv[1]);
+    Glib::TimeVal tBefore;
+    tBefore.assign_current_time();
+    for(int n = 0; n < iterations; ++n) {
+      bool result = false;
+      if(!pool.getDecision(request_str,result)) {
+        Evaluator* eval = pool.acquire();
+        if(!eval) {
+          std::cerr<<"Failed to create policy evaluator"<<std::endl;
+          return -1;
+        };
+        result = permitted(eval->evaluate(Source(request)));
+        pool.putDecision(eval,request_str,result);
+        pool.release(eval);
+      };
+      if(result != reference) {
+        std::cerr<<"Decision differs from reference"<<std::endl;
+        return -1;
+      };
+    };
+    report(cache_size?"Pooled evaluator with decision cache":"Pooled evaluator",iterations,tBefore);
+  };
+  return 0;
+}
@@ -0,0 +1,130 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_databuffer.cpp
+//
+// Compares fixed and adaptive DataBuffer configurations for a transfer
+// from simulated high latency source into fast local destination.
+// Source is emulated by several parallel streams. Every block read by
+// stream costs one round trip time plus time needed to pass block at
+// per-stream bandwidth.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/data/DataBuffer.h>
+
+struct SourceStandIn {
+  Arc::DataBuffer* buffer;
+  Glib::Mutex lock;
+  unsigned long long int next_offset;
+  unsigned long long int total;
+  unsigned int latency;   // microseconds
+  unsigned long long int bandwidth; // bytes per second per stream
+  int active;
+};
+
+static void source_stream(void* arg) {
+  SourceStandIn& source(*(SourceStandIn*)arg);
+  for (;;) {
+    int handle;
+    unsigned int length;
+    if (!source.buffer->for_read(handle, length, true)) break;
+    unsigned long long int offset;
+    {
+      Glib::Mutex::Lock lock(source.lock);
+      offset = source.next_offset;
+      if (offset >= source.total) {
+        length = 0;
+      } else {
+        if ((source.total - offset) < length) length = source.total - offset;
+        source.next_offset += length;
+      }
+    }
+    if (length == 0) {
+      source.buffer->is_read(handle, 0, offset);
+      break;
+    }
+    // Remote end answers after round trip and then streams the block.
+    ::usleep(source.latency + (unsigned int)((length * 1000000ULL) / source.bandwidth));
+    source.buffer->is_read(handle, length, offset);
+  }
+  Glib::Mutex::Lock lock(source.lock);
+  if (--source.active == 0) source.buffer->eof_read(true);
+}
+
+static void run(const std::string& name, bool adaptive, unsigned int latency,
+                int streams, unsigned long long int bandwidth,
+                unsigned long long int total) {
+  Arc::DataBuffer buffer;
+  buffer.set(NULL, 1048576, 3);
+  if (adaptive) buffer.adaptive(16*1048576, 32);
+  SourceStandIn source;
+  source.buffer = &buffer;
+  source.next_offset = 0;
+  source.total = total;
+  source.latency = latency;
+  source.bandwidth = bandwidth;
+  source.active = streams;
+  Arc::SimpleCounter counter;
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for (int n = 0; n < streams; ++n) {
+    if (!Arc::CreateThreadFunction(&source_stream, &source, &counter)) {
+      Glib::Mutex::Lock lock(source.lock);
+      if (--source.active == 0) buffer.eof_read(true);
+    }
+  }
+  // Destination is local memory - takes data as soon as it is available.
+  unsigned long long int memory_peak = 0;
+  unsigned long long int written = 0;
+  for (;;) {
+    int handle;
+    unsigned int length;
+    unsigned long long int offset;
+    if (!buffer.for_write(handle, length, offset, true)) break;
+    written += length;
+    unsigned long long int used = Arc::DataBuffer::process_memory_used();
+    if (used > memory_peak) memory_peak = used;
+    buffer.is_written(handle);
+  }
+  buffer.eof_write(true);
+  counter.wait();
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter.subtract(tBefore);
+  double seconds = tAfter.as_double();
+  std::cout << name << ": " << written/1048576 << " MB in " << seconds << " s, "
+            << (seconds > 0 ? written/1048576/seconds : 0) << " MB/s, "
+            << "final buffers " << buffer.buffer_num() << " x " << buffer.buffer_size()
+            << ", peak memory " << memory_peak/1048576 << " MB"
+            << (buffer.error() ? ", FAILED" : "") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  // perftest_databuffer [<latency ms> [<streams> [<stream bandwidth MB/s> [<size MB>]]]]
+  unsigned int latency = 50;
+  int streams = 8;
+  unsigned int bandwidth = 20;
+  unsigned int size = 512;
+  if (((argc > 1) && !Arc::stringto(argv[1], latency)) ||
+      ((argc > 2) && (!Arc::stringto(argv[2], streams) || (streams <= 0))) ||
+      ((argc > 3) && (!Arc::stringto(argv[3], bandwidth) || (bandwidth == 0))) ||
+      ((argc > 4) && (!Arc::stringto(argv[4], size) || (size == 0)))) {
+    std::cerr << "Usage: " << argv[0]
+              << " [<latency ms> [<streams> [<stream bandwidth MB/s> [<size MB>]]]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Round trip " << latency << " ms, " << streams << " streams of "
+            << bandwidth << " MB/s, " << size << " MB" << std::endl;
+  run("fixed   ", false, latency*1000, streams, bandwidth*1048576ULL, size*1048576ULL);
+  run("adaptive", true, latency*1000, streams, bandwidth*1048576ULL, size*1048576ULL);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_datahandle.cpp
+//
+// Measures rate of DataHandle creations, which is what staging does for
+// every file and replica. URLs of several schemes served by different
+// DMCs are used. Also URL with scheme which no plugin accepts is
+// measured. Schemes for which plugins are not installed are skipped.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+
+#include <arc/Logger.h>
+#include <arc/UserConfig.h>
+#include <arc/data/DataHandle.h>
+
+static void measure(Arc::UserConfig& usercfg, const std::string& url, bool supported, int iterations) {
+  Arc::URL u(url);
+  {
+    // First creation loads plugin
+    Arc::DataHandle h(u, usercfg);
+    if (!h && supported) {
+      std::cout << url << ": plugin not available, skipping" << std::endl;
+      return;
+    }
+  }
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    Arc::DataHandle h(u, usercfg);
+  }
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter -= tBefore;
+  std::cout << url << ": " << (iterations / tAfter.as_double())
+            << " handles per second" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 10000;
+  if (argc > 1) iterations = atoi(argv[1]);
+  if (iterations <= 0) {
+    std::cerr << "Usage: perftest_datahandle [iterations]" << std::endl;
+    return 1;
+  }
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  Arc::UserConfig usercfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  measure(usercfg, "file:///tmp/perftest_datahandle", true, iterations);
+  measure(usercfg, "https://example.org/path/to/file", true, iterations);
+  measure(usercfg, "gsiftp://example.org/path/to/file", true, iterations);
+  measure(usercfg, "srm://example.org/path/to/file", true, iterations);
+  measure(usercfg, "root://example.org//path/to/file", true, iterations);
+  measure(usercfg, "unknown://example.org/path/to/file", false, iterations);
+  return 0;
+}
@@ -0,0 +1,103 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_deleg_burst.cpp
+//
+// Measures latency of bursts of delegation requests as seen by service.
+// Requests are processed in-process by DelegationContainerSOAP (SOAP
+// delegation interfaces) and by DelegationConsumerSOAP with credentials
+// request (path used by A-REX REST interface). Every burst is run first
+// without key pool and then with key pool filled in advance.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glibmm/thread.h>
+
+#include <arc/Logger.h>
+#include <arc/message/PayloadSOAP.h>
+#include <arc/delegation/DelegationInterface.h>
+
+static double elapsed(const Glib::TimeVal& tBefore) {
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter -= tBefore;
+  return tAfter.as_double();
+}
+
+static void report(const std::string& name, int requests, double total, double longest) {
+  std::cout << name << ": " << requests << " requests in " << total << " s, average "
+            << (total * 1000.0 / requests) << " ms, longest " << (longest * 1000.0)
+            << " ms" << std::endl;
+}
+
+static bool burst_soap(int requests) {
+  Arc::DelegationContainerSOAP container;
+  Arc::NS ns;
+  ns["deleg"] = "http://www.nordugrid.org/schemas/delegation";
+  double total = 0, longest = 0;
+  for (int n = 0; n < requests; ++n) {
+    Arc::PayloadSOAP in(ns);
+    in.NewChild("deleg:DelegateCredentialsInit");
+    Arc::PayloadSOAP out(ns);
+    Glib::TimeVal tBefore;
+    tBefore.assign_current_time();
+    if (!container.Process(in, out) || out.IsFault()) {
+      std::cerr << "DelegateCredentialsInit failed" << std::endl;
+      return false;
+    }
+    double t = elapsed(tBefore);
+    total += t;
+    if (t > longest) longest = t;
+  }
+  report("  SOAP DelegateCredentialsInit", requests, total, longest);
+  return true;
+}
+
+static bool burst_consumer(int requests) {
+  double total = 0, longest = 0;
+  for (int n = 0; n < requests; ++n) {
+    Glib::TimeVal tBefore;
+    tBefore.assign_current_time();
+    Arc::DelegationConsumerSOAP consumer;
+    std::string request;
+    if (!consumer || !consumer.Request(request)) {
+      std::cerr << "Failed to create credentials request" << std::endl;
+      return false;
+    }
+    double t = elapsed(tBefore);
+    total += t;
+    if (t > longest) longest = t;
+  }
+  report("  Consumer with credentials request", requests, total, longest);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int requests = 20;
+  int fill_time = 10;
+  if (argc > 1) requests = atoi(argv[1]);
+  if (argc > 2) fill_time = atoi(argv[2]);
+  if ((requests <= 0) || (fill_time < 0)) {
+    std::cerr << "Usage: perftest_deleg_burst [requests [seconds to fill key pool]]" << std::endl;
+    return 1;
+  }
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  std::cout << "Without key pool" << std::endl;
+  if (!burst_soap(requests)) return 1;
+  if (!burst_consumer(requests)) return 1;
+
+  Arc::DelegationConsumer::KeyPoolSize(requests);
+  std::cout << "With key pool of " << requests << " keys" << std::endl;
+  sleep(fill_time);
+  if (!burst_soap(requests)) return 1;
+  sleep(fill_time);
+  if (!burst_consumer(requests)) return 1;
+  Arc::DelegationConsumer::KeyPoolSize(0);
+  return 0;
+}
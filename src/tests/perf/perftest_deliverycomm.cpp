@@ -0,0 +1,247 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_deliverycomm.cpp
+//
+// Measures cost of monitoring many concurrent transfers by
+// DataDeliveryCommHandler. Each simulated delivery process reports its
+// status through a pipe several times per second like DataStagingDelivery
+// does and closes pipe when transfer is finished. In "watch" mode pipes
+// are registered with handler and consumer waits for wake up like
+// DataDelivery does. In "poll" mode all transfers are polled periodically.
+// Reported are CPU time used for monitoring and delay between end of
+// transfer and its detection by consumer.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <glibmm/timeval.h>
+
+#include <arc/Thread.h>
+#include <arc/User.h>
+#include <arc/UserConfig.h>
+#include <arc/data-staging/DataDeliveryComm.h>
+
+using namespace DataStaging;
+
+// Reads status written by simulated delivery process
+class PipeComm: public DataDeliveryComm {
+ public:
+  Glib::TimeVal finished;
+  PipeComm(DTR_ptr dtr, const TransferParameters& params, int handle, bool watch)
+    : DataDeliveryComm(dtr, params), handle_(handle) {
+    memset(&status_, 0, sizeof(status_));
+    status_.commstatus = CommInit;
+    handler_->Add(this);
+    if (watch) handler_->Watch(this, handle_);
+  }
+  virtual ~PipeComm() {
+    handler_->Remove(this);
+    if (handle_ != -1) close(handle_);
+  }
+  virtual void PullStatus() {
+    Glib::Mutex::Lock lock(lock_);
+    if (handle_ == -1) return;
+    for (;;) {
+      ssize_t l = ::read(handle_, ((char*)&status_buf_) + status_pos_, sizeof(status_buf_) - status_pos_);
+      if ((l < 0) && (errno == EINTR)) continue;
+      if ((l < 0) && (errno == EAGAIN)) break;
+      if (l <= 0) {
+        status_.commstatus = CommExited;
+        updated_ = true;
+        close(handle_);
+        handle_ = -1;
+        return;
+      }
+      status_pos_ += l;
+      if (status_pos_ >= sizeof(status_buf_)) {
+        status_ = status_buf_;
+        status_pos_ -= sizeof(status_buf_);
+        updated_ = true;
+      }
+    }
+  }
+  virtual operator bool() const { return (handle_ != -1); }
+  virtual bool operator!() const { return (handle_ == -1); }
+ private:
+  int handle_;
+};
+
+class Transfer {
+ public:
+  int handle;
+  PipeComm* comm;
+  Glib::TimeVal next;
+  Glib::TimeVal end;
+  unsigned long long int transferred;
+};
+
+static Glib::Mutex lock;
+static std::vector<Transfer> transfers;
+static int period = 100; // ms between reports of each transfer
+static unsigned long long int reports = 0;
+static double writer_cpu = 0;
+
+static double cputime(int who) {
+  struct rusage usage;
+  if (getrusage(who, &usage) != 0) return 0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+// Simulates all delivery processes
+static void deliveries(void*) {
+  unsigned int active = transfers.size();
+  while (active > 0) {
+    Glib::usleep(5000);
+    Glib::TimeVal now;
+    now.assign_current_time();
+    for (std::vector<Transfer>::iterator t = transfers.begin(); t != transfers.end(); ++t) {
+      if (t->handle == -1) continue;
+      if (now < t->next) continue;
+      DataDeliveryComm::Status status;
+      memset(&status, 0, sizeof(status));
+      status.commstatus = DataDeliveryComm::CommNoError;
+      status.timestamp = now.tv_sec;
+      status.status = DTRStatus::TRANSFERRING;
+      t->transferred += 1048576;
+      status.transferred = t->transferred;
+      if (!(now < t->end)) status.status = DTRStatus::TRANSFERRED;
+      if (write(t->handle, &status, sizeof(status)) == sizeof(status)) ++reports;
+      t->next.add_milliseconds(period);
+      if (!(now < t->end)) {
+        {
+          Glib::Mutex::Lock lock_(lock);
+          t->comm->finished.assign_current_time();
+        }
+        close(t->handle);
+        t->handle = -1;
+        --active;
+      }
+    }
+  }
+#ifdef RUSAGE_THREAD
+  writer_cpu = cputime(RUSAGE_THREAD);
+#endif
+}
+
+int main(int argc, char* argv[]) {
+  int number = 5000;
+  int duration = 10;
+  bool watch = true;
+  if (argc > 1) number = atoi(argv[1]);
+  if (argc > 2) duration = atoi(argv[2]);
+  if (argc > 3) period = atoi(argv[3]);
+  if (argc > 4) watch = (std::string(argv[4]) != "poll");
+  if ((number <= 0) || (duration <= 0) || (period <= 0)) {
+    std::cerr << "Usage: perftest_deliverycomm [transfers [seconds [report period ms [watch|poll]]]]" << std::endl;
+    return 1;
+  }
+
+  // Every transfer needs 2 handles
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < (rlim_t)(2 * number + 64)) {
+      number = (limit.rlim_cur - 64) / 2;
+      std::cout << "Number of transfers reduced to " << number << " by limit of open files" << std::endl;
+    }
+  }
+
+  // Comm objects only need DTR for logging
+  Arc::UserConfig cfg;
+  std::list<DTRLogDestination> logs;
+  DTR_ptr dtr(new DTR("file:///dev/null", "file:///dev/null", cfg, "perftest", Arc::User().get_uid(), logs, "perftest"));
+  TransferParameters params;
+
+  Arc::SimpleCondition cond;
+  std::list<PipeComm*> comms;
+  transfers.resize(number);
+  Glib::TimeVal start;
+  start.assign_current_time();
+  for (int n = 0; n < number; ++n) {
+    int handles[2];
+    if (pipe(handles) != 0) {
+      std::cerr << "Failed to create pipe" << std::endl;
+      return 1;
+    }
+    fcntl(handles[0], F_SETFL, O_NONBLOCK);
+    fcntl(handles[1], F_SETFL, O_NONBLOCK);
+    Transfer& t = transfers[n];
+    t.handle = handles[1];
+    t.transferred = 0;
+    t.next = start;
+    t.next.add_milliseconds(n % period);
+    t.end = start;
+    // Spread ends of transfers between 1/2 and 3/2 of duration
+    t.end.add_milliseconds(duration * 500 + (long)(duration * 1000.0 * n / number));
+    t.comm = new PipeComm(dtr, params, handles[0], watch);
+    if (watch) t.comm->SetWakeUp(&cond);
+    comms.push_back(t.comm);
+  }
+
+  double cpu_before = cputime(RUSAGE_SELF);
+  Arc::SimpleCounter counter;
+  Arc::CreateThreadFunction(&deliveries, NULL, &counter);
+
+  // Consumer mimics main loop of DataDelivery
+  double latency = 0;
+  double max_latency = 0;
+  unsigned long long int updates = 0;
+  while (!comms.empty()) {
+    for (std::list<PipeComm*>::iterator c = comms.begin(); c != comms.end();) {
+      PipeComm* comm = *c;
+      if (watch && !comm->Updated()) {
+        ++c;
+        continue;
+      }
+      DataDeliveryComm::Status status = comm->GetStatus();
+      ++updates;
+      if ((status.commstatus == DataDeliveryComm::CommExited) || !(*comm)) {
+        Glib::TimeVal now;
+        now.assign_current_time();
+        {
+          Glib::Mutex::Lock lock_(lock);
+          now -= comm->finished;
+        }
+        latency += now.as_double();
+        if (now.as_double() > max_latency) max_latency = now.as_double();
+        delete comm;
+        c = comms.erase(c);
+        continue;
+      }
+      ++c;
+    }
+    cond.wait(watch ? 1000 : 100);
+  }
+  counter.wait();
+
+  Glib::TimeVal wall;
+  wall.assign_current_time();
+  wall -= start;
+  double cpu = cputime(RUSAGE_SELF) - cpu_before - writer_cpu;
+  std::cout << (watch ? "Watching " : "Polling ") << number << " transfers for "
+            << wall.as_double() << " s, " << reports << " reports, "
+            << updates << " status updates processed" << std::endl;
+  std::cout << "Monitoring CPU usage: " << (cpu * 100.0 / wall.as_double()) << "%"
+#ifndef RUSAGE_THREAD
+            << " (including simulated deliveries)"
+#endif
+            << std::endl;
+  std::cout << "Detection of finished transfer: average " << (latency * 1000.0 / number)
+            << " ms, maximum " << (max_latency * 1000.0) << " ms" << std::endl;
+  return 0;
+}
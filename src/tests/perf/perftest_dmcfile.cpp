@@ -0,0 +1,121 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_dmcfile.cpp
+//
+// Measures throughput of local file copies made through the file DMC
+// with default I/O and with the I/O engine selected by URL options.
+
+#include <iostream>
+#include <list>
+#include <string>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/UserConfig.h>
+#include <arc/data/DataHandle.h>
+#include <arc/data/DataMover.h>
+#include <arc/data/FileCache.h>
+#include <arc/data/URLMap.h>
+
+static bool create_source(const std::string& path, unsigned long long int size) {
+  int h = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (h == -1) return false;
+  const unsigned int bsize = 1048576;
+  char* block = new char[bsize];
+  for (unsigned int n = 0; n < bsize; ++n) block[n] = (char)(n * 31 + 7);
+  bool result = true;
+  for (unsigned long long int done = 0; done < size;) {
+    unsigned int l = ((size - done) < bsize) ? (size - done) : bsize;
+    ssize_t ll = ::write(h, block, l);
+    if (ll <= 0) { result = false; break; }
+    done += ll;
+  }
+  delete[] block;
+  if (::fsync(h) != 0) result = false;
+  if (::close(h) != 0) result = false;
+  return result;
+}
+
+static bool copy(Arc::UserConfig& usercfg, const std::string& name,
+                 const std::string& source, const std::string& destination,
+                 const std::list<std::string>& options, unsigned long long int size) {
+  Arc::FileDelete(destination);
+  Arc::URL src_url("file://" + source);
+  Arc::URL dst_url("file://" + destination);
+  for (std::list<std::string>::const_iterator o = options.begin(); o != options.end(); ++o) {
+    std::string::size_type p = o->find('=');
+    src_url.AddOption(o->substr(0, p), o->substr(p + 1));
+    dst_url.AddOption(o->substr(0, p), o->substr(p + 1));
+  }
+  Arc::DataHandle src(src_url, usercfg);
+  Arc::DataHandle dst(dst_url, usercfg);
+  if (!src || !dst) {
+    std::cerr << "Failed to load file DMC" << std::endl;
+    return false;
+  }
+  Arc::DataMover mover;
+  mover.retry(false);
+  Arc::FileCache cache;
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  Arc::DataStatus res = mover.Transfer(*src, *dst, cache, Arc::URLMap());
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter.subtract(tBefore);
+  double seconds = tAfter.as_double();
+  std::cout << name << ": " << size/1048576 << " MB in " << seconds << " s, "
+            << (seconds > 0 ? size/1048576/seconds : 0) << " MB/s";
+  if (!res) std::cout << ", FAILED: " << std::string(res);
+  std::cout << std::endl;
+  Arc::FileDelete(destination);
+  return (bool)res;
+}
+
+int main(int argc, char* argv[]) {
+  // perftest_dmcfile <directory> [<size MB> [<threads>]]
+  unsigned int size = 1024;
+  std::string threads = "4";
+  unsigned int n;
+  if ((argc < 2) ||
+      ((argc > 2) && (!Arc::stringto(argv[2], size) || (size == 0))) ||
+      ((argc > 3) && (!Arc::stringto(argv[3], n) || (n == 0)))) {
+    std::cerr << "Usage: " << argv[0] << " <directory> [<size MB> [<threads>]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (argc > 3) threads = argv[3];
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  std::string dir(argv[1]);
+  std::string source = dir + "/perftest_dmcfile.src";
+  std::string destination = dir + "/perftest_dmcfile.dst";
+  unsigned long long int bytes = size * 1048576ULL;
+  if (!create_source(source, bytes)) {
+    std::cerr << "Failed to create " << source << std::endl;
+    Arc::FileDelete(source);
+    return EXIT_FAILURE;
+  }
+  Arc::UserConfig usercfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  bool result = true;
+  std::list<std::string> options;
+  result &= copy(usercfg, "default          ", source, destination, options, bytes);
+  options.push_back("ioengine=async");
+  options.push_back("threads=" + threads);
+  result &= copy(usercfg, "async            ", source, destination, options, bytes);
+  options.push_back("iodirect=yes");
+  result &= copy(usercfg, "async+direct     ", source, destination, options, bytes);
+  options.push_back("iosync=16777216");
+  result &= copy(usercfg, "async+direct+sync", source, destination, options, bytes);
+  Arc::FileDelete(source);
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_glue2.cpp
+//
+// Measures parsing of GLUE2 information as returned by REST interface
+// of A-REX. Compares parsing of whole XML tree against sequential
+// parsing which skips ComputingActivities. Document is either read from
+// file or generated with specified number of activities. Peak memory
+// usage is reported after each parser, so streaming one runs first.
+
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <glibmm/timeval.h>
+
+#include <arc/XMLNode.h>
+#include <arc/compute/ExecutionTarget.h>
+#include <arc/compute/GLUE2.h>
+
+static std::string generate(int activities) {
+  std::ostringstream xml;
+  xml << "<Domains xmlns=\"http://schemas.ogf.org/glue/2009/03/spec_2.0_r1\">"
+      << "<AdminDomain><ID>urn:ad:perftest</ID><Services><ComputingService>"
+      << "<ID>urn:cs:perftest</ID><Type>org.nordugrid.arex</Type>"
+      << "<QualityLevel>production</QualityLevel>"
+      << "<TotalJobs>" << activities << "</TotalJobs>"
+      << "<ComputingEndpoint><URL>https://ce.example.org:443/arex</URL>"
+      << "<InterfaceName>org.nordugrid.arcrest</InterfaceName>"
+      << "<HealthState>ok</HealthState><ComputingActivities>";
+  for (int n = 0; n < activities; ++n) {
+    xml << "<ComputingActivity><ID>urn:caid:ce.example.org:job" << n << "</ID>"
+        << "<Name>job " << n << "</Name><State>emies:processing-running</State>"
+        << "<State>arcrest:RUNNING</State><Owner>/DC=org/DC=example/CN=User "
+        << (n % 100) << "</Owner><Queue>batch</Queue>"
+        << "<SubmissionTime>2021-04-20T10:00:00Z</SubmissionTime></ComputingActivity>";
+  }
+  xml << "</ComputingActivities></ComputingEndpoint>"
+      << "<ComputingShare><MappingQueue>batch</MappingQueue>"
+      << "<RunningJobs>" << activities << "</RunningJobs></ComputingShare>"
+      << "<ComputingManager><ProductName>SLURM</ProductName><TotalSlots>1024</TotalSlots>"
+      << "<ExecutionEnvironments><ExecutionEnvironment><Platform>amd64</Platform>"
+      << "<Associations>";
+  for (int n = 0; n < activities; ++n) {
+    xml << "<ComputingActivityID>urn:caid:ce.example.org:job" << n << "</ComputingActivityID>";
+  }
+  xml << "</Associations></ExecutionEnvironment></ExecutionEnvironments>"
+      << "</ComputingManager></ComputingService></Services></AdminDomain></Domains>";
+  return xml.str();
+}
+
+static long maxrss(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+static void report(const std::string& name, int iterations, std::string::size_type size,
+                   const Glib::TimeVal& tBefore) {
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter -= tBefore;
+  std::cout << name << ": " << (tAfter.as_double() * 1000.0 / iterations) << " ms per document, "
+            << (size * (double)iterations / tAfter.as_double() / 1048576.0) << " MB/s, "
+            << "peak RSS " << maxrss() << " kB" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 10;
+  std::string xml;
+  if (argc > 1) iterations = atoi(argv[1]);
+  if ((argc > 2) && (atoi(argv[2]) == 0)) {
+    std::ifstream f(argv[2]);
+    std::ostringstream content;
+    content << f.rdbuf();
+    xml = content.str();
+  } else {
+    xml = generate((argc > 2) ? atoi(argv[2]) : 100000);
+  }
+  if ((iterations <= 0) || xml.empty()) {
+    std::cerr << "Usage: perftest_glue2 [iterations [activities|file]]" << std::endl;
+    return 1;
+  }
+  std::cout << "Document size: " << xml.length() << " bytes" << std::endl;
+
+  Glib::TimeVal tBefore;
+  unsigned int streamed = 0;
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    std::list<Arc::ComputingServiceType> services;
+    if (!Arc::GLUE2::ParseExecutionTargets(xml.c_str(), xml.length(), services)) {
+      std::cerr << "Document is not XML" << std::endl;
+      return 1;
+    }
+    streamed = services.size();
+  }
+  report("Streaming parser", iterations, xml.length(), tBefore);
+
+  unsigned int parsed = 0;
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    std::list<Arc::ComputingServiceType> services;
+    Arc::XMLNode tree(xml.c_str(), xml.length());
+    Arc::GLUE2::ParseExecutionTargets(tree["AdminDomain"]["Services"], services);
+    parsed = services.size();
+  }
+  report("Tree parser", iterations, xml.length(), tBefore);
+
+  if (streamed != parsed) {
+    std::cerr << "Parsers found different number of services: "
+              << streamed << " and " << parsed << std::endl;
+    return 1;
+  }
+  return 0;
+}
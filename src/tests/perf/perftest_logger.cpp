@@ -0,0 +1,92 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_logger.cpp
+//
+// Measures cost of log messages suppressed by threshold. Compares
+// msg() with arguments against explicitly constructed LogMessage
+// which is formatted before threshold is checked. Also measures case
+// when some other logger has lower threshold, so only threshold of
+// logger in use (including per-thread context) rejects message.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+class NullDestination: public Arc::LogDestination {
+ public:
+  unsigned long long int count;
+  NullDestination(void):count(0) {}
+  virtual void log(const Arc::LogMessage&) { ++count; }
+};
+
+static void report(const std::string& name, int iterations, const Glib::TimeVal& tBefore) {
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  tAfter -= tBefore;
+  std::cout << name << ": " << (tAfter.as_double() * 1000000000.0 / iterations)
+            << " ns per message" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 1000000;
+  if (argc > 1) iterations = atoi(argv[1]);
+  if (iterations <= 0) {
+    std::cerr << "Usage: perftest_logger [iterations]" << std::endl;
+    return 1;
+  }
+
+  NullDestination destination;
+  Arc::Logger::getRootLogger().addDestination(destination);
+  Arc::Logger::getRootLogger().setThreshold(Arc::INFO);
+  Arc::Logger logger(Arc::Logger::getRootLogger(), "perftest");
+  std::string transfer("gsiftp://example.org/path/to/some/file");
+  Glib::TimeVal tBefore;
+
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    logger.msg(Arc::DEBUG, "Transferred %llu bytes of %s in %i seconds",
+               (unsigned long long int)n, transfer, n % 60);
+  }
+  report("Suppressed msg()", iterations, tBefore);
+
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    logger.msg(Arc::LogMessage(Arc::DEBUG, Arc::IString("Transferred %llu bytes of %s in %i seconds",
+               (unsigned long long int)n, transfer, n % 60)));
+  }
+  report("Suppressed preformatted LogMessage", iterations, tBefore);
+
+  {
+    // Some other logger requires DEBUG messages - quick check can't help
+    Arc::Logger debug_logger(Arc::Logger::getRootLogger(), "debug", Arc::DEBUG);
+    logger.setThreadContext();
+    logger.setThreshold(Arc::INFO);
+    tBefore.assign_current_time();
+    for (int n = 0; n < iterations; ++n) {
+      logger.msg(Arc::DEBUG, "Transferred %llu bytes of %s in %i seconds",
+                 (unsigned long long int)n, transfer, n % 60);
+    }
+    report("Suppressed msg() by per-thread threshold", iterations, tBefore);
+  }
+
+  tBefore.assign_current_time();
+  for (int n = 0; n < iterations; ++n) {
+    logger.msg(Arc::INFO, "Transferred %llu bytes of %s in %i seconds",
+               (unsigned long long int)n, transfer, n % 60);
+  }
+  report("Logged msg()", iterations, tBefore);
+
+  if (destination.count != (unsigned long long int)iterations) {
+    std::cerr << "Unexpected number of logged messages: " << destination.count << std::endl;
+    return 1;
+  }
+  Arc::Logger::getRootLogger().removeDestinations();
+  return 0;
+}
@@ -0,0 +1,266 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_tlshandshake.cpp
+//
+// Measures rate of TLS handshakes a service (for example A-REX) can
+// accept. Each request opens new TCP connection, performs TLS handshake
+// and closes connection. Run it against a service configured with
+// SharedContext set to "true" and to "false" in its TLS MCC to compare
+// shared and per-connection SSL contexts. With -r option every thread
+// tries to resume session obtained in previous connection which makes
+// it possible to compare full handshakes with resumed ones of service
+// with SessionCache enabled.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <glibmm/thread.h>
+#include <glibmm/timer.h>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <arc/Logger.h>
+#include <arc/crypto/OpenSSL.h>
+
+// Some global shared variables...
+Glib::Mutex* mutex;
+bool run;
+int finishedThreads;
+unsigned long completedHandshakes;
+unsigned long failedHandshakes;
+Glib::TimeVal completedTime;
+std::string host;
+std::string port;
+SSL_CTX* sslctx;
+bool resumeSessions = false;
+unsigned long resumedHandshakes;
+
+// Keeps last session received from service for thread which made connection
+static int newSession(SSL* ssl, SSL_SESSION* session) {
+  SSL_SESSION** last = (SSL_SESSION**)SSL_get_app_data(ssl);
+  if(!last) return 0;
+  if(*last) SSL_SESSION_free(*last);
+  *last = session;
+  return 1;
+}
+
+static int connect_tcp(void) {
+  struct addrinfo hint;
+  struct addrinfo* info = NULL;
+  memset(&hint, 0, sizeof(hint));
+  hint.ai_family = AF_UNSPEC;
+  hint.ai_socktype = SOCK_STREAM;
+  if(getaddrinfo(host.c_str(), port.c_str(), &hint, &info) != 0) return -1;
+  int s = -1;
+  for(struct addrinfo* i = info; i; i = i->ai_next) {
+    s = socket(i->ai_family, i->ai_socktype, i->ai_protocol);
+    if(s == -1) continue;
+    if(connect(s, i->ai_addr, i->ai_addrlen) == 0) break;
+    close(s); s = -1;
+  }
+  freeaddrinfo(info);
+  return s;
+}
+
+// Perform handshakes and collect statistics.
+void doHandshakes(){
+  unsigned long completedHandshakes = 0;
+  unsigned long failedHandshakes = 0;
+  unsigned long resumedHandshakes = 0;
+  SSL_SESSION* session = NULL;
+  Glib::TimeVal completedTime(0,0);
+  Glib::TimeVal tBefore;
+  Glib::TimeVal tAfter;
+
+  while(run){
+    tBefore.assign_current_time();
+    bool ok = false;
+    int s = connect_tcp();
+    if(s != -1) {
+      SSL* ssl = SSL_new(sslctx);
+      if(ssl) {
+        SSL_set_fd(ssl, s);
+        if(resumeSessions) {
+          SSL_set_app_data(ssl, &session);
+          if(session) SSL_set_session(ssl, session);
+        }
+        if(SSL_connect(ssl) == 1) {
+          ok = true;
+          if(SSL_session_reused(ssl)) resumedHandshakes++;
+          // Waiting for close notification from service also makes
+          // sure session tickets sent after handshake are processed.
+          if((SSL_shutdown(ssl) == 0) && resumeSessions) SSL_shutdown(ssl);
+        } else if(session) {
+          SSL_SESSION_free(session);
+          session = NULL;
+        }
+        SSL_free(ssl);
+      }
+      close(s);
+    }
+    ERR_clear_error();
+    tAfter.assign_current_time();
+    if(ok) {
+      completedHandshakes++;
+      completedTime+=tAfter-tBefore;
+    } else {
+      failedHandshakes++;
+    }
+  }
+  if(session) SSL_SESSION_free(session);
+
+  // Update global variables.
+  Glib::Mutex::Lock lock(*mutex);
+  ::completedHandshakes+=completedHandshakes;
+  ::failedHandshakes+=failedHandshakes;
+  ::resumedHandshakes+=resumedHandshakes;
+  ::completedTime+=completedTime;
+  finishedThreads++;
+}
+
+int main(int argc, char* argv[]){
+  int numberOfThreads;
+  int duration;
+  int i;
+  Glib::Thread** threads;
+  const char* cert_file = NULL;
+  const char* key_file = NULL;
+  const char* ca_dir = NULL;
+  int debug_level = -1;
+  Arc::LogStream logcerr(std::cerr);
+
+  // Process options - quick hack, must use Glib options later
+  while(argc >= 3) {
+    if(strcmp(argv[1],"-c") == 0) {
+      cert_file = argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-k") == 0) {
+      key_file = argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-C") == 0) {
+      ca_dir = argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-d") == 0) {
+      debug_level=Arc::istring_to_level(argv[2]);
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-r") == 0) {
+      resumeSessions=true; argv+=1; argc-=1;
+    } else {
+      break;
+    };
+  }
+  if(debug_level >= 0) {
+    Arc::Logger::getRootLogger().setThreshold((Arc::LogLevel)debug_level);
+    Arc::Logger::getRootLogger().addDestination(logcerr);
+  }
+  // Extract command line arguments.
+  if (argc!=5){
+    std::cerr << "Wrong number of arguments!" << std::endl
+	      << std::endl
+	      << "Usage:" << std::endl
+	      << "perftest_tlshandshake [-c cert] [-k key] [-C cadir] [-d debug] [-r] host port threads duration" << std::endl
+	      << std::endl
+	      << "Arguments:" << std::endl
+	      << "host      The host name of the service." << std::endl
+	      << "port      The port of the service." << std::endl
+	      << "threads   The number of concurrent connections." << std::endl
+	      << "duration  The duration of the test in seconds." << std::endl
+	      << "-c cert   Client certificate or proxy if service requires client" << std::endl
+	      << "          authentication." << std::endl
+	      << "-k key    Client private key. Defaults to certificate file." << std::endl
+	      << "-C cadir  Directory with CA certificates. If not specified" << std::endl
+	      << "          server certificate is not verified." << std::endl
+	      << "-d debug  The textual representation of desired debug level. Available " << std::endl
+	      << "          levels: DEBUG, VERBOSE, INFO, WARNING, ERROR, FATAL." << std::endl
+	      << "-r        Resume session of previous connection instead of" << std::endl
+	      << "          making full handshake every time." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  host = argv[1];
+  port = argv[2];
+  numberOfThreads = atoi(argv[3]);
+  duration = atoi(argv[4]);
+
+  if(!Arc::OpenSSLInit()) {
+    std::cerr << "Failed to initialize OpenSSL" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  sslctx = SSL_CTX_new(SSLv23_client_method());
+  if(!sslctx) {
+    std::cerr << "Failed to create SSL context" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if(resumeSessions) {
+    // Sessions are kept by threads
+    SSL_CTX_set_session_cache_mode(sslctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(sslctx, &newSession);
+  } else {
+    // Make every handshake a full one
+    SSL_CTX_set_session_cache_mode(sslctx, SSL_SESS_CACHE_OFF);
+#ifdef SSL_OP_NO_TICKET
+    SSL_CTX_set_options(sslctx, SSL_OP_NO_TICKET);
+#endif
+  }
+  if(cert_file) {
+    if(!key_file) key_file = cert_file;
+    if((SSL_CTX_use_certificate_chain_file(sslctx, cert_file) != 1) ||
+       (SSL_CTX_use_PrivateKey_file(sslctx, key_file, SSL_FILETYPE_PEM) != 1)) {
+      std::cerr << "Failed to load client credentials" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  if(ca_dir) {
+    if(SSL_CTX_load_verify_locations(sslctx, NULL, ca_dir) != 1) {
+      std::cerr << "Failed to load CA certificates" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER, NULL);
+    X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx), X509_V_FLAG_ALLOW_PROXY_CERTS);
+  } else {
+    SSL_CTX_set_verify(sslctx, SSL_VERIFY_NONE, NULL);
+  }
+
+  // Start threads.
+  run=true;
+  finishedThreads=0;
+  mutex=new Glib::Mutex;
+  threads = new Glib::Thread*[numberOfThreads];
+  for (i=0; i<numberOfThreads; i++)
+    threads[i]=Glib::Thread::create(sigc::ptr_fun(doHandshakes),true);
+
+  // Sleep while the threads are working.
+  Glib::usleep(duration*1000000);
+
+  // Stop the threads
+  run=false;
+  for (i=0; i<numberOfThreads; i++)
+    threads[i]->join();
+
+  // Print the result of the test.
+  Glib::Mutex::Lock lock(*mutex);
+  std::cout << "========================================" << std::endl;
+  std::cout << "Number of threads: " << numberOfThreads << std::endl;
+  std::cout << "Duration: " << duration << " s" << std::endl;
+  std::cout << "Completed handshakes: " << completedHandshakes << std::endl;
+  std::cout << "Failed handshakes: " << failedHandshakes << std::endl;
+  std::cout << "Resumed handshakes: " << resumedHandshakes << std::endl;
+  if(duration > 0)
+    std::cout << "Handshakes per second: "
+              << double(completedHandshakes)/duration << std::endl;
+  if(completedHandshakes > 0)
+    std::cout << "Average handshake time: "
+              << completedTime.as_double()*1000/completedHandshakes << " ms" << std::endl;
+  std::cout << "========================================" << std::endl;
+
+  delete[] threads;
+  SSL_CTX_free(sslctx);
+  return EXIT_SUCCESS;
+}
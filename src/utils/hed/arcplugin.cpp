@@ -2,6 +2,7 @@
 #include <config.h>
 #endif
 
+#include <cstring>
 #include <fstream>
 #include <unistd.h>
 
@@ -59,6 +60,17 @@ static std::string replace_file_suffix(const std::string& path,const std::string
     return newpath;
 }
 
+static const char* find_protocols(Arc::PluginProtocolsDescriptor* protocols, Arc::PluginDescriptor* desc) {
+    for(;protocols;++protocols) {
+        if(protocols->name == NULL) break;
+        if(protocols->kind == NULL) break;
+        if(protocols->protocols == NULL) break;
+        if((strcmp(protocols->name, desc->name) == 0) &&
+           (strcmp(protocols->kind, desc->kind) == 0)) return protocols->protocols;
+    }
+    return NULL;
+}
+
 static bool process_module(const std::string& plugin_filename, bool create_apd) {
     Arc::PluginDescriptor dummy_desc[2];
     memset(dummy_desc,0,sizeof(dummy_desc));
@@ -93,6 +105,12 @@ static bool process_module(const std::string& plugin_filename, bool create_apd)
 
     Arc::PluginDescriptor* desc = (Arc::PluginDescriptor*)ptr;
 
+    // Optional declaration of URL schemes
+    void *protocols_ptr = NULL;
+    if((ptr == dummy_desc) || !module->get_symbol(ARC_PLUGINS_PROTOCOLS_SYMB,protocols_ptr)) {
+        protocols_ptr = NULL;
+    };
+
     std::ofstream apd;
     if(create_apd) {
         apd.open(descriptor_filename.c_str());
@@ -106,6 +124,7 @@ static bool process_module(const std::string& plugin_filename, bool create_apd)
         if(desc->name == NULL) break;
         if(desc->kind == NULL) break;
         if(desc->instance == NULL) break;
+        const char* protocols = find_protocols((Arc::PluginProtocolsDescriptor*)protocols_ptr, desc);
         if(create_apd) {
             uint32_t priority = map_priority(desc->name, desc->kind);
             apd << "name=" << encode_for_var(desc->name) << std::endl;
@@ -115,6 +134,9 @@ static bool process_module(const std::string& plugin_filename, bool create_apd)
             }
             apd << "version=" << encode_for_var(desc->version) << std::endl;
             apd << "priority=" << encode_for_var(priority) <<  std::endl;
+            if (protocols != NULL) {
+              apd << "protocols=" << encode_for_var(protocols) << std::endl;
+            }
             apd << std::endl; // end of description mark
         } else {
             std::cout << "name: " << desc->name << std::endl;
@@ -123,6 +145,9 @@ static bool process_module(const std::string& plugin_filename, bool create_apd)
               std::cout << "description: " << desc->description << std::endl;
             }
             std::cout << "version: " << desc->version << std::endl;
+            if (protocols != NULL) {
+              std::cout << "protocols: " << protocols << std::endl;
+            }
             std::cout << std::endl;
         };
     };